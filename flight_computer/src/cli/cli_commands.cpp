@@ -24,6 +24,7 @@
 #include "util/battery.hpp"
 #include "util/enum_str_maps.hpp"
 #include "util/log.h"
+#include "util/loop_timing.hpp"
 
 #include <strings.h>
 
@@ -44,6 +45,7 @@ static void cli_cmd_defaults(const char *cmd_name, char *args);
 static void cli_cmd_dump(const char *cmd_name, char *args);
 
 static void cli_cmd_status(const char *cmd_name, char *args);
+static void cli_cmd_timing(const char *cmd_name, char *args);
 static void cli_cmd_version(const char *cmd_name, char *args);
 
 static void cli_cmd_log_enable(const char *cmd_name, char *args);
@@ -80,7 +82,8 @@ const clicmd_t cmd_table[] = {
     CLI_COMMAND_DEF("flash_start_write", "set recorder state to REC_WRITE_TO_FLASH", nullptr, cli_cmd_flash_write),
     CLI_COMMAND_DEF("flash_stop_write", "set recorder state to REC_FILL_QUEUE", nullptr, cli_cmd_flash_stop),
     CLI_COMMAND_DEF("flight_dump", "print a specific flight", "<flight_number>", cli_cmd_dump_flight),
-    CLI_COMMAND_DEF("flight_parse", "print a specific flight", "<flight_number>", cli_cmd_parse_flight),
+    CLI_COMMAND_DEF("flight_parse", "print a specific flight", "<flight_number> [--us] [--filter <types>]",
+                    cli_cmd_parse_flight),
     CLI_COMMAND_DEF("get", "get variable value", "[cmd_name]", cli_cmd_get),
     CLI_COMMAND_DEF("help", "display command help", "[search string]", cli_cmd_help),
     CLI_COMMAND_DEF("lfs_format", "reformat lfs", nullptr, cli_cmd_lfs_format),
@@ -96,6 +99,7 @@ const clicmd_t cmd_table[] = {
 #endif
     CLI_COMMAND_DEF("stats", "print flight stats", "<flight_number>", cli_cmd_print_stats),
     CLI_COMMAND_DEF("status", "show status", nullptr, cli_cmd_status),
+    CLI_COMMAND_DEF("timing", "show task loop timing statistics", "[--reset]", cli_cmd_timing),
     CLI_COMMAND_DEF("version", "show version", nullptr, cli_cmd_version),
 };
 
@@ -407,10 +411,15 @@ static void cli_cmd_status(const char *cmd_name [[maybe_unused]], char *args [[m
   }
   cli_printf("State:       %s\n", GetStr(new_enum, fsm_map));
   cli_printf("Voltage:     %.2fV\n", static_cast<double>(battery_voltage()));
-  cli_printf("h: %.2fm, v: %.2fm/s, a: %.2fm/s^2",
-             static_cast<double>(task::global_state_estimation->GetEstimationOutput().height),
-             static_cast<double>(task::global_state_estimation->GetEstimationOutput().velocity),
-             static_cast<double>(task::global_state_estimation->GetEstimationOutput().acceleration));
+  const estimation_output_t estimation_output = task::global_state_estimation->GetEstimationOutput();
+  cli_printf("h: %.2fm, v: %.2fm/s, a: %.2fm/s^2", static_cast<double>(estimation_output.height),
+             static_cast<double>(estimation_output.velocity), static_cast<double>(estimation_output.acceleration));
+  const filter_consistency_t consistency = task::global_state_estimation->GetFilterConsistency();
+  if (consistency.num_updates > 0) {
+    cli_printf("\nNIS:         mean: %.2f, max: %.2f over %hu updates in %s", static_cast<double>(consistency.nis_mean),
+               static_cast<double>(consistency.nis_max), consistency.num_updates,
+               GetStr(static_cast<flight_fsm_e>(consistency.flight_state), fsm_map));
+  }
 
 #ifdef CATS_DEV
   if (strcmp(args, "--heap") == 0) {
@@ -429,6 +438,46 @@ static void cli_cmd_status(const char *cmd_name [[maybe_unused]], char *args [[m
 #endif
 }
 
+static void cli_cmd_timing(const char *cmd_name [[maybe_unused]], char *args) {
+  if (strcmp(args, "--reset") == 0) {
+    loop_timing_reset();
+    cli_print_line("Loop timing statistics reset.");
+    return;
+  }
+
+#ifdef USE_DATAFLOW_PIPELINE
+  cli_print_line(
+      "Task loop timing in us, lateness is measured from the tick the task should have woken up at, or from the data of "
+      "the previous stage for the tasks it wakes.");
+#else
+  cli_print_line("Task loop timing in us, lateness is measured from the tick the task should have woken up at.");
+#endif
+  for (uint8_t i = 0; i < NUM_LOOP_TIMING_TASKS; i++) {
+    const auto task = static_cast<loop_timing_task_e>(i);
+    const loop_timing_stats_t *stats = loop_timing_get_stats(task);
+    cli_print_linef("\n%s (%lu samples)", loop_timing_task_name(task), stats->execution.count);
+
+    const loop_timing_hist_t *hists[2] = {&stats->lateness, &stats->execution};
+    const char *const hist_names[2] = {"Lateness ", "Execution"};
+    for (uint8_t j = 0; j < 2; j++) {
+      const loop_timing_hist_t *hist = hists[j];
+      cli_printf("  %s  max: %lu, p50: <= %lu, p99: <= %lu\n  ", hist_names[j], hist->max_us,
+                 loop_timing_percentile(hist, 50), loop_timing_percentile(hist, 99));
+      /* Bin k counts the durations below 2^k us, the last bin everything above */
+      for (uint8_t k = 0; k < LOOP_TIMING_NUM_BINS - 1U; k++) {
+        if (hist->bins[k] > 0U) {
+          cli_printf(" <%lu: %lu", 1UL << k, hist->bins[k]);
+        }
+      }
+      const uint8_t last = LOOP_TIMING_NUM_BINS - 1U;
+      if (hist->bins[last] > 0U) {
+        cli_printf(" >=%lu: %lu", 1UL << (last - 1U), hist->bins[last]);
+      }
+      cli_printf("\n");
+    }
+  }
+}
+
 static void cli_cmd_version(const char *cmd_name [[maybe_unused]], char *args [[maybe_unused]]) {
   cli_printf("Board: %s\n", board_name);
   cli_printf("Code version: %s\n", code_version);
@@ -619,8 +668,15 @@ static void cli_cmd_parse_flight(const char *cmd_name [[maybe_unused]], char *ar
     return;
   }
 
-  /* Read filter command */
+  /* Timestamps in us instead of ms */
   ptr = strtok(nullptr, " ");
+  bool print_us = false;
+  if ((ptr != nullptr) && (strcmp(ptr, "--us") == 0)) {
+    print_us = true;
+    ptr = strtok(nullptr, " ");
+  }
+
+  /* Read filter command */
   if (ptr != nullptr) {
     if (strcmp(ptr, "--filter") == 0) {
       /*Read filter types */
@@ -655,6 +711,15 @@ static void cli_cmd_parse_flight(const char *cmd_name [[maybe_unused]], char *ar
         if (strcmp(ptr, "VOLTAGE_INFO") == 0) {
           filter_mask = static_cast<rec_entry_type_e>(filter_mask | VOLTAGE_INFO);
         }
+        if (strcmp(ptr, "LOOP_TIMING_INFO") == 0) {
+          filter_mask = static_cast<rec_entry_type_e>(filter_mask | LOOP_TIMING_INFO);
+        }
+        if (strcmp(ptr, "APOGEE_PREDICTION") == 0) {
+          filter_mask = static_cast<rec_entry_type_e>(filter_mask | APOGEE_PREDICTION);
+        }
+        if (strcmp(ptr, "FILTER_CONSISTENCY") == 0) {
+          filter_mask = static_cast<rec_entry_type_e>(filter_mask | FILTER_CONSISTENCY);
+        }
         ptr = strtok(nullptr, " ");
       }
     } else {
@@ -664,7 +729,7 @@ static void cli_cmd_parse_flight(const char *cmd_name [[maybe_unused]], char *ar
     filter_mask = static_cast<rec_entry_type_e>(UINT32_MAX);
   }
 
-  reader::parse_recording(flight_idx_or_err, filter_mask);
+  reader::parse_recording(flight_idx_or_err, filter_mask, print_us);
 }
 
 static void cli_cmd_print_stats(const char *cmd_name [[maybe_unused]], char *args) {
@@ -24,6 +24,10 @@ const cli_value_t value_table[] = {
      VAR_UINT16,
      {.minmax_unsigned = {10, 65535}},
      offsetof(cats_config_t, control_settings.main_altitude)},
+    {"control_rate",
+     VAR_UINT8 | MODE_LOOKUP,
+     {.lookup = {TABLE_CONTROL_SAMPLING_FREQS}},
+     offsetof(cats_config_t, control_sampling_freq_idx)},
 
     // Timers
     {"timer1_start",
@@ -16,7 +16,14 @@
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
 #define ARRAYLEN(x) (sizeof(x) / sizeof((x)[0]))
 
-enum lookup_table_index_e { TABLE_EVENTS = 0, TABLE_ACTIONS, TABLE_POWER, TABLE_SPEEDS, TABLE_BATTERY };
+enum lookup_table_index_e {
+  TABLE_EVENTS = 0,
+  TABLE_ACTIONS,
+  TABLE_POWER,
+  TABLE_SPEEDS,
+  TABLE_BATTERY,
+  TABLE_CONTROL_SAMPLING_FREQS
+};
 
 inline constexpr uint8_t VALUE_TYPE_OFFSET = 0;
 inline constexpr uint8_t VALUE_SECTION_OFFSET = 3;
@@ -90,8 +97,8 @@ struct cli_value_t {
   callback_f cb;
 } __attribute__((packed));
 
-inline constexpr std::array<EnumToStrMap, 5> lookup_tables{event_map, action_map, on_off_map, recorder_speed_map,
-                                                           battery_map};
+inline constexpr std::array<EnumToStrMap, 6> lookup_tables{
+    event_map, action_map, on_off_map, recorder_speed_map, battery_map, control_sampling_freq_map};
 
 extern const uint16_t value_table_entry_count;
 
@@ -3,6 +3,7 @@
 /// SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "config/cats_config.hpp"
+#include "config/globals.hpp"
 
 #include "flash/lfs_custom.hpp"
 #include "lfs.h"
@@ -48,6 +49,7 @@ const cats_config_t DEFAULT_CONFIG = {
     .buzzer_volume = 100U,
     .battery_type = LI_ION,
     .rec_speed_idx = 0,
+    .control_sampling_freq_idx = 1,  // 100 Hz
     .enable_testing_mode = false,
     /* Assume that when the user starts the board for the first time the default config will be considered theirs. */
     .is_set_by_user = true};
@@ -62,7 +64,7 @@ lfs_file_t config_file;
 
 void cc_init() {
   /* Fill lookup_table_speeds with the string representation of the available speeds. The speeds are placed in the array
-   * in descending order and are dependent on CONTROL_SAMPLING_FREQ. */
+   * in descending order and are dependent on the control sampling frequency, the config needs to be loaded first. */
   init_recorder_speed_map();
 }
 
@@ -121,6 +123,13 @@ bool cc_save() {
   return ret;
 }
 
+uint16_t cc_get_control_sampling_freq() {
+  if (global_cats_config.control_sampling_freq_idx >= NUM_CONTROL_SAMPLING_FREQS) {
+    return DEFAULT_CONTROL_SAMPLING_FREQ;
+  }
+  return CONTROL_SAMPLING_FREQS[global_cats_config.control_sampling_freq_idx];
+}
+
 /**
  * Returns the number of actions configured for an event
  * @param event -
@@ -10,11 +10,14 @@
 #include "util/types.hpp"
 
 /* The system will reload the default config when the number changes */
-constexpr uint32_t CONFIG_VERSION = 212U;
+constexpr uint32_t CONFIG_VERSION = 213U;
 
 /* Number of supported recording speeds */
 constexpr uint8_t NUM_REC_SPEEDS = 10;
 
+/* Number of supported control sampling frequencies */
+constexpr uint8_t NUM_CONTROL_SAMPLING_FREQS = 4;
+
 struct cats_config_t {
   /* Needs to be in first position */
   uint32_t config_version{0};
@@ -33,6 +36,8 @@ struct cats_config_t {
   uint8_t buzzer_volume{0};
   battery_type_e battery_type{LI_ION};
   uint8_t rec_speed_idx{0};  // == inverse recording rate - 1
+  /* Index into CONTROL_SAMPLING_FREQS, applied at boot */
+  uint8_t control_sampling_freq_idx{0};
   /* Testing Mode */
   bool enable_testing_mode{false};
   bool is_set_by_user{false};
@@ -50,6 +55,9 @@ bool cc_load();
 bool cc_save();
 bool cc_format_save();
 
+/** control sampling frequency of the loaded config, falls back to the default for an invalid index **/
+uint16_t cc_get_control_sampling_freq();
+
 /** action map functions **/
 uint16_t cc_get_num_actions(cats_event_e event);
 bool cc_get_action(cats_event_e event, uint16_t act_idx, config_action_t* action);
@@ -7,10 +7,66 @@
 #include <cstdint>
 
 #define USE_MEDIAN_FILTER
-inline constexpr uint8_t MEDIAN_FILTER_SIZE = 9;
+/* The median filter window covers this duration, rounded to an odd number of control steps */
+inline constexpr uint16_t MEDIAN_FILTER_TIME = 90;  // ms
+/* Window length at the highest control sampling frequency */
+inline constexpr uint8_t MEDIAN_FILTER_MAX_SIZE = 23;
+
+/* Control steps the flight state machine watches a condition for, the longest safety time at the highest control
+ * sampling frequency plus one */
+inline constexpr uint16_t FLIGHT_PHASE_WINDOW_SIZE = 251;
+/* Control steps over which the flight state machine checks that the IMU is at rest while calibrating, the stillness
+ * time at the highest control sampling frequency plus one */
+inline constexpr uint16_t STILLNESS_WINDOW_SIZE = 26;
+
+/* Wake Preprocessing, StateEstimation and FlightFsm as soon as the previous stage published new data instead of
+ * running each of them on its own timer */
+// #define USE_DATAFLOW_PIPELINE
+
+/* Run the Kalman filter with precomputed steady state gains, the full filter only runs after a change of the
+ * measurement noise until its gain settled again */
+// #define USE_STEADY_STATE_KALMAN
+inline constexpr uint8_t KALMAN_NUM_STEADY_STATES = 8;
+
+/* Estimate the measurement noise of the barometer while coasting from the innovations of the last steps instead of
+ * deriving it from the velocity */
+// #define USE_ADAPTIVE_MEASUREMENT_NOISE
+/* The innovations of new barometer measurements are averaged over as many of them as there are control steps in this
+ * duration, the barometer delivers at most one per step */
+inline constexpr uint16_t KALMAN_INNOVATION_TIME = 500;  // ms
+/* Window length at the highest control sampling frequency */
+inline constexpr uint8_t KALMAN_INNOVATION_MAX_SIZE = 125;
+
+/* Feed the Kalman filter with the acceleration along the vertical estimated by the orientation filter instead of the
+ * acceleration along the rocket axis corrected by the tilt on the launch pad */
+// #define USE_TILT_COMPENSATION
+
+/* Predict the state with every IMU sample and update it only when the barometer delivered a new measurement, instead
+ * of once per control step with the averaged IMU data. The steady state and tilt compensation modes do not apply. */
+// #define USE_MULTI_RATE_ESTIMATION
+
+/* Fuse the GNSS altitude forwarded by the telemetry MCU in addition to the barometer, with an error state filter that
+ * also estimates the offset between the GNSS altitude and the height AGL. The steady state and multi-rate modes do not
+ * apply. */
+// #define USE_GNSS_FUSION
+
+/* Run the Kalman filter in fixed point, which makes its estimate bit identical between the target and a replay of the
+ * recorded filter inputs (FILTERED_DATA_INFO) and flight phases on a host. The inputs themselves are computed by the
+ * float preprocessing, a replay of the raw sensor records therefore only reproduces the estimate approximately. The
+ * steady state, multi-rate and GNSS modes do not apply, tilt compensation keeps the float orientation filter in the
+ * loop. */
+// #define USE_FIXED_POINT_ESTIMATION
+
+/* The normalized innovation squared of new barometer measurements is averaged over windows of as many measurements as
+ * there are control steps in this duration */
+inline constexpr uint16_t CONSISTENCY_TIME = 1000;  // ms
+/* The bounds of a window mean are the two sided interval of this standard normal quantile for the mean of as many
+ * chi-square samples with one degree of freedom as the window holds, the mean of a consistent filter lies outside of
+ * them in one of 20 windows */
+inline constexpr float CONSISTENCY_NIS_QUANTILE = 1.96F;
 
 inline constexpr float P_INITIAL = 101250.0F;                   // hPa
 inline constexpr float GRAVITY = 9.81F;                         // m/s^2
 inline constexpr float TEMPERATURE_0 = 15.0F;                   // °C
-inline constexpr float BARO_LIFTOFF_MOV_AVG_SIZE = 500.0F;      // samples -> 5 seconds
-inline constexpr float BARO_LIFTOFF_FAST_MOV_AVG_SIZE = 10.0F;  // samples -> 5 seconds
+inline constexpr float BARO_LIFTOFF_MOV_AVG_TIME = 5.0F;        // s
+inline constexpr float BARO_LIFTOFF_FAST_MOV_AVG_TIME = 0.1F;   // s
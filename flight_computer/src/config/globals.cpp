@@ -17,8 +17,10 @@ driver::Servo* global_servo2 = nullptr;
 
 /** State Estimation **/
 
+uint16_t global_control_sampling_freq = DEFAULT_CONTROL_SAMPLING_FREQ;
+
 baro_data_t global_baro_sim[NUM_BARO] = {};
-imu_data_t global_imu_sim[NUM_BARO] = {};
+imu_data_t global_imu_sim[NUM_IMU] = {};
 
 osEventFlagsId_t fsm_flag_id;
 
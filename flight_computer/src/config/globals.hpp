@@ -12,16 +12,26 @@
 #include "target.hpp"
 #include "util/types.hpp"
 
+#include <array>
+
 /** Sampling Frequencies **/
-inline constexpr uint16_t CONTROL_SAMPLING_FREQ = 100;   // in Hz
-inline constexpr uint16_t TELEMETRY_SAMPLING_FREQ = 10;  // in Hz
+/* Control sampling frequencies selectable in the config. The sensor task runs at twice the control sampling frequency,
+ * the tick frequency therefore needs to be a multiple of twice each of them. */
+inline constexpr std::array<uint16_t, NUM_CONTROL_SAMPLING_FREQS> CONTROL_SAMPLING_FREQS = {50, 100, 125, 250};
+inline constexpr uint16_t DEFAULT_CONTROL_SAMPLING_FREQ = 100;  // in Hz
+inline constexpr uint16_t MAX_CONTROL_SAMPLING_FREQ = 250;      // in Hz
+inline constexpr uint16_t HEALTH_MONITOR_SAMPLING_FREQ = 100;   // in Hz
+inline constexpr uint16_t TELEMETRY_SAMPLING_FREQ = 10;         // in Hz
 
 // NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
 
 /** State Estimation **/
 
+/* Control sampling frequency in Hz, taken from the config at boot and fixed afterwards */
+extern uint16_t global_control_sampling_freq;
+
 extern baro_data_t global_baro_sim[NUM_BARO];
-extern imu_data_t global_imu_sim[NUM_BARO];
+extern imu_data_t global_imu_sim[NUM_IMU];
 
 extern osEventFlagsId_t fsm_flag_id;
 
@@ -0,0 +1,44 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "config/stored_calibration.hpp"
+#include "flash/lfs_custom.hpp"
+#include "util/log.h"
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+stored_calibration_t global_stored_calibration = {};
+
+bool calibration_load() {
+  lfs_file_t calibration_file;
+  global_stored_calibration = {};
+  if (lfs_file_open(&lfs, &calibration_file, "calibration", LFS_O_RDONLY) < 0) {
+    log_info("No stored calibration found.");
+    return false;
+  }
+  const bool ret = lfs_file_read(&lfs, &calibration_file, &global_stored_calibration,
+                                 sizeof(global_stored_calibration)) == sizeof(global_stored_calibration);
+  lfs_file_close(&lfs, &calibration_file);
+
+  if (!ret || (global_stored_calibration.version != STORED_CALIBRATION_VERSION)) {
+    log_warn("Stored calibration is invalid!");
+    global_stored_calibration = {};
+    return false;
+  }
+  return true;
+}
+
+bool calibration_save() {
+  lfs_file_t calibration_file;
+  if (lfs_file_open(&lfs, &calibration_file, "calibration", LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC) < 0) {
+    log_error("Error while opening calibration file!");
+    return false;
+  }
+  const bool ret = lfs_file_write(&lfs, &calibration_file, &global_stored_calibration,
+                                  sizeof(global_stored_calibration)) == sizeof(global_stored_calibration);
+  lfs_file_close(&lfs, &calibration_file);
+  if (!ret) {
+    log_error("Error while saving calibration file!");
+  }
+  return ret;
+}
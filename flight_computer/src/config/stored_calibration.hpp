@@ -0,0 +1,32 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "util/types.hpp"
+
+#include <cstdint>
+
+/* The stored calibration is discarded when the number changes */
+inline constexpr uint32_t STORED_CALIBRATION_VERSION = 1U;
+
+/* Result of the last full calibration on the launch pad, used to shorten the calibration after a reboot */
+struct stored_calibration_t {
+  uint32_t version;
+  calibration_data_t calibration;
+  vf32_t acceleration;    // m/s^2, acceleration in the IMU frame at the transition to READY
+  float32_t height_0;     // m ASL
+  float32_t temperature;  // °C, barometer temperature
+  /* There is no clock which survives a power cycle, the flight counter tells whether the rocket flew since */
+  uint32_t flight_counter;
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+extern stored_calibration_t global_stored_calibration;
+
+/* Read the calibration file into global_stored_calibration, its version is zero if there is no valid calibration */
+bool calibration_load();
+
+/* Write global_stored_calibration into the calibration file */
+bool calibration_save();
@@ -0,0 +1,97 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/apogee_predictor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/* Below this ratio of drag to gravity, the closed form solutions are replaced by their Taylor series */
+inline constexpr float32_t SMALL_DRAG_THRESHOLD = 1e-3F;
+
+void reset_apogee_predictor(apogee_predictor_t *predictor, float32_t t_sampl) {
+  predictor->drag_coeff = 0.0F;
+  predictor->drag_coeff_var = APOGEE_INITIAL_DRAG_VARIANCE;
+  predictor->residual_var = APOGEE_INITIAL_RESIDUAL_VARIANCE;
+  predictor->forgetting_factor = 1.0F - t_sampl / APOGEE_FORGETTING_TIME;
+  predictor->num_samples = 0;
+  predictor->min_samples = static_cast<uint16_t>(lroundf(APOGEE_MIN_FIT_TIME / t_sampl));
+}
+
+/* Recursive least squares fit of -(a + g) = k * v^2 with exponential forgetting */
+static void update_drag_fit(apogee_predictor_t *predictor, float32_t velocity, float32_t acceleration) {
+  const float32_t regressor = velocity * velocity;
+  const float32_t deceleration = -(acceleration + GRAVITY);
+
+  const float32_t denominator = predictor->forgetting_factor + predictor->drag_coeff_var * regressor * regressor;
+  const float32_t gain = predictor->drag_coeff_var * regressor / denominator;
+  predictor->drag_coeff += gain * (deceleration - predictor->drag_coeff * regressor);
+  predictor->drag_coeff_var /= denominator;
+
+  const float32_t residual = deceleration - predictor->drag_coeff * regressor;
+  predictor->residual_var += (1.0F - predictor->forgetting_factor) * (residual * residual - predictor->residual_var);
+
+  if (predictor->num_samples < UINT16_MAX) {
+    predictor->num_samples++;
+  }
+}
+
+apogee_prediction_t predict_apogee(apogee_predictor_t *predictor, estimation_output_t state,
+                                   const Matrix<2, 2> &covariance, timestamp_us_t timestamp) {
+  constexpr float32_t tolerance_sq = APOGEE_HEIGHT_TOLERANCE * APOGEE_HEIGHT_TOLERANCE;
+  const float32_t v = state.velocity;
+  if (v <= 0.0F) {
+    /* The apogee is reached, only the estimated height is uncertain */
+    return {.timestamp = timestamp,
+            .height = state.height,
+            .confidence = predictor->num_samples < predictor->min_samples
+                              ? 0.0F
+                              : tolerance_sq / (tolerance_sq + std::max(covariance(0, 0), 0.0F))};
+  }
+
+  update_drag_fit(predictor, v, state.acceleration);
+
+  /* Ballistic flight with quadratic drag, dv/dt = -g - k * v^2, integrated in closed form up to v = 0:
+   *   t = atan(sqrt(u)) / sqrt(u) * v / g and h = ln(1 + u) / u * v^2 / (2 * g) with u = k * v^2 / g */
+  const float32_t k = std::max(predictor->drag_coeff, 0.0F);
+  const float32_t u = k * v * v / GRAVITY;
+  float32_t time_ratio = 0.0F;
+  float32_t height_ratio = 0.0F;
+  float32_t height_ratio_derivative = 0.0F;  // d(height_ratio) / du
+  if (u < SMALL_DRAG_THRESHOLD) {
+    time_ratio = 1.0F - u / 3.0F;
+    height_ratio = 1.0F - u / 2.0F;
+    height_ratio_derivative = -0.5F + 2.0F * u / 3.0F;
+  } else {
+    const float32_t sqrt_u = sqrtf(u);
+    const float32_t log_u = logf(1.0F + u);
+    time_ratio = atanf(sqrt_u) / sqrt_u;
+    height_ratio = log_u / u;
+    height_ratio_derivative = (u / (1.0F + u) - log_u) / (u * u);
+  }
+  const float32_t ballistic_height = v * v / (2.0F * GRAVITY);
+  const float32_t time_to_apogee = time_ratio * v / GRAVITY;
+
+  const float32_t climb = ballistic_height * height_ratio;
+
+  /* The variances of the drag coefficient and of the estimated state are propagated to the height linearly, the model
+   * error is added independently of them */
+  float32_t confidence = 0.0F;
+  if (predictor->num_samples >= predictor->min_samples) {
+    const float32_t drag_coeff_var = predictor->drag_coeff_var * predictor->residual_var;
+    const float32_t drag_sensitivity = ballistic_height * height_ratio_derivative * v * v / GRAVITY;
+    /* d(climb) / dv, u grows with v^2 */
+    const float32_t velocity_sensitivity = v / GRAVITY * (height_ratio + u * height_ratio_derivative);
+    const float32_t state_var = covariance(0, 0) + 2.0F * velocity_sensitivity * covariance(0, 1) +
+                                velocity_sensitivity * velocity_sensitivity * covariance(1, 1);
+    const float32_t model_error = APOGEE_MODEL_ERROR * ballistic_height;
+    const float32_t height_var = drag_sensitivity * drag_sensitivity * drag_coeff_var + std::max(state_var, 0.0F) +
+                                 model_error * model_error;
+    confidence = tolerance_sq / (tolerance_sq + height_var);
+  }
+
+  return {.timestamp = timestamp + static_cast<timestamp_us_t>(time_to_apogee * 1e6F),
+          .height = state.height + climb,
+          .confidence = confidence};
+}
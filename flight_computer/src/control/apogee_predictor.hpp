@@ -0,0 +1,56 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "util/types.hpp"
+
+#include <cstdint>
+
+/* The drag deceleration is modelled as k * v^2, k is fitted to the estimated state while coasting. The air density is
+ * assumed to be constant, at high apogees the prediction is therefore slightly too low. */
+
+// s, time constant of the exponential forgetting of the drag fit, samples lose half of their weight after ~1.4 s
+inline constexpr float32_t APOGEE_FORGETTING_TIME = 2.0F;
+
+// 1/m^2, initial variance of the drag coefficient relative to the residual variance
+inline constexpr float32_t APOGEE_INITIAL_DRAG_VARIANCE = 1.0F;
+
+// (m/s^2)^2, initial variance of the fit residuals
+inline constexpr float32_t APOGEE_INITIAL_RESIDUAL_VARIANCE = 1.0F;
+
+// s, the confidence is zero for the first 0.2 s of coasting
+inline constexpr float32_t APOGEE_MIN_FIT_TIME = 0.2F;
+
+// m, standard deviation of the predicted apogee height for which the confidence is 0.5
+inline constexpr float32_t APOGEE_HEIGHT_TOLERANCE = 10.0F;
+
+// Standard deviation of the predicted apogee height relative to the climb without drag v^2 / (2 * g), an upper bound of
+// the rest of the climb, for the drag which is not quadratic in the velocity and the air density which drops with the
+// height. The predictions for the simulated flights miss by up to 93 % of it shortly after burnout, which are 2.7
+// standard deviations.
+inline constexpr float32_t APOGEE_MODEL_ERROR = 0.35F;
+
+struct apogee_predictor_t {
+  float32_t drag_coeff;      // 1/m
+  float32_t drag_coeff_var;  // variance of the drag coefficient relative to the residual variance
+  float32_t residual_var;    // (m/s^2)^2
+  float32_t forgetting_factor;
+  uint16_t num_samples;
+  uint16_t min_samples;
+};
+
+/* Start a new fit, t_sampl is the time between two calls of predict_apogee in s */
+void reset_apogee_predictor(apogee_predictor_t *predictor, float32_t t_sampl);
+
+/** Add the current estimate to the drag fit and predict the apogee, the cost is constant per step
+ *
+ * @param predictor drag fit, started with reset_apogee_predictor
+ * @param state estimated state
+ * @param covariance covariance of the estimated height and velocity
+ * @param timestamp time of the estimate
+ * @return predicted apogee, the confidence accounts for the fit, the state and the model
+ */
+apogee_prediction_t predict_apogee(apogee_predictor_t *predictor, estimation_output_t state,
+                                   const Matrix<2, 2> &covariance, timestamp_us_t timestamp);
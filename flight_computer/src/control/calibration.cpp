@@ -3,6 +3,8 @@
 /// SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "control/calibration.hpp"
+#include "control/flight_phases.hpp"
+#include "flash/lfs_custom.hpp"
 #include "util/log.h"
 
 void calibrate_imu(const vf32_t *accel_data, calibration_data_t *calibration) {
@@ -94,3 +96,69 @@ void calibrate_gyro(const calibration_data_t *calibration, vf32_t *gyro_data) {
   gyro_data->y = gyro_data->y - calibration->gyro_calib.y;
   gyro_data->z = gyro_data->z - calibration->gyro_calib.z;
 }
+
+void init_warm_start_check(warm_start_check_t *check, const stored_calibration_t *stored, uint16_t min_samples) {
+  *check = {.acc_sum = {},
+            .gyro_sum = {},
+            .height_sum = 0.0F,
+            .num_samples = 0,
+            .min_samples = min_samples,
+            .status = WARM_START_PENDING};
+  if (stored->version != STORED_CALIBRATION_VERSION) {
+    check->status = WARM_START_REJECTED;
+  } else if (stored->flight_counter != flight_counter) {
+    log_info("Stored calibration rejected, a flight was recorded since");
+    check->status = WARM_START_REJECTED;
+  }
+}
+
+static bool is_close(const vf32_t *a, const vf32_t *b, float32_t tolerance) {
+  return (fabsf(a->x - b->x) < tolerance) && (fabsf(a->y - b->y) < tolerance) && (fabsf(a->z - b->z) < tolerance);
+}
+
+warm_start_e check_warm_start(warm_start_check_t *check, const stored_calibration_t *stored, const vf32_t *acc_data,
+                              const vf32_t *gyro_data, float32_t height, float32_t temperature) {
+  if (check->status != WARM_START_PENDING) {
+    return check->status;
+  }
+
+  /* Restart the average while the rocket is handled, the full calibration waits for this as well */
+  if (!is_close(acc_data, &stored->acceleration, ALLOWED_ACC_ERROR) ||
+      !is_close(gyro_data, &stored->calibration.gyro_calib, GYRO_ALLOWED_ERROR_SI)) {
+    check->acc_sum = {};
+    check->gyro_sum = {};
+    check->height_sum = 0.0F;
+    check->num_samples = 0;
+    return check->status;
+  }
+
+  check->acc_sum.x += acc_data->x;
+  check->acc_sum.y += acc_data->y;
+  check->acc_sum.z += acc_data->z;
+  check->gyro_sum.x += gyro_data->x;
+  check->gyro_sum.y += gyro_data->y;
+  check->gyro_sum.z += gyro_data->z;
+  check->height_sum += height;
+  check->num_samples++;
+  if (check->num_samples < check->min_samples) {
+    return check->status;
+  }
+
+  const float32_t inv_n = 1.0F / static_cast<float32_t>(check->num_samples);
+  const vf32_t acc_mean = {.x = check->acc_sum.x * inv_n, .y = check->acc_sum.y * inv_n, .z = check->acc_sum.z * inv_n};
+  const vf32_t gyro_mean = {
+      .x = check->gyro_sum.x * inv_n, .y = check->gyro_sum.y * inv_n, .z = check->gyro_sum.z * inv_n};
+  const float32_t height_mean = check->height_sum * inv_n;
+
+  if (is_close(&acc_mean, &stored->acceleration, WARM_START_ACC_TOLERANCE) &&
+      is_close(&gyro_mean, &stored->calibration.gyro_calib, WARM_START_GYRO_TOLERANCE) &&
+      (fabsf(height_mean - stored->height_0) < WARM_START_HEIGHT_TOLERANCE) &&
+      (fabsf(temperature - stored->temperature) < WARM_START_TEMPERATURE_TOLERANCE)) {
+    log_info("Stored calibration restored");
+    check->status = WARM_START_VALID;
+  } else {
+    log_info("Stored calibration rejected, recalibrating");
+    check->status = WARM_START_REJECTED;
+  }
+  return check->status;
+}
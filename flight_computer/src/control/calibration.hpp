@@ -4,11 +4,55 @@
 
 #pragma once
 
+#include "config/stored_calibration.hpp"
 #include "util/types.hpp"
 
 inline constexpr uint16_t GYRO_NUM_SAME_VALUE = 200;
 inline constexpr float GYRO_ALLOWED_ERROR_SI = 3.0F;
 
+/* A stored calibration is reused if the means over WARM_START_TIME agree with it. The noise of the means is far below
+ * the tolerances, a failed check means that the rocket was moved or the sensors drifted. */
+// ms
+inline constexpr uint16_t WARM_START_TIME = 1000;
+// m/s^2, per axis, corresponds to a tilt of about 1°
+inline constexpr float WARM_START_ACC_TOLERANCE = 0.2F;
+// dps, per axis
+inline constexpr float WARM_START_GYRO_TOLERANCE = 0.5F;
+// m, the weather changes the barometric height by a few meters per hour
+inline constexpr float WARM_START_HEIGHT_TOLERANCE = 10.0F;
+// °C
+inline constexpr float WARM_START_TEMPERATURE_TOLERANCE = 5.0F;
+
+enum warm_start_e : uint8_t { WARM_START_PENDING = 0, WARM_START_VALID, WARM_START_REJECTED };
+
+struct warm_start_check_t {
+  vf32_t acc_sum;
+  vf32_t gyro_sum;
+  float32_t height_sum;
+  uint16_t num_samples;
+  uint16_t min_samples;
+  warm_start_e status;
+};
+
 void calibrate_imu(const vf32_t *accel_data, calibration_data_t *);
 bool compute_gyro_calibration(const vf32_t *gyro_data, calibration_data_t *calibration);
 void calibrate_gyro(const calibration_data_t *calibration, vf32_t *gyro_data);
+
+/* Start checking the stored calibration, min_samples is the number of control steps in WARM_START_TIME */
+void init_warm_start_check(warm_start_check_t *check, const stored_calibration_t *stored, uint16_t min_samples);
+
+/** Compare one sample while calibrating with the stored calibration
+ *
+ * The samples are averaged until min_samples are collected, a sample which deviates as much as movement restarts the
+ * average. The result is final once it is not WARM_START_PENDING anymore.
+ *
+ * @param check state of the check
+ * @param stored calibration to check
+ * @param acc_data acceleration in the IMU frame
+ * @param gyro_data angular rate without the gyro calibration
+ * @param height barometric height ASL
+ * @param temperature barometer temperature
+ * @return status of the check
+ */
+warm_start_e check_warm_start(warm_start_check_t *check, const stored_calibration_t *stored, const vf32_t *acc_data,
+                              const vf32_t *gyro_data, float32_t height, float32_t temperature);
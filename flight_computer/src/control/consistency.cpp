@@ -0,0 +1,63 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/consistency.hpp"
+#include "config/globals.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static_assert(consistency_window_length(CONTROL_SAMPLING_FREQS[0]) > 1, "a window must not end twice in one update");
+static_assert(consistency_window_length(MAX_CONTROL_SAMPLING_FREQ) <= std::numeric_limits<uint8_t>::max(),
+              "the number of updates of a window is stored in a byte");
+
+consistency_bounds_t consistency_nis_bounds(uint8_t num_updates) {
+  /* chi2_n / n is approximately (1 - 2 / (9 n) + z * sqrt(2 / (9 n)))^3 for the standard normal quantile z */
+  const float32_t a = 2.0F / (9.0F * static_cast<float32_t>(num_updates));
+  const float32_t spread = CONSISTENCY_NIS_QUANTILE * sqrtf(a);
+  const float32_t lower = std::max(1.0F - a - spread, 0.0F);
+  const float32_t upper = 1.0F - a + spread;
+  return {.lower = lower * lower * lower, .upper = upper * upper * upper};
+}
+
+static void start_window(consistency_monitor_t *monitor) {
+  monitor->nis_sum = 0.0F;
+  monitor->nis_max = 0.0F;
+  monitor->num_updates = 0;
+  monitor->flight_state = INVALID;
+}
+
+void reset_consistency_monitor(consistency_monitor_t *monitor) {
+  start_window(monitor);
+  monitor->window_length = static_cast<uint8_t>(consistency_window_length(global_control_sampling_freq));
+}
+
+static void close_window(consistency_monitor_t *monitor, filter_consistency_t *window) {
+  window->nis_mean = monitor->nis_sum / static_cast<float32_t>(monitor->num_updates);
+  window->nis_max = monitor->nis_max;
+  window->num_updates = monitor->num_updates;
+  window->flight_state = static_cast<uint8_t>(monitor->flight_state);
+  start_window(monitor);
+}
+
+bool update_consistency(consistency_monitor_t *monitor, float32_t nis, flight_fsm_e flight_state,
+                        filter_consistency_t *window) {
+  bool window_ended = false;
+  if ((monitor->num_updates > 0) && (flight_state != monitor->flight_state)) {
+    close_window(monitor, window);
+    window_ended = true;
+  }
+
+  monitor->flight_state = flight_state;
+  monitor->nis_sum += nis;
+  monitor->nis_max = std::max(monitor->nis_max, nis);
+  monitor->num_updates++;
+
+  if (monitor->num_updates >= monitor->window_length) {
+    close_window(monitor, window);
+    window_ended = true;
+  }
+  return window_ended;
+}
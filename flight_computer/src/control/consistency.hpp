@@ -0,0 +1,65 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "config/control_config.hpp"
+#include "util/types.hpp"
+
+#include <cstddef>
+
+/* The normalized innovation squared (NIS) of a barometer update is nu^2 / S, with the innovation nu and its variance S
+ * predicted by the filter. If the noise parameters describe the actual errors, it is chi-square distributed with one
+ * degree of freedom and its mean is one. A window mean above the upper bound means that the filter is overconfident,
+ * e.g. during the transonic pressure error, a mean below the lower bound that it distrusts the barometer. */
+
+struct consistency_monitor_t {
+  float32_t nis_sum;
+  float32_t nis_max;
+  uint8_t num_updates;
+  /* Updates of a full window */
+  uint8_t window_length;
+  flight_fsm_e flight_state;
+};
+
+struct consistency_bounds_t {
+  float32_t lower;
+  float32_t upper;
+};
+
+/** Get the number of updates of a full window
+ *
+ * @param control_sampling_freq control sampling frequency in Hz
+ * @return number of control steps covering CONSISTENCY_TIME
+ */
+constexpr size_t consistency_window_length(uint16_t control_sampling_freq) {
+  return (static_cast<size_t>(CONSISTENCY_TIME) * control_sampling_freq) / 1000U;
+}
+
+/** Get the bounds of the mean NIS of a consistent filter
+ *
+ * The mean of n chi-square samples with one degree of freedom is chi-square distributed with n degrees of freedom,
+ * divided by n. Its quantiles follow from the Wilson-Hilferty approximation, which gives 0.742 and 1.296 for 100
+ * updates.
+ *
+ * @param num_updates number of updates in the window
+ * @return bounds for CONSISTENCY_NIS_QUANTILE
+ */
+consistency_bounds_t consistency_nis_bounds(uint8_t num_updates);
+
+/* Start a new window, its length follows from the control sampling frequency */
+void reset_consistency_monitor(consistency_monitor_t *monitor);
+
+/** Add the NIS of a new barometer measurement to the current window
+ *
+ * A window ends after window_length updates or early when the flight phase changes.
+ *
+ * @param monitor window state
+ * @param nis normalized innovation squared of the update
+ * @param flight_state flight phase of the update
+ * @param window filled with the statistics of the window that ended, if any
+ * @return true if a window ended
+ */
+bool update_consistency(consistency_monitor_t *monitor, float32_t nis, flight_fsm_e flight_state,
+                        filter_consistency_t *window);
@@ -5,131 +5,62 @@
 #include "control/data_processing.hpp"
 
 #include "config/control_config.hpp"
-
-#include <cstring>
-
-/* a temporary variable "tmp" must be defined beforehand to use these macros */
-// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
-#define SWAP(a, b, tmp) \
-  {                     \
-    (tmp) = (a);        \
-    (a) = (b);          \
-    (b) = (tmp);        \
-  }
-
-// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
-#define SORT_TWO(a, b, tmp)              \
-  {                                      \
-    if ((a) > (b)) SWAP((a), (b), (tmp)) \
+#include "config/globals.hpp"
+
+#include <cmath>
+
+/* Exponent of the barometric formula, R * L / (g * M) */
+inline constexpr float32_t BARO_EXPONENT = 1 / 5.257F;
+
+/* 2^(e * BARO_EXPONENT) for the binary exponents e of the pressure ratio in [BARO_POW_MIN_EXP, BARO_POW_MAX_EXP] */
+inline constexpr int32_t BARO_POW_MIN_EXP = -8;
+inline constexpr int32_t BARO_POW_MAX_EXP = 2;
+inline constexpr float32_t BARO_POW_EXP_TABLE[BARO_POW_MAX_EXP - BARO_POW_MIN_EXP + 1] = {
+    3.482558559e-01F, 3.973389358e-01F, 4.533397709e-01F, 5.172333475e-01F, 5.901320665e-01F, 6.733051098e-01F,
+    7.682005379e-01F, 8.764705003e-01F, 1.000000000e+00F, 1.140939712e+00F, 1.301743426e+00F};
+
+/* Polynomial fit of m^BARO_EXPONENT over the mantissa m in [0.5, 1), in the variable t = 4 * m - 3 in [-1, 1). The
+ * coefficients are those of the powers of t in ascending order, baro_pow evaluates them with the Horner scheme. The
+ * absolute error of the fit is below 1.9e-7. */
+inline constexpr float32_t BARO_POW_COEFFS[] = {9.467467733e-01F,  6.003177464e-02F, -8.102199463e-03F,
+                                                1.621988774e-03F,  -3.794185441e-04F, 1.108446885e-04F,
+                                                -2.986457927e-05F};
+
+/* Computes ratio^BARO_EXPONENT. The ratio is split into mantissa and binary exponent, the exponent is looked up and
+ * the mantissa goes through the polynomial. Ratios from 2^-9 up to 4 (roughly 2 hPa to 4050 hPa for the ground level
+ * pressure) are covered, this includes the whole measurement range of the barometer. Anything outside falls back to
+ * powf. */
+static float32_t baro_pow(float32_t ratio) {
+  int exp = 0;
+  const float32_t mantissa = frexpf(ratio, &exp);
+  if ((ratio <= 0.0F) || (exp < BARO_POW_MIN_EXP) || (exp > BARO_POW_MAX_EXP)) {
+    return powf(ratio, BARO_EXPONENT);
   }
 
-/* this function returns the median of an array of size MEDIAN_FILTER_SIZE
- * it assumes that the size of "input_array" is equal to MEDIAN_FILTER_SIZE */
-// NOLINTNEXTLINE(readability-function-cognitive-complexity)
-float32_t median(float32_t input_array[]) {
-  float32_t array[MEDIAN_FILTER_SIZE];
-  memcpy(array, input_array, MEDIAN_FILTER_SIZE * sizeof(float32_t));
-
-  if constexpr (MEDIAN_FILTER_SIZE == 9) {
-    /* hardwired algorithm - see
-     * https://web.archive.org/web/20060613213236/https://www.xilinx.com/xcell/xl23/xl23_16.pdf
-     */
-    float tmp{0.0F};
-    SORT_TWO(array[1], array[2], tmp);
-    SORT_TWO(array[4], array[5], tmp);
-    SORT_TWO(array[7], array[8], tmp);
-    SORT_TWO(array[0], array[1], tmp);
-    SORT_TWO(array[3], array[4], tmp);
-    SORT_TWO(array[6], array[7], tmp);
-    SORT_TWO(array[1], array[2], tmp);
-    SORT_TWO(array[4], array[5], tmp);
-    SORT_TWO(array[7], array[8], tmp);
-    SORT_TWO(array[0], array[3], tmp);
-    SORT_TWO(array[5], array[8], tmp);
-    SORT_TWO(array[4], array[7], tmp);
-    SORT_TWO(array[3], array[6], tmp);
-    SORT_TWO(array[1], array[4], tmp);
-    SORT_TWO(array[2], array[5], tmp);
-    SORT_TWO(array[4], array[7], tmp);
-    SORT_TWO(array[4], array[2], tmp);
-    SORT_TWO(array[6], array[4], tmp);
-    SORT_TWO(array[4], array[2], tmp);
-    return array[4];
-  } else {
-    /* quickselect algorithm */
-    float a = 0.0F;
-    float tmp = 0.0F;
-    int32_t i = 0;
-    int32_t j = 0;
-    int32_t m = 0;
-    const int32_t k = MEDIAN_FILTER_SIZE >> 1U;
-    int32_t l = 0;
-    int32_t r = MEDIAN_FILTER_SIZE - 1;
-
-    while (r > l + 1) { /* keep iterating until our partition is of size less than two */
-      // NOLINTNEXTLINE(hicpp-signed-bitwise)
-      m = (l + r) >> 1U;
-
-      /* we want the inequalities array[l] <= array[l + 1] <= array[r] to hold */
-      SWAP(array[m], array[l + 1], tmp);
-      SORT_TWO(array[l], array[r], tmp);
-      SORT_TWO(array[l + 1], array[r], tmp);
-      SORT_TWO(array[l], array[l + 1], tmp);
-
-      i = l + 1;
-      j = r;
-      a = array[l + 1];
-
-      while (true) {
-        i++;
-        j--;
-        while (array[i] < a) {
-          i++;
-        }
-        while (array[j] > a) {
-          j--;
-        }
-        if (j < i) {
-          break;
-        }
-        SWAP(array[i], array[j], tmp);
-      }
-
-      array[l + 1] = array[j];
-      array[j] = a;
-
-      /* the partition for the next iteration [l, r] must contain the median */
-      if (j >= k) {
-        r = j - 1;
-      }
-      if (j <= k) {
-        l = i;
-      }
-    }
-
-    /* we have the final partition which is of size 1 or 2 */
-    if (r == l + 1) {
-      SORT_TWO(array[l], array[r], tmp);
-    }
-
-    return array[k];
+  const float32_t t = 4.0F * mantissa - 3.0F;
+  float32_t result = BARO_POW_COEFFS[6];
+  for (int32_t i = 5; i >= 0; i--) {
+    result = result * t + BARO_POW_COEFFS[i];
   }
+  return result * BARO_POW_EXP_TABLE[exp - BARO_POW_MIN_EXP];
 }
 
-/* Todo: Huge Ass comment describing this formula */
+/* Altitude above the reference pressure P_INITIAL from the barometric formula of the ISA troposphere with constant
+ * temperature lapse rate L = 0.0065 K/m:
+ *   h = T_0 / L * (1 - (p / p_0)^(R * L / (g * M)))
+ * The power is evaluated by baro_pow, which deviates from the exact formula by less than 2 cm of altitude over the
+ * measurement range of the barometer (10 hPa to 1200 hPa). */
 float32_t calculate_height(float32_t pressure) {
-  return (-(powf(pressure / P_INITIAL, (1 / 5.257F)) - 1) * (TEMPERATURE_0 + 273.15F) / 0.0065F);
+  return (-(baro_pow(pressure / P_INITIAL) - 1) * (TEMPERATURE_0 + 273.15F) / 0.0065F);
 }
 
-/* Todo: Huge Ass comment describing Barometric Liftoff Detection */
-float32_t approx_moving_average(float32_t data, bool is_transparent) {
-  static float32_t avg = 0;
-  if (is_transparent) {
-    avg -= avg / BARO_LIFTOFF_FAST_MOV_AVG_SIZE;
-    avg += data / BARO_LIFTOFF_FAST_MOV_AVG_SIZE;
-  } else {
-    avg -= avg / BARO_LIFTOFF_MOV_AVG_SIZE;
-    avg += data / BARO_LIFTOFF_MOV_AVG_SIZE;
-  }
-  return avg;
+/* Exponential moving average of the height before liftoff, which serves as the reference for the height AGL. The
+ * averaging time is converted to a number of samples at the control sampling frequency. While calibrating, the short
+ * time lets the average settle quickly. On the launch pad, the long time suppresses the noise of the barometer and
+ * wind gusts, while still following the drift of the ambient pressure. */
+void approx_moving_average(float32_t *avg, float32_t data, bool is_transparent) {
+  const float32_t size = (is_transparent ? BARO_LIFTOFF_FAST_MOV_AVG_TIME : BARO_LIFTOFF_MOV_AVG_TIME) *
+                         static_cast<float32_t>(global_control_sampling_freq);
+  *avg -= *avg / size;
+  *avg += data / size;
 }
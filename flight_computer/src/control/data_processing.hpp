@@ -8,6 +8,6 @@
 
 #include <cstdint>
 
-float32_t median(float32_t input_array[]);
 float32_t calculate_height(float32_t pressure);
-float32_t approx_moving_average(float32_t data, bool is_transparent);
+/* Update the moving average avg with a new value, is_transparent selects the short averaging time */
+void approx_moving_average(float32_t *avg, float32_t data, bool is_transparent);
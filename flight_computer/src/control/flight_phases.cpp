@@ -4,8 +4,24 @@
 
 #include "control/flight_phases.hpp"
 #include "config/cats_config.hpp"
+#include "config/globals.hpp"
+#include "control/calibration.hpp"
 #include "tasks/task_peripherals.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/* Safety time of the transitions checked with the condition window or the height slope */
+inline constexpr uint32_t LONGEST_SAFETY_TIME = std::max(
+    {LIFTOFF_SAFETY_TIME, COASTING_SAFETY_TIME, APOGEE_SAFETY_TIME, MAIN_SAFETY_TIME, TOUCHDOWN_SAFETY_TIME});  // ms
+static_assert(LONGEST_SAFETY_TIME * MAX_CONTROL_SAMPLING_FREQ / 1000U + 1U <= FLIGHT_PHASE_WINDOW_SIZE,
+              "the condition window needs to cover the safety times");
+static_assert(STILLNESS_TIME * MAX_CONTROL_SAMPLING_FREQ / 1000U + 1U <= STILLNESS_WINDOW_SIZE,
+              "the stillness window needs to cover the stillness time");
+static_assert(TIME_THRESHOLD_RESTORED_CALIB_TO_READY >= WARM_START_TIME,
+              "the rocket rests at least as long as the stored calibration was checked");
+
 static void check_calibrating_phase(flight_fsm_t *fsm_state, vf32_t acc_data, vf32_t gyro_data);
 static void check_ready_phase(flight_fsm_t *fsm_state, vf32_t acc_data, const control_settings_t *settings);
 static void check_thrusting_phase(flight_fsm_t *fsm_state, estimation_output_t state_data);
@@ -13,13 +29,19 @@ static void check_coasting_phase(flight_fsm_t *fsm_state, estimation_output_t st
 static void check_drogue_phase(flight_fsm_t *fsm_state, estimation_output_t state_data);
 static void check_main_phase(flight_fsm_t *fsm_state, estimation_output_t state_data);
 
+static uint32_t ms_to_steps(uint16_t duration);
+static uint16_t safety_time(flight_fsm_e flight_state);
+static bool condition_held(flight_fsm_t *fsm_state, float32_t margin);
+static bool imu_at_rest(flight_fsm_t *fsm_state, vf32_t acc_data, vf32_t gyro_data);
 static void clear_fsm_memory(flight_fsm_t *fsm_state);
 static void change_state_to(flight_fsm_e new_state, cats_event_e event_to_trigger, flight_fsm_t *fsm_state);
 
+void init_flight_phase(flight_fsm_t *fsm_state) { clear_fsm_memory(fsm_state); }
+
 void check_flight_phase(flight_fsm_t *fsm_state, vf32_t acc_data, vf32_t gyro_data, estimation_output_t state_data,
                         const control_settings_t *settings) {
   /* Save old FSM State */
-  const flight_fsm_t old_fsm_state = *fsm_state;
+  const flight_fsm_e old_flight_state = fsm_state->flight_state;
 
   /* Check FSM State */
   switch (fsm_state->flight_state) {
@@ -46,29 +68,20 @@ void check_flight_phase(flight_fsm_t *fsm_state, vf32_t acc_data, vf32_t gyro_da
       break;
   }
 
-  fsm_state->state_changed = old_fsm_state.flight_state != fsm_state->flight_state;
+  fsm_state->state_changed = old_flight_state != fsm_state->flight_state;
 }
 
 static void check_calibrating_phase(flight_fsm_t *fsm_state, vf32_t acc_data, vf32_t gyro_data) {
-  /* Check if the IMU moved between two timesteps */
-  /* Add an error bound as the IMU is noisy which is accepted */
-  if ((fabsf(fsm_state->old_acc_data.x - acc_data.x) < ALLOWED_ACC_ERROR) &&
-      (fabsf(fsm_state->old_acc_data.y - acc_data.y) < ALLOWED_ACC_ERROR) &&
-      (fabsf(fsm_state->old_acc_data.z - acc_data.z) < ALLOWED_ACC_ERROR) &&
-      (fabsf(fsm_state->old_gyro_data.x - gyro_data.x) < ALLOWED_GYRO_ERROR) &&
-      (fabsf(fsm_state->old_gyro_data.y - gyro_data.y) < ALLOWED_GYRO_ERROR) &&
-      (fabsf(fsm_state->old_gyro_data.z - gyro_data.z) < ALLOWED_GYRO_ERROR)) {
-    fsm_state->memory[0]++;
-  } else {
-    fsm_state->memory[0] = 0;
+  /* The rest restarts with every movement, it has to last for the threshold without interruption */
+  const timestamp_t now = osKernelGetTickCount();
+  if (!imu_at_rest(fsm_state, acc_data, gyro_data)) {
+    fsm_state->rest_start_time = now;
   }
 
-  /* Update old IMU value */
-  fsm_state->old_acc_data = acc_data;
-  fsm_state->old_gyro_data = gyro_data;
-
   /* Check if we reached the threshold */
-  if (fsm_state->memory[0] > TIME_THRESHOLD_CALIB_TO_READY) {
+  const uint16_t threshold =
+      fsm_state->calibration_restored ? TIME_THRESHOLD_RESTORED_CALIB_TO_READY : TIME_THRESHOLD_CALIB_TO_READY;
+  if ((now - fsm_state->rest_start_time) > threshold) {
     change_state_to(READY, EV_READY, fsm_state);
   }
 }
@@ -80,39 +93,28 @@ static void check_ready_phase(flight_fsm_t *fsm_state, vf32_t acc_data, const co
   const float32_t accel_y = acc_data.y * acc_data.y;
   const float32_t accel_z = acc_data.z * acc_data.z;
   const float32_t acceleration = accel_x + accel_y + accel_z;
+  const float32_t threshold =
+      static_cast<float32_t>(settings->liftoff_acc_threshold) * static_cast<float32_t>(settings->liftoff_acc_threshold);
 
-  if (acceleration > (static_cast<float32_t>(settings->liftoff_acc_threshold) *
-                      static_cast<float32_t>(settings->liftoff_acc_threshold))) {
-    fsm_state->memory[1]++;
-  } else {
-    fsm_state->memory[1] = 0;
-  }
-
-  if (fsm_state->memory[1] > LIFTOFF_SAFETY_COUNTER) {
+  if (condition_held(fsm_state, threshold - acceleration)) {
     change_state_to(THRUSTING, EV_LIFTOFF, fsm_state);
   }
 }
 
 static void check_thrusting_phase(flight_fsm_t *fsm_state, estimation_output_t state_data) {
   /* When acceleration is below 0, liftoff concludes */
-  if (state_data.acceleration < 0) {
-    fsm_state->memory[0]++;
-  } else {
-    fsm_state->memory[0] = 0;
-  }
-
-  if (fsm_state->memory[0] > COASTING_SAFETY_COUNTER) {
+  if (condition_held(fsm_state, state_data.acceleration)) {
     change_state_to(COASTING, EV_MAX_V, fsm_state);
   }
 }
 
 static void check_coasting_phase(flight_fsm_t *fsm_state, estimation_output_t state_data) {
-  /* When velocity is below 0, coasting concludes */
-  if (state_data.velocity < 0) {
-    fsm_state->memory[0]++;
-  }
+  /* When the height decreases, coasting concludes. The line fitted through the heights of the safety time averages the
+   * noise around apogee. A NaN height keeps the slope NaN, which does not conclude coasting, until the sums are
+   * computed again after it left the window. */
+  fsm_state->height_slope.Add(state_data.height);
 
-  if (fsm_state->memory[0] > APOGEE_SAFETY_COUNTER) {
+  if (fsm_state->height_slope.IsFull() && (fsm_state->height_slope.GetSlope() < 0.0F)) {
     /* If the duration between thrusting and apogee is smaller than defined, go to touchdown */
     if ((osKernelGetTickCount() - fsm_state->thrust_trigger_time) < MIN_TICK_COUNTS_BETWEEN_THRUSTING_APOGEE) {
       change_state_to(TOUCHDOWN, EV_TOUCHDOWN, fsm_state);
@@ -124,40 +126,77 @@ static void check_coasting_phase(flight_fsm_t *fsm_state, estimation_output_t st
 
 static void check_drogue_phase(flight_fsm_t *fsm_state, estimation_output_t state_data) {
   /* If the height is smaller than the configured Main height, main deployment needs to be actuated */
-  if (state_data.height < static_cast<float32_t>(global_cats_config.control_settings.main_altitude)) {
-    /* Achieved Height to deploy Main */
-    fsm_state->memory[0]++;
-  } else {
-    /* Did Not Achieve */
-    fsm_state->memory[0] = 0;
-  }
-
-  if (fsm_state->memory[0] > MAIN_SAFETY_COUNTER) {
+  const auto main_altitude = static_cast<float32_t>(global_cats_config.control_settings.main_altitude);
+  if (condition_held(fsm_state, state_data.height - main_altitude)) {
     change_state_to(MAIN, EV_MAIN_DEPLOYMENT, fsm_state);
   }
 }
 
 static void check_main_phase(flight_fsm_t *fsm_state, estimation_output_t state_data) {
   /* If the velocity is very small we have touchdown */
-  if (fabsf(state_data.velocity) < VELOCITY_BOUND_TOUCHDOWN) {
-    /* Touchdown achieved */
-    fsm_state->memory[0]++;
-  } else {
-    /* Touchdown not achieved */
-    fsm_state->memory[0] = 0;
+  if (condition_held(fsm_state, fabsf(state_data.velocity) - VELOCITY_BOUND_TOUCHDOWN)) {
+    change_state_to(TOUCHDOWN, EV_TOUCHDOWN, fsm_state);
   }
+}
 
-  if (fsm_state->memory[0] > TOUCHDOWN_SAFETY_COUNTER) {
-    change_state_to(TOUCHDOWN, EV_TOUCHDOWN, fsm_state);
+/* Number of control steps that last the given duration in ms */
+static uint32_t ms_to_steps(uint16_t duration) {
+  return static_cast<uint32_t>(duration) * global_control_sampling_freq / 1000U;
+}
+
+/* Duration in ms for which the transition condition of the given phase needs to hold */
+static uint16_t safety_time(flight_fsm_e flight_state) {
+  switch (flight_state) {
+    case READY:
+      return LIFTOFF_SAFETY_TIME;
+    case THRUSTING:
+      return COASTING_SAFETY_TIME;
+    case COASTING:
+      return APOGEE_SAFETY_TIME;
+    case DROGUE:
+      return MAIN_SAFETY_TIME;
+    case MAIN:
+      return TOUCHDOWN_SAFETY_TIME;
+    default:
+      return 0;
   }
 }
 
+/* Adds the margin of the transition condition in this step, which is negative if the condition is met. Returns true
+ * once it was met in every step of the safety time, i.e. in one step more than the safety time lasts. A NaN margin,
+ * e.g. from a diverged estimate, does not meet the condition. It compares false with everything and would leave the
+ * window of the maximum with the next value, it is therefore added as the largest possible margin. */
+static bool condition_held(flight_fsm_t *fsm_state, float32_t margin) {
+  fsm_state->condition_margin.Add(std::isnan(margin) ? std::numeric_limits<float32_t>::infinity() : margin);
+  return fsm_state->condition_margin.IsFull() && (fsm_state->condition_margin.Get() < 0.0F);
+}
+
+/* Adds the IMU data of this step to the stillness window. Returns true if the window is full and none of the axes
+ * varied by more than its allowed error in it. A NaN value is added as an infinite range, which counts as movement
+ * until it left the window. */
+static bool imu_at_rest(flight_fsm_t *fsm_state, vf32_t acc_data, vf32_t gyro_data) {
+  const float32_t values[6] = {acc_data.x, acc_data.y, acc_data.z, gyro_data.x, gyro_data.y, gyro_data.z};
+  bool at_rest = true;
+  for (uint8_t i = 0; i < 6; i++) {
+    const bool invalid = std::isnan(values[i]);
+    fsm_state->imu_max[i].Add(invalid ? std::numeric_limits<float32_t>::infinity() : values[i]);
+    fsm_state->imu_min[i].Add(invalid ? -std::numeric_limits<float32_t>::infinity() : values[i]);
+    const float32_t allowed_error = (i < 3) ? ALLOWED_ACC_ERROR : ALLOWED_GYRO_ERROR;
+    at_rest = at_rest && ((fsm_state->imu_max[i].Get() - fsm_state->imu_min[i].Get()) < allowed_error);
+  }
+  return at_rest && fsm_state->imu_max[0].IsFull();
+}
+
 /* Function that needs to be called every time that a state transition is done */
 static void clear_fsm_memory(flight_fsm_t *fsm_state) {
-  fsm_state->clock_memory = 0;
-  fsm_state->memory[0] = 0;
-  fsm_state->memory[1] = 0;
-  fsm_state->memory[2] = 0;
+  const uint32_t safety_steps = ms_to_steps(safety_time(fsm_state->flight_state)) + 1U;
+  fsm_state->condition_margin.Reset(safety_steps);
+  fsm_state->height_slope.Reset(safety_steps);
+  for (uint8_t i = 0; i < 6; i++) {
+    fsm_state->imu_max[i].Reset(ms_to_steps(STILLNESS_TIME) + 1U);
+    fsm_state->imu_min[i].Reset(ms_to_steps(STILLNESS_TIME) + 1U);
+  }
+  fsm_state->rest_start_time = osKernelGetTickCount();
 }
 
 static void change_state_to(flight_fsm_e new_state, cats_event_e event_to_trigger, flight_fsm_t *fsm_state) {
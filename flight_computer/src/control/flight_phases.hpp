@@ -8,34 +8,45 @@
 
 #include <cstdint>
 
+/* The durations below are given in ms, they are converted to control steps for the configured control sampling
+ * frequency */
+
 /* CALIBRATING */
-// num iterations, imu action needs to be 0 for at least 10 seconds
-inline constexpr uint16_t TIME_THRESHOLD_CALIB_TO_READY = 1000;
+// ms, imu action needs to be 0 for at least 10 seconds
+inline constexpr uint16_t TIME_THRESHOLD_CALIB_TO_READY = 10000;
+// ms, imu action needs to be 0 for at least 5 seconds if the stored calibration was restored. The full calibration
+// waits 10 seconds so that the gyro bias is averaged over a rocket at rest, the stored bias was checked over
+// WARM_START_TIME instead. The rest before READY is still needed for the gravity vector, which calibrate_imu takes from
+// the acceleration at the transition, and it has to outlast the pauses while the rocket is handled on the pad.
+inline constexpr uint16_t TIME_THRESHOLD_RESTORED_CALIB_TO_READY = 5000;
+
+// ms, the IMU is at rest if none of its axes varied by more than the allowed errors below within this time
+inline constexpr uint16_t STILLNESS_TIME = 100;
 
-// m/s^2, if the IMU measurement is smaller than 0.6 m/s^2 it is not considered as movement for the transition
+// m/s^2, if the IMU measurement varies by less than 0.6 m/s^2 it is not considered as movement for the transition
 // CALIBRATING -> READY
 inline constexpr float ALLOWED_ACC_ERROR = 0.6F;
 
-// dps, if the GYRO measurement is smaller than 10 dps it is not considered as movement for the transition CALIBRATING
-// -> READY
+// dps, if the GYRO measurement varies by less than 10 dps it is not considered as movement for the transition
+// CALIBRATING -> READY
 inline constexpr float ALLOWED_GYRO_ERROR = 10.0F;
 
 /* READY */
 
-// num iterations, if the acceleration is bigger than the threshold for 0.1 s we detect liftoff
-inline constexpr uint16_t LIFTOFF_SAFETY_COUNTER = 10;
+// ms, if the acceleration is bigger than the threshold for 0.1 s we detect liftoff
+inline constexpr uint16_t LIFTOFF_SAFETY_TIME = 100;
 
 /* THRUSTING */
-// num iterations, acceleration needs to be smaller than 0 for at least 0.1 s for the transition THRUSTING -> COASTING
-inline constexpr uint16_t COASTING_SAFETY_COUNTER = 10;
+// ms, acceleration needs to be smaller than 0 for at least 0.1 s for the transition THRUSTING -> COASTING
+inline constexpr uint16_t COASTING_SAFETY_TIME = 100;
 
 /* COASTING */
-// num iterations, velocity needs to be smaller than 0 for at least 0.3 s for the transition COASTING -> DROGUE
-inline constexpr uint16_t APOGEE_SAFETY_COUNTER = 30;
+// ms, the height fitted over the last 0.3 s needs to decrease for the transition COASTING -> DROGUE
+inline constexpr uint16_t APOGEE_SAFETY_TIME = 300;
 
 /* DROGUE */
-// num iterations, height needs to be smaller than user-defined for at least 0.3 s for the transition DROGUE -> MAIN
-inline constexpr uint16_t MAIN_SAFETY_COUNTER = 30;
+// ms, height needs to be smaller than user-defined for at least 0.3 s for the transition DROGUE -> MAIN
+inline constexpr uint16_t MAIN_SAFETY_TIME = 300;
 // tick counts [ms]
 inline constexpr uint16_t MIN_TICK_COUNTS_BETWEEN_THRUSTING_APOGEE = 1500;
 
@@ -43,8 +54,11 @@ inline constexpr uint16_t MIN_TICK_COUNTS_BETWEEN_THRUSTING_APOGEE = 1500;
 // m/s, velocity needs to be smaller than this to detect touchdown
 inline constexpr float VELOCITY_BOUND_TOUCHDOWN = 3.0F;
 
-// num iterations, for at least 1s it needs to be smaller
-inline constexpr uint16_t TOUCHDOWN_SAFETY_COUNTER = 100;
+// ms, for at least 1s it needs to be smaller
+inline constexpr uint16_t TOUCHDOWN_SAFETY_TIME = 1000;
+
+/* Prepare the memory of the current phase, needs to be called before the first check */
+void init_flight_phase(flight_fsm_t *fsm_state);
 
 /* Function which implements the FSM */
 void check_flight_phase(flight_fsm_t *fsm_state, vf32_t acc_data, vf32_t gyro_data, estimation_output_t state_data,
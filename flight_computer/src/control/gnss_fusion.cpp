@@ -0,0 +1,140 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/gnss_fusion.hpp"
+#include "control/kalman_filter.hpp"
+
+/* Covariance of the Kalman filter states after a reset, as in reset_kalman */
+inline constexpr float32_t GNSS_FUSION_INITIAL_VARIANCE = 0.1F;
+
+void init_gnss_fusion(gnss_fusion_t *fusion, const kalman_filter_t *filter) {
+  /* The GNSS altitude offset is constant apart from its random walk */
+  fusion->F = Matrix<4, 4>::Identity();
+  fusion->Q = {};
+  for (uint8_t row = 0; row < 3; row++) {
+    for (uint8_t col = 0; col < 3; col++) {
+      fusion->F(row, col) = filter->Ad(row, col);
+      fusion->Q(row, col) = filter->GdQGd_T(row, col);
+    }
+  }
+  fusion->Q(3, 3) = GNSS_OFFSET_NOISE * filter->t_sampl;
+
+  reset_gnss_fusion(fusion);
+}
+
+void reset_gnss_fusion(gnss_fusion_t *fusion) {
+  fusion->P = Matrix<4, 4>::Identity() * GNSS_FUSION_INITIAL_VARIANCE;
+  fusion->gnss_offset = 0.0F;
+  fusion->history_index = 0;
+  fusion->history_count = 0;
+  fusion->num_rejections = 0;
+  fusion->offset_initialized = false;
+}
+
+void soft_reset_gnss_fusion(gnss_fusion_t *fusion) {
+  const float32_t offset_var = fusion->P(3, 3);
+  fusion->P = Matrix<4, 4>::Identity() * GNSS_FUSION_INITIAL_VARIANCE;
+  fusion->P(3, 3) = offset_var;
+}
+
+/* Estimate the error state from a scalar innovation and inject it into the nominal state */
+static void correct_error_state(gnss_fusion_t *fusion, kalman_filter_t *filter, const Matrix<4, 1> &K,
+                                const Matrix<1, 4> &HP, float32_t innovation) {
+  const Matrix<4, 1> error = K * innovation;
+  for (uint8_t i = 0; i < 3; i++) {
+    filter->x_bar[i] += error[i];
+  }
+  fusion->gnss_offset += error[3];
+
+  /* The model is linear, the error state is reset to zero without changing the covariance */
+  fusion->P = symmetric_update(fusion->P, K, HP);
+}
+
+void gnss_fusion_step(gnss_fusion_t *fusion, kalman_filter_t *filter, flight_fsm_e flight_state) {
+  update_measurement_noise(filter, flight_state);
+
+  /* Propagate the nominal state and the error covariance */
+  filter->x_hat = filter->Ad * filter->x_bar + filter->Bd * filter->measured_acceleration;
+  filter->x_bar = filter->x_hat;
+  fusion->P = symmetric_product(fusion->F, fusion->P) + fusion->Q;
+
+  /* Barometer update, H = [1 0 0 0] */
+  const Matrix<1, 4> HP = {{fusion->P(0, 0), fusion->P(0, 1), fusion->P(0, 2), fusion->P(0, 3)}};
+  const float32_t S = HP[0] + filter->R;
+  if (S > 0.0F) {
+    const float32_t innovation = filter->measured_AGL - filter->x_hat[0];
+    store_nis(filter, innovation, S);
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+    if (filter->measured_AGL_updated) {
+      record_innovation(filter, innovation, HP[0]);
+    }
+#endif
+    correct_error_state(fusion, filter, HP.Transpose() * (1.0F / S), HP, innovation);
+  }
+
+  constrain_offset(filter, flight_state);
+
+  fusion->history_index = (fusion->history_index + 1U) % GNSS_HISTORY_SIZE;
+  fusion->height_history[fusion->history_index] = filter->x_bar[0];
+  if (fusion->history_count < GNSS_HISTORY_SIZE) {
+    fusion->history_count++;
+  }
+}
+
+bool gnss_fusion_update(gnss_fusion_t *fusion, kalman_filter_t *filter, flight_fsm_e flight_state, float32_t altitude,
+                        float32_t age) {
+  if ((age < 0.0F) || (age > GNSS_MAX_AGE)) {
+    return false;
+  }
+  const auto steps = static_cast<uint16_t>(age / filter->t_sampl + 0.5F);
+  if (steps >= fusion->history_count) {
+    return false;
+  }
+  const float32_t delayed_height =
+      fusion->height_history[(fusion->history_index + GNSS_HISTORY_SIZE - steps) % GNSS_HISTORY_SIZE];
+
+  /* The offset is only observable while the barometer is trusted, i.e. on the launch pad */
+  if (!fusion->offset_initialized) {
+    if (flight_state != READY) {
+      return false;
+    }
+    fusion->gnss_offset = altitude - delayed_height;
+    for (uint8_t i = 0; i < 3; i++) {
+      fusion->P(i, 3) = 0.0F;
+      fusion->P(3, i) = 0.0F;
+    }
+    fusion->P(3, 3) = STD_NOISE_GNSS + fusion->P(0, 0);
+    fusion->num_rejections = 0;
+    fusion->offset_initialized = true;
+    return true;
+  }
+
+  /* The fix measures the height of the delayed state, whose error follows from the current one by running the constant
+   * acceleration model backwards: H = [1 -T T^2/2 1]. The process noise between the two states is neglected. */
+  const float32_t T = static_cast<float32_t>(steps) * filter->t_sampl;
+  const Matrix<1, 4> H = {{1.0F, -T, T * T / 2.0F, 1.0F}};
+  const Matrix<1, 4> HP = H * fusion->P;
+  /* An error of the assumed latency shifts the fix by the distance travelled meanwhile */
+  const float32_t latency_error = filter->x_bar[1] * GNSS_LATENCY_STD;
+  const float32_t S = (HP * H.Transpose())[0] + STD_NOISE_GNSS + latency_error * latency_error;
+  const float32_t innovation = altitude - (delayed_height + fusion->gnss_offset);
+
+  if (innovation * innovation > GNSS_INNOVATION_GATE * S) {
+    /* Single outliers are rejected. A persistent disagreement means a wrong offset before liftoff, e.g. from a fix
+     * taken before the receiver settled, and a diverged height in flight, e.g. while the barometer lags. */
+    fusion->num_rejections++;
+    if (fusion->num_rejections < GNSS_MAX_REJECTIONS) {
+      return false;
+    }
+    if (flight_state == READY) {
+      fusion->offset_initialized = false;
+      return false;
+    }
+  }
+  fusion->num_rejections = 0;
+
+  correct_error_state(fusion, filter, HP.Transpose() * (1.0F / S), HP, innovation);
+  constrain_offset(filter, flight_state);
+  return true;
+}
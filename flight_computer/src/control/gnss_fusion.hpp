@@ -0,0 +1,78 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "config/globals.hpp"
+#include "util/matrix.hpp"
+#include "util/types.hpp"
+
+#include <array>
+#include <cstdint>
+
+/* The nominal height, velocity and acceleration offset are the state of the Kalman filter, which is propagated as
+ * usual. The error state additionally contains the offset of the GNSS altitude above the height AGL, i.e. the GNSS
+ * altitude of the launch pad plus the slowly drifting GNSS bias. The barometer measures the height, the GNSS the height
+ * plus the offset. */
+
+// m^2, 5 m standard deviation of the GNSS altitude, used as measurement noise like STD_NOISE_BARO
+inline constexpr float32_t STD_NOISE_GNSS = 25.0F;
+
+// m^2/s, random walk of the GNSS altitude offset
+inline constexpr float32_t GNSS_OFFSET_NOISE = 0.01F;
+
+// s, time from the GNSS fix to its reception by the telemetry task, NMEA output and UART forwarding included
+inline constexpr float32_t GNSS_LATENCY = 0.3F;
+
+// s, standard deviation of the latency, mostly from polling the UART with TELEMETRY_SAMPLING_FREQ
+inline constexpr float32_t GNSS_LATENCY_STD = 0.03F;
+
+// s, older fixes are dropped
+inline constexpr float32_t GNSS_MAX_AGE = 0.6F;
+
+/* Fixes with fewer satellites are not fused */
+inline constexpr uint8_t GNSS_MIN_SATS = 6;
+
+/* Fixes whose squared innovation exceeds this multiple of its variance are rejected */
+inline constexpr float32_t GNSS_INNOVATION_GATE = 9.0F;
+
+/* After this many consecutive rejected fixes, the GNSS altitude offset is initialized again on the launch pad and the
+ * next fix is fused in flight */
+inline constexpr uint8_t GNSS_MAX_REJECTIONS = 5;
+
+/* Heights of the last steps, enough to look up a fix of the maximum age at the highest control sampling frequency */
+inline constexpr uint16_t GNSS_HISTORY_SIZE = static_cast<uint16_t>(GNSS_MAX_AGE * MAX_CONTROL_SAMPLING_FREQ) + 1U;
+
+struct gnss_fusion_t {
+  /* Error covariance of height, velocity, acceleration offset and GNSS altitude offset */
+  Matrix<4, 4> P;
+  /* Propagation of the error state and its process noise over one control step */
+  Matrix<4, 4> F;
+  Matrix<4, 4> Q;
+  float32_t gnss_offset;  // m, GNSS altitude at zero height AGL
+  /* Nominal height after every step, the newest one at history_index */
+  std::array<float32_t, GNSS_HISTORY_SIZE> height_history;
+  uint16_t history_index;
+  uint16_t history_count;
+  uint8_t num_rejections;
+  bool offset_initialized;
+};
+
+/* Set up the error state model from the discretized model of the Kalman filter */
+void init_gnss_fusion(gnss_fusion_t *fusion, const kalman_filter_t *filter);
+
+/* Forget the GNSS altitude offset and the height history, called together with reset_kalman */
+void reset_gnss_fusion(gnss_fusion_t *fusion);
+
+/* Reset the covariance of the Kalman filter states and keep the GNSS altitude offset, called together with
+ * soft_reset_kalman */
+void soft_reset_gnss_fusion(gnss_fusion_t *fusion);
+
+/* Propagate the state over one control step and fuse the barometer, replaces kalman_step */
+void gnss_fusion_step(gnss_fusion_t *fusion, kalman_filter_t *filter, flight_fsm_e flight_state);
+
+/* Fuse a GNSS altitude which was measured age seconds before the current step. The cost does not depend on the age.
+ * Returns true if the fix was used. */
+bool gnss_fusion_update(gnss_fusion_t *fusion, kalman_filter_t *filter, flight_fsm_e flight_state, float32_t altitude,
+                        float32_t age);
@@ -3,216 +3,287 @@
 /// SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "control/kalman_filter.hpp"
+#include "config/globals.hpp"
 
 #include "util/error_handler.hpp"
 
 #include "cmsis_os.h"
 
-#include <arm_neon.h>
+#include <algorithm>
 #include <cmath>
-#include <cstring>
-
-void init_filter_struct(kalman_filter_t *const filter) {
-  arm_mat_init_f32(&filter->Ad, 3, 3, filter->Ad_data);
-  arm_mat_init_f32(&filter->Ad_T, 3, 3, filter->Ad_T_data);
-  arm_mat_init_f32(&filter->Bd, 3, 1, filter->Bd_data);
-  arm_mat_init_f32(&filter->GdQGd_T, 3, 3, filter->GdQGd_T_data);
-  arm_mat_init_f32(&filter->H, 1, 3, filter->H_data);
-  arm_mat_init_f32(&filter->H_T, 3, 1, filter->H_T_data);
-  arm_mat_init_f32(&filter->K, 3, 1, filter->K_data);
-  arm_mat_init_f32(&filter->x_hat, 3, 1, filter->x_hat_data);
-  arm_mat_init_f32(&filter->x_bar, 3, 1, filter->x_bar_data);
-  arm_mat_init_f32(&filter->P_hat, 3, 3, filter->P_hat_data);
-  arm_mat_init_f32(&filter->P_bar, 3, 3, filter->P_bar_data);
+
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+static_assert(kalman_innovation_window(MAX_CONTROL_SAMPLING_FREQ) <= KALMAN_INNOVATION_MAX_SIZE);
+#endif
+
+#ifdef USE_STEADY_STATE_KALMAN
+/* The recursion converges slowly since the offset is nearly constant, the change of a single step underestimates the
+ * remaining distance by far. The gains are therefore compared over a block of steps: the recursion is considered
+ * converged once the height and velocity gains changed by less than this fraction over the last block. The offset gain
+ * is left out, it is close to zero and follows the other two. */
+inline constexpr uint32_t KALMAN_RICCATI_BLOCK = 1000;
+inline constexpr float32_t KALMAN_RICCATI_TOLERANCE = 1e-4F;
+/* A larger change of the measurement noise between two steps is treated as a change of the regime */
+inline constexpr float32_t KALMAN_R_TRANSITION_RATIO = 0.1F;
+/* The full filter hands over once its height and velocity gains are this close to the tabulated ones */
+inline constexpr float32_t KALMAN_GAIN_TOLERANCE = 0.02F;
+
+static float32_t relative_difference(float32_t a, float32_t b) { return std::fabs(a - b) / std::fabs(b); }
+
+/* Iterate the covariance equations of the filter until the gain for the measurement noise R converged. The
+ * recursion starts from the covariance in steady_state->P_bar. */
+static void compute_steady_state(const kalman_filter_t *filter, float32_t R, kalman_steady_state_t *steady_state) {
+  Matrix<3, 3> P_bar = steady_state->P_bar;
+  Matrix<3, 1> K{};
+  Matrix<3, 1> K_block{};
+  uint32_t i = 0;
+  while (i < KALMAN_MAX_RICCATI_ITERATIONS) {
+    const Matrix<3, 3> P_hat = symmetric_product(filter->Ad, P_bar) + filter->GdQGd_T;
+    const Matrix<1, 3> HP = filter->H * P_hat;
+    K = HP.Transpose() * (1.0F / (HP * filter->H.Transpose() + Matrix<1, 1>{{R}})[0]);
+    P_bar = symmetric_update(P_hat, K, HP);
+    i++;
+
+    if (i % KALMAN_RICCATI_BLOCK == 0) {
+      const float32_t change = std::max(relative_difference(K_block[0], K[0]), relative_difference(K_block[1], K[1]));
+      if (change < KALMAN_RICCATI_TOLERANCE) {
+        break;
+      }
+      K_block = K;
+    }
+  }
+  steady_state->iterations = i;
+  steady_state->R = R;
+  steady_state->K = K;
+  steady_state->P_bar = P_bar;
 }
 
-void initialize_matrices(kalman_filter_t *const filter) {
-  /* Matrix -> mat[9] = [0, 1, 2; 3, 4 , 5; 6, 7, 8];*/
+/* Tabulate the steady states for measurement noises spaced geometrically between the smallest and the largest value
+ * kalman_step uses. Every entry starts from the previous one, which saves most of the iterations. */
+static void compute_steady_states(kalman_filter_t *filter) {
+  const float32_t ratio = STD_NOISE_BARO / STD_NOISE_BARO_INITIAL;
+  kalman_steady_state_t steady_state{};
+  steady_state.P_bar = filter->P_bar;
+  for (uint8_t i = 0; i < KALMAN_NUM_STEADY_STATES; i++) {
+    const float32_t R =
+        STD_NOISE_BARO_INITIAL * powf(ratio, static_cast<float32_t>(i) / (KALMAN_NUM_STEADY_STATES - 1));
+    compute_steady_state(filter, R, &steady_state);
+    filter->steady_states[i] = steady_state;
+  }
+  filter->R_prev = filter->R;
+  filter->steady = false;
+}
 
-  /* Initialize static values */
-  float32_t Ad[9] = {1, filter->t_sampl, filter->t_sampl * filter->t_sampl / 2, 0, 1, filter->t_sampl, 0, 0, 1};
-  arm_matrix_instance_f32 Ad_mat;
-  arm_mat_init_f32(&Ad_mat, 3, 3, Ad);
+/* Find the table entries next to R, the result is clamped to the table */
+static void find_steady_states(const kalman_filter_t *filter, float32_t R, uint8_t *index, float32_t *weight) {
+  const auto &table = filter->steady_states;
+  uint8_t i = 1;
+  while ((i < KALMAN_NUM_STEADY_STATES - 1) && (R > table[i].R)) {
+    i++;
+  }
+  *index = i - 1;
+  *weight = std::clamp((R - table[i - 1].R) / (table[i].R - table[i - 1].R), 0.0F, 1.0F);
+}
 
-  float32_t Ad_T[9] = {1, filter->t_sampl, filter->t_sampl * filter->t_sampl / 2, 0, 1, filter->t_sampl, 0, 0, 1};
-  arm_matrix_instance_f32 Ad_T_mat;
-  arm_mat_init_f32(&Ad_T_mat, 3, 3, Ad_T);
-  arm_mat_trans_f32(&Ad_mat, &Ad_T_mat);
+static Matrix<3, 1> interpolate_gain(const kalman_filter_t *filter, float32_t R) {
+  uint8_t i = 0;
+  float32_t w = 0.0F;
+  find_steady_states(filter, R, &i, &w);
+  return filter->steady_states[i].K * (1.0F - w) + filter->steady_states[i + 1].K * w;
+}
 
-  float32_t Gd[6] = {filter->t_sampl, filter->t_sampl * filter->t_sampl / 2, 1, filter->t_sampl, 0, 1};
-  // float32_t Gd[6] = {filter->t_sampl, 0, 1, 0, 0, 0};
-  arm_matrix_instance_f32 Gd_mat;
-  arm_mat_init_f32(&Gd_mat, 3, 2, Gd);
+static Matrix<3, 3> interpolate_covariance(const kalman_filter_t *filter, float32_t R) {
+  uint8_t i = 0;
+  float32_t w = 0.0F;
+  find_steady_states(filter, R, &i, &w);
+  return filter->steady_states[i].P_bar * (1.0F - w) + filter->steady_states[i + 1].P_bar * w;
+}
 
-  float32_t Gd_T[6];
-  arm_matrix_instance_f32 Gd_T_mat;
-  arm_mat_init_f32(&Gd_T_mat, 2, 3, Gd_T);
-  arm_mat_trans_f32(&Gd_mat, &Gd_T_mat);
+/* Prediction and update with the tabulated gain, the covariance is not propagated */
+static void kalman_steady_state_step(kalman_filter_t *filter) {
+  const bool transition = std::fabs(filter->R - filter->R_prev) > KALMAN_R_TRANSITION_RATIO * filter->R_prev;
+  if (filter->steady && transition) {
+    /* The full filter continues from the steady state of the previous regime */
+    filter->P_bar = interpolate_covariance(filter, filter->R_prev);
+    filter->steady = false;
+  }
+  filter->R_prev = filter->R;
+
+  const Matrix<3, 1> K = interpolate_gain(filter, filter->R);
+  if (!filter->steady) {
+    kalman_prediction(filter);
+    kalman_update(filter);
+    filter->steady = (relative_difference(filter->K[0], K[0]) < KALMAN_GAIN_TOLERANCE) &&
+                     (relative_difference(filter->K[1], K[1]) < KALMAN_GAIN_TOLERANCE);
+    return;
+  }
 
-  float32_t Bd[3] = {filter->t_sampl * filter->t_sampl / 2, filter->t_sampl, 0};
-  arm_matrix_instance_f32 Bd_mat;
-  arm_mat_init_f32(&Bd_mat, 3, 1, Bd);
+  filter->K = K;
+  filter->x_hat = filter->Ad * filter->x_bar + filter->Bd * filter->measured_acceleration;
+  const float32_t innovation = filter->measured_AGL - filter->x_hat[0];
+  filter->x_bar = filter->x_hat + filter->K * innovation;
+  /* K[0] = H*P_hat*H' / (H*P_hat*H' + R) */
+  store_nis(filter, innovation, filter->R / (1.0F - K[0]));
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+  if (filter->measured_AGL_updated) {
+    record_innovation(filter, innovation, K[0] * filter->R / (1.0F - K[0]));
+  }
+#endif
+}
+#endif
 
-  float32_t H[3] = {1, 0, 0};
-  arm_matrix_instance_f32 H_mat;
-  arm_mat_init_f32(&H_mat, 1, 3, H);
+/* The acceleration and the offset noise are treated as random walks whose variances grow linearly with time, they are
+ * scaled from the tuning period to dt */
+Matrix<3, 3> kalman_process_noise(float32_t dt) {
+  const Matrix<3, 2> Gd = {{dt, dt * dt / 2, 1, dt, 0, 1}};
+  // const Matrix<3, 2> Gd = {{dt, 0, 1, 0, 0, 0}};
 
-  float32_t H_T[3] = {1, 0, 0};
-  arm_matrix_instance_f32 H_T_mat;
-  arm_mat_init_f32(&H_T_mat, 3, 1, H_T);
+  const Matrix<2, 2> Q = Matrix<2, 2>{{STD_NOISE_IMU, 0, 0, STD_NOISE_OFFSET}} * (dt / KALMAN_NOISE_TUNING_PERIOD);
 
-  float32_t Q[4] = {STD_NOISE_IMU, 0, 0, STD_NOISE_OFFSET};
-  arm_matrix_instance_f32 Q_mat;
-  arm_mat_init_f32(&Q_mat, 2, 2, Q);
+  return symmetric_product(Gd, Q);
+}
 
-  float32_t GdQGd_T[9];
-  arm_matrix_instance_f32 GdQGd_T_mat;
-  arm_mat_init_f32(&GdQGd_T_mat, 3, 3, GdQGd_T);
+/* Covariance of the noise the model collects over dt. The acceleration noise drives the velocity and the offset is a
+ * random walk, both white with the spectral densities q_acc and q_offset. Integrating
+ *   Qd = int_0^dt e^(A t) G Qc G' e^(A' t) dt,  e^(A t) G = [t t^2/2; 1 t; 0 1],  Qc = diag(q_acc, q_offset)
+ * term by term gives the polynomials below. */
+Matrix<3, 3> kalman_exact_process_noise(float32_t dt) {
+  const float32_t q_acc = STD_NOISE_IMU / KALMAN_NOISE_TUNING_PERIOD;
+  const float32_t q_offset = STD_NOISE_OFFSET / KALMAN_NOISE_TUNING_PERIOD;
+  const float32_t dt2 = dt * dt;
+  const float32_t dt3 = dt2 * dt;
+  const float32_t dt4 = dt3 * dt;
+  const float32_t dt5 = dt4 * dt;
+
+  const float32_t hh = q_acc * dt3 / 3 + q_offset * dt5 / 20;
+  const float32_t hv = q_acc * dt2 / 2 + q_offset * dt4 / 8;
+  const float32_t ho = q_offset * dt3 / 6;
+  const float32_t vv = q_acc * dt + q_offset * dt3 / 3;
+  const float32_t vo = q_offset * dt2 / 2;
+  const float32_t oo = q_offset * dt;
+  return {{hh, hv, ho, hv, vv, vo, ho, vo, oo}};
+}
 
-  float32_t holder[6];
-  arm_matrix_instance_f32 holder_mat;
-  arm_mat_init_f32(&holder_mat, 3, 2, holder);
+void kalman_discretize(kalman_filter_t *filter, float32_t dt, bool exact_noise) {
+  filter->dt = dt;
+  filter->exact_noise = exact_noise;
 
-  arm_mat_mult_f32(&Gd_mat, &Q_mat, &holder_mat);
-  arm_mat_mult_f32(&holder_mat, &Gd_T_mat, &GdQGd_T_mat);
+  filter->Ad = {{1, dt, dt * dt / 2, 0, 1, dt, 0, 0, 1}};
 
-  float32_t x_bar[3] = {0, 0, 0};
-  arm_matrix_instance_f32 x_bar_mat;
-  arm_mat_init_f32(&x_bar_mat, 3, 1, x_bar);
+  filter->Bd = {{dt * dt / 2, dt, 0}};
 
-  float32_t x_hat[3] = {0, 0, 0};
-  arm_matrix_instance_f32 x_hat_mat;
-  arm_mat_init_f32(&x_hat_mat, 3, 1, x_hat);
+  filter->GdQGd_T = exact_noise ? kalman_exact_process_noise(dt) : kalman_process_noise(dt);
+}
 
-  float32_t K[3] = {0, 0, 0};
-  arm_matrix_instance_f32 K_mat;
-  arm_mat_init_f32(&K_mat, 3, 1, K);
+void initialize_matrices(kalman_filter_t *const filter) {
+  /* Initialize static values */
+  kalman_discretize(filter, filter->t_sampl);
 
-  float32_t P_hat[9] = {0.1F, 0, 0, 0, 0.1F, 0, 0, 0, 0.1F};
-  arm_matrix_instance_f32 P_hat_mat;
-  arm_mat_init_f32(&P_hat_mat, 3, 3, P_hat);
+  filter->H = {{1, 0, 0}};
 
-  float32_t P_bar[9] = {0.1F, 0, 0, 0, 0.1F, 0, 0, 0, 0.1F};
-  arm_matrix_instance_f32 P_bar_mat;
-  arm_mat_init_f32(&P_bar_mat, 3, 3, P_bar);
+  filter->x_bar = {};
+  filter->x_hat = {};
+  filter->K = {};
+  filter->P_hat = Matrix<3, 3>::Identity() * 0.1F;
+  filter->P_bar = Matrix<3, 3>::Identity() * 0.1F;
 
   filter->R = STD_NOISE_BARO;
-  memcpy(filter->Ad_data, Ad, sizeof(Ad));
-  memcpy(filter->Ad_T_data, Ad_T, sizeof(Ad_T));
-  memcpy(filter->Bd_data, Bd, sizeof(Bd));
-  memcpy(filter->GdQGd_T_data, GdQGd_T, sizeof(GdQGd_T));
-  memcpy(filter->H_data, H, sizeof(H));
-  memcpy(filter->H_T_data, H_T, sizeof(H_T));
-  memcpy(filter->K_data, K, sizeof(K));
-  memcpy(filter->x_bar_data, x_bar, sizeof(x_bar));
-  memcpy(filter->x_hat_data, x_hat, sizeof(x_hat));
-  memcpy(filter->P_bar_data, P_bar, sizeof(P_bar));
-  memcpy(filter->P_hat_data, P_hat, sizeof(P_hat));
+
+#ifdef USE_STEADY_STATE_KALMAN
+  compute_steady_states(filter);
+#endif
 }
 
 void reset_kalman(kalman_filter_t *filter) {
   log_debug("Resetting Kalman Filter...");
-  float32_t x_dash[3] = {0.0F, 10.0F, 0.0F};
-  float32_t P_dash[9] = {0.1F, 0.0F, 0.0F, 0.0F, 0.1F, 0.0F, 0.0F, 0.0F, 0.1F};
-
-  memcpy(filter->x_bar_data, x_dash, sizeof(x_dash));
-  memcpy(filter->x_bar_data, x_dash, sizeof(x_dash));
-  memcpy(filter->P_bar_data, P_dash, sizeof(P_dash));
-  memcpy(filter->P_bar_data, P_dash, sizeof(P_dash));
+  filter->x_bar = {{0.0F, 10.0F, 0.0F}};
+  filter->P_bar = Matrix<3, 3>::Identity() * 0.1F;
+#ifdef USE_STEADY_STATE_KALMAN
+  filter->steady = false;
+#endif
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+  filter->innovations.Reset(kalman_innovation_window(global_control_sampling_freq));
+#endif
 }
 
 void soft_reset_kalman(kalman_filter_t *filter) {
   log_debug("Resetting Kalman Filter...");
-  float32_t P_dash[9] = {0.1F, 0.0F, 0.0F, 0.0F, 0.1F, 0.0F, 0.0F, 0.0F, 0.1F};
-
-  memcpy(filter->P_hat_data, P_dash, sizeof(P_dash));
-  memcpy(filter->P_bar_data, P_dash, sizeof(P_dash));
+  filter->P_hat = Matrix<3, 3>::Identity() * 0.1F;
+  filter->P_bar = Matrix<3, 3>::Identity() * 0.1F;
+#ifdef USE_STEADY_STATE_KALMAN
+  filter->steady = false;
+#endif
 }
 
 /* This Function Implements the kalman Prediction as long as more than 0 IMU
  * work */
 void kalman_prediction(kalman_filter_t *filter) {
-  float32_t holder_data[3];
-  arm_matrix_instance_f32 holder_vec;
-  arm_mat_init_f32(&holder_vec, 3, 1, holder_data);
-
-  float32_t holder2_data[3];
-  arm_matrix_instance_f32 holder2_vec;
-  arm_mat_init_f32(&holder2_vec, 3, 1, holder2_data);
-
-  float32_t holder[9];
-  arm_matrix_instance_f32 holder_mat;
-  arm_mat_init_f32(&holder_mat, 3, 3, holder);
-
-  float32_t holder2[9];
-  arm_matrix_instance_f32 holder2_mat;
-  arm_mat_init_f32(&holder2_mat, 3, 3, holder2);
-
   /* Prediction Step */
 
   /* Calculate Prediction of the state: x_hat = A*x_bar + B*u */
-  arm_mat_mult_f32(&filter->Ad, &filter->x_bar, &holder_vec);
-  arm_mat_scale_f32(&filter->Bd, filter->measured_acceleration, &holder2_vec);
-  arm_mat_add_f32(&holder_vec, &holder2_vec, &filter->x_hat);
+  filter->x_hat = filter->Ad * filter->x_bar + filter->Bd * filter->measured_acceleration;
 
   /* Update the Variance of the state P_hat = A*P_bar*A' + GQG' */
-  arm_mat_mult_f32(&filter->Ad, &filter->P_bar, &holder_mat);
-  arm_mat_mult_f32(&holder_mat, &filter->Ad_T, &holder2_mat);
-  arm_mat_add_f32(&holder2_mat, &filter->GdQGd_T, &filter->P_hat);
+  filter->P_hat = symmetric_product(filter->Ad, filter->P_bar) + filter->GdQGd_T;
 
   /* Prediction Step finished */
 }
 
 /* This function implements the Kalman update when no Barometer is faulty */
 void kalman_update(kalman_filter_t *filter) {
-  float32_t holder_single[1];
-  arm_matrix_instance_f32 holder_single_mat;
-  arm_mat_init_f32(&holder_single_mat, 1, 1, holder_single);
-
-  float32_t holder2_data[3];
-  arm_matrix_instance_f32 holder2_vec;
-  arm_mat_init_f32(&holder2_vec, 3, 1, holder2_data);
-
-  float32_t holder_0_1x3[3];
-  arm_matrix_instance_f32 holder_0_1x3_mat;
-  arm_mat_init_f32(&holder_0_1x3_mat, 1, 3, holder_0_1x3);
-
   /* Update Step */
 
-  /* Calculate K = P_hat*H_T*(H*P_Hat*H_T+R)^-1 */
-  arm_mat_mult_f32(&filter->H, &filter->P_hat, &holder_0_1x3_mat);
-  arm_mat_mult_f32(&holder_0_1x3_mat, &filter->H_T, &holder_single_mat);
-  holder_single[0] += filter->R;
-
-  arm_mat_mult_f32(&filter->P_hat, &filter->H_T, &holder2_vec);
-  arm_mat_scale_f32(&holder2_vec, 1.0F / holder_single[0], &filter->K);
+  /* Calculate K = P_hat*H_T*(H*P_Hat*H_T+R)^-1, P_hat is symmetric and therefore P_hat*H_T = (H*P_hat)' */
+  const Matrix<1, 3> HP = filter->H * filter->P_hat;
+  Matrix<1, 1> S = HP * filter->H.Transpose();
+  S[0] += filter->R;
+  Matrix<1, 1> S_inv;
+  if (!inverse(S, S_inv)) {
+    /* Skip the measurement, the prediction is kept */
+    filter->x_bar = filter->x_hat;
+    filter->P_bar = filter->P_hat;
+    return;
+  }
+  filter->K = HP.Transpose() * S_inv;
 
   /* Calculate x_bar = x_hat+K*(y-Hx_hat); */
+  const Matrix<1, 1> innovation = Matrix<1, 1>{{filter->measured_AGL}} - filter->H * filter->x_hat;
+  filter->x_bar = filter->x_hat + filter->K * innovation;
+  store_nis(filter, innovation[0], S[0]);
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+  if (filter->measured_AGL_updated) {
+    record_innovation(filter, innovation[0], HP[0]);
+  }
+#endif
 
-  arm_mat_mult_f32(&filter->H, &filter->x_hat, &holder_single_mat);
-  arm_mat_scale_f32(&filter->K, filter->measured_AGL - holder_single[0], &holder2_vec);
-  arm_mat_add_f32(&holder2_vec, &filter->x_hat, &filter->x_bar);
-
-  /* Finished Calculating x_bar */
-
-  /* Calculate P_bar = (eye-K*H)*P_hat */
-  float32_t eye[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
-  arm_matrix_instance_f32 eye_mat;
-  arm_mat_init_f32(&eye_mat, 3, 3, eye);
-  float32_t holder_3x3[9];
-  arm_matrix_instance_f32 holder_3x3_mat;
-  arm_mat_init_f32(&holder_3x3_mat, 3, 3, holder_3x3);
-  float32_t holder2_3x3[9];
-  arm_matrix_instance_f32 holder2_3x3_mat;
-  arm_mat_init_f32(&holder2_3x3_mat, 3, 3, holder2_3x3);
-
-  arm_mat_mult_f32(&filter->K, &filter->H, &holder_3x3_mat);
-  arm_mat_sub_f32(&eye_mat, &holder_3x3_mat, &holder2_3x3_mat);
-  arm_mat_mult_f32(&holder2_3x3_mat, &filter->P_hat, &filter->P_bar);
+  /* Calculate P_bar = (eye-K*H)*P_hat = P_hat - K*(H*P_hat) */
+  filter->P_bar = symmetric_update(filter->P_hat, filter->K, HP);
 }
 
+void store_nis(kalman_filter_t *filter, float32_t innovation, float32_t innovation_variance) {
+  /* The innovation of a held measurement is correlated with that of its first update, the chi-square bounds of the
+   * window mean assume independent samples */
+  if (!filter->measured_AGL_updated) {
+    return;
+  }
+  filter->nis = innovation * innovation / innovation_variance;
+  filter->nis_updated = true;
+}
+
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+void record_innovation(kalman_filter_t *filter, float32_t innovation, float32_t predicted_variance) {
+  filter->innovations.Add(innovation * innovation - predicted_variance);
+}
+
+/* Measurement noise which explains the spread of the innovations: E[v*v'] = H*P_hat*H' + R */
+static float32_t adaptive_measurement_noise(const kalman_filter_t *filter) {
+  if (filter->innovations.GetCount() == 0U) {
+    return KALMAN_ADAPTIVE_R_MAX;
+  }
+  return std::clamp(filter->innovations.GetMean(), KALMAN_ADAPTIVE_R_MIN, KALMAN_ADAPTIVE_R_MAX);
+}
+#else
 float32_t R_interpolation(float32_t velocity) {
-  /* Todo: Can be optimized */
   const float32_t lower_bound = 20.0F;
   const float32_t upper_bound = 100.0F;
   const float32_t f_lower_bound = 0.3981F;
@@ -220,17 +291,20 @@ float32_t R_interpolation(float32_t velocity) {
 
   const float32_t m = (f_lower_bound - f_upper_bound) / (lower_bound - upper_bound);
   const float32_t b = f_upper_bound - m * upper_bound;
+  /* The factor is raised to the fifth power, f_lower_bound^5 is 0.01 */
+  float32_t f = f_upper_bound;
   if (velocity < lower_bound) {
-    return powf(f_lower_bound, 5.0F);
-  }
-  if (velocity < upper_bound) {
-    return powf(m * velocity + b, 5.0F);
+    f = f_lower_bound;
+  } else if (velocity < upper_bound) {
+    f = m * velocity + b;
   }
-  return f_upper_bound;
+  const float32_t f2 = f * f;
+  return f2 * f2 * f;
 }
+#endif
 
-void kalman_step(kalman_filter_t *filter, flight_fsm_e flight_state) {
-  /* Update IMU trust value based on flight phase */
+/* Update IMU trust value based on flight phase */
+void update_measurement_noise(kalman_filter_t *filter, flight_fsm_e flight_state) {
   switch (flight_state) {
     case READY:
     case CALIBRATING:
@@ -240,7 +314,11 @@ void kalman_step(kalman_filter_t *filter, flight_fsm_e flight_state) {
       filter->R = STD_NOISE_BARO;
       break;
     case COASTING:
-      filter->R = STD_NOISE_BARO * R_interpolation(filter->x_bar_data[1]);
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+      filter->R = adaptive_measurement_noise(filter);
+#else
+      filter->R = STD_NOISE_BARO * R_interpolation(filter->x_bar[1]);
+#endif
       break;
     default:
       break;
@@ -250,18 +328,54 @@ void kalman_step(kalman_filter_t *filter, flight_fsm_e flight_state) {
   if (get_error_by_tag(CATS_ERR_FILTER_ACC)) {
     filter->R = STD_NOISE_BARO_INITIAL;
   }
+}
 
-  kalman_prediction(filter);
-
-  kalman_update(filter);
-
+void constrain_offset(kalman_filter_t *filter, flight_fsm_e flight_state) {
   /* Do not update offset estimation if we took off */
   if (flight_state >= THRUSTING) {
-    filter->x_bar_data[2] = filter->x_hat_data[2];
+    filter->x_bar[2] = filter->x_hat[2];
   }
 
   /* Do not use offset estimation while descending */
   if (flight_state >= DROGUE) {
-    filter->x_bar_data[2] = 0;
+    filter->x_bar[2] = 0;
   }
 }
+
+void kalman_step(kalman_filter_t *filter, flight_fsm_e flight_state) {
+  update_measurement_noise(filter, flight_state);
+
+#ifdef USE_STEADY_STATE_KALMAN
+  kalman_steady_state_step(filter);
+#else
+  kalman_prediction(filter);
+
+  kalman_update(filter);
+#endif
+
+  constrain_offset(filter, flight_state);
+}
+
+void kalman_multi_rate_step(kalman_filter_t *filter, flight_fsm_e flight_state, const float32_t *accelerations,
+                            uint8_t num_accelerations, float32_t dt, bool height_updated) {
+  update_measurement_noise(filter, flight_state);
+
+  /* The step follows the jitter of the IMU timestamps, the model is only discretized anew for a noticeable change */
+  if (!filter->exact_noise || (std::fabs(dt - filter->dt) > KALMAN_DT_TOLERANCE * filter->dt)) {
+    kalman_discretize(filter, dt, true);
+  }
+
+  /* Propagate the state over every IMU sample, the prediction of one sample is the starting point of the next */
+  for (uint8_t i = 0; i < num_accelerations; i++) {
+    filter->measured_acceleration = accelerations[i];
+    kalman_prediction(filter);
+    filter->x_bar = filter->x_hat;
+    filter->P_bar = filter->P_hat;
+  }
+
+  if (height_updated) {
+    kalman_update(filter);
+  }
+
+  constrain_offset(filter, flight_state);
+}
@@ -22,10 +22,34 @@ inline constexpr float STD_NOISE_IMU = 0.004F;
 
 inline constexpr float STD_NOISE_OFFSET = 0.000001F;
 
-void init_filter_struct(kalman_filter_t *filter);
+// Limits of the measurement noise estimated from the innovations, the same range the flight phases use otherwise
+inline constexpr float KALMAN_ADAPTIVE_R_MIN = STD_NOISE_BARO_INITIAL;
+inline constexpr float KALMAN_ADAPTIVE_R_MAX = STD_NOISE_BARO;
+
+// s, STD_NOISE_IMU and STD_NOISE_OFFSET are the variances collected over one step of this period. kalman_step scales
+// them to its sampling period, kalman_multi_rate_step divides them by it to get the spectral densities of the
+// continuous noise
+inline constexpr float KALMAN_NOISE_TUNING_PERIOD = 0.01F;
+
+// Relative change of the step of kalman_multi_rate_step below which the discretized model is kept
+inline constexpr float KALMAN_DT_TOLERANCE = 0.01F;
+
+#ifdef USE_STEADY_STATE_KALMAN
+// Iterations of the Riccati recursion per tabulated measurement noise
+inline constexpr uint32_t KALMAN_MAX_RICCATI_ITERATIONS = 50000;
+#endif
 
 void initialize_matrices(kalman_filter_t *filter);
 
+/* Covariance of the process noise over a step of dt seconds as tuned for kalman_step */
+Matrix<3, 3> kalman_process_noise(float32_t dt);
+
+/* Covariance of the process noise over a step of dt seconds, integrated exactly from the continuous noise */
+Matrix<3, 3> kalman_exact_process_noise(float32_t dt);
+
+/* Discretize the process model for a step of dt seconds, kalman_multi_rate_step uses the exact process noise */
+void kalman_discretize(kalman_filter_t *filter, float32_t dt, bool exact_noise = false);
+
 void kalman_prediction(kalman_filter_t *filter);
 
 void reset_kalman(kalman_filter_t *filter);
@@ -34,4 +58,33 @@ void soft_reset_kalman(kalman_filter_t *filter);
 
 void kalman_update(kalman_filter_t *filter);
 
+/* Store the normalized innovation squared of a barometer update, innovation_variance is H*P_hat*H' + R. Updates with a
+ * held measurement are skipped. */
+void store_nis(kalman_filter_t *filter, float32_t innovation, float32_t innovation_variance);
+
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+/** Get the length of the innovation window
+ *
+ * @param control_sampling_freq control sampling frequency in Hz
+ * @return number of control steps covering KALMAN_INNOVATION_TIME
+ */
+constexpr size_t kalman_innovation_window(uint16_t control_sampling_freq) {
+  return (static_cast<size_t>(KALMAN_INNOVATION_TIME) * control_sampling_freq) / 1000U;
+}
+
+/* Add the innovation of a barometer update to the window, predicted_variance is H*P_hat*H' of the update. Only called
+ * for new measurements, a held one would enter the window again with the innovation left after its first update. */
+void record_innovation(kalman_filter_t *filter, float32_t innovation, float32_t predicted_variance);
+#endif
+
+/* Set the measurement noise of the barometer for the flight phase */
+void update_measurement_noise(kalman_filter_t *filter, flight_fsm_e flight_state);
+
+/* Freeze the acceleration offset after liftoff and drop it while descending */
+void constrain_offset(kalman_filter_t *filter, flight_fsm_e flight_state);
+
 void kalman_step(kalman_filter_t *filter, flight_fsm_e flight_state);
+
+/* One prediction per IMU sample, each dt seconds long, followed by a measurement update if the height is new */
+void kalman_multi_rate_step(kalman_filter_t *filter, flight_fsm_e flight_state, const float32_t *accelerations,
+                            uint8_t num_accelerations, float32_t dt, bool height_updated);
@@ -0,0 +1,168 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/kalman_fixed.hpp"
+#include "control/kalman_filter.hpp"
+
+#include "util/error_handler.hpp"
+
+/* Covariance after a reset, as in reset_kalman */
+inline constexpr q5_27_t KALMAN_FIXED_INITIAL_VARIANCE = q5_27_t::FromFloat(0.1F);
+
+void initialize_kalman_fixed(kalman_fixed_t *fixed, const kalman_filter_t *filter) {
+  const q2_30_t one = q2_30_t::FromInt(1);
+  const q2_30_t dt = q2_30_t::FromFloat(filter->t_sampl);
+  const q2_30_t dt2_2 = multiply<30>(dt, dt) / q16_16_t::FromInt(2);
+
+  fixed->Ad = {{{one, dt, dt2_2}, {q2_30_t{}, one, dt}, {q2_30_t{}, q2_30_t{}, one}}};
+  fixed->Bd = {dt2_2, dt, q2_30_t{}};
+
+  /* Same noise model as kalman_step, the covariance is only computed once */
+  const Matrix<3, 3> Qd = kalman_process_noise(filter->t_sampl);
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      fixed->GdQGd_T[i][j] = q5_27_t::FromFloat(Qd(i, j));
+    }
+  }
+
+  fixed->R = q16_16_t::FromFloat(STD_NOISE_BARO);
+  fixed->K = {};
+  fixed->x_hat = {};
+  fixed->x_bar = {};
+  soft_reset_kalman_fixed(fixed);
+}
+
+void reset_kalman_fixed(kalman_fixed_t *fixed) {
+  fixed->x_bar = {q16_16_t{}, q16_16_t::FromInt(10), q16_16_t{}};
+  soft_reset_kalman_fixed(fixed);
+}
+
+void soft_reset_kalman_fixed(kalman_fixed_t *fixed) {
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      fixed->P[i][j] = (i == j) ? KALMAN_FIXED_INITIAL_VARIANCE : q5_27_t{};
+    }
+  }
+}
+
+/* Same as update_measurement_noise, R_interpolation is evaluated with four multiplications instead of powf */
+static void update_measurement_noise_fixed(kalman_fixed_t *fixed, flight_fsm_e flight_state) {
+  constexpr q16_16_t lower_bound = q16_16_t::FromInt(20);
+  constexpr q16_16_t upper_bound = q16_16_t::FromInt(100);
+  constexpr q2_30_t f_lower_bound = q2_30_t::FromFloat(0.3981F);
+  constexpr q2_30_t m = q2_30_t::FromFloat((0.3981F - 1.0F) / (20.0F - 100.0F));
+  constexpr q2_30_t b = q2_30_t::FromFloat(1.0F - (0.3981F - 1.0F) / (20.0F - 100.0F) * 100.0F);
+
+  switch (flight_state) {
+    case READY:
+    case CALIBRATING:
+      fixed->R = q16_16_t::FromFloat(STD_NOISE_BARO_INITIAL);
+      break;
+    case THRUSTING:
+      fixed->R = q16_16_t::FromFloat(STD_NOISE_BARO);
+      break;
+    case COASTING: {
+      const q16_16_t velocity = fixed->x_bar[1];
+      q2_30_t f = q2_30_t::FromInt(1);
+      if (velocity < lower_bound) {
+        f = f_lower_bound;
+      } else if (velocity < upper_bound) {
+        f = multiply<30>(m, velocity) + b;
+      }
+      const q2_30_t f2 = f * f;
+      fixed->R = multiply<16>(q16_16_t::FromFloat(STD_NOISE_BARO), f2 * f2 * f);
+    } break;
+    default:
+      break;
+  }
+
+  /* If all IMUs are disabled, trust the barometer */
+  if (get_error_by_tag(CATS_ERR_FILTER_ACC)) {
+    fixed->R = q16_16_t::FromFloat(STD_NOISE_BARO_INITIAL);
+  }
+}
+
+static void kalman_fixed_prediction(kalman_fixed_t *fixed, q16_16_t measured_acceleration) {
+  /* x_hat = A*x_bar + B*u */
+  for (uint8_t i = 0; i < 3; i++) {
+    fixed->x_hat[i] = multiply<16>(fixed->Bd[i], measured_acceleration);
+    for (uint8_t k = 0; k < 3; k++) {
+      fixed->x_hat[i] += multiply<16>(fixed->Ad[i][k], fixed->x_bar[k]);
+    }
+  }
+
+  /* P_hat = A*P_bar*A' + GQG', only the upper triangle is computed */
+  std::array<std::array<q5_27_t, 3>, 3> AP{};
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      for (uint8_t k = 0; k < 3; k++) {
+        AP[i][j] += multiply<27>(fixed->Ad[i][k], fixed->P[k][j]);
+      }
+    }
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = i; j < 3; j++) {
+      q5_27_t sum = fixed->GdQGd_T[i][j];
+      for (uint8_t k = 0; k < 3; k++) {
+        sum += multiply<27>(AP[i][k], fixed->Ad[j][k]);
+      }
+      fixed->P[i][j] = sum;
+      fixed->P[j][i] = sum;
+    }
+  }
+}
+
+static void kalman_fixed_update(kalman_fixed_t *fixed, q16_16_t measured_AGL) {
+  /* K = P_hat*H'/(H*P_hat*H' + R) with H = [1 0 0], S >= R is never zero */
+  const q16_16_t S = fixed->P[0][0].Convert<16>() + fixed->R;
+  for (uint8_t i = 0; i < 3; i++) {
+    fixed->K[i] = divide<30>(fixed->P[i][0], S);
+  }
+
+  /* x_bar = x_hat + K*(y - H*x_hat) */
+  const q16_16_t innovation = measured_AGL - fixed->x_hat[0];
+  for (uint8_t i = 0; i < 3; i++) {
+    fixed->x_bar[i] = fixed->x_hat[i] + multiply<16>(fixed->K[i], innovation);
+  }
+
+  /* P_bar = P_hat - K*(H*P_hat), the first row is read before it is overwritten */
+  const std::array<q5_27_t, 3> HP = fixed->P[0];
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = i; j < 3; j++) {
+      const q5_27_t value = fixed->P[i][j] - multiply<27>(fixed->K[i], HP[j]);
+      fixed->P[i][j] = value;
+      fixed->P[j][i] = value;
+    }
+  }
+}
+
+/* Same as constrain_offset */
+static void constrain_offset_fixed(kalman_fixed_t *fixed, flight_fsm_e flight_state) {
+  if (flight_state >= THRUSTING) {
+    fixed->x_bar[2] = fixed->x_hat[2];
+  }
+  if (flight_state >= DROGUE) {
+    fixed->x_bar[2] = {};
+  }
+}
+
+void kalman_fixed_step(kalman_fixed_t *fixed, kalman_filter_t *filter, flight_fsm_e flight_state) {
+  update_measurement_noise_fixed(fixed, flight_state);
+
+  const q16_16_t measured_AGL = q16_16_t::FromFloat(filter->measured_AGL);
+  kalman_fixed_prediction(fixed, q16_16_t::FromFloat(filter->measured_acceleration));
+  /* The NIS is only a diagnostic and is computed in float */
+  store_nis(filter, (measured_AGL - fixed->x_hat[0]).ToFloat(), fixed->P[0][0].ToFloat() + fixed->R.ToFloat());
+  kalman_fixed_update(fixed, measured_AGL);
+
+  constrain_offset_fixed(fixed, flight_state);
+
+  /* The conversion to float is deterministic as well, values above 256 are rounded to the 24 bit mantissa */
+  for (uint8_t i = 0; i < 3; i++) {
+    filter->x_hat[i] = fixed->x_hat[i].ToFloat();
+    filter->x_bar[i] = fixed->x_bar[i].ToFloat();
+    filter->K[i] = fixed->K[i].ToFloat();
+  }
+  filter->R = fixed->R.ToFloat();
+}
@@ -0,0 +1,42 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "util/fixed.hpp"
+#include "util/types.hpp"
+
+#include <array>
+
+/* The Kalman filter of kalman_filter.cpp in fixed point. Given the same measurements, i.e. the recorded filter inputs,
+ * it produces bit identical estimates on the target and on a host, independent of the compiler, the contraction of
+ * floating point operations and the math library. The process noise is computed in float once and rounded to Q5.27,
+ * far coarser than the rounding of the float unit. States and measurements are Q16.16, the model and the gain
+ * Q2.30. */
+
+/* Covariances, the height variance reaches about 7 m^2 during the boost */
+using q5_27_t = Fixed<27>;
+
+struct kalman_fixed_t {
+  /* Model discretized for the control sampling period */
+  std::array<std::array<q2_30_t, 3>, 3> Ad;
+  std::array<q2_30_t, 3> Bd;
+  std::array<std::array<q5_27_t, 3>, 3> GdQGd_T;
+  /* Height, velocity and acceleration offset */
+  std::array<q16_16_t, 3> x_hat;
+  std::array<q16_16_t, 3> x_bar;
+  std::array<std::array<q5_27_t, 3>, 3> P;
+  std::array<q2_30_t, 3> K;
+  q16_16_t R;
+};
+
+/* Discretize the model for the sampling period of the float filter and reset the state */
+void initialize_kalman_fixed(kalman_fixed_t *fixed, const kalman_filter_t *filter);
+
+void reset_kalman_fixed(kalman_fixed_t *fixed);
+
+void soft_reset_kalman_fixed(kalman_fixed_t *fixed);
+
+/* Replaces kalman_step, the measurements are taken from the float filter, which receives the estimate in return */
+void kalman_fixed_step(kalman_fixed_t *fixed, kalman_filter_t *filter, flight_fsm_e flight_state);
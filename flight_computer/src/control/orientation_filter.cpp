@@ -6,11 +6,36 @@
 #include "config/globals.hpp"
 #include "util/math_util.hpp"
 
+#include <cmath>
+
+/* Below this rotation angle per step, sine and cosine of the half angle are replaced by their Taylor series. At the
+ * threshold, the truncation error is below 1e-8. */
+inline constexpr float32_t SMALL_ANGLE_THRESHOLD = 0.05F;  // rad
+
+/* The exponential map keeps the norm up to rounding errors, renormalize only if |q|^2 drifted by more than this */
+inline constexpr float32_t NORM_DRIFT_THRESHOLD = 1e-5F;
+
+/* Rotate the vertical from the reference frame into the body frame, up = q* ⊗ up_reference ⊗ q */
+static void update_up(orientation_filter_t* filter) {
+  const float32_t w = filter->estimate_data[0];
+  const float32_t ux = -filter->estimate_data[1];
+  const float32_t uy = -filter->estimate_data[2];
+  const float32_t uz = -filter->estimate_data[3];
+  const vf32_t& v = filter->up_reference;
+
+  /* v' = v + w * t + u x t with t = 2 * (u x v) */
+  const float32_t tx = 2.0F * (uy * v.z - uz * v.y);
+  const float32_t ty = 2.0F * (uz * v.x - ux * v.z);
+  const float32_t tz = 2.0F * (ux * v.y - uy * v.x);
+  filter->up.x = v.x + w * tx + (uy * tz - uz * ty);
+  filter->up.y = v.y + w * ty + (uz * tx - ux * tz);
+  filter->up.z = v.z + w * tz + (ux * ty - uy * tx);
+}
+
 /* Orientation Filter */
 void init_orientation_filter(orientation_filter_t* filter) {
-  arm_mat_init_f32(&filter->gyro, 4, 1, filter->gyro_data);
-  arm_mat_init_f32(&filter->estimate, 4, 1, filter->estimate_data);
-  filter->t_sampl = static_cast<float32_t>(1.0F / CONTROL_SAMPLING_FREQ);
+  filter->t_sampl = 1.0F / static_cast<float32_t>(global_control_sampling_freq);
+  filter->up_reference = {.x = 0.0F, .y = 0.0F, .z = 1.0F};
 }
 
 void reset_orientation_filter(orientation_filter_t* filter) {
@@ -18,28 +43,57 @@ void reset_orientation_filter(orientation_filter_t* filter) {
   filter->estimate_data[1] = 0.0F;
   filter->estimate_data[2] = 0.0F;
   filter->estimate_data[3] = 0.0F;
+  filter->up = filter->up_reference;
 }
 
-void quaternion_kinematics(orientation_filter_t* filter, vf32_t angular_vel) {
-  filter->gyro_data[0] = 0.0F;
-  filter->gyro_data[1] = angular_vel.x / 180.0F * PI;  // Convert to rad/s
-  filter->gyro_data[2] = angular_vel.y / 180.0F * PI;  // Convert to rad/s
-  filter->gyro_data[3] = angular_vel.z / 180.0F * PI;  // Convert to rad/s
+/* The acceleration measured while the rocket rests defines the vertical, it needs to be set before the reset */
+void set_orientation_vertical(orientation_filter_t* filter, vf32_t acc_data) {
+  const float32_t norm = sqrtf(acc_data.x * acc_data.x + acc_data.y * acc_data.y + acc_data.z * acc_data.z);
+  if (norm < 0.5F * GRAVITY) {
+    /* Free fall or a broken accelerometer, keep the previous vertical */
+    return;
+  }
+  filter->up_reference = {.x = acc_data.x / norm, .y = acc_data.y / norm, .z = acc_data.z / norm};
+}
 
-  /* x_hat = x_bar + 1/2*Ts(quat_mult(velocity, x_bar)) */
-  float32_t holder_data[4] = {};
-  arm_matrix_instance_f32 holder_mat;
-  arm_mat_init_f32(&holder_mat, 4, 1, holder_data);
+void quaternion_kinematics(orientation_filter_t* filter, vf32_t angular_vel) {
+  /* Rotation over one sampling period, the angular velocity is assumed to be constant in between */
+  const float32_t wx = angular_vel.x / 180.0F * PI;  // Convert to rad/s
+  const float32_t wy = angular_vel.y / 180.0F * PI;  // Convert to rad/s
+  const float32_t wz = angular_vel.z / 180.0F * PI;  // Convert to rad/s
+  const float32_t dt = filter->t_sampl;
+  const float32_t angle_sq = (wx * wx + wy * wy + wz * wz) * dt * dt;
 
-  float32_t holder2_data[4] = {};
-  arm_matrix_instance_f32 holder2_mat;
-  arm_mat_init_f32(&holder2_mat, 4, 1, holder2_data);
-  quaternion_mat(&filter->estimate, &filter->gyro, &holder_mat);
+  /* dq = [cos(angle / 2), sin(angle / 2) * w / |w|] = [c, s * w] */
+  float32_t c = 0.0F;
+  float32_t s = 0.0F;
+  if (angle_sq < SMALL_ANGLE_THRESHOLD * SMALL_ANGLE_THRESHOLD) {
+    c = 1.0F - angle_sq / 8.0F + angle_sq * angle_sq / 384.0F;
+    s = 0.5F * dt * (1.0F - angle_sq / 24.0F);
+  } else {
+    const float32_t angle = sqrtf(angle_sq);
+    c = cosf(0.5F * angle);
+    s = sinf(0.5F * angle) * dt / angle;
+  }
+  const float32_t dx = s * wx;
+  const float32_t dy = s * wy;
+  const float32_t dz = s * wz;
 
-  arm_mat_scale_f32(&holder_mat, static_cast<float32_t>(0.5F * filter->t_sampl), &holder2_mat);
+  /* x_hat = x_bar ⊗ dq */
+  float32_t* q = filter->estimate_data;
+  const float32_t q0 = q[0] * c - q[1] * dx - q[2] * dy - q[3] * dz;
+  const float32_t q1 = q[0] * dx + q[1] * c + q[2] * dz - q[3] * dy;
+  const float32_t q2 = q[0] * dy - q[1] * dz + q[2] * c + q[3] * dx;
+  const float32_t q3 = q[0] * dz + q[1] * dy - q[2] * dx + q[3] * c;
+  q[0] = q0;
+  q[1] = q1;
+  q[2] = q2;
+  q[3] = q3;
 
-  arm_mat_add_f32(&holder2_mat, &filter->estimate, &filter->estimate);
+  const float32_t norm_sq = q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3;
+  if (fabsf(norm_sq - 1.0F) > NORM_DRIFT_THRESHOLD) {
+    normalize_q(q);
+  }
 
-  /* Normalize Prediction */
-  normalize_q(filter->estimate_data);
+  update_up(filter);
 }
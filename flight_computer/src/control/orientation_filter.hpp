@@ -7,14 +7,22 @@
 #include "util/types.hpp"
 
 struct orientation_filter_t {
-  float32_t gyro_data[4];
+  /* Rotation from the body frame to the reference frame, i.e. the body frame at the last reset */
   float32_t estimate_data[4];
+  /* Vertical unit vector in the reference frame */
+  vf32_t up_reference;
+  /* Vertical unit vector in the body frame, updated with every integration step */
+  vf32_t up;
   float32_t t_sampl;
-  arm_matrix_instance_f32 gyro;
-  arm_matrix_instance_f32 estimate;
 };
 
 /* Filter Functions */
 void init_orientation_filter(orientation_filter_t* filter);
 void reset_orientation_filter(orientation_filter_t* filter);
+void set_orientation_vertical(orientation_filter_t* filter, vf32_t acc_data);
 void quaternion_kinematics(orientation_filter_t* filter, vf32_t angular_vel);
+
+/* Acceleration along the vertical, including gravity, from the acceleration measured in the body frame */
+inline float32_t vertical_acceleration(const orientation_filter_t* filter, vf32_t acc_data) {
+  return acc_data.x * filter->up.x + acc_data.y * filter->up.y + acc_data.z * filter->up.z;
+}
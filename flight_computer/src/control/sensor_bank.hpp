@@ -0,0 +1,243 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "target.hpp"
+#include "util/int16_kernels.hpp"
+#include "util/types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+/* Number of consecutive control steps in which all channels of a sensor may keep the same raw value */
+inline constexpr uint8_t MAX_NUM_SAME_VALUE = 7;
+
+/* Accelerometer channels of the IMU: acceleration x, y, z. The accelerometer and the gyroscope of an IMU are checked and
+ * fused independently, a faulty accelerometer does not exclude a healthy gyroscope and vice versa. */
+struct AccBankTraits {
+  using sample_t = imu_data_t;
+  using raw_t = int16_t;
+  static constexpr uint8_t kNumChannels = 3;
+
+  static void Split(const sample_t& sample, raw_t (&raw)[kNumChannels]) {
+    raw[0] = sample.acc.x;
+    raw[1] = sample.acc.y;
+    raw[2] = sample.acc.z;
+  }
+
+  static const sens_info_t& GetInfo(uint8_t /*channel*/, uint8_t index) { return acc_info[index]; }
+};
+
+/* Gyroscope channels of the IMU: angular rate x, y, z */
+struct GyroBankTraits {
+  using sample_t = imu_data_t;
+  using raw_t = int16_t;
+  static constexpr uint8_t kNumChannels = 3;
+
+  static void Split(const sample_t& sample, raw_t (&raw)[kNumChannels]) {
+    raw[0] = sample.gyro.x;
+    raw[1] = sample.gyro.y;
+    raw[2] = sample.gyro.z;
+  }
+
+  static const sens_info_t& GetInfo(uint8_t /*channel*/, uint8_t index) { return gyro_info[index]; }
+};
+
+/* Barometer channels: pressure only, the temperature is already used for the compensation inside the sensor driver */
+struct BaroBankTraits {
+  using sample_t = baro_data_t;
+  using raw_t = int32_t;
+  static constexpr uint8_t kNumChannels = 1;
+
+  static void Split(const sample_t& sample, raw_t (&raw)[kNumChannels]) { raw[0] = sample.pressure; }
+
+  static const sens_info_t& GetInfo(uint8_t /*channel*/, uint8_t index) { return baro_info[index]; }
+};
+
+/**
+ * Holds the latest raw samples of N redundant sensors of the same type. The raw samples are stored sensor by sensor,
+ * the SI values channel by channel such that the fusion runs in one pass over contiguous memory. The int16 triples of
+ * the IMU are checked with the int16 kernels in raw units, their limits are converted to raw units once.
+ *
+ * @tparam Traits describes the sample layout and the sensor info of the sensor type
+ * @tparam N number of sensors
+ */
+template <typename Traits, uint8_t N>
+class SensorBank {
+ public:
+  static constexpr uint8_t kNumChannels = Traits::kNumChannels;
+  using raw_t = typename Traits::raw_t;
+  using sample_t = typename Traits::sample_t;
+  using channels_t = std::array<float32_t, kNumChannels>;
+
+  static_assert(N <= 32, "the sensor health is reported as a 32 bit mask");
+
+  /* The channels of a sensor form an int16 triple */
+  static constexpr bool kInt16Triple = std::is_same_v<raw_t, int16_t> && (kNumChannels == 3);
+
+  SensorBank() {
+    for (uint8_t i = 0; i < N; i++) {
+      for (uint8_t ch = 0; ch < kNumChannels; ch++) {
+        const sens_info_t& info = Traits::GetInfo(ch, i);
+        m_scale[i][ch] = info.conversion_to_SI;
+        if constexpr (!kInt16Triple) {
+          m_upper_limit[i][ch] = info.upper_limit;
+          m_lower_limit[i][ch] = info.lower_limit;
+        }
+      }
+      if constexpr (kInt16Triple) {
+        const auto limits = [this, i](uint8_t ch) {
+          const sens_info_t& info = Traits::GetInfo(ch, i);
+          return RawLimits(info.conversion_to_SI, info.lower_limit, info.upper_limit);
+        };
+        const auto [x_lower, x_upper] = limits(0);
+        const auto [y_lower, y_upper] = limits(1);
+        const auto [z_lower, z_upper] = limits(2);
+        m_lower_limit[i] = {.x = x_lower, .y = y_lower, .z = z_lower};
+        m_upper_limit[i] = {.x = x_upper, .y = y_upper, .z = z_upper};
+      }
+    }
+  }
+
+  /* Store the newest sample of a sensor */
+  void Set(uint8_t index, const sample_t& sample) noexcept { Traits::Split(sample, m_raw[index]); }
+
+  /* Convert the stored samples to SI and check them. A sensor is faulty if any channel is out of bounds or if none of
+   * its channels changed for more than MAX_NUM_SAME_VALUE steps. Returns a bit mask of the faulty sensors. */
+  uint32_t Check() noexcept {
+    bool out_of_bounds[N] = {};
+    bool changed[N] = {};
+
+    for (uint8_t i = 0; i < N; i++) {
+      if constexpr (kInt16Triple) {
+        const vi16_t value = {.x = m_raw[i][0], .y = m_raw[i][1], .z = m_raw[i][2]};
+        const vi16_t last = {.x = m_last_raw[i][0], .y = m_last_raw[i][1], .z = m_last_raw[i][2]};
+        out_of_bounds[i] = vi16_out_of_bounds(value, m_lower_limit[i], m_upper_limit[i]);
+        changed[i] = vi16_changed(value, last);
+        float32_t si[kNumChannels];
+        vi16_scale(value, m_scale[i], si);
+        for (uint8_t ch = 0; ch < kNumChannels; ch++) {
+          m_si[ch][i] = si[ch];
+        }
+      } else {
+        for (uint8_t ch = 0; ch < kNumChannels; ch++) {
+          const float32_t value = static_cast<float32_t>(m_raw[i][ch]) * m_scale[i][ch];
+          m_si[ch][i] = value;
+          out_of_bounds[i] |= (value > m_upper_limit[i][ch]) || (value < m_lower_limit[i][ch]);
+          changed[i] |= m_raw[i][ch] != m_last_raw[i][ch];
+        }
+      }
+      std::copy(std::begin(m_raw[i]), std::end(m_raw[i]), std::begin(m_last_raw[i]));
+    }
+
+    uint32_t faulty_mask = 0U;
+    for (uint8_t i = 0; i < N; i++) {
+      if (changed[i]) {
+        m_freeze_counter[i] = 0;
+      } else if (m_freeze_counter[i] <= MAX_NUM_SAME_VALUE) {
+        m_freeze_counter[i]++;
+      }
+      m_healthy[i] = !out_of_bounds[i] && (m_freeze_counter[i] <= MAX_NUM_SAME_VALUE);
+      if (!m_healthy[i]) {
+        faulty_mask |= 1U << i;
+      }
+    }
+    return faulty_mask;
+  }
+  /* Fuse the healthy sensors, channel wise median if at least three are healthy, mean otherwise. Returns false if no
+   * sensor is healthy. */
+  bool Fuse(channels_t& out) const noexcept {
+    uint8_t num_healthy = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      num_healthy += m_healthy[i] ? 1 : 0;
+    }
+    if (num_healthy == 0) {
+      return false;
+    }
+
+    for (uint8_t ch = 0; ch < kNumChannels; ch++) {
+      if constexpr (N >= 3) {
+        if (num_healthy >= 3) {
+          std::array<float32_t, N> values{};
+          uint8_t count = 0;
+          for (uint8_t i = 0; i < N; i++) {
+            if (m_healthy[i]) {
+              values[count++] = m_si[ch][i];
+            }
+          }
+          const auto mid = values.begin() + count / 2;
+          std::nth_element(values.begin(), mid, values.begin() + count);
+          out[ch] = *mid;
+          continue;
+        }
+      }
+      float32_t sum = 0.0F;
+      for (uint8_t i = 0; i < N; i++) {
+        sum += m_healthy[i] ? m_si[ch][i] : 0.0F;
+      }
+      out[ch] = sum / static_cast<float32_t>(num_healthy);
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool IsHealthy(uint8_t index) const noexcept { return m_healthy[index]; }
+
+ private:
+  /* Limits of a channel in raw units */
+  struct raw_limits_t {
+    int16_t lower;
+    int16_t upper;
+  };
+
+  /* Find the raw values which are in bounds exactly when their SI value is, for a positive scale. The conversion to SI
+   * is rounded, the division only gives a first guess. If no raw value is in bounds, the lower limit lies above the
+   * upper one. */
+  static raw_limits_t RawLimits(float32_t scale, float32_t lower_limit, float32_t upper_limit) {
+    constexpr int32_t kMin = std::numeric_limits<int16_t>::min();
+    constexpr int32_t kMax = std::numeric_limits<int16_t>::max();
+    const auto in_bounds_above = [&](int32_t raw) { return !(static_cast<float32_t>(raw) * scale < lower_limit); };
+    const auto in_bounds_below = [&](int32_t raw) { return !(static_cast<float32_t>(raw) * scale > upper_limit); };
+    const auto guess = [](float32_t raw) {
+      return static_cast<int32_t>(std::clamp(raw, static_cast<float32_t>(kMin), static_cast<float32_t>(kMax)));
+    };
+
+    /* Smallest raw value not below the lower limit */
+    int32_t lower = guess(std::ceil(lower_limit / scale));
+    while ((lower > kMin) && in_bounds_above(lower - 1)) {
+      lower--;
+    }
+    while ((lower < kMax) && !in_bounds_above(lower)) {
+      lower++;
+    }
+    /* Largest raw value not above the upper limit */
+    int32_t upper = guess(std::floor(upper_limit / scale));
+    while ((upper < kMax) && in_bounds_below(upper + 1)) {
+      upper++;
+    }
+    while ((upper > kMin) && !in_bounds_below(upper)) {
+      upper--;
+    }
+    if (!in_bounds_above(lower) || !in_bounds_below(upper)) {
+      return {.lower = static_cast<int16_t>(kMax), .upper = static_cast<int16_t>(kMin)};
+    }
+    return {.lower = static_cast<int16_t>(lower), .upper = static_cast<int16_t>(upper)};
+  }
+
+  using limits_t = std::conditional_t<kInt16Triple, vi16_t, float32_t[kNumChannels]>;
+
+  raw_t m_raw[N][kNumChannels]{};
+  raw_t m_last_raw[N][kNumChannels]{};
+  float32_t m_si[kNumChannels][N]{};
+  float32_t m_scale[N][kNumChannels]{};
+  /* In raw units for the int16 triples, in SI units otherwise */
+  limits_t m_upper_limit[N]{};
+  limits_t m_lower_limit[N]{};
+  uint8_t m_freeze_counter[N]{};
+  bool m_healthy[N]{};
+};
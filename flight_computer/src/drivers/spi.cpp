@@ -0,0 +1,279 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "drivers/spi.hpp"
+#include "util/task_util.hpp"
+
+namespace driver {
+
+namespace {
+
+inline constexpr uint8_t kMaxSpiInstances = 3U;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+uint8_t instance_count = 0U;
+
+Spi* instances[kMaxSpiInstances]{};
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace
+
+Spi::Spi(SPI_HandleTypeDef* spi_handle, uint32_t timeout) : m_spi_handle(spi_handle), m_timeout(timeout) {
+  if (instance_count < kMaxSpiInstances) {
+    instances[instance_count] = this;
+    instance_count++;
+  }
+}
+
+Spi* Spi::FromHandle(const SPI_HandleTypeDef* spi_handle) {
+  for (uint8_t i = 0U; i < instance_count; i++) {
+    if (instances[i]->m_spi_handle == spi_handle) {
+      return instances[i];
+    }
+  }
+  return nullptr;
+}
+
+bool Spi::Submit(Transaction& transaction) {
+  const osThreadId_t thread = osThreadGetId();
+  for (Transaction* t = &transaction; t != nullptr; t = t->next) {
+    t->notify = thread;
+    t->status = Status::kQueued;
+  }
+
+  Queue& queue = m_queues[static_cast<size_t>(transaction.priority)];
+  taskENTER_CRITICAL();
+  const size_t next_tail = (queue.tail + 1U) % kQueueSize;
+  if (next_tail == queue.head) {
+    taskEXIT_CRITICAL();
+    for (Transaction* t = &transaction; t != nullptr; t = t->next) {
+      t->status = Status::kError;
+    }
+    return false;
+  }
+  queue.items[queue.tail] = &transaction;
+  queue.tail = next_tail;
+  StartNext();
+  taskEXIT_CRITICAL();
+
+  return true;
+}
+
+bool Spi::SubmitBatch(Transaction* transactions, size_t count) {
+  if (count == 0U) {
+    return false;
+  }
+  for (size_t i = 0U; i < count; i++) {
+    transactions[i].next = (i + 1U < count) ? &transactions[i + 1U] : nullptr;
+  }
+  return Submit(transactions[0]);
+}
+
+bool Spi::Wait(Transaction& transaction) {
+  const uint32_t start = osKernelGetTickCount();
+  while (IsPending(transaction)) {
+    const uint32_t elapsed = osKernelGetTickCount() - start;
+    if (elapsed > m_timeout) {
+      taskENTER_CRITICAL();
+      const bool abort = Cancel(transaction);
+      taskEXIT_CRITICAL();
+      if (abort) {
+        // Aborting waits for the DMA streams to stop, which must not happen with the interrupts masked
+        HAL_SPI_Abort(m_spi_handle);
+        taskENTER_CRITICAL();
+        m_aborting = false;
+        StartNext();
+        taskEXIT_CRITICAL();
+      }
+      break;
+    }
+    // The flag may also be set by an earlier transaction of this thread, the status is therefore checked again
+    osThreadFlagsWait(THREAD_FLAG_SPI_DONE, osFlagsWaitAny, m_timeout - elapsed + 1U);
+  }
+
+  for (const Transaction* t = &transaction; t != nullptr; t = t->next) {
+    if (t->status != Status::kDone) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Spi::TransmitReceive(OutputPin& cs, const uint8_t* tx, uint8_t* rx, size_t length, Priority priority) {
+  Transaction transaction{.cs = &cs, .tx = tx, .rx = rx, .length = static_cast<uint16_t>(length), .priority = priority};
+  return TransmitReceiveBatch(&transaction, 1U);
+}
+
+bool Spi::TransmitReceiveBatch(Transaction* transactions, size_t count) {
+  if (!rtos_started) {
+    bool success = true;
+    for (size_t i = 0U; i < count; i++) {
+      Transaction& transaction = transactions[i];
+      HAL_StatusTypeDef status = HAL_OK;
+      if (transaction.cs != nullptr) {
+        transaction.cs->SetLow();
+      }
+      // HAL does not take const pointers even though the transmit buffer is not modified
+      if (transaction.rx == nullptr) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        status = HAL_SPI_Transmit(m_spi_handle, const_cast<uint8_t*>(transaction.tx), transaction.length, m_timeout);
+      } else {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        status = HAL_SPI_TransmitReceive(m_spi_handle, const_cast<uint8_t*>(transaction.tx), transaction.rx,
+                                         transaction.length, m_timeout);
+      }
+      if (transaction.cs != nullptr) {
+        transaction.cs->SetHigh();
+      }
+      transaction.status = (status == HAL_OK) ? Status::kDone : Status::kError;
+      success &= status == HAL_OK;
+    }
+    return success;
+  }
+
+  if (!SubmitBatch(transactions, count)) {
+    return false;
+  }
+  return Wait(transactions[0]);
+}
+
+void Spi::OnTransferComplete(bool success) {
+  Transaction* next = (m_active != nullptr) ? m_active->next : nullptr;
+  Finish(success ? Status::kDone : Status::kError);
+  // Keep the bus for the rest of the batch
+  if (success && (next != nullptr)) {
+    Start(*next);
+  }
+  StartNext();
+}
+
+void Spi::StartNext() {
+  if (m_aborting) {
+    return;
+  }
+  for (Queue& queue : m_queues) {
+    while ((m_active == nullptr) && (queue.head != queue.tail)) {
+      Transaction* transaction = queue.items[queue.head];
+      queue.head = (queue.head + 1U) % kQueueSize;
+      Start(*transaction);
+    }
+  }
+}
+
+void Spi::Start(Transaction& transaction) {
+  m_active = &transaction;
+  transaction.status = Status::kActive;
+  if (transaction.cs != nullptr) {
+    transaction.cs->SetLow();
+  }
+
+  HAL_StatusTypeDef status = HAL_OK;
+  if (transaction.rx == nullptr) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    status = HAL_SPI_Transmit_DMA(m_spi_handle, const_cast<uint8_t*>(transaction.tx), transaction.length);
+  } else {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    status = HAL_SPI_TransmitReceive_DMA(m_spi_handle, const_cast<uint8_t*>(transaction.tx), transaction.rx,
+                                         transaction.length);
+  }
+
+  if (status != HAL_OK) {
+    Finish(Status::kError);
+  }
+}
+
+void Spi::Finish(Status status) {
+  Transaction* transaction = m_active;
+  if (transaction == nullptr) {
+    return;
+  }
+  m_active = nullptr;
+
+  if (transaction->cs != nullptr) {
+    transaction->cs->SetHigh();
+  }
+  transaction->status = status;
+
+  // A failed transfer ends the whole batch
+  if (status != Status::kDone) {
+    for (Transaction* t = transaction->next; t != nullptr; t = t->next) {
+      t->status = Status::kError;
+    }
+  }
+
+  // Only wake the waiting thread once the batch is finished
+  const bool batch_finished = (status != Status::kDone) || (transaction->next == nullptr);
+  if (batch_finished && (transaction->notify != nullptr)) {
+    osThreadFlagsSet(transaction->notify, THREAD_FLAG_SPI_DONE);
+  }
+}
+
+bool Spi::Cancel(Transaction& transaction) {
+  // The batch might have completed in the meantime
+  if (!IsPending(transaction)) {
+    return false;
+  }
+
+  for (Transaction* t = &transaction; t != nullptr; t = t->next) {
+    if (m_active == t) {
+      // Nobody is waiting for this notification anymore
+      t->notify = nullptr;
+      Finish(Status::kError);
+      // The bus stays reserved until the transfer is aborted
+      m_aborting = true;
+      return true;
+    }
+  }
+
+  // Still queued, drop it while keeping the order of the remaining batches
+  Queue& queue = m_queues[static_cast<size_t>(transaction.priority)];
+  size_t write = queue.head;
+  for (size_t read = queue.head; read != queue.tail; read = (read + 1U) % kQueueSize) {
+    if (queue.items[read] != &transaction) {
+      queue.items[write] = queue.items[read];
+      write = (write + 1U) % kQueueSize;
+    }
+  }
+  queue.tail = write;
+  for (Transaction* t = &transaction; t != nullptr; t = t->next) {
+    t->status = Status::kError;
+  }
+  return false;
+}
+
+bool Spi::IsPending(const Transaction& transaction) {
+  for (const Transaction* t = &transaction; t != nullptr; t = t->next) {
+    if ((t->status == Status::kQueued) || (t->status == Status::kActive)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace driver
+
+extern "C" {
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi) {
+  driver::Spi* spi = driver::Spi::FromHandle(hspi);
+  if (spi != nullptr) {
+    spi->OnTransferComplete(true);
+  }
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef* hspi) {
+  driver::Spi* spi = driver::Spi::FromHandle(hspi);
+  if (spi != nullptr) {
+    spi->OnTransferComplete(true);
+  }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi) {
+  driver::Spi* spi = driver::Spi::FromHandle(hspi);
+  if (spi != nullptr) {
+    spi->OnTransferComplete(false);
+  }
+}
+
+}
@@ -4,23 +4,185 @@
 
 #pragma once
 
+#include "cmsis_os.h"
+#include "drivers/gpio.hpp"
 #include "target.hpp"
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
 namespace driver {
 
+/**
+ * Owns an SPI peripheral and arbitrates it between the devices on the bus. Transactions are queued per priority and
+ * started from the DMA completion interrupt, a running transfer is never interrupted.
+ */
 class Spi {
  public:
-  explicit Spi(SPI_HandleTypeDef* spi_handle, uint32_t timeout = 5U) : m_spi_handle(spi_handle), m_timeout(timeout) {}
+  /// Bus priority of a transaction, queued transactions of a higher priority are always started first
+  enum class Priority : uint8_t {
+    /// High rate sensors, e.g. the IMU
+    kHigh = 0,
+    /// Low rate sensors, e.g. the barometer
+    kMedium,
+    /// Configuration and housekeeping
+    kLow,
+  };
+
+  /// Transaction state, updated from the DMA completion interrupt
+  enum class Status : uint8_t {
+    kIdle = 0,
+    kQueued,
+    kActive,
+    kDone,
+    kError,
+  };
+
+  /// Full duplex transfer framed by a single chip select assertion
+  struct Transaction {
+    /// Chip select pin, pulled low for the duration of the transfer, may be nullptr
+    OutputPin* cs{nullptr};
+    /// Data clocked out
+    const uint8_t* tx{nullptr};
+    /// Data clocked in, may be nullptr if the response is not needed
+    uint8_t* rx{nullptr};
+    /// Number of bytes to transfer
+    uint16_t length{0U};
+    /// Priority of the transaction, a batch is queued with the priority of its first transaction
+    Priority priority{Priority::kLow};
+    /// Transaction of the same batch started right after this one without giving up the bus, may be nullptr
+    Transaction* next{nullptr};
+    /// Thread notified on completion, set on submission
+    osThreadId_t notify{nullptr};
+    /// Current state of the transaction
+    volatile Status status{Status::kIdle};
+  };
+
+  /** Constructor
+   *
+   * @param spi_handle Pointer to the HAL SPI handle, DMA streams need to be linked to it
+   * @param timeout Transaction timeout in ms
+   */
+  explicit Spi(SPI_HandleTypeDef* spi_handle, uint32_t timeout = 5U);
+
+  /** Queue a transaction together with the transactions linked through next, it is started immediately if the bus is
+   * idle
+   *
+   * @note Only call this function after the scheduler was started. The transactions need to stay valid until they are
+   * finished.
+   *
+   * @param transaction the first transaction of the batch
+   * @return true if the transaction was queued
+   */
+  [[nodiscard]] bool Submit(Transaction& transaction);
+
+  /** Link consecutive transactions into a batch and queue it
+   *
+   * @param transactions the transactions of the batch, started in the given order
+   * @param count number of transactions
+   * @return true if the batch was queued
+   */
+  [[nodiscard]] bool SubmitBatch(Transaction* transactions, size_t count);
+
+  /** Sleep until a submitted transaction and the rest of its batch are finished, cancels them on timeout
+   *
+   * @param transaction the first transaction of the batch
+   * @return true if all transfers completed successfully
+   */
+  [[nodiscard]] bool Wait(Transaction& transaction);
+
+  /** Transfer data and wait for the result, falls back to a blocking transfer before the scheduler is started
+   *
+   * @param cs chip select pin
+   * @param tx data to send
+   * @param rx buffer for the received data, may be nullptr
+   * @param length number of bytes to transfer
+   * @param priority bus priority of the transfer
+   * @return true on success
+   */
+  bool TransmitReceive(OutputPin& cs, const uint8_t* tx, uint8_t* rx, size_t length,
+                       Priority priority = Priority::kLow);
 
-  void Transfer(uint8_t* data, const size_t length) { HAL_SPI_Transmit(m_spi_handle, data, length, m_timeout); }
+  /** Run transactions back to back without giving up the bus in between and wait for the result, falls back to
+   * blocking transfers before the scheduler is started
+   *
+   * @param transactions the transactions of the batch, started in the given order
+   * @param count number of transactions
+   * @return true if all transfers completed successfully
+   */
+  bool TransmitReceiveBatch(Transaction* transactions, size_t count);
 
-  void Receive(uint8_t* data, const size_t length) { HAL_SPI_Receive(m_spi_handle, data, length, m_timeout); }
+  /** Called from the HAL callbacks when the active transfer finished
+   *
+   * @param success false if the HAL reported an error
+   */
+  void OnTransferComplete(bool success);
+
+  /** Find the driver belonging to a HAL handle
+   *
+   * @param spi_handle HAL handle passed to the callback
+   * @return pointer to the driver, nullptr if there is none
+   */
+  static Spi* FromHandle(const SPI_HandleTypeDef* spi_handle);
 
  private:
+  /** Start the next queued batch if the bus is idle, interrupts need to be masked */
+  void StartNext();
+
+  /** Put a transaction on the bus, interrupts need to be masked
+   *
+   * @param transaction the transaction to start
+   */
+  void Start(Transaction& transaction);
+
+  /** Release the active transaction, the rest of its batch fails with it on error, interrupts need to be masked
+   *
+   * @param status final status of the transaction
+   */
+  void Finish(Status status);
+
+  /** Remove a batch from the bus after a timeout, interrupts need to be masked. If the batch is on the bus, it is
+   * released but the bus stays reserved: the caller needs to abort the transfer with the interrupts enabled, then clear
+   * m_aborting and start the next batch.
+   *
+   * @param transaction the first transaction of the batch
+   * @return true if the active transfer needs to be aborted
+   */
+  bool Cancel(Transaction& transaction);
+
+  /** Check whether any transaction of a batch is still queued or running
+   *
+   * @param transaction the first transaction of the batch
+   * @return true if the batch is not finished
+   */
+  static bool IsPending(const Transaction& transaction);
+
+  /// Maximum number of queued batches per priority
+  static constexpr size_t kQueueSize = 8U;
+  /// Number of priorities
+  static constexpr size_t kNumPriorities = 3U;
+
+  /// Ring buffer of the batches queued with the same priority
+  struct Queue {
+    /// Queued batches
+    std::array<Transaction*, kQueueSize> items{};
+    /// Index of the next batch to start
+    volatile size_t head{0U};
+    /// Index of the next free slot
+    volatile size_t tail{0U};
+  };
+
   /// Pointer to the SPI handle
   SPI_HandleTypeDef* const m_spi_handle;
   /// SPI transfer timeout
   const uint32_t m_timeout;
+  /// Queued batches, indexed by the priority
+  std::array<Queue, kNumPriorities> m_queues{};
+  /// Transaction currently on the bus
+  Transaction* volatile m_active{nullptr};
+  /// Set while a timed out transfer is aborted, no transaction is started in the meantime
+  volatile bool m_aborting{false};
 };
 
 }  // namespace driver
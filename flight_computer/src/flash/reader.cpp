@@ -16,9 +16,33 @@
 
 constexpr uint16_t STRING_BUF_SZ = 400;
 constexpr uint16_t READ_BUF_SZ = 256;
+constexpr uint16_t TIMESTAMP_BUF_SZ = 24;
 
 namespace {
 
+/**
+ * Formats the timestamp column of a parsed entry. By default it is printed in whole ms like before the entries were
+ * timestamped in us, such that existing parsers keep working. The us are only printed when requested.
+ *
+ * @param buf output buffer
+ * @param ts_us unwrapped timestamp in us
+ * @param print_us true to print the timestamp in us
+ */
+void format_timestamp(char (&buf)[TIMESTAMP_BUF_SZ], uint64_t ts_us, bool print_us) {
+  if (!print_us) {
+    snprintf(buf, TIMESTAMP_BUF_SZ, "%lu", static_cast<uint32_t>(ts_us / 1000U));
+    return;
+  }
+  /* printf of the target does not support 64 bit integers */
+  const auto ts_s = static_cast<uint32_t>(ts_us / 1000000U);
+  const auto ts_frac = static_cast<uint32_t>(ts_us % 1000000U);
+  if (ts_s == 0U) {
+    snprintf(buf, TIMESTAMP_BUF_SZ, "%lu", ts_frac);
+  } else {
+    snprintf(buf, TIMESTAMP_BUF_SZ, "%lu%06lu", ts_s, ts_frac);
+  }
+}
+
 /**
  * Prints the stats by reading them from the stats txt file.
  * The file is read READ_BUF_SZ bytes at a time.
@@ -168,7 +192,7 @@ void dump_recording(uint16_t flight_num) {
 
 // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
-void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
+void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask, bool print_us) {
   if (global_recorder_status == REC_WRITE_TO_FLASH) {
     log_raw("The recorder is currently active, stop it first!");
     return;
@@ -198,7 +222,26 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
       }
     }
 
+    /* The timestamps are recorded in us and wrap around after ~71 min. They are unwrapped with the signed difference to
+     * the previous entry, which also holds for entries that were recorded slightly out of order. */
+    if (print_us) {
+      log_raw("Timestamps in us");
+    }
+    uint64_t ts_us = 0U;
+    timestamp_us_t last_ts = 0U;
+    bool first_entry = true;
+
     while (lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem), 8) > 0) {
+      if (first_entry) {
+        ts_us = rec_elem.ts;
+        first_entry = false;
+      } else {
+        ts_us = static_cast<uint64_t>(static_cast<int64_t>(ts_us) + static_cast<int32_t>(rec_elem.ts - last_ts));
+      }
+      last_ts = rec_elem.ts;
+      char ts_str[TIMESTAMP_BUF_SZ];
+      format_timestamp(ts_str, ts_us, print_us);
+
       const rec_entry_type_e rec_type = rec_elem.rec_type;
       const rec_entry_type_e rec_type_without_id = get_record_type_without_id(rec_type);
       switch (rec_type_without_id) {
@@ -206,7 +249,7 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           const size_t elem_sz = sizeof(rec_elem.u.imu);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|IMU%hu|%d|%d|%d|%d|%d|%d", rec_elem.ts, get_id_from_record_type(rec_type),
+            log_raw("%s|IMU%hu|%d|%d|%d|%d|%d|%d", ts_str, get_id_from_record_type(rec_type),
                     rec_elem.u.imu.acc.x, rec_elem.u.imu.acc.y, rec_elem.u.imu.acc.z, rec_elem.u.imu.gyro.x,
                     rec_elem.u.imu.gyro.y, rec_elem.u.imu.gyro.z);
           }
@@ -215,15 +258,16 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           const size_t elem_sz = sizeof(rec_elem.u.baro);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|BARO%hu|%ld|%ld", rec_elem.ts, get_id_from_record_type(rec_type), rec_elem.u.baro.pressure,
-                    rec_elem.u.baro.temperature);
+            log_raw("%s|BARO%hu|%ld|%ld", ts_str, get_id_from_record_type(rec_type),
+                    rec_elem.u.baro.pressure, rec_elem.u.baro.temperature);
           }
         } break;
         case FLIGHT_INFO: {
           const size_t elem_sz = sizeof(rec_elem.u.flight_info);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|FLIGHT_INFO|%f|%f|%f", rec_elem.ts, static_cast<double>(rec_elem.u.flight_info.acceleration),
+            log_raw("%s|FLIGHT_INFO|%f|%f|%f", ts_str,
+                    static_cast<double>(rec_elem.u.flight_info.acceleration),
                     static_cast<double>(rec_elem.u.flight_info.height),
                     static_cast<double>(rec_elem.u.flight_info.velocity));
           }
@@ -232,7 +276,7 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           const size_t elem_sz = sizeof(rec_elem.u.orientation_info);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|ORIENTATION_INFO|%d|%d|%d|%d", rec_elem.ts,
+            log_raw("%s|ORIENTATION_INFO|%d|%d|%d|%d", ts_str,
                     rec_elem.u.orientation_info.estimated_orientation[0],
                     rec_elem.u.orientation_info.estimated_orientation[1],
                     rec_elem.u.orientation_info.estimated_orientation[2],
@@ -243,7 +287,7 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           const size_t elem_sz = sizeof(rec_elem.u.filtered_data_info);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|FILTERED_DATA_INFO|%f|%f", rec_elem.ts,
+            log_raw("%s|FILTERED_DATA_INFO|%f|%f", ts_str,
                     static_cast<double>(rec_elem.u.filtered_data_info.filtered_altitude_AGL),
                     static_cast<double>(rec_elem.u.filtered_data_info.filtered_acceleration));
           }
@@ -252,7 +296,7 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           const size_t elem_sz = sizeof(rec_elem.u.flight_state);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|FLIGHT_STATE|%s", rec_elem.ts, GetStr(rec_elem.u.flight_state, fsm_map));
+            log_raw("%s|FLIGHT_STATE|%s", ts_str, GetStr(rec_elem.u.flight_state, fsm_map));
           }
         } break;
         case EVENT_INFO: {
@@ -260,7 +304,7 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
             const peripheral_act_t action = rec_elem.u.event_info.action;
-            log_raw("%lu|EVENT_INFO|%s|%s|%d", rec_elem.ts, GetStr(rec_elem.u.event_info.event, event_map),
+            log_raw("%s|EVENT_INFO|%s|%s|%d", ts_str, GetStr(rec_elem.u.event_info.event, event_map),
                     GetStr(rec_elem.u.event_info.action.action, action_map), action.action_arg);
           }
         } break;
@@ -268,14 +312,14 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           const size_t elem_sz = sizeof(rec_elem.u.error_info);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|ERROR_INFO|%lu", rec_elem.ts, rec_elem.u.error_info.error);
+            log_raw("%s|ERROR_INFO|%lu", ts_str, rec_elem.u.error_info.error);
           }
         } break;
         case GNSS_INFO: {
           const size_t elem_sz = sizeof(rec_elem.u.gnss_info);
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
-            log_raw("%lu|GNSS_INFO|%f|%f|%hu", rec_elem.ts, static_cast<double>(rec_elem.u.gnss_info.lat),
+            log_raw("%s|GNSS_INFO|%f|%f|%hu", ts_str, static_cast<double>(rec_elem.u.gnss_info.lat),
                     static_cast<double>(rec_elem.u.gnss_info.lon), rec_elem.u.gnss_info.sats);
           }
         } break;
@@ -284,7 +328,40 @@ void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask) {
           lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
           if ((rec_type_without_id & filter_mask) > 0) {
             /* Convert mV to V by dividing with 1000. */
-            log_raw("%lu|VOLTAGE_INFO|%.3f", rec_elem.ts, static_cast<double>(rec_elem.u.voltage_info) / 1000);
+            log_raw("%s|VOLTAGE_INFO|%.3f", ts_str, static_cast<double>(rec_elem.u.voltage_info) / 1000);
+          }
+        } break;
+        case LOOP_TIMING_INFO: {
+          const size_t elem_sz = sizeof(rec_elem.u.loop_timing_info);
+          lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
+          if ((rec_type_without_id & filter_mask) > 0) {
+            /* Lateness and execution time of the task given by the ID, in us */
+            log_raw("%s|LOOP_TIMING_INFO%hu|%u|%u|%u|%u", ts_str, get_id_from_record_type(rec_type),
+                    rec_elem.u.loop_timing_info.lateness_max, rec_elem.u.loop_timing_info.lateness_p99,
+                    rec_elem.u.loop_timing_info.execution_max, rec_elem.u.loop_timing_info.execution_p99);
+          }
+        } break;
+        case APOGEE_PREDICTION: {
+          const size_t elem_sz = sizeof(rec_elem.u.apogee_prediction);
+          lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
+          if ((rec_type_without_id & filter_mask) > 0) {
+            /* The predicted time is printed relative to the entry, in ms */
+            const auto time_to_apogee = static_cast<int32_t>(rec_elem.u.apogee_prediction.timestamp - rec_elem.ts);
+            log_raw("%s|APOGEE_PREDICTION|%.3f|%f|%.2f", ts_str,
+                    static_cast<double>(time_to_apogee) / 1000,
+                    static_cast<double>(rec_elem.u.apogee_prediction.height),
+                    static_cast<double>(rec_elem.u.apogee_prediction.confidence));
+          }
+        } break;
+        case FILTER_CONSISTENCY: {
+          const size_t elem_sz = sizeof(rec_elem.u.filter_consistency);
+          lfs_file_read(&lfs, &curr_file, reinterpret_cast<uint8_t *>(&rec_elem.u.imu), elem_sz);
+          if ((rec_type_without_id & filter_mask) > 0) {
+            log_raw("%s|FILTER_CONSISTENCY|%s|%hu|%.3f|%.3f", ts_str,
+                    GetStr(static_cast<flight_fsm_e>(rec_elem.u.filter_consistency.flight_state), fsm_map),
+                    rec_elem.u.filter_consistency.num_updates,
+                    static_cast<double>(rec_elem.u.filter_consistency.nis_mean),
+                    static_cast<double>(rec_elem.u.filter_consistency.nis_max));
           }
         } break;
         default:
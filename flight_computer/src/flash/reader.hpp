@@ -11,7 +11,8 @@
 namespace reader {
 
 void dump_recording(uint16_t flight_num);
-void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask);
+/* Print the entries of a flight, the timestamps are printed in ms unless print_us is set */
+void parse_recording(uint16_t flight_num, rec_entry_type_e filter_mask, bool print_us);
 
 void print_stats_and_cfg(uint16_t flight_num);
 
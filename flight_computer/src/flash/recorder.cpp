@@ -5,9 +5,11 @@
 #include "recorder.hpp"
 #include "config/cats_config.hpp"
 #include "config/globals.hpp"
+#include "control/consistency.hpp"
 #include "util/gnss.hpp"
 #include "util/log.h"
 
+#include <algorithm>
 #include <cmath>
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
@@ -24,9 +26,14 @@ static inline bool should_record(rec_entry_type_e rec_type) { return (global_cat
 
 /* TODO: See whether this is optimized in assembler. Here we copy the entire struct but the alternative is to pass a
  * pointer and this will cause too many indirect accesses. */
-static inline void collect_flight_info_stats(timestamp_t ts, flight_info_t flight_info) {
+static inline void collect_flight_info_stats(timestamp_us_t ts, flight_info_t flight_info) {
   if (global_recorder_status == REC_WRITE_TO_FLASH) {
-    /* TODO: We need to offset the timestamps in the flight stats struct by subtracting the timestamp at EV_LIFTOFF. */
+    /* Writing to flash starts at liftoff by default, the times are counted from the first entry written */
+    if (!global_flight_stats.started) {
+      global_flight_stats.start_ts = ts;
+      global_flight_stats.started = true;
+    }
+    ts -= global_flight_stats.start_ts;
     if ((flight_info.height > global_flight_stats.max_height.val)) {
       global_flight_stats.max_height.ts = ts;
       global_flight_stats.max_height.val = flight_info.height;
@@ -42,9 +49,27 @@ static inline void collect_flight_info_stats(timestamp_t ts, flight_info_t fligh
   }
 }
 
+static inline void collect_consistency_stats(const filter_consistency_t &window) {
+  if ((global_recorder_status == REC_WRITE_TO_FLASH) && (window.flight_state <= TOUCHDOWN)) {
+    consistency_summary_t &summary = global_flight_stats.consistency[window.flight_state];
+    summary.num_updates += window.num_updates;
+    summary.nis_sum += window.nis_mean * static_cast<float32_t>(window.num_updates);
+    summary.nis_max = std::max(summary.nis_max, window.nis_max);
+    /* Windows cut short by a change of the flight phase are not compared to the bounds */
+    if (window.num_updates == consistency_window_length(global_control_sampling_freq)) {
+      const consistency_bounds_t bounds = consistency_nis_bounds(window.num_updates);
+      summary.num_windows++;
+      if (window.nis_mean < bounds.lower) {
+        summary.num_windows_low++;
+      } else if (window.nis_mean > bounds.upper) {
+        summary.num_windows_high++;
+      }
+    }
+  }
+}
+
 /* Counter used for determining whether individual types should be recorded. */
 struct skip_counter_t {
-  uint8_t imu;
   uint8_t baro;
   uint8_t flight_info;
   uint8_t orientation;
@@ -104,14 +129,35 @@ inline static bool should_skip(uint8_t *cnt, uint8_t num_reps_per_iter) {
   return skip;
 }
 
-void record(timestamp_t ts, rec_entry_type_e rec_type_with_id, const void *const rec_value) {
+/**
+ * Determines whether an IMU sample should be recorded or not, based on the recorder speed settings.
+ *
+ * The IMU delivers several samples per control step, as many as the FIFO collected. Their number varies from step to
+ * step, so they cannot be counted like the other entries. Instead the samples are assigned to control steps by their
+ * timestamp, and all samples of every inv_rec_rate-th control step are recorded. The recorded rate is lowered by the
+ * same factor as for the other periodic entries.
+ *
+ * @param ts - timestamp of the sample in us
+ * @return true if the sample should not be recorded, false otherwise
+ */
+inline static bool should_skip_imu_sample(timestamp_us_t ts) {
+  /* Return right away if everything should be recorded */
+  if (global_cats_config.rec_speed_idx == 0) {
+    return false;
+  }
+  const uint8_t inv_rec_rate = global_cats_config.rec_speed_idx + 1;
+  const uint32_t control_step = ts / (1000000U / global_control_sampling_freq);
+  return (control_step % inv_rec_rate) != 0U;
+}
+
+void record(timestamp_us_t ts, rec_entry_type_e rec_type_with_id, const void *const rec_value) {
   const rec_entry_type_e pure_rec_type = get_record_type_without_id(rec_type_with_id);
 
   if (global_recorder_status >= REC_FILL_QUEUE && should_record(pure_rec_type)) {
     rec_elem_t e = {.ts = ts, .rec_type = rec_type_with_id};
     switch (pure_rec_type) {
       case IMU:
-        if (should_skip(&skip_counter.imu, NUM_IMU)) {
+        if (should_skip_imu_sample(ts)) {
           return;
         }
         e.u.imu = *(static_cast<const imu_data_t *>(rec_value));
@@ -157,6 +203,16 @@ void record(timestamp_t ts, rec_entry_type_e rec_type_with_id, const void *const
       case VOLTAGE_INFO:
         e.u.voltage_info = *(static_cast<const voltage_info_t *>(rec_value));
         break;
+      case LOOP_TIMING_INFO:
+        e.u.loop_timing_info = *(static_cast<const loop_timing_info_t *>(rec_value));
+        break;
+      case APOGEE_PREDICTION:
+        e.u.apogee_prediction = *(static_cast<const apogee_prediction_t *>(rec_value));
+        break;
+      case FILTER_CONSISTENCY:
+        e.u.filter_consistency = *(static_cast<const filter_consistency_t *>(rec_value));
+        collect_consistency_stats(e.u.filter_consistency);
+        break;
       default:
         log_fatal("Impossible recorder entry type %lu!", pure_rec_type);
         break;
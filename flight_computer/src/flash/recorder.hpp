@@ -7,6 +7,7 @@
 #include "config/cats_config.hpp"
 #include "util/error_handler.hpp"
 #include "util/gnss.hpp"
+#include "util/loop_timing.hpp"
 #include "util/types.hpp"
 
 #include "arm_math.h"
@@ -45,10 +46,20 @@ inline constexpr uint32_t REC_ID_MASK = 0x0000000F;
   ERROR_INFO         = 1U << 11U,  // 0x1000
   GNSS_INFO          = 1U << 12U,  // 0x2000
   VOLTAGE_INFO       = 1U << 13U,  // 0x4000
+  LOOP_TIMING_INFO   = 1U << 14U,  // 0x8000
+  APOGEE_PREDICTION  = 1U << 15U,  // 0x10000
+  FILTER_CONSISTENCY = 1U << 16U,  // 0x20000
 };
 // clang-format on
 
-enum rec_cmd_type_e { REC_CMD_INVALID = 0, REC_CMD_FILL_Q = 1, REC_CMD_FILL_Q_STOP, REC_CMD_WRITE, REC_CMD_WRITE_STOP };
+enum rec_cmd_type_e {
+  REC_CMD_INVALID = 0,
+  REC_CMD_FILL_Q = 1,
+  REC_CMD_FILL_Q_STOP,
+  REC_CMD_WRITE,
+  REC_CMD_WRITE_STOP,
+  REC_CMD_SAVE_CALIBRATION
+};
 
 struct flight_info_t {
   float32_t height;
@@ -89,10 +100,13 @@ union rec_elem_u {
   error_info_t error_info;
   gnss_position_t gnss_info;
   voltage_info_t voltage_info;
+  loop_timing_info_t loop_timing_info;
+  apogee_prediction_t apogee_prediction;
+  filter_consistency_t filter_consistency;
 };
 
 struct rec_elem_t {
-  timestamp_t ts;
+  timestamp_us_t ts;
   rec_entry_type_e rec_type;
   rec_elem_u u;
 };
@@ -101,18 +115,23 @@ struct rec_elem_t {
 
 struct flight_stats_t {
   cats_config_t config{};
+  /* Timestamp of the first flight info entry written to flash. The times of the maxima are relative to it, the us
+   * since boot wrap around after ~71 min. */
+  timestamp_us_t start_ts{};
+  bool started{};
+
   struct {
-    timestamp_t ts;
+    timestamp_us_t ts;
     float32_t val;
   } max_height{};
 
   struct {
-    timestamp_t ts;
+    timestamp_us_t ts;
     float32_t val;
   } max_velocity{};
 
   struct {
-    timestamp_t ts;
+    timestamp_us_t ts;
     float32_t val;
   } max_acceleration{};
 
@@ -120,6 +139,9 @@ struct flight_stats_t {
   float32_t height_0{};
 
   gnss_time_t liftoff_time{};
+
+  /* Consistency of the Kalman filter, indexed by flight_fsm_e */
+  consistency_summary_t consistency[TOUCHDOWN + 1]{};
 };
 
 /** Exported Variables **/
@@ -128,12 +150,13 @@ extern flight_stats_t global_flight_stats;
 
 /** Exported Functions **/
 
-void record(timestamp_t ts, rec_entry_type_e rec_type_with_id, const void *rec_value);
+void record(timestamp_us_t ts, rec_entry_type_e rec_type_with_id, const void *rec_value);
 
 inline void init_global_flight_stats() {
   /* Save current flight config */
   memcpy(&global_flight_stats.config, &global_cats_config, sizeof(global_cats_config));
   /* Initialize nonzero members */
+  global_flight_stats.started = false;
   global_flight_stats.max_height.val = -INFINITY;
   global_flight_stats.max_velocity.val = -INFINITY;
   global_flight_stats.max_acceleration.val = -INFINITY;
@@ -6,6 +6,7 @@
 
 #include "config/cats_config.hpp"
 #include "config/globals.hpp"
+#include "config/stored_calibration.hpp"
 #include "drivers/servo.hpp"
 #include "util/actions.hpp"
 #include "util/log.h"
@@ -17,10 +18,16 @@ static void init_timers();
 
 void load_and_set_config() {
   HAL_Delay(100);
-  cc_init();
   cc_load();
+  /* The tasks are set up for this frequency, a changed config only takes effect after a reboot */
+  global_control_sampling_freq = cc_get_control_sampling_freq();
+  cc_init();
   log_info("Config initialization complete.");
 
+  if (calibration_load()) {
+    log_info("Stored calibration found.");
+  }
+
   HAL_Delay(100);
   create_event_map();
   init_timers();
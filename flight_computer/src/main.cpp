@@ -11,6 +11,7 @@
 #include "config/globals.hpp"
 #include "util/battery.hpp"
 #include "util/log.h"
+#include "util/loop_timing.hpp"
 #include "util/task_util.hpp"
 
 #include "init/config.hpp"
@@ -133,6 +134,8 @@ int main() {
   battery_monitor_init(global_cats_config.battery_type);
   log_info("Battery monitor initialization complete.");
 
+  loop_timing_init();
+
   /* Init scheduler */
   osKernelInitialize();
 
@@ -154,19 +157,37 @@ int main() {
   if (!global_cats_config.enable_testing_mode) {
     task::Recorder::Start();
 
-    static const task::SensorRead& task_sensor_read = task::SensorRead::Start(&imu, &barometer);
+    // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+    static task::SensorRead& task_sensor_read = task::SensorRead::Start(&imu, &barometer);
 
-    static const task::Preprocessing& task_preprocessing = task::Preprocessing::Start(task_sensor_read);
+    // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+    static task::Preprocessing& task_preprocessing = task::Preprocessing::Start(task_sensor_read);
 
     // NOLINTNEXTLINE(cppcoreguidelines-init-variables,cppcoreguidelines-avoid-non-const-global-variables)
     static task::StateEstimation& task_state_estimation = task::StateEstimation::Start(task_preprocessing);
 
-    task::FlightFsm::Start(task_preprocessing, task_state_estimation);
+    [[maybe_unused]] task::FlightFsm& task_flight_fsm =
+        task::FlightFsm::Start(task_preprocessing, task_state_estimation);
+
+#ifdef USE_DATAFLOW_PIPELINE
+    /* Every stage is woken by the previous one, the threads only run once the scheduler is started. A stage can be
+     * woken only every N-th time the previous one published by passing N as the decimation. */
+    task_sensor_read.SetDataSubscriber(task_preprocessing);
+    task_preprocessing.SetDataSubscriber(task_state_estimation);
+    task_state_estimation.SetDataSubscriber(task_flight_fsm);
+#endif
 
     task_state_estimation_ptr = &task_state_estimation;
   }
 
-  task::Telemetry::Start(task_state_estimation_ptr, task_buzzer);
+  [[maybe_unused]] const task::Telemetry& task_telemetry =
+      task::Telemetry::Start(task_state_estimation_ptr, task_buzzer);
+
+#ifdef USE_GNSS_FUSION
+  if (task::global_state_estimation != nullptr) {
+    task::global_state_estimation->SetGnssSource(&task_telemetry);
+  }
+#endif
 
   log_info("Task initialization complete.");
 
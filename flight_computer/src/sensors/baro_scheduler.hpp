@@ -0,0 +1,160 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "sensors/ms5607.hpp"
+#include "util/types.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace sensor {
+
+/**
+ * Chooses the over sampling rate and the order of pressure and temperature conversions of the barometer. The scheduler
+ * is ticked once per sensor task slot and keeps a conversion running for as many slots as its datasheet conversion
+ * time requires.
+ */
+class BaroScheduler {
+ public:
+  /// Conversion settings of a flight phase
+  struct PhaseConfig {
+    /// Over sampling rate of all conversions
+    Ms5607::Osr osr;
+    /// Number of pressure conversions between two temperature conversions
+    uint8_t pressure_per_temperature;
+  };
+
+  /// Conversion settings indexed by the flight phase
+  static constexpr std::array<PhaseConfig, TOUCHDOWN + 1> kPhaseConfig = {{
+      /* INVALID */ {.osr = Ms5607::Osr::kOsr1024, .pressure_per_temperature = 1U},
+      /* CALIBRATING, quiet height_0 */ {.osr = Ms5607::Osr::kOsr4096, .pressure_per_temperature = 4U},
+      /* READY */ {.osr = Ms5607::Osr::kOsr4096, .pressure_per_temperature = 4U},
+      /* THRUSTING, pressure rate matters most and the temperature barely changes within seconds */
+      {.osr = Ms5607::Osr::kOsr512, .pressure_per_temperature = 8U},
+      /* COASTING */ {.osr = Ms5607::Osr::kOsr512, .pressure_per_temperature = 8U},
+      /* DROGUE */ {.osr = Ms5607::Osr::kOsr2048, .pressure_per_temperature = 4U},
+      /* MAIN */ {.osr = Ms5607::Osr::kOsr2048, .pressure_per_temperature = 4U},
+      /* TOUCHDOWN */ {.osr = Ms5607::Osr::kOsr4096, .pressure_per_temperature = 1U},
+  }};
+
+  /// Next conversion to start
+  struct Conversion {
+    Ms5607::Request request;
+    Ms5607::Osr osr;
+  };
+
+  /** Constructor
+   *
+   * @param slot_time time between two calls of Tick in us
+   */
+  explicit constexpr BaroScheduler(uint32_t slot_time) : m_slot_time{slot_time} {}
+
+  /** Get the number of slots a conversion occupies
+   *
+   * @param osr over sampling rate of the conversion
+   * @return number of slots until the result can be read
+   */
+  [[nodiscard]] constexpr uint32_t GetConversionSlots(const Ms5607::Osr osr) const {
+    return (Ms5607::GetConversionTime(osr) + m_slot_time - 1U) / m_slot_time;
+  }
+
+  /** Change the flight phase, the settings are applied from the next conversion on
+   *
+   * @param phase new flight phase
+   */
+  constexpr void SetPhase(const flight_fsm_e phase) {
+    if (phase <= TOUCHDOWN) {
+      m_phase = phase;
+    }
+  }
+
+  /** Advance by one slot
+   *
+   * @return true if the running conversion is finished, the result needs to be read and the next conversion started
+   */
+  constexpr bool Tick() {
+    if (m_remaining_slots > 0U) {
+      m_remaining_slots--;
+    }
+    return m_remaining_slots == 0U;
+  }
+
+  /** Select the next conversion and start counting its slots
+   *
+   * @return the conversion to prepare
+   */
+  constexpr Conversion Next() {
+    const PhaseConfig& config = kPhaseConfig[m_phase];
+    Ms5607::Request request = Ms5607::Request::kPressure;
+    if (m_pressure_count >= config.pressure_per_temperature) {
+      request = Ms5607::Request::kTemperature;
+      m_pressure_count = 0U;
+    } else {
+      m_pressure_count++;
+    }
+    m_remaining_slots = GetConversionSlots(config.osr);
+    return {.request = request, .osr = config.osr};
+  }
+
+ private:
+  /// Time between two ticks in us
+  uint32_t m_slot_time;
+  /// Current flight phase
+  flight_fsm_e m_phase{CALIBRATING};
+  /// Slots until the running conversion is finished
+  uint32_t m_remaining_slots{0U};
+  /// Pressure conversions since the last temperature conversion, starts with a temperature conversion
+  uint8_t m_pressure_count{UINT8_MAX};
+};
+
+namespace baro_scheduler_check {
+
+/* Compile time checks of the schedule against the datasheet conversion times, to be used in static_asserts with the
+ * slot time of the sensor task */
+
+/* Every phase needs to allot enough slots for its conversions */
+constexpr bool conversions_fit(uint32_t slot_time) {
+  const BaroScheduler scheduler{slot_time};
+  for (const auto& config : BaroScheduler::kPhaseConfig) {
+    const uint32_t slots = scheduler.GetConversionSlots(config.osr);
+    if ((slots == 0U) || (slots * slot_time < Ms5607::GetConversionTime(config.osr))) {
+      return false;
+    }
+    if (config.pressure_per_temperature == 0U) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Run the schedule of a phase and check that no conversion is read early */
+constexpr bool schedule_respects_conversion_time(uint32_t slot_time, flight_fsm_e phase) {
+  BaroScheduler scheduler{slot_time};
+  scheduler.SetPhase(phase);
+  uint32_t elapsed = 0U;
+  uint32_t required = 0U;
+  bool first = true;
+  uint32_t temperature_count = 0U;
+  for (uint32_t i = 0U; i < 100U; i++) {
+    if (scheduler.Tick()) {
+      if (!first && (elapsed < required)) {
+        return false;
+      }
+      const auto conversion = scheduler.Next();
+      temperature_count += (conversion.request == Ms5607::Request::kTemperature) ? 1U : 0U;
+      required = Ms5607::GetConversionTime(conversion.osr);
+      elapsed = 0U;
+      first = false;
+    }
+    elapsed += slot_time;
+  }
+  /* The temperature needs to be refreshed regularly */
+  return temperature_count > 0U;
+}
+
+}  // namespace baro_scheduler_check
+
+}  // namespace sensor
@@ -7,15 +7,20 @@
 #include "drivers/gpio.hpp"
 #include "drivers/spi.hpp"
 #include "util/log.h"
+#include "util/types.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstring>
-#include <vector>
 
 namespace sensor {
 
 class Lsm6dso32 {
  public:
+  /// Output data rate of both the accelerometer and the gyroscope in Hz, every sample is batched into the FIFO
+  static constexpr uint32_t kSampleRate = 416U;
+
   /** Constructor
    *
    * @param spi reference the the SPI interface @injected
@@ -36,16 +41,86 @@ class Lsm6dso32 {
     }
 
     // Configure Accelerometer
-    temp = static_cast<uint8_t>(ImuOdr::kOdr104Hz) | static_cast<uint8_t>(AccelerometerFs::kFs32G);
+    temp = static_cast<uint8_t>(ImuOdr::kOdr416Hz) | static_cast<uint8_t>(AccelerometerFs::kFs32G);
     WriteRegister(static_cast<uint8_t>(Register::kCtrl1Xl), &temp, 1U);
 
     // Configure Gyroscope
-    temp = static_cast<uint8_t>(ImuOdr::kOdr104Hz) | static_cast<uint8_t>(GyroscopeFs::kFs2000Dps);
+    temp = static_cast<uint8_t>(ImuOdr::kOdr416Hz) | static_cast<uint8_t>(GyroscopeFs::kFs2000Dps);
     WriteRegister(static_cast<uint8_t>(Register::kCtrl2G), &temp, 1U);
 
+    // Batch both sensors at their output data rate into the FIFO, the oldest data is overwritten when it is full
+    temp = static_cast<uint8_t>(static_cast<uint8_t>(FifoBdr::kBdr417Hz) << 4U) |
+           static_cast<uint8_t>(FifoBdr::kBdr417Hz);
+    WriteRegister(static_cast<uint8_t>(Register::kFifoCtrl3), &temp, 1U);
+    temp = static_cast<uint8_t>(FifoMode::kContinuous);
+    WriteRegister(static_cast<uint8_t>(Register::kFifoCtrl4), &temp, 1U);
+
+    m_pending_sample = {};
+    m_pending_flags = 0U;
+
     return true;
   }
 
+  /** Set the FIFO watermark
+   *
+   * @param num_samples number of accelerometer and gyroscope sample pairs after which the watermark flag is set
+   */
+  void SetFifoWatermark(const uint16_t num_samples) {
+    // The watermark is counted in FIFO words, every sample pair occupies two of them
+    const uint16_t num_words = num_samples * 2U;
+    const uint8_t wtm[2] = {static_cast<uint8_t>(num_words & 0xFFU), static_cast<uint8_t>((num_words >> 8U) & 0x01U)};
+    WriteRegister(static_cast<uint8_t>(Register::kFifoCtrl1), wtm, 2U);
+  }
+
+  /** Route the FIFO watermark flag to the INT1 pin */
+  void EnableFifoWatermarkInterrupt() {
+    const uint8_t temp = kInt1FifoThreshold;
+    WriteRegister(static_cast<uint8_t>(Register::kInt1Ctrl), &temp, 1U);
+  }
+
+  /** Read all samples from the FIFO
+   *
+   * @note The FIFO is read in bursts of at most kFifoBurstWords words, if it holds more samples than fit into the
+   * buffer the oldest ones are dropped.
+   *
+   * @param samples buffer for the samples, ordered from oldest to newest
+   * @param max_samples size of the buffer
+   * @param num_dropped number of samples read from the FIFO but not stored in the buffer
+   * @return number of samples written to the buffer
+   */
+  size_t ReadFifo(imu_data_t* samples, const size_t max_samples, size_t& num_dropped) {
+    size_t count = 0U;
+    num_dropped = 0U;
+
+    uint8_t status[2] = {};
+    ReadRegister(static_cast<uint8_t>(Register::kFifoStatus1), status, 2U);
+    size_t num_words = static_cast<size_t>(status[0]) | (static_cast<size_t>(status[1] & 0x03U) << 8U);
+
+    uint8_t words[kFifoBurstWords * kFifoWordSize];
+    while (num_words > 0U) {
+      const size_t burst_words = std::min(num_words, kFifoBurstWords);
+      num_words -= burst_words;
+      // The address rolls over from the last data byte back to the tag register, the burst is therefore contiguous
+      ReadRegister(static_cast<uint8_t>(Register::kFifoDataOutTag), words, burst_words * kFifoWordSize);
+
+      for (size_t i = 0U; i < burst_words; i++) {
+        if (!DecodeFifoWord(&words[i * kFifoWordSize])) {
+          continue;
+        }
+        if (count == max_samples) {
+          // Keep the newest samples
+          std::memmove(samples, samples + 1, (max_samples - 1U) * sizeof(imu_data_t));
+          count--;
+          num_dropped++;
+        }
+        samples[count] = m_pending_sample;
+        count++;
+      }
+    }
+
+    return count;
+  }
+
   /** Read raw gyroscope data from the sensor
    *
    * @param data pointer to write the raw data to, needs to be of size 3!
@@ -76,13 +151,19 @@ class Lsm6dso32 {
    * @param length length of read data
    */
   void ReadRegister(const uint8_t reg, uint8_t* const data, const size_t length) {
-    // Set the read flag of the register
-    uint8_t read_reg = reg | static_cast<uint8_t>(0x80U);
+    if (length + 1U > m_tx_buffer.size()) {
+      std::memset(data, 0, length);
+      return;
+    }
+    // Set the read flag of the register, the data is clocked in during the same transaction
+    m_tx_buffer.fill(0U);
+    m_tx_buffer[0] = reg | static_cast<uint8_t>(0x80U);
     // Read from the sensor
-    m_cs.SetLow();
-    m_spi.Transfer(&read_reg, 1U);
-    m_spi.Receive(data, length);
-    m_cs.SetHigh();
+    if (m_spi.TransmitReceive(m_cs, m_tx_buffer.data(), m_rx_buffer.data(), length + 1U, kBusPriority)) {
+      std::memcpy(data, &m_rx_buffer[1], length);
+    } else {
+      std::memset(data, 0, length);
+    }
   }
 
   /** Write to a data register of the IMU
@@ -92,24 +173,75 @@ class Lsm6dso32 {
    * @param length length of write data
    */
   void WriteRegister(const uint8_t reg, const uint8_t* data, const size_t length) {
+    if (length + 1U > m_tx_buffer.size()) {
+      return;
+    }
     // Concatenate the register and the data
-    // NOLINTNEXTLINE(cppcoreguidelines-init-variables) linter is confused
-    std::vector<uint8_t> concatenated{};
-    concatenated.push_back(reg);
-    concatenated.insert(concatenated.end(), data, data + length);
+    m_tx_buffer[0] = reg;
+    std::memcpy(&m_tx_buffer[1], data, length);
     // Transfer the data
-    m_cs.SetLow();
-    m_spi.Transfer(concatenated.data(), length + 1U);
-    m_cs.SetHigh();
+    m_spi.TransmitReceive(m_cs, m_tx_buffer.data(), nullptr, length + 1U, kBusPriority);
+  }
+
+  /** Decode a FIFO word into the pending sample
+   *
+   * @param word pointer to the tag byte followed by the six data bytes
+   * @return true if both the accelerometer and the gyroscope part of the pending sample are complete
+   */
+  bool DecodeFifoWord(const uint8_t* word) {
+    const auto tag = static_cast<FifoTag>(word[0] >> 3U);
+    if (tag == FifoTag::kGyroscope) {
+      std::memcpy(&m_pending_sample.gyro, &word[1], sizeof(m_pending_sample.gyro));
+      m_pending_flags |= kPendingGyro;
+    } else if (tag == FifoTag::kAccelerometer) {
+      std::memcpy(&m_pending_sample.acc, &word[1], sizeof(m_pending_sample.acc));
+      m_pending_flags |= kPendingAcc;
+    }
+
+    if (m_pending_flags == (kPendingAcc | kPendingGyro)) {
+      m_pending_flags = 0U;
+      return true;
+    }
+    return false;
   }
 
   /// Scoped sensor register enum
   enum class Register : uint8_t {
+    kFifoCtrl1 = 0x07,
+    kFifoCtrl2 = 0x08,
+    kFifoCtrl3 = 0x09,
+    kFifoCtrl4 = 0x0A,
+    kInt1Ctrl = 0x0D,
     kWhoAmI = 0x0F,
     kCtrl1Xl = 0x10,
     kCtrl2G = 0x11,
     kOutXLG = 0x22,
     kOutXLA = 0x28,
+    kFifoStatus1 = 0x3A,
+    kFifoStatus2 = 0x3B,
+    kFifoDataOutTag = 0x78,
+  };
+
+  /// Scoped FIFO batch data rate enum, valid for both the accelerometer and the gyroscope
+  enum class FifoBdr : uint8_t {
+    kNotBatched = 0x00,
+    kBdr104Hz = 0x04,
+    kBdr208Hz = 0x05,
+    kBdr417Hz = 0x06,
+    kBdr833Hz = 0x07,
+  };
+
+  /// Scoped FIFO mode enum
+  enum class FifoMode : uint8_t {
+    kBypass = 0x00,
+    kFifo = 0x01,
+    kContinuous = 0x06,
+  };
+
+  /// Scoped FIFO tag enum, identifies the sensor a FIFO word belongs to
+  enum class FifoTag : uint8_t {
+    kGyroscope = 0x01,
+    kAccelerometer = 0x02,
   };
 
   /// Scoped sensor output data rate enum
@@ -143,10 +275,33 @@ class Lsm6dso32 {
     kFs2000Dps = 0x0C,
   };
 
+  /// Size of a FIFO word, the tag followed by three 16 bit values
+  static constexpr size_t kFifoWordSize = 7U;
+  /// Maximum number of FIFO words read in a single transaction
+  static constexpr size_t kFifoBurstWords = 16U;
+  /// Maximum number of data bytes in a single register access
+  static constexpr size_t kMaxTransferLength = kFifoBurstWords * kFifoWordSize;
+  /// INT1_CTRL bit routing the FIFO threshold flag to INT1
+  static constexpr uint8_t kInt1FifoThreshold = 0x08U;
+  /// Pending sample flag set once the accelerometer part was read from the FIFO
+  static constexpr uint8_t kPendingAcc = 0x01U;
+  /// Pending sample flag set once the gyroscope part was read from the FIFO
+  static constexpr uint8_t kPendingGyro = 0x02U;
+  /// The IMU is read at the highest rate and is served first on a shared bus
+  static constexpr driver::Spi::Priority kBusPriority = driver::Spi::Priority::kHigh;
+
   /// Reference to the spi interface
   driver::Spi& m_spi;
   /// Reference to the chip select pin
   driver::OutputPin& m_cs;
+  /// Transmit buffer, holds the register address followed by the data
+  std::array<uint8_t, kMaxTransferLength + 1U> m_tx_buffer{};
+  /// Receive buffer, the first byte is clocked in while sending the register address
+  std::array<uint8_t, kMaxTransferLength + 1U> m_rx_buffer{};
+  /// Sample assembled from the FIFO, accelerometer and gyroscope data arrive in separate words
+  imu_data_t m_pending_sample{};
+  /// Parts of the pending sample already read from the FIFO
+  uint8_t m_pending_flags{0U};
 };
 
 }  // namespace sensor
@@ -7,8 +7,9 @@
 #include "drivers/gpio.hpp"
 #include "drivers/spi.hpp"
 
+#include <array>
 #include <cstdint>
-#include <vector>
+#include <cstring>
 
 namespace sensor {
 
@@ -20,6 +21,36 @@ class Ms5607 {
     kTemperature = 0x50,
   };
 
+  /// Sensor over sampling rate enum
+  enum class Osr : uint8_t {
+    kOsr256 = 0x00,
+    kOsr512 = 0x02,
+    kOsr1024 = 0x04,
+    kOsr2048 = 0x06,
+    kOsr4096 = 0x08,
+  };
+
+  /** Get the maximum conversion time from the datasheet
+   *
+   * @param osr over sampling rate of the conversion
+   * @return conversion time in us
+   */
+  static constexpr uint32_t GetConversionTime(const Osr osr) {
+    switch (osr) {
+      case Osr::kOsr256:
+        return 600U;
+      case Osr::kOsr512:
+        return 1170U;
+      case Osr::kOsr1024:
+        return 2280U;
+      case Osr::kOsr2048:
+        return 4540U;
+      case Osr::kOsr4096:
+      default:
+        return 9040U;
+    }
+  }
+
   /** Constructor
    *
    * @param spi reference the the SPI interface @injected
@@ -50,15 +81,24 @@ class Ms5607 {
   }
 
   /** Prepare a new measurement
+   *
+   * @note The result can only be read after the conversion time of the chosen over sampling rate
    *
    * @param req The measurement to perform
+   * @param osr The over sampling rate of the conversion
    */
-  void Prepare(const Request req) {
+  void Prepare(const Request req, const Osr osr = Osr::kOsr1024) {
     m_last_request = req;
 
-    WriteCommand(static_cast<uint8_t>(req) | static_cast<uint8_t>(Osr::kOsr1024));
+    WriteCommand(static_cast<uint8_t>(req) | static_cast<uint8_t>(osr));
   }
 
+  /** Get the last measurement request
+   *
+   * @return The measurement prepared last
+   */
+  [[nodiscard]] Request GetLastRequest() const { return m_last_request; }
+
   /** Readout the requested measurement */
   void Read() {
     if (m_last_request == Request::kPressure) {
@@ -68,6 +108,31 @@ class Ms5607 {
     }
   }
 
+  /** Readout the requested measurement and prepare the next one in a single bus access
+   *
+   * @param req The measurement to perform next
+   * @param osr The over sampling rate of the next conversion
+   */
+  void ReadAndPrepare(const Request req, const Osr osr = Osr::kOsr1024) {
+    uint8_t *const data = (m_last_request == Request::kPressure) ? m_pressure : m_temperature;
+    m_last_request = req;
+
+    m_tx_buffer.fill(0U);
+    m_tx_buffer[0] = static_cast<uint8_t>(Command::kAdcRead);
+    m_command_buffer = static_cast<uint8_t>(req) | static_cast<uint8_t>(osr);
+
+    // Both transfers are started back to back, the conversion starts as soon as the result was read
+    driver::Spi::Transaction transactions[2] = {
+        {.cs = &m_cs, .tx = m_tx_buffer.data(), .rx = m_rx_buffer.data(), .length = 4U, .priority = kBusPriority},
+        {.cs = &m_cs, .tx = &m_command_buffer, .rx = nullptr, .length = 1U, .priority = kBusPriority},
+    };
+    if (m_spi.TransmitReceiveBatch(transactions, 2U)) {
+      std::memcpy(data, &m_rx_buffer[1], 3U);
+    } else {
+      std::memset(data, 0, 3U);
+    }
+  }
+
   /** Get the measurement results
    *
    * @note Only call this fucntion after preparing and reading out both the air pressure and the temperature
@@ -105,11 +170,19 @@ class Ms5607 {
    * @param length length of read data
    */
   void ReadData(uint8_t reg, uint8_t *const data, const size_t length) {
+    if (length + 1U > m_tx_buffer.size()) {
+      std::memset(data, 0, length);
+      return;
+    }
+    // The data is clocked in during the same transaction as the command
+    m_tx_buffer.fill(0U);
+    m_tx_buffer[0] = reg;
     // Read from the sensor
-    m_cs.SetLow();
-    m_spi.Transfer(&reg, 1U);
-    m_spi.Receive(data, length);
-    m_cs.SetHigh();
+    if (m_spi.TransmitReceive(m_cs, m_tx_buffer.data(), m_rx_buffer.data(), length + 1U, kBusPriority)) {
+      std::memcpy(data, &m_rx_buffer[1], length);
+    } else {
+      std::memset(data, 0, length);
+    }
   }
 
   /** Write to a data register of the IMU
@@ -120,9 +193,8 @@ class Ms5607 {
    */
   void WriteCommand(uint8_t reg) {
     // Transfer the data
-    m_cs.SetLow();
-    m_spi.Transfer(&reg, 1U);
-    m_cs.SetHigh();
+    m_tx_buffer[0] = reg;
+    m_spi.TransmitReceive(m_cs, m_tx_buffer.data(), nullptr, 1U, kBusPriority);
   }
 
   /// Sensor commands enum
@@ -132,14 +204,10 @@ class Ms5607 {
     kPromRead = 0xA0,
   };
 
-  /// Sensor over sampling rate enum
-  enum class Osr : uint8_t {
-    kOsr256 = 0x00,
-    kOsr512 = 0x02,
-    kOsr1024 = 0x04,
-    kOsr2048 = 0x06,
-    kOsr4096 = 0x08,
-  };
+  /// Maximum number of data bytes in a single read
+  static constexpr size_t kMaxTransferLength = 3U;
+  /// The barometer yields to the IMU on a shared bus
+  static constexpr driver::Spi::Priority kBusPriority = driver::Spi::Priority::kMedium;
 
   /// Reference to the spi interface
   driver::Spi &m_spi;
@@ -153,6 +221,12 @@ class Ms5607 {
   uint8_t m_temperature[3]{};
   /// The barometer calibration coefficients
   uint16_t m_coefficients[6]{};
+  /// Transmit buffer, holds the command followed by dummy bytes
+  std::array<uint8_t, kMaxTransferLength + 1U> m_tx_buffer{};
+  /// Receive buffer, the first byte is clocked in while sending the command
+  std::array<uint8_t, kMaxTransferLength + 1U> m_rx_buffer{};
+  /// Conversion command sent after a readout
+  uint8_t m_command_buffer{0U};
 };
 
 }  // namespace sensor
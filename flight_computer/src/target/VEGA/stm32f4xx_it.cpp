@@ -45,6 +45,9 @@
 
 /* External variables --------------------------------------------------------*/
 extern DMA_HandleTypeDef hdma_adc1;
+extern DMA_HandleTypeDef hdma_spi1_rx;
+extern DMA_HandleTypeDef hdma_spi1_tx;
+extern SPI_HandleTypeDef hspi1;
 extern TIM_HandleTypeDef htim1;
 
 /* USER CODE BEGIN EV */
@@ -138,6 +141,13 @@ void DebugMon_Handler(void) {
 /* please refer to the startup file (startup_stm32f4xx.s).                    */
 /******************************************************************************/
 
+#ifdef USE_IMU_DRDY
+/**
+ * @brief This function handles the EXTI line of the IMU INT1 pin, the handler name is set by the target.
+ */
+extern "C" void IMU_INT1_EXTI_IRQHandler(void) { HAL_GPIO_EXTI_IRQHandler(IMU_INT1_Pin); }
+#endif
+
 /**
  * @brief This function handles TIM1 update interrupt and TIM10 global interrupt.
  */
@@ -177,6 +187,19 @@ void USART2_IRQHandler(void) {
   /* USER CODE END USART2_IRQn 1 */
 }
 
+/**
+ * @brief This function handles SPI1 global interrupt.
+ */
+void SPI1_IRQHandler(void) {
+  /* USER CODE BEGIN SPI1_IRQn 0 */
+
+  /* USER CODE END SPI1_IRQn 0 */
+  HAL_SPI_IRQHandler(&hspi1);
+  /* USER CODE BEGIN SPI1_IRQn 1 */
+
+  /* USER CODE END SPI1_IRQn 1 */
+}
+
 /**
  * @brief This function handles DMA2 stream0 global interrupt.
  */
@@ -190,6 +213,32 @@ void DMA2_Stream0_IRQHandler(void) {
   /* USER CODE END DMA2_Stream0_IRQn 1 */
 }
 
+/**
+ * @brief This function handles DMA2 stream2 global interrupt.
+ */
+void DMA2_Stream2_IRQHandler(void) {
+  /* USER CODE BEGIN DMA2_Stream2_IRQn 0 */
+
+  /* USER CODE END DMA2_Stream2_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_spi1_rx);
+  /* USER CODE BEGIN DMA2_Stream2_IRQn 1 */
+
+  /* USER CODE END DMA2_Stream2_IRQn 1 */
+}
+
+/**
+ * @brief This function handles DMA2 stream3 global interrupt.
+ */
+void DMA2_Stream3_IRQHandler(void) {
+  /* USER CODE BEGIN DMA2_Stream3_IRQn 0 */
+
+  /* USER CODE END DMA2_Stream3_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_spi1_tx);
+  /* USER CODE BEGIN DMA2_Stream3_IRQn 1 */
+
+  /* USER CODE END DMA2_Stream3_IRQn 1 */
+}
+
 /**
  * @brief This function handles USB On The Go FS global interrupt.
  */
@@ -12,9 +12,12 @@ DMA_HandleTypeDef hdma_adc1;
 
 SPI_HandleTypeDef hspi1;
 SPI_HandleTypeDef hspi2;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
 
 TIM_HandleTypeDef htim3;
 TIM_HandleTypeDef htim4;
+TIM_HandleTypeDef htim5;
 
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
@@ -271,6 +274,38 @@ static void MX_TIM4_Init() {
   HAL_TIM_MspPostInit(&htim4);
 }
 
+/**
+ * @brief TIM5 Initialization Function, free running 32 bit microsecond counter
+ * @param None
+ * @retval None
+ */
+static void MX_TIM5_Init() {
+  TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  htim5.Instance = TIM5;
+  htim5.Init.Prescaler = 95;
+  htim5.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim5.Init.Period = 0xFFFFFFFF;
+  htim5.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim5.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim5) != HAL_OK) {
+    Error_Handler();
+  }
+  sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+  if (HAL_TIM_ConfigClockSource(&htim5, &sClockSourceConfig) != HAL_OK) {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim5, &sMasterConfig) != HAL_OK) {
+    Error_Handler();
+  }
+  if (HAL_TIM_Base_Start(&htim5) != HAL_OK) {
+    Error_Handler();
+  }
+}
+
 /**
  * @brief USART1 Initialization Function
  * @param None
@@ -342,6 +377,13 @@ static void MX_DMA_Init() {
   /* DMA2_Stream0_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 0, 0);
   HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+  /* DMA2_Stream2_IRQn interrupt configuration, the completion callback notifies tasks and therefore needs to be at or
+   * below configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY */
+  HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+  /* DMA2_Stream3_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
 }
 
 /**
@@ -394,6 +436,19 @@ static void MX_GPIO_Init() {
   GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+#ifdef USE_IMU_DRDY
+  /*Configure GPIO pin : IMU_INT1_Pin */
+  GPIO_InitStruct.Pin = IMU_INT1_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+  HAL_GPIO_Init(IMU_INT1_GPIO_Port, &GPIO_InitStruct);
+
+  /* EXTI interrupt init, the callback notifies a task and therefore needs to be at or below
+   * configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY */
+  HAL_NVIC_SetPriority(IMU_INT1_EXTI_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(IMU_INT1_EXTI_IRQn);
+#endif
 }
 
 /**
@@ -427,6 +482,7 @@ bool target_init() {
   MX_SPI2_Init();
   MX_TIM3_Init();
   MX_TIM4_Init();
+  MX_TIM5_Init();
   MX_USART1_UART_Init();
   MX_USART2_UART_Init();
   return static_cast<bool>(HAL_GPIO_ReadPin(USB_DET_GPIO_Port, USB_DET_Pin));
@@ -37,6 +37,18 @@
 /***** Peripherals config *****/
 // #define USE_CAN
 
+/* IMU data ready interrupt. The VEGA pinout above lists no MCU pin for the IMU INT1 line, so there is no default: the
+ * pin, its EXTI line and the interrupt handler have to be taken from the schematic of a board revision which routes
+ * INT1 to the MCU, e.g. for a line on PB3:
+ *   #define IMU_INT1_Pin              GPIO_PIN_3
+ *   #define IMU_INT1_GPIO_Port        GPIOB
+ *   #define IMU_INT1_EXTI_IRQn        EXTI3_IRQn
+ *   #define IMU_INT1_EXTI_IRQHandler  EXTI3_IRQHandler */
+// #define USE_IMU_DRDY
+#if defined(USE_IMU_DRDY) && !defined(IMU_INT1_Pin)
+#error "USE_IMU_DRDY needs the IMU INT1 pin of the board, see above"
+#endif
+
 // NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
 /* ADC config */
 extern ADC_HandleTypeDef hadc1;
@@ -50,10 +62,13 @@ extern RTC_HandleTypeDef hrtc;
 /* SPI config */
 extern SPI_HandleTypeDef hspi1;
 extern SPI_HandleTypeDef hspi2;
+extern DMA_HandleTypeDef hdma_spi1_rx;
+extern DMA_HandleTypeDef hdma_spi1_tx;
 
 /* Timer config */
 extern TIM_HandleTypeDef htim3;
 extern TIM_HandleTypeDef htim4;
+extern TIM_HandleTypeDef htim5;
 
 /* CAN config */
 #ifdef USE_CAN
@@ -82,6 +97,9 @@ extern UART_HandleTypeDef huart2;
 #define BUZZER_TIMER_HANDLE  htim4
 #define BUZZER_TIMER_CHANNEL TIM_CHANNEL_1
 
+/* Free running 32 bit timer counting microseconds */
+#define MICROS_TIMER_HANDLE htim5
+
 /* Sensor config */
 inline constexpr uint8_t NUM_IMU = 1;
 inline constexpr uint8_t NUM_BARO = 1;
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "config/globals.hpp"
+#include "util/task_util.hpp"
 #include "util/types.hpp"
 
 #include "cmsis_os.h"
@@ -48,6 +49,17 @@ class Task {
     return task;
   }
 
+  [[nodiscard]] osThreadId_t GetThreadId() const noexcept { return m_thread_id; }
+
+  /* Wake the given task every decimation-th time this task published new data */
+  template <typename S, uint32_t SUBSCRIBER_STACK_SZ>
+  void SetDataSubscriber(Task<S, SUBSCRIBER_STACK_SZ>& subscriber, uint32_t decimation = 1U) noexcept {
+    m_data_subscriber = subscriber.GetThreadId();
+    m_data_decimation = decimation;
+    m_data_counter = 0U;
+    subscriber.m_input_decimation = decimation;
+  }
+
  protected:
   /* Protected constructor */
   Task() = default;
@@ -75,10 +87,38 @@ class Task {
   // NOLINTNEXTLINE(misc-misplaced-const)
   void SetThreadId(const osThreadId_t thread_id) { m_thread_id = thread_id; }
 
+  /* Called after publishing new data */
+  void NotifyDataSubscriber() noexcept {
+    if (m_data_subscriber == nullptr) {
+      return;
+    }
+    if (++m_data_counter >= m_data_decimation) {
+      m_data_counter = 0U;
+      osThreadFlagsSet(m_data_subscriber, THREAD_FLAG_NEW_DATA);
+    }
+  }
+
+  /* Sleep until the previous stage published new data, returns false on timeout. The timeout is given per publication
+   * of the previous stage and scaled by the decimation this task is woken with. */
+  bool WaitForData(uint32_t timeout) noexcept {
+    const uint32_t flags = osThreadFlagsWait(THREAD_FLAG_NEW_DATA, osFlagsWaitAny, timeout * m_input_decimation);
+    return (flags & osFlagsError) == 0U;
+  }
+
  private:
+  /* The publisher sets the decimation its subscriber is woken with */
+  template <typename, uint32_t>
+  friend class Task;
+
   std::array<uint32_t, STACK_SZ> m_task_buffer{};
   StaticTask_t m_task_control_block{};
   osThreadId_t m_thread_id{nullptr};
+  osThreadId_t m_data_subscriber{nullptr};
+  /* Publications per wake-up of the subscriber, and publications since its last wake-up */
+  uint32_t m_data_decimation{1U};
+  uint32_t m_data_counter{0U};
+  /* Publications of the previous stage per wake-up of this task */
+  uint32_t m_input_decimation{1U};
 
   const osThreadAttr_t m_task_attributes = {
       // TODO: This is not a good name
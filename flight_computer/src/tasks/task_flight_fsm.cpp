@@ -10,6 +10,7 @@
 #include "tasks/task_peripherals.hpp"
 #include "util/enum_str_maps.hpp"
 #include "util/log.h"
+#include "util/loop_timing.hpp"
 #include "util/task_util.hpp"
 
 namespace task {
@@ -21,24 +22,39 @@ namespace task {
   osEventFlagsSet(fsm_flag_id, CALIBRATING);
 
   trigger_event(EV_CALIBRATE);
-
-  flight_fsm_t flight_state = {.flight_state = CALIBRATING};
+  init_flight_phase(&m_flight_state);
 
   uint32_t tick_count = osKernelGetTickCount();
-  constexpr uint32_t tick_update = sysGetTickFreq() / CONTROL_SAMPLING_FREQ;
+  const uint32_t tick_update = sysGetTickFreq() / global_control_sampling_freq;
   while (true) {
-    /* Check Flight Phases */
-    check_flight_phase(&flight_state, m_task_preprocessing.GetSIData().acc, m_task_preprocessing.GetSIData().gyro,
-                       m_task_state_estimation.GetEstimationOutput(), &settings);
+#ifdef USE_DATAFLOW_PIPELINE
+    loop_timing_begin_triggered(LOOP_TIMING_FLIGHT_FSM, LOOP_TIMING_STATE_ESTIMATION);
+#else
+    loop_timing_begin(LOOP_TIMING_FLIGHT_FSM, tick_count);
+#endif
 
-    if (flight_state.state_changed) {
-      log_info("State Changed FlightFSM to %s", GetStr(flight_state.flight_state, fsm_map));
-      log_sim("State Changed FlightFSM to %s", GetStr(flight_state.flight_state, fsm_map));
-      record(tick_count, FLIGHT_STATE, &flight_state.flight_state);
+    /* Check Flight Phases */
+    const SI_data_t si_data = m_task_preprocessing.GetSIData();
+    m_flight_state.calibration_restored = m_task_preprocessing.IsCalibrationRestored();
+    check_flight_phase(&m_flight_state, si_data.acc, si_data.gyro, m_task_state_estimation.GetEstimationOutput(),
+                       &settings);
+
+    if (m_flight_state.state_changed) {
+      log_info("State Changed FlightFSM to %s", GetStr(m_flight_state.flight_state, fsm_map));
+      log_sim("State Changed FlightFSM to %s", GetStr(m_flight_state.flight_state, fsm_map));
+      record(sysGetMicros(), FLIGHT_STATE, &m_flight_state.flight_state);
     }
 
+    loop_timing_end(LOOP_TIMING_FLIGHT_FSM);
+
+#ifdef USE_DATAFLOW_PIPELINE
+    /* Run as soon as the previous stage published new data, the timeout keeps the task alive if it stalls */
+    WaitForData(2 * tick_update);
+    tick_count = osKernelGetTickCount();
+#else
     tick_count += tick_update;
     osDelayUntil(tick_count);
+#endif
   }
 }
 
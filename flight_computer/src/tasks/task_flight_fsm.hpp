@@ -18,6 +18,8 @@ class FlightFsm final : public Task<FlightFsm, 512> {
  private:
   const Preprocessing& m_task_preprocessing;
   StateEstimation& m_task_state_estimation;
+  /* Holds the windows of the current phase, which are too large for the task stack */
+  flight_fsm_t m_flight_state = {.flight_state = CALIBRATING};
   [[noreturn]] void Run() noexcept override;
 };
 
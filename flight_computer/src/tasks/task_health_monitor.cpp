@@ -10,6 +10,7 @@
 #include "util/actions.hpp"
 #include "util/battery.hpp"
 #include "util/log.h"
+#include "util/loop_timing.hpp"
 #include "util/task_util.hpp"
 
 #include "tasks/task_cdc.hpp"
@@ -40,7 +41,7 @@ static bool cli_task_started = false;
   m_task_buzzer.Beep(Buzzer::BeepCode::kBootup);
 
   uint32_t tick_count = osKernelGetTickCount();
-  constexpr uint32_t tick_update = sysGetTickFreq() / CONTROL_SAMPLING_FREQ;
+  constexpr uint32_t tick_update = sysGetTickFreq() / HEALTH_MONITOR_SAMPLING_FREQ;
 
   while (true) {
     /* Uncomment the code below to enable stack usage monitoring:
@@ -89,7 +90,13 @@ static bool cli_task_started = false;
     if (++voltage_logging_timer >= 100) {
       voltage_logging_timer = 0;
       uint16_t voltage = battery_voltage_short();
-      record(osKernelGetTickCount(), VOLTAGE_INFO, &voltage);
+      record(sysGetMicros(), VOLTAGE_INFO, &voltage);
+
+      /* Timing of the control tasks during the last second */
+      for (uint8_t i = 0; i < NUM_LOOP_TIMING_TASKS; i++) {
+        const loop_timing_info_t loop_timing = loop_timing_get_info(static_cast<loop_timing_task_e>(i));
+        record(sysGetMicros(), add_id_to_record_type(LOOP_TIMING_INFO, i), &loop_timing);
+      }
     }
 
     old_level = battery_level();
@@ -10,6 +10,7 @@
 #include "util/actions.hpp"
 #include "util/enum_str_maps.hpp"
 #include "util/log.h"
+#include "util/task_util.hpp"
 #include "util/types.hpp"
 
 const uint32_t EVENT_QUEUE_SIZE = 16;
@@ -47,7 +48,7 @@ namespace task {
       peripheral_act_t* action_list = event_action_map[curr_event].action_list;
       const uint8_t num_actions = event_action_map[curr_event].num_actions;
       for (uint32_t i = 0; i < num_actions; ++i) {
-        const timestamp_t curr_ts = osKernelGetTickCount();
+        const timestamp_us_t curr_ts = sysGetMicros();
         /* get the actuator function */
         peripheral_act_fp curr_fp = action_table[action_list[i].action];
         if (curr_fp != nullptr) {
@@ -62,7 +63,7 @@ namespace task {
       if (num_actions == 0) {
         log_error("EXECUTING EVENT: %s, ACTION: %s", GetStr(curr_event, event_map),
                   GetStr(action_list[0].action, action_map));
-        const timestamp_t curr_ts = osKernelGetTickCount();
+        const timestamp_us_t curr_ts = sysGetMicros();
         event_info_t event_info = {.event = curr_event, .action = {ACT_NO_OP}};
         record(curr_ts, EVENT_INFO, &event_info);
       }
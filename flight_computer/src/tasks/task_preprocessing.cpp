@@ -7,17 +7,25 @@
 #include "config/globals.hpp"
 #include "control/calibration.hpp"
 #include "control/data_processing.hpp"
+#include "control/sensor_bank.hpp"
+#include "flash/lfs_custom.hpp"
 #include "tasks/task_preprocessing.hpp"
+#include "util/int16_kernels.hpp"
 
+#include "util/loop_timing.hpp"
 #include "util/task_util.hpp"
 
-constexpr uint8_t MAX_NUM_SAME_VALUE = 7;
-
 namespace task {
 
-state_estimation_input_t Preprocessing::GetEstimationInput() const noexcept { return m_state_est_input; }
+#ifdef USE_MEDIAN_FILTER
+static_assert(Preprocessing::MedianFilterLength(MAX_CONTROL_SAMPLING_FREQ) <= MEDIAN_FILTER_MAX_SIZE);
+#endif
+
+state_estimation_input_t Preprocessing::GetEstimationInput() const noexcept { return m_state_est_input_channel.Read(); }
+
+SI_data_t Preprocessing::GetSIData() const noexcept { return m_si_data_channel.Read(); }
 
-SI_data_t Preprocessing::GetSIData() const noexcept { return m_si_data; }
+bool Preprocessing::IsCalibrationRestored() const noexcept { return m_calibration_restored_channel.Read(); }
 
 /**
  * @brief Function implementing the task_preprocessing thread.
@@ -27,14 +35,29 @@ SI_data_t Preprocessing::GetSIData() const noexcept { return m_si_data; }
 [[noreturn]] void Preprocessing::Run() noexcept {
   /* Infinite loop */
   uint32_t tick_count = osKernelGetTickCount();
-  constexpr uint32_t tick_update = sysGetTickFreq() / CONTROL_SAMPLING_FREQ;
+  const uint32_t tick_update = sysGetTickFreq() / global_control_sampling_freq;
+  const auto max_faulty_calib = static_cast<int32_t>(kFaultyCalibTime * global_control_sampling_freq / 1000U);
+  init_warm_start_check(&m_warm_start, &global_stored_calibration,
+                        static_cast<uint16_t>(WARM_START_TIME * global_control_sampling_freq / 1000U));
   while (true) {
+#ifdef USE_DATAFLOW_PIPELINE
+    loop_timing_begin_triggered(LOOP_TIMING_PREPROCESSING, LOOP_TIMING_SENSOR_READ);
+#else
+    loop_timing_begin(LOOP_TIMING_PREPROCESSING, tick_count);
+#endif
+
     /* update fsm enum */
     bool fsm_updated = GetNewFsmEnum();
 
     /* get new sensor data */
-    m_baro_data[0] = m_task_sensor_read.GetBaro(0);
-    m_imu_data[0] = m_task_sensor_read.GetImu(0);
+    uint32_t baro_count = 0U;
+    for (uint8_t i = 0; i < NUM_BARO; i++) {
+      m_baro_bank.Set(i, m_task_sensor_read.GetBaro(i));
+      baro_count += m_task_sensor_read.GetBaroCount(i);
+    }
+    m_state_est_input.height_updated = baro_count != m_baro_count;
+    m_baro_count = baro_count;
+    DecimateImuBatches();
 
     /* Do the sensor elimination */
     CheckSensors();
@@ -47,6 +70,15 @@ SI_data_t Preprocessing::GetSIData() const noexcept { return m_si_data; }
       calibrate_imu(&m_si_data.acc, &m_calibration);
       global_flight_stats.calibration_data.angle = m_calibration.angle;
       global_flight_stats.calibration_data.axis = m_calibration.axis;
+      /* A restored calibration is stored already */
+      if (m_gyro_calibrated && (m_warm_start.status != WARM_START_VALID)) {
+        StoreCalibration();
+      }
+    }
+
+    /* The full calibration continues as the fallback while the stored calibration is checked */
+    if (m_fsm_enum == CALIBRATING) {
+      CheckStoredCalibration();
     }
 
     /* calibrate gyro once at startup */
@@ -59,17 +91,20 @@ SI_data_t Preprocessing::GetSIData() const noexcept { return m_si_data; }
 
     /* Compute current height constantly before liftoff. If the state is calibrating, the filter is much faster. */
     if (m_fsm_enum == CALIBRATING) {
-      m_height_0 = approx_moving_average(calculate_height(m_si_data.pressure), true);
+      approx_moving_average(&m_height_0, calculate_height(m_si_data.pressure), true);
       global_flight_stats.height_0 = m_height_0;
     }
     /* Compute current height constantly before liftoff. If the state is ready, the filter is much slower. */
     if (m_fsm_enum == READY) {
-      m_height_0 = approx_moving_average(calculate_height(m_si_data.pressure), false);
+      approx_moving_average(&m_height_0, calculate_height(m_si_data.pressure), false);
       global_flight_stats.height_0 = m_height_0;
     }
 
     /* Get Sensor Readings already transformed in the right coordinate Frame */
     TransformData();
+#ifdef USE_MULTI_RATE_ESTIMATION
+    TransformImuSamples();
+#endif
 
     /* Check if there is a Calibration Error */
     if (m_fsm_enum == READY) {
@@ -79,7 +114,7 @@ SI_data_t Preprocessing::GetSIData() const noexcept { return m_si_data; }
       } else {
         faulty_calibration_counter = 0;
       }
-      if (faulty_calibration_counter > kMaxFaultyCalib) {
+      if (faulty_calibration_counter > max_faulty_calib) {
         add_error(CATS_ERR_CALIB);
       } else {
         clear_error(CATS_ERR_CALIB);
@@ -93,62 +128,82 @@ SI_data_t Preprocessing::GetSIData() const noexcept { return m_si_data; }
 
     memcpy(&m_si_data_old, &m_si_data, sizeof(m_si_data));
 
+    m_si_data_channel.Write(m_si_data);
+    m_state_est_input_channel.Write(m_state_est_input);
+    loop_timing_publish(LOOP_TIMING_PREPROCESSING);
+    NotifyDataSubscriber();
+
+    loop_timing_end(LOOP_TIMING_PREPROCESSING);
+
+#ifdef USE_DATAFLOW_PIPELINE
+    /* Run as soon as the previous stage published new data, the timeout keeps the task alive if it stalls */
+    WaitForData(2 * tick_update);
+    tick_count = osKernelGetTickCount();
+#else
     tick_count += tick_update;
     osDelayUntil(tick_count);
+#endif
   }
 }
 
-void Preprocessing::AvgToSi() noexcept {
-  float32_t counter = 0;
-  if constexpr (NUM_IMU > 0) {
-    /* Reset SI data */
-    m_si_data.acc.x = 0;
-    m_si_data.acc.y = 0;
-    m_si_data.acc.z = 0;
-    m_si_data.gyro.x = 0;
-    m_si_data.gyro.y = 0;
-    m_si_data.gyro.z = 0;
-
-    /* Sum up all non-eliminated IMUs and transform to SI */
-    for (int i = 0; i < NUM_IMU; i++) {
-      if (m_sensor_elimination.faulty_imu[i] == 0) {
-        counter++;
-        m_si_data.acc.x += static_cast<float32_t>(m_imu_data[i].acc.x) * acc_info[i].conversion_to_SI;
-        m_si_data.acc.y += static_cast<float32_t>(m_imu_data[i].acc.y) * acc_info[i].conversion_to_SI;
-        m_si_data.acc.z += static_cast<float32_t>(m_imu_data[i].acc.z) * acc_info[i].conversion_to_SI;
-        m_si_data.gyro.x += static_cast<float32_t>(m_imu_data[i].gyro.x) * gyro_info[i].conversion_to_SI;
-        m_si_data.gyro.y += static_cast<float32_t>(m_imu_data[i].gyro.y) * gyro_info[i].conversion_to_SI;
-        m_si_data.gyro.z += static_cast<float32_t>(m_imu_data[i].gyro.z) * gyro_info[i].conversion_to_SI;
+void Preprocessing::DecimateImuBatches() noexcept {
+  /* The IMU samples faster than the control loop, average all samples of the last control step. This acts as an
+   * anti-aliasing filter before decimating to the control rate. */
+  for (uint8_t i = 0; i < NUM_IMU; i++) {
+    m_imu_batch[i] = m_task_sensor_read.GetImuBatch(i);
+    imu_batch_t &batch = m_imu_batch[i];
+    m_imu_missed_samples[i] = 0U;
+    if (m_imu_next_index_valid[i]) {
+      /* The sensor task does not run in lockstep with this one, the same batch can be read twice. It was consumed
+       * before if it ends before the first unconsumed sample. A batch that starts after that sample follows one that
+       * was overwritten before it was read, or the FIFO dropped samples. */
+      const auto ahead = static_cast<int32_t>(batch.first_index - m_imu_next_index[i]);
+      if (ahead + static_cast<int32_t>(batch.count) <= 0) {
+        batch.count = 0U;
+      } else if (ahead > 0) {
+        m_imu_missed_samples[i] = static_cast<uint32_t>(ahead);
       }
     }
+    if (batch.count == 0) {
+      /* No new data, keep the last sample */
+      continue;
+    }
+    m_imu_next_index[i] = batch.first_index + batch.count;
+    m_imu_next_index_valid[i] = true;
+    const imu_data_t mean = mean_imu_samples(batch.samples, batch.count);
+    m_acc_bank.Set(i, mean);
+    m_gyro_bank.Set(i, mean);
+
+    /* The mean belongs to the middle of the batch, all IMUs are read out together */
+    const uint32_t half_batch_us = ((batch.count - 1U) * 1000000U) / (2U * sensor::Lsm6dso32::kSampleRate);
+    m_si_data.timestamp = batch.timestamp - half_batch_us;
+  }
+}
 
-    /* average for SI data */
-    if (counter > 0) {
-      m_si_data.acc.x /= counter;
-      m_si_data.acc.y /= counter;
-      m_si_data.acc.z /= counter;
-      m_si_data.gyro.x /= counter;
-      m_si_data.gyro.y /= counter;
-      m_si_data.gyro.z /= counter;
+void Preprocessing::AvgToSi() noexcept {
+  if constexpr (NUM_IMU > 0) {
+    /* Fuse all non-eliminated accelerometers and gyroscopes, the data is already converted to SI */
+    AccBank::channels_t acc{};
+    if (m_acc_bank.Fuse(acc)) {
+      m_si_data.acc = {.x = acc[0], .y = acc[1], .z = acc[2]};
       clear_error(CATS_ERR_FILTER_ACC);
     } else {
       m_si_data.acc = m_si_data_old.acc;
-      m_si_data.gyro = m_si_data_old.gyro;
       add_error(CATS_ERR_FILTER_ACC);
     }
+
+    GyroBank::channels_t gyro{};
+    if (m_gyro_bank.Fuse(gyro)) {
+      m_si_data.gyro = {.x = gyro[0], .y = gyro[1], .z = gyro[2]};
+    } else {
+      m_si_data.gyro = m_si_data_old.gyro;
+    }
   }
 
   if constexpr (NUM_BARO > 0) {
-    counter = 0;
-    m_si_data.pressure = 0;
-    for (int i = 0; i < NUM_BARO; i++) {
-      if (m_sensor_elimination.faulty_baro[i] == 0) {
-        counter++;
-        m_si_data.pressure += static_cast<float32_t>(m_baro_data[i].pressure) * baro_info[i].conversion_to_SI;
-      }
-    }
-    if (counter > 0) {
-      m_si_data.pressure /= counter;
+    BaroBank::channels_t baro{};
+    if (m_baro_bank.Fuse(baro)) {
+      m_si_data.pressure = baro[0];
       clear_error(CATS_ERR_FILTER_HEIGHT);
     } else {
       m_si_data.pressure = m_si_data_old.pressure;
@@ -157,130 +212,131 @@ void Preprocessing::AvgToSi() noexcept {
   }
 }
 
-void Preprocessing::MedianFilter() noexcept {
-  /* Insert into array */
-  m_filter_data.acc[m_filter_data.counter] = m_state_est_input.acceleration_z;
-  m_filter_data.height_AGL[m_filter_data.counter] = m_state_est_input.height_AGL;
+void Preprocessing::CheckStoredCalibration() noexcept {
+  if (m_warm_start.status != WARM_START_PENDING) {
+    return;
+  }
+  /* The gyro data is not calibrated yet at this point */
+  if (check_warm_start(&m_warm_start, &global_stored_calibration, &m_si_data.acc, &m_si_data.gyro,
+                       calculate_height(m_si_data.pressure), BaroTemperature()) == WARM_START_VALID) {
+    m_calibration.gyro_calib = global_stored_calibration.calibration.gyro_calib;
+    m_gyro_calibrated = true;
+    m_calibration_restored_channel.Write(true);
+  }
+}
 
-  /* Update Counter */
-  m_filter_data.counter++;
-  m_filter_data.counter = m_filter_data.counter % MEDIAN_FILTER_SIZE;
+void Preprocessing::StoreCalibration() noexcept {
+  global_stored_calibration = {.version = STORED_CALIBRATION_VERSION,
+                               .calibration = m_calibration,
+                               .acceleration = m_si_data.acc,
+                               .height_0 = m_height_0,
+                               .temperature = BaroTemperature(),
+                               .flight_counter = flight_counter};
+
+  /* Writing to the flash takes too long for this task, the recorder saves the calibration */
+  if (global_recorder_status != REC_WRITE_TO_FLASH) {
+    const rec_cmd_type_e rec_cmd = REC_CMD_SAVE_CALIBRATION;
+    if (osMessageQueuePut(rec_cmd_queue, &rec_cmd, 0U, 0U) != osOK) {
+      log_error("Inserting an element to the recorder command queue failed!");
+    }
+  }
+}
 
-  /* Filter data */
-  m_state_est_input.acceleration_z = median(m_filter_data.acc);
-  m_state_est_input.height_AGL = median(m_filter_data.height_AGL);
+float32_t Preprocessing::BaroTemperature() const noexcept {
+  /* The first barometer is used, the temperature is given in 0.01 °C */
+  return static_cast<float32_t>(m_task_sensor_read.GetBaro(0).temperature) * 0.01F;
+}
+
+void Preprocessing::MedianFilter() noexcept {
+  /* Replace the oldest values of the windows and filter data */
+  m_state_est_input.acceleration_z = m_acc_median.Add(m_state_est_input.acceleration_z);
+  m_state_est_input.height_AGL = m_height_AGL_median.Add(m_state_est_input.height_AGL);
 }
 
 void Preprocessing::TransformData() noexcept {
   /* Get Data from the Sensors */
+  m_state_est_input.acceleration_z = AxisAcceleration(m_si_data.acc);
+  this->m_state_est_input.height_AGL = calculate_height(m_si_data.pressure) - m_height_0;
+}
+
+float32_t Preprocessing::AxisAcceleration(const vf32_t &acc) const noexcept {
   /* Use calibration step to get the correct acceleration */
   switch (this->m_calibration.axis) {
     case 0:
       /* Choose X Axis */
-      m_state_est_input.acceleration_z = m_si_data.acc.x / m_calibration.angle - GRAVITY;
-      break;
+      return acc.x / m_calibration.angle - GRAVITY;
     case 1:
       /* Choose Y Axis */
-      m_state_est_input.acceleration_z = m_si_data.acc.y / m_calibration.angle - GRAVITY;
-      break;
+      return acc.y / m_calibration.angle - GRAVITY;
     case 2:
       /* Choose Z Axis */
-      m_state_est_input.acceleration_z = m_si_data.acc.z / m_calibration.angle - GRAVITY;
-      break;
+      return acc.z / m_calibration.angle - GRAVITY;
     default:
-      break;
+      return m_state_est_input.acceleration_z;
   }
-  this->m_state_est_input.height_AGL = calculate_height(m_si_data.pressure) - m_height_0;
 }
 
-void Preprocessing::CheckSensors() noexcept {
-  cats_error_e status = CATS_ERR_OK;
-
-  /* IMU */
+#ifdef USE_MULTI_RATE_ESTIMATION
+void Preprocessing::TransformImuSamples() noexcept {
+  /* Average the IMUs with a healthy accelerometer sample by sample, the batches are aligned at their newest sample */
+  uint8_t num_samples = 0U;
+  uint32_t num_missed = 0U;
   for (uint8_t i = 0; i < NUM_IMU; i++) {
-    status = static_cast<cats_error_e>(CheckSensorBounds(i, &acc_info[i]) | CheckSensorFreezing(i, &acc_info[i]));
-    /* Check if accel is not faulty anymore */
-    if (status == CATS_ERR_OK) {
-      m_sensor_elimination.faulty_imu[i] = 0;
-      clear_error(static_cast<cats_error_e>(CATS_ERR_IMU_0 << i));
-    } else {
-      add_error(status);
+    if (m_acc_bank.IsHealthy(i)) {
+      num_samples = std::max(num_samples, m_imu_batch[i].count);
+      num_missed = std::max(num_missed, m_imu_missed_samples[i]);
     }
   }
 
-  /* Barometer */
-  for (uint8_t i = 0; i < NUM_BARO; i++) {
-    status = static_cast<cats_error_e>(CheckSensorBounds(i, &baro_info[i]) | CheckSensorFreezing(i, &baro_info[i]));
-    /* Check if accel is not faulty anymore */
-    if (status == CATS_ERR_OK) {
-      m_sensor_elimination.faulty_baro[i] = 0;
-      clear_error(static_cast<cats_error_e>(CATS_ERR_BARO_0 << i));
-    } else {
-      add_error(status);
+  for (uint8_t k = 0; k < num_samples; k++) {
+    vf32_t sum = {.x = 0.0F, .y = 0.0F, .z = 0.0F};
+    uint8_t num_imus = 0U;
+    for (uint8_t i = 0; i < NUM_IMU; i++) {
+      const imu_batch_t &batch = m_imu_batch[i];
+      if (!m_acc_bank.IsHealthy(i) || (k + batch.count < num_samples)) {
+        continue;
+      }
+      const imu_data_t &sample = batch.samples[k + batch.count - num_samples];
+      const float32_t scale = acc_info[i].conversion_to_SI;
+      const float32_t factor[3] = {scale, scale, scale};
+      float32_t acc[3];
+      vi16_scale(sample.acc, factor, acc);
+      sum.x += acc[0];
+      sum.y += acc[1];
+      sum.z += acc[2];
+      num_imus++;
     }
+    const auto n = static_cast<float32_t>(num_imus);
+    m_state_est_input.acceleration_samples[k] = AxisAcceleration({.x = sum.x / n, .y = sum.y / n, .z = sum.z / n});
   }
+  m_state_est_input.num_acceleration_samples = num_samples;
+  m_state_est_input.num_missed_acceleration_samples =
+      static_cast<uint8_t>(std::min(num_missed, static_cast<uint32_t>(IMU_MAX_BATCH_SIZE)));
 }
+#endif
 
-cats_error_e Preprocessing::CheckSensorBounds(uint8_t index, const sens_info_t *sens_info) noexcept {
-  cats_error_e status = CATS_ERR_OK;
-
-  switch (sens_info->sens_type) {
-    case SensorType::kBaro:
-      if (((static_cast<float32_t>(m_baro_data[index].pressure) * sens_info->conversion_to_SI) >
-           sens_info->upper_limit) ||
-          ((static_cast<float32_t>(m_baro_data[index].pressure) * sens_info->conversion_to_SI) <
-           sens_info->lower_limit)) {
-        m_sensor_elimination.faulty_baro[index] = 1;
-        status = static_cast<cats_error_e>(CATS_ERR_BARO_0 << index);
-      }
-      break;
-    case SensorType::kAcc:
-      if (((static_cast<float32_t>(m_imu_data[index].acc.x) * sens_info->conversion_to_SI) > sens_info->upper_limit) ||
-          ((static_cast<float32_t>(m_imu_data[index].acc.x) * sens_info->conversion_to_SI) < sens_info->lower_limit)) {
-        m_sensor_elimination.faulty_imu[index] = 1;
-        status = static_cast<cats_error_e>(CATS_ERR_IMU_0 << index);
-      }
-      break;
-    default:
-      break;
+void Preprocessing::CheckSensors() noexcept {
+  /* Convert to SI and check bounds and freezing of all sensors in one pass per sensor type */
+  /* An IMU is reported as faulty if its accelerometer or its gyroscope is, each is only excluded from its own fusion */
+  const uint32_t faulty_imu = m_acc_bank.Check() | m_gyro_bank.Check();
+  for (uint8_t i = 0; i < NUM_IMU; i++) {
+    const auto error = static_cast<cats_error_e>(CATS_ERR_IMU_0 << i);
+    if ((faulty_imu & (1U << i)) != 0U) {
+      add_error(error);
+    } else {
+      clear_error(error);
+    }
   }
 
-  return status;
-}
-
-cats_error_e Preprocessing::CheckSensorFreezing(uint8_t index, const sens_info_t *sens_info) noexcept {
-  cats_error_e status = CATS_ERR_OK;
-
-  switch (sens_info->sens_type) {
-    case SensorType::kBaro:
-      if (m_baro_data[index].pressure == m_sensor_elimination.last_value_baro[index]) {
-        m_sensor_elimination.freeze_counter_baro[index]++;
-        if (m_sensor_elimination.freeze_counter_baro[index] > MAX_NUM_SAME_VALUE) {
-          m_sensor_elimination.faulty_baro[index] = 1;
-          status = static_cast<cats_error_e>(CATS_ERR_BARO_0 << index);
-        }
-      } else {
-        m_sensor_elimination.last_value_baro[index] = m_baro_data[index].pressure;
-        m_sensor_elimination.freeze_counter_baro[index] = 0;
-      }
-      break;
-    case SensorType::kAcc:
-      if (m_imu_data[index].acc.x == m_sensor_elimination.last_value_imu[index]) {
-        m_sensor_elimination.freeze_counter_imu[index]++;
-        if (m_sensor_elimination.freeze_counter_imu[index] > MAX_NUM_SAME_VALUE) {
-          m_sensor_elimination.faulty_imu[index] = 1;
-          status = static_cast<cats_error_e>(CATS_ERR_IMU_0 << index);
-        }
-      } else {
-        m_sensor_elimination.last_value_imu[index] = m_imu_data[index].acc.x;
-        m_sensor_elimination.freeze_counter_imu[index] = 0;
-      }
-      break;
-    default:
-      break;
+  const uint32_t faulty_baro = m_baro_bank.Check();
+  for (uint8_t i = 0; i < NUM_BARO; i++) {
+    const auto error = static_cast<cats_error_e>(CATS_ERR_BARO_0 << i);
+    if ((faulty_baro & (1U << i)) != 0U) {
+      add_error(error);
+    } else {
+      clear_error(error);
+    }
   }
-
-  return status;
 }
 
 }  // namespace task
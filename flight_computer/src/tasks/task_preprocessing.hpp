@@ -6,9 +6,14 @@
 
 #include "task.hpp"
 
+#include "config/globals.hpp"
+#include "control/calibration.hpp"
+#include "control/sensor_bank.hpp"
 #include "task_sensor_read.hpp"
 #include "util/error_handler.hpp"
+#include "util/latest_value.hpp"
 #include "util/log.h"
+#include "util/sliding_median.hpp"
 #include "util/types.hpp"
 
 namespace task {
@@ -18,43 +23,86 @@ class Preprocessing final : public Task<Preprocessing, 512> {
   explicit Preprocessing(const SensorRead& task_sensor_read) : m_task_sensor_read(task_sensor_read) {}
   [[nodiscard]] state_estimation_input_t GetEstimationInput() const noexcept;
   [[nodiscard]] SI_data_t GetSIData() const noexcept;
+  /* True once the stored calibration was validated and replaces the full calibration */
+  [[nodiscard]] bool IsCalibrationRestored() const noexcept;
+
+  /** Get the length of the median filter window
+   *
+   * @param control_sampling_freq control sampling frequency in Hz
+   * @return odd number of control steps covering MEDIAN_FILTER_TIME
+   */
+  static constexpr size_t MedianFilterLength(uint16_t control_sampling_freq) noexcept {
+    return ((static_cast<size_t>(MEDIAN_FILTER_TIME) * control_sampling_freq) / 1000U) | 1U;
+  }
 
  private:
   [[noreturn]] void Run() noexcept override;
 
+  void DecimateImuBatches() noexcept;
   void AvgToSi() noexcept;
   void MedianFilter() noexcept;
   void TransformData() noexcept;
+  [[nodiscard]] float32_t AxisAcceleration(const vf32_t& acc) const noexcept;
+#ifdef USE_MULTI_RATE_ESTIMATION
+  void TransformImuSamples() noexcept;
+#endif
   void CheckSensors() noexcept;
-  cats_error_e CheckSensorBounds(uint8_t index, const sens_info_t* sens_info) noexcept;
-  cats_error_e CheckSensorFreezing(uint8_t index, const sens_info_t* sens_info) noexcept;
+  void CheckStoredCalibration() noexcept;
+  void StoreCalibration() noexcept;
+  [[nodiscard]] float32_t BaroTemperature() const noexcept;
+
+  using AccBank = SensorBank<AccBankTraits, NUM_IMU>;
+  using GyroBank = SensorBank<GyroBankTraits, NUM_IMU>;
+  using BaroBank = SensorBank<BaroBankTraits, NUM_BARO>;
 
   const SensorRead& m_task_sensor_read;
 
-  imu_data_t m_imu_data[NUM_IMU]{};
-  baro_data_t m_baro_data[NUM_BARO]{};
+  AccBank m_acc_bank{};
+  GyroBank m_gyro_bank{};
+  BaroBank m_baro_bank{};
+
+  /* IMU samples of the last control step, the count of a batch that was consumed before is set to zero */
+  imu_batch_t m_imu_batch[NUM_IMU] = {};
+  /* Running index of the first IMU sample that was not consumed yet, valid once a batch was consumed */
+  uint32_t m_imu_next_index[NUM_IMU] = {};
+  bool m_imu_next_index_valid[NUM_IMU] = {};
+  /* Samples between the consumed batch and the one before it, which were dropped by the FIFO or in a batch that was
+   * overwritten before it was read */
+  uint32_t m_imu_missed_samples[NUM_IMU] = {};
+  /* Number of barometer measurements seen so far */
+  uint32_t m_baro_count = 0U;
 
   SI_data_t m_si_data = {};
   SI_data_t m_si_data_old = {.acc = {.x = GRAVITY, .y = 0.0F, .z = 0.0F}, .pressure = P_INITIAL};
 
 #ifdef USE_MEDIAN_FILTER
-  median_filter_t m_filter_data = {};
+  SlidingMedian<float32_t, MEDIAN_FILTER_MAX_SIZE> m_acc_median{MedianFilterLength(global_control_sampling_freq)};
+  SlidingMedian<float32_t, MEDIAN_FILTER_MAX_SIZE> m_height_AGL_median{
+      MedianFilterLength(global_control_sampling_freq)};
 #endif
-  sensor_elimination_t m_sensor_elimination = {};
 
   /* Calibration Data including the gyro calibration as the first three values and then the angle and axis are for
    * the linear acceleration calibration */
   calibration_data_t m_calibration = {.gyro_calib = {.x = 0, .y = 0, .z = 0}, .angle = 1, .axis = 2};
   state_estimation_input_t m_state_est_input = {.acceleration_z = 0.0F, .height_AGL = 0.0F};
+  /* Moving average of the height before liftoff, see approx_moving_average */
   float32_t m_height_0 = 0.0F;
 
+  /* Published results, read by the state estimation and the flight state machine */
+  LatestValue<SI_data_t> m_si_data_channel{};
+  LatestValue<state_estimation_input_t> m_state_est_input_channel{};
+
   /* Variable to keep track of the calibration health */
   int32_t faulty_calibration_counter = 0;
-  /* with a sampling frequency of 100 Hz this yields 1s */
-  static constexpr int32_t kMaxFaultyCalib = 100;
+  /* Time the calibration needs to be faulty before the error is raised, in ms */
+  static constexpr uint32_t kFaultyCalibTime = 1000U;
 
   /* Gyro Calib tag */
   bool m_gyro_calibrated = false;
+
+  /* Check of the calibration stored before the last reboot */
+  warm_start_check_t m_warm_start{};
+  LatestValue<bool> m_calibration_restored_channel{};
 };
 
 }  // namespace task
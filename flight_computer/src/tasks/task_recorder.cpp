@@ -7,15 +7,22 @@
 
 #include "cmsis_os.h"
 #include "config/globals.hpp"
+#include "config/stored_calibration.hpp"
 #include "flash/lfs_custom.hpp"
 #include "flash/recorder.hpp"
 #include "tasks/task_recorder.hpp"
+#include "util/enum_str_maps.hpp"
 #include "util/log.h"
 
 /** Private Constants **/
 
 constexpr uint16_t REC_BUFFER_LEN = 256;
 
+/* Before the calibration is saved while the pre recording queue is filled, the oldest elements are dropped down to this
+ * count. The rest of the queue takes up the records of the flash write, which is not drained meanwhile and takes a few
+ * hundred ms if littlefs has to erase a block. */
+constexpr uint32_t REC_QUEUE_CALIBRATION_SAVE_LIMIT = REC_QUEUE_PRE_THRUSTING_LIMIT / 2;
+
 /** Private Function Declarations **/
 
 namespace {
@@ -26,6 +33,9 @@ inline void write_value(const rec_elem_t *rec_elem, uint8_t *rec_buffer, uint16_
 
 void create_stats_and_cfg_log();
 
+bool take_fill_queue_cmd(rec_cmd_type_e *rec_cmd);
+bool take_write_cmd(rec_cmd_type_e *rec_cmd);
+
 }  // namespace
 
 /** Exported Function Definitions **/
@@ -46,9 +56,14 @@ namespace task {
   lfs_file_t current_flight_file;
   char current_flight_filename[MAX_FILENAME_SIZE] = {};
 
+  /* Command which ended the previous one */
+  rec_cmd_type_e next_rec_cmd = REC_CMD_INVALID;
+
   while (true) {
-    rec_cmd_type_e curr_rec_cmd = REC_CMD_INVALID;
-    if (osMessageQueueGet(rec_cmd_queue, &curr_rec_cmd, nullptr, osWaitForever) != osOK) {
+    rec_cmd_type_e curr_rec_cmd = next_rec_cmd;
+    next_rec_cmd = REC_CMD_INVALID;
+    if ((curr_rec_cmd == REC_CMD_INVALID) &&
+        (osMessageQueueGet(rec_cmd_queue, &curr_rec_cmd, nullptr, osWaitForever) != osOK)) {
       log_error("Something wrong with the command recorder queue");
       continue;
     }
@@ -72,7 +87,7 @@ namespace task {
             // osMessageQueueGet(rec_queue, &dummy_log_elem, 0, 10);
           } else {
             /* Check for a new command */
-            if (osMessageQueueGetCount(rec_cmd_queue) > 0) {
+            if (take_fill_queue_cmd(&next_rec_cmd)) {
               /* breaks out of the inner while loop */
               break;
             }
@@ -81,7 +96,7 @@ namespace task {
 
           ++cmd_check_counter;
           /* Check for a new command */
-          if (((cmd_check_counter % 16) == 0) && (osMessageQueueGetCount(rec_cmd_queue) > 0)) {
+          if (((cmd_check_counter % 16) == 0) && take_fill_queue_cmd(&next_rec_cmd)) {
             /* breaks out of the inner while loop */
             break;
           }
@@ -161,7 +176,7 @@ namespace task {
                    bytes_remaining);
           }
           /* Check for a new command */
-          if (osMessageQueueGetCount(rec_cmd_queue) > 0) {
+          if (take_write_cmd(&next_rec_cmd)) {
             lfs_file_sync(&lfs, &current_flight_file);
             /* breaks out of the inner while loop */
             break;
@@ -182,6 +197,10 @@ namespace task {
         /* create flight stats file */
         create_stats_and_cfg_log();
       } break;
+      case REC_CMD_SAVE_CALIBRATION:
+        /* The recorder is idle, while filling the queue or writing a flight the command is taken in the loops */
+        calibration_save();
+        break;
       default:
         log_error("Unknown command value: %u", curr_rec_cmd);
         break;
@@ -196,6 +215,42 @@ namespace task {
 
 namespace {
 
+/* Takes a new command while the pre recording queue is filled. The calibration is saved without leaving the loop, a
+ * command to continue filling could otherwise end up behind the command to write at liftoff. Returns true for any other
+ * command, which ends filling the queue. */
+bool take_fill_queue_cmd(rec_cmd_type_e *rec_cmd) {
+  if ((osMessageQueueGetCount(rec_cmd_queue) == 0) ||
+      (osMessageQueueGet(rec_cmd_queue, rec_cmd, nullptr, 0U) != osOK)) {
+    return false;
+  }
+  if (*rec_cmd != REC_CMD_SAVE_CALIBRATION) {
+    return true;
+  }
+  *rec_cmd = REC_CMD_INVALID;
+
+  rec_elem_t dummy_log_elem{};
+  while ((osMessageQueueGetCount(rec_queue) > REC_QUEUE_CALIBRATION_SAVE_LIMIT) &&
+         (osMessageQueueGet(rec_queue, &dummy_log_elem, nullptr, 0U) == osOK)) {
+  }
+  calibration_save();
+  return false;
+}
+
+/* Takes a new command while a flight is written. The calibration is saved on the launch pad only, a late command to
+ * save it is dropped. Returns true for any other command, which ends writing. */
+bool take_write_cmd(rec_cmd_type_e *rec_cmd) {
+  if ((osMessageQueueGetCount(rec_cmd_queue) == 0) ||
+      (osMessageQueueGet(rec_cmd_queue, rec_cmd, nullptr, 0U) != osOK)) {
+    return false;
+  }
+  if (*rec_cmd != REC_CMD_SAVE_CALIBRATION) {
+    return true;
+  }
+  log_warn("Calibration not saved, a flight is written");
+  *rec_cmd = REC_CMD_INVALID;
+  return false;
+}
+
 constexpr uint_fast8_t get_rec_elem_size(const rec_elem_t *const rec_elem) {
   uint_fast8_t rec_elem_size = sizeof(rec_elem->rec_type) + sizeof(rec_elem->ts);
   switch (get_record_type_without_id(rec_elem->rec_type)) {
@@ -229,6 +284,15 @@ constexpr uint_fast8_t get_rec_elem_size(const rec_elem_t *const rec_elem) {
     case VOLTAGE_INFO:
       rec_elem_size += sizeof(rec_elem->u.voltage_info);
       break;
+    case LOOP_TIMING_INFO:
+      rec_elem_size += sizeof(rec_elem->u.loop_timing_info);
+      break;
+    case APOGEE_PREDICTION:
+      rec_elem_size += sizeof(rec_elem->u.apogee_prediction);
+      break;
+    case FILTER_CONSISTENCY:
+      rec_elem_size += sizeof(rec_elem->u.filter_consistency);
+      break;
     default:
       log_raw("Impossible recorder entry type!");
       break;
@@ -309,15 +373,15 @@ void create_stats_file() {
   write_line("Flight #%lu Stats\r\n", flight_counter);
   write_line("========================\r\n");
   write_line("  Height\r\n");
-  write_line("    Time Since Bootup: %lu\r\n", global_flight_stats.max_height.ts);
+  write_line("    Time Since Recording Start [us]: %lu\r\n", global_flight_stats.max_height.ts);
   write_line("    Max. Height [m]: %.10f\r\n", static_cast<double>(global_flight_stats.max_height.val));
   write_line("========================\r\n");
   write_line("  Velocity\r\n");
-  write_line("    Time Since Bootup: %lu\r\n", global_flight_stats.max_velocity.ts);
+  write_line("    Time Since Recording Start [us]: %lu\r\n", global_flight_stats.max_velocity.ts);
   write_line("    Max. Velocity [m/s]: %.10f\r\n", static_cast<double>(global_flight_stats.max_velocity.val));
   write_line("========================\r\n");
   write_line("  Acceleration\r\n");
-  write_line("    Time Since Bootup: %lu\r\n", global_flight_stats.max_acceleration.ts);
+  write_line("    Time Since Recording Start [us]: %lu\r\n", global_flight_stats.max_acceleration.ts);
   write_line("    Max. Acceleration [m/s^2]: %.10f\r\n", static_cast<double>(global_flight_stats.max_acceleration.val));
   write_line("========================\r\n");
   write_line("  Calibration Values\r\n");
@@ -333,6 +397,20 @@ void create_stats_file() {
   write_line("  Liftoff Time: %02hu:%02hu:%02hu UTC\r\n", global_flight_stats.liftoff_time.hour,
              global_flight_stats.liftoff_time.min, global_flight_stats.liftoff_time.sec);
   write_line("========================\r\n");
+  write_line("  Filter Consistency (NIS, expected mean: 1)\r\n");
+  for (uint32_t state = READY; state <= TOUCHDOWN; state++) {
+    const consistency_summary_t &summary = global_flight_stats.consistency[state];
+    if (summary.num_updates == 0) {
+      continue;
+    }
+    write_line("    %s:\r\n", GetStr(static_cast<flight_fsm_e>(state), fsm_map));
+    write_line("      Updates: %lu\r\n", summary.num_updates);
+    write_line("      Mean: %.4f\r\n", static_cast<double>(summary.nis_sum / static_cast<float32_t>(summary.num_updates)));
+    write_line("      Max.: %.4f\r\n", static_cast<double>(summary.nis_max));
+    write_line("      Windows below / above bounds: %hu / %hu of %hu\r\n", summary.num_windows_low,
+               summary.num_windows_high, summary.num_windows);
+  }
+  write_line("========================\r\n");
 
   if (err < 0) {
     log_error("Writing to stats file failed with %ld", err);
@@ -9,15 +9,52 @@
 
 #include "sensors/ms5607.hpp"
 #include "util/log.h"
+#include "util/loop_timing.hpp"
 #include "util/task_util.hpp"
 
+#include <algorithm>
+
 /** Private Function Declarations **/
 
 namespace task {
 
-baro_data_t SensorRead::GetBaro(uint8_t index) const noexcept { return m_baro_data[index]; }
+/* Check the slots and the barometer schedule of every flight phase against the datasheet conversion times for every
+ * selectable control sampling frequency */
+constexpr bool slots_fit_all_control_sampling_freqs() {
+  for (const uint16_t freq : CONTROL_SAMPLING_FREQS) {
+    const uint32_t slot_time = SensorRead::GetSlotTime(freq);
+    if ((sysGetTickFreq() % (2U * freq)) != 0U) {
+      return false;
+    }
+    if (!sensor::baro_scheduler_check::conversions_fit(slot_time)) {
+      return false;
+    }
+    for (uint32_t phase = CALIBRATING; phase <= TOUCHDOWN; phase++) {
+      if (!sensor::baro_scheduler_check::schedule_respects_conversion_time(slot_time,
+                                                                           static_cast<flight_fsm_e>(phase))) {
+        return false;
+      }
+    }
+    /* All IMU samples of a control step need to fit into one batch, with margin for a late readout */
+    if (2U * sensor::Lsm6dso32::kSampleRate / freq > IMU_MAX_BATCH_SIZE) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(slots_fit_all_control_sampling_freqs());
 
-imu_data_t SensorRead::GetImu(uint8_t index) const noexcept { return m_imu_data[index]; }
+baro_data_t SensorRead::GetBaro(uint8_t index) const noexcept { return m_baro_data_channel[index].Read(); }
+
+imu_batch_t SensorRead::GetImuBatch(uint8_t index) const noexcept { return m_imu_batch_channel[index].Read(); }
+
+uint32_t SensorRead::GetBaroCount(uint8_t index) const noexcept { return m_baro_data_channel[index].GetWriteCount(); }
+
+void SensorRead::OnImuDataReady(uint32_t timestamp_us) noexcept {
+  m_imu_drdy_timestamp_us = timestamp_us;
+  m_imu_drdy_pending = true;
+  osThreadFlagsSet(GetThreadId(), THREAD_FLAG_IMU_DRDY);
+}
 
 /** Exported Function Definitions **/
 
@@ -27,59 +64,193 @@ imu_data_t SensorRead::GetImu(uint8_t index) const noexcept { return m_imu_data[
  * @retval None
  */
 [[noreturn]] void SensorRead::Run() noexcept {
+  /* Start the first barometer conversion, a temperature conversion */
+  const auto conversion = m_baro_scheduler.Next();
+  m_barometer->Prepare(conversion.request, conversion.osr);
+
   /* Initialize IMU data variables */
-  m_barometer->Prepare(sensor::Ms5607::Request::kTemperature);
-  osDelay(5);
+  for (int i = 0; i < NUM_IMU; i++) {
+    if (imu_initialized[i]) {
+      m_imu->SetFifoWatermark(m_imu_watermark);
+#ifdef USE_IMU_DRDY
+      m_imu->EnableFifoWatermarkInterrupt();
+#endif
+    }
+  }
 
   uint32_t tick_count = osKernelGetTickCount();
-  /* This task is sampled with 2 times the control sampling frequency to maximize speed of the barometer. In one
-   * timestep the Baro pressure is read out and then the Baro Temperature. The other sensors are only read out one in
-   * two times. */
-  constexpr uint32_t tick_update = sysGetTickFreq() / static_cast<uint32_t>(2 * CONTROL_SAMPLING_FREQ);
+#ifdef USE_IMU_DRDY
+  /* The IMU is read as soon as its FIFO watermark is reached. The barometer keeps its own timed slots at twice the
+   * control sampling frequency, the same slots as without the interrupt, so the scheduler still gives every conversion
+   * its datasheet conversion time. The task sleeps until either the next barometer slot or the interrupt. */
+  uint32_t imu_tick_count = tick_count;
   while (true) {
-    // Readout the baro register
-    m_barometer->Read();
+    const uint32_t next_slot_tick = tick_count + m_tick_update;
+    const auto ticks_to_slot = static_cast<int32_t>(next_slot_tick - osKernelGetTickCount());
+    const uint32_t flags =
+        osThreadFlagsWait(THREAD_FLAG_IMU_DRDY, osFlagsWaitAny, static_cast<uint32_t>(std::max(ticks_to_slot, 0)));
+    const uint32_t now = osKernelGetTickCount();
 
-    // Prepare new readout for the baro
-    if (m_current_readout == SensorRead::BaroReadoutType::kReadBaroPressure) {
-      m_barometer->Prepare(sensor::Ms5607::Request::kPressure);
-      m_current_readout = SensorRead::BaroReadoutType::kReadBaroTemperature;
-    } else {
-      m_barometer->Prepare(sensor::Ms5607::Request::kTemperature);
-      m_current_readout = SensorRead::BaroReadoutType::kReadBaroPressure;
-      /* For Simulator */
-      if (simulation_started) {
-        for (int i = 0; i < NUM_BARO; i++) {
-          m_baro_data[i].pressure = global_baro_sim[i].pressure;
-        }
-      } else {
-        m_barometer->GetMeasurement(m_baro_data[0].pressure, m_baro_data[0].temperature);
-      }
+    /* A missed interrupt only delays the IMU readout by one control step */
+    const bool slot_due = static_cast<int32_t>(now - next_slot_tick) >= 0;
+    const bool imu_due = ((flags & osFlagsError) == 0U) || (now - imu_tick_count >= 4U * m_tick_update);
+    if (!slot_due && !imu_due) {
+      continue;
+    }
 
-      /* Save Barometric Data */
-      for (int i = 0; i < NUM_BARO; i++) {
-        record(tick_count, add_id_to_record_type(BARO, i), &(m_baro_data[0]));
+    /* The execution time covers everything done after this wake up, the barometer slot as well as the IMU readout */
+    if (slot_due) {
+      tick_count = next_slot_tick;
+      loop_timing_begin(LOOP_TIMING_SENSOR_READ, tick_count);
+      if (GetNewFsmEnum()) {
+        m_baro_scheduler.SetPhase(m_fsm_enum);
       }
-
-      /* Read and Save IMU Data */
-      for (int i = 0; i < NUM_IMU; i++) {
-        if (simulation_started) {
-          m_imu_data[i].acc = global_imu_sim[i].acc;
-        } else {
-          if (imu_initialized[i]) {
-            // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
-            m_imu->ReadGyroRaw(reinterpret_cast<int16_t *>(&m_imu_data[i].gyro));
-            m_imu->ReadAccelRaw(reinterpret_cast<int16_t *>(&m_imu_data[i].acc));
-            // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
-          }
-        }
-        record(tick_count, add_id_to_record_type(IMU, i), &(m_imu_data[i]));
+      if (m_baro_scheduler.Tick()) {
+        ReadBaro(sysGetMicros());
       }
+    } else {
+      loop_timing_begin_untimed(LOOP_TIMING_SENSOR_READ);
+    }
+
+    if (imu_due) {
+      imu_tick_count = now;
+      ReadImu();
+      loop_timing_publish(LOOP_TIMING_SENSOR_READ);
+      NotifyDataSubscriber();
+    }
+    loop_timing_end(LOOP_TIMING_SENSOR_READ);
+  }
+#else
+  /* This task is sampled with 2 times the control sampling frequency to maximize speed of the barometer. The
+   * barometer scheduler decides in which of these slots a conversion is read out, the IMU is only read out one in two
+   * times. */
+  uint32_t slot = 0U;
+  /* The first slot follows the first conversion by one slot time, like all the others */
+  tick_count += m_tick_update;
+  osDelayUntil(tick_count);
+  while (true) {
+    loop_timing_begin(LOOP_TIMING_SENSOR_READ, tick_count);
+
+    /* Adapt the barometer conversions to the flight phase */
+    if (GetNewFsmEnum()) {
+      m_baro_scheduler.SetPhase(m_fsm_enum);
+    }
+
+    if (m_baro_scheduler.Tick()) {
+      ReadBaro(sysGetMicros());
+    }
+
+    if ((slot % 2U) == 1U) {
+      ReadImu();
+      loop_timing_publish(LOOP_TIMING_SENSOR_READ);
+      NotifyDataSubscriber();
     }
+    slot++;
 
-    tick_count += tick_update;
+    loop_timing_end(LOOP_TIMING_SENSOR_READ);
+
+    tick_count += m_tick_update;
     osDelayUntil(tick_count);
   }
+#endif
+}
+
+void SensorRead::ReadBaro(timestamp_us_t ts) noexcept {
+  const bool pressure_read = m_barometer->GetLastRequest() == sensor::Ms5607::Request::kPressure;
+
+  // Readout the baro register and prepare the new readout without giving up the bus in between
+  const auto conversion = m_baro_scheduler.Next();
+  m_barometer->ReadAndPrepare(conversion.request, conversion.osr);
+
+  /* A new measurement is available once a pressure conversion was read */
+  if (!pressure_read) {
+    return;
+  }
+
+  /* For Simulator */
+  if (simulation_started) {
+    for (int i = 0; i < NUM_BARO; i++) {
+      m_baro_data[i].pressure = global_baro_sim[i].pressure;
+    }
+  } else {
+    m_barometer->GetMeasurement(m_baro_data[0].pressure, m_baro_data[0].temperature);
+  }
+
+  /* Save Barometric Data */
+  for (int i = 0; i < NUM_BARO; i++) {
+    m_baro_data_channel[i].Write(m_baro_data[i]);
+    record(ts, add_id_to_record_type(BARO, i), &(m_baro_data[i]));
+  }
+}
+
+void SensorRead::ReadImu() noexcept {
+  /* Sample times are derived from the microsecond timer */
+  const timestamp_us_t now_us = sysGetMicros();
+  constexpr auto samples_to_us = [](uint32_t num_samples) {
+    return (num_samples * 1000000U) / sensor::Lsm6dso32::kSampleRate;
+  };
+
+  /* Read IMU Data, all samples collected in the FIFO since the last control step are read in one go */
+  uint8_t max_count = 0U;
+  uint32_t num_read = 0U;
+  for (int i = 0; i < NUM_IMU; i++) {
+    imu_batch_t &batch = m_imu_batch[i];
+    if (simulation_started) {
+      batch.samples[0] = global_imu_sim[i];
+      batch.count = 1U;
+    } else if (imu_initialized[i]) {
+      size_t num_dropped = 0U;
+      batch.count = static_cast<uint8_t>(m_imu->ReadFifo(batch.samples, IMU_MAX_BATCH_SIZE, num_dropped));
+      m_imu_sample_index[i] += num_dropped;
+      num_read = std::max(num_read, static_cast<uint32_t>(batch.count + num_dropped));
+    }
+    batch.first_index = m_imu_sample_index[i];
+    m_imu_sample_index[i] += batch.count;
+    max_count = std::max(max_count, batch.count);
+  }
+
+  /* Without the data ready interrupt the newest sample is assumed to be taken at the time of the readout */
+  timestamp_us_t newest_sample_us = now_us;
+#ifdef USE_IMU_DRDY
+  if (m_imu_drdy_pending && (num_read > 0U)) {
+    /* The interrupt fired when the watermark sample was written, the samples after it followed at the output data
+     * rate */
+    m_imu_drdy_pending = false;
+    if (num_read >= m_imu_watermark) {
+      newest_sample_us = m_imu_drdy_timestamp_us + samples_to_us(num_read - m_imu_watermark);
+    } else {
+      newest_sample_us = m_imu_drdy_timestamp_us - samples_to_us(m_imu_watermark - num_read);
+    }
+    /* Never stamp a sample in the future */
+    if (static_cast<int32_t>(newest_sample_us - now_us) > 0) {
+      newest_sample_us = now_us;
+    }
+  }
+#endif
+  for (int i = 0; i < NUM_IMU; i++) {
+    m_imu_batch[i].timestamp = newest_sample_us;
+    m_imu_batch_channel[i].Write(m_imu_batch[i]);
+  }
+
+  /* Save IMU Data, sample by sample such that all IMUs of one sample are recorded together. Every FIFO sample is
+   * recorded with its own timestamp, the recorder lowers the rate per control step according to rec_speed. */
+  for (uint8_t k = 0U; k < max_count; k++) {
+    for (int i = 0; i < NUM_IMU; i++) {
+      const imu_batch_t &batch = m_imu_batch[i];
+      if (k < batch.count) {
+        const timestamp_us_t sample_us = newest_sample_us - samples_to_us(batch.count - 1U - k);
+        record(sample_us, add_id_to_record_type(IMU, i), &(batch.samples[k]));
+      }
+    }
+  }
 }
 
 }  // namespace task
+
+#ifdef USE_IMU_DRDY
+extern "C" void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  if (GPIO_Pin == IMU_INT1_Pin) {
+    task::SensorRead::GetInstance().OnImuDataReady(sysGetMicros());
+  }
+}
+#endif
@@ -6,9 +6,13 @@
 
 #include "task.hpp"
 
+#include "config/globals.hpp"
+#include "sensors/baro_scheduler.hpp"
 #include "sensors/lsm6dso32.hpp"
 #include "sensors/ms5607.hpp"
+#include "util/latest_value.hpp"
 #include "util/log.h"
+#include "util/task_util.hpp"
 #include "util/types.hpp"
 
 namespace task {
@@ -18,23 +22,57 @@ class SensorRead final : public Task<SensorRead, 512> {
   SensorRead() = default;
   explicit SensorRead(sensor::Lsm6dso32* imu, sensor::Ms5607* barometer) : m_imu(imu), m_barometer(barometer) {}
 
+  /** Get the number of ticks between two slots, the task runs at twice the control sampling frequency
+   *
+   * @param control_sampling_freq control sampling frequency in Hz
+   * @return ticks between two slots
+   */
+  static constexpr uint32_t GetTickUpdate(uint16_t control_sampling_freq) {
+    return sysGetTickFreq() / (2U * control_sampling_freq);
+  }
+
+  /** Get the time between two slots
+   *
+   * @param control_sampling_freq control sampling frequency in Hz
+   * @return time between two slots in us
+   */
+  static constexpr uint32_t GetSlotTime(uint16_t control_sampling_freq) {
+    return GetTickUpdate(control_sampling_freq) * (1000000U / sysGetTickFreq());
+  }
+
   [[nodiscard]] baro_data_t GetBaro(uint8_t index) const noexcept;
-  [[nodiscard]] imu_data_t GetImu(uint8_t index) const noexcept;
+  [[nodiscard]] imu_batch_t GetImuBatch(uint8_t index) const noexcept;
+  /* Number of barometer measurements published so far */
+  [[nodiscard]] uint32_t GetBaroCount(uint8_t index) const noexcept;
+
+  /* Called from the IMU data ready interrupt */
+  void OnImuDataReady(uint32_t timestamp_us) noexcept;
 
  private:
   [[noreturn]] void Run() noexcept override;
 
-  enum class BaroReadoutType {
-    kReadBaroTemperature = 1,
-    kReadBaroPressure = 2,
-  };
+  void ReadBaro(timestamp_us_t ts) noexcept;
+  void ReadImu() noexcept;
+
+  /* Ticks between two slots for the configured control sampling frequency */
+  const uint32_t m_tick_update{GetTickUpdate(global_control_sampling_freq)};
+  /* IMU samples per control step, the FIFO watermark interrupt fires once they are available */
+  const uint16_t m_imu_watermark{static_cast<uint16_t>(sensor::Lsm6dso32::kSampleRate / global_control_sampling_freq)};
 
   sensor::Lsm6dso32* m_imu{nullptr};
   sensor::Ms5607* m_barometer{nullptr};
 
-  imu_data_t m_imu_data[NUM_IMU]{};
+  imu_batch_t m_imu_batch[NUM_IMU]{};
+  uint32_t m_imu_sample_index[NUM_IMU]{};
+  volatile uint32_t m_imu_drdy_timestamp_us{0U};
+  volatile bool m_imu_drdy_pending{false};
   baro_data_t m_baro_data[NUM_BARO]{};
-  BaroReadoutType m_current_readout{BaroReadoutType::kReadBaroTemperature};
+
+  /* Published sensor data, read by the preprocessing task */
+  LatestValue<imu_batch_t> m_imu_batch_channel[NUM_IMU]{};
+  LatestValue<baro_data_t> m_baro_data_channel[NUM_BARO]{};
+
+  sensor::BaroScheduler m_baro_scheduler{GetSlotTime(global_control_sampling_freq)};
 };
 
 }  // namespace task
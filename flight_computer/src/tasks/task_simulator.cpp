@@ -127,7 +127,7 @@ void Simulator::ComputeSimValues(float32_t time) {
   SetCoefficients(m_sim_config.simulation_option);
 
   uint32_t tick_count = osKernelGetTickCount();
-  constexpr uint32_t tick_update = sysGetTickFreq() / CONTROL_SAMPLING_FREQ;
+  const uint32_t tick_update = sysGetTickFreq() / global_control_sampling_freq;
 
   /* initialise time */
   const timestamp_t sim_start = osKernelGetTickCount();
@@ -171,9 +171,9 @@ void Simulator::ComputeSimValues(float32_t time) {
         break;
     }
 
-    /* Write into global imu sim variable */
+    /* Write into global imu sim variable, the simulated rocket does not rotate and its gyro data stays zero */
     for (int i = 0; i < NUM_IMU; i++) {
-      memcpy(&global_imu_sim[i].acc, &sim_imu_data[i].acc, sizeof(vi16_t));
+      global_imu_sim[i] = sim_imu_data[i];
     }
 
     /* Write into global pressure sim variable */
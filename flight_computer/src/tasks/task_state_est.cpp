@@ -4,6 +4,8 @@
 
 #include "tasks/task_state_est.hpp"
 #include "config/globals.hpp"
+#include "tasks/task_telemetry.hpp"
+#include "util/loop_timing.hpp"
 #include "util/task_util.hpp"
 
 namespace task {
@@ -17,26 +19,133 @@ void StateEstimation::GetEstimationInputData() {
    * due to parachute forces. */
   const state_estimation_input_t input = m_task_preprocessing.GetEstimationInput();
 
+  /* Do Orientation Filter, the rate is integrated over the measured time between two IMU readouts */
+  const SI_data_t si_data = m_task_preprocessing.GetSIData();
+  m_orientation_filter.t_sampl = MeasureSampleTime(si_data.timestamp);
+  if (m_orientation_filter.t_sampl > 0.0F) {
+    quaternion_kinematics(&m_orientation_filter, si_data.gyro);
+  }
+
   if (m_fsm_enum < DROGUE) {
+#ifdef USE_TILT_COMPENSATION
+    m_filter.measured_acceleration = vertical_acceleration(&m_orientation_filter, si_data.acc) - GRAVITY;
+#else
     m_filter.measured_acceleration = input.acceleration_z;
+#endif
   } else {
     m_filter.measured_acceleration = 0;
   }
 
   m_filter.measured_AGL = input.height_AGL;
+  m_filter.measured_AGL_updated = input.height_updated;
 
-  /* Do Orientation Filter */
-  quaternion_kinematics(&m_orientation_filter, m_task_preprocessing.GetSIData().gyro);
+#ifdef USE_MULTI_RATE_ESTIMATION
+  /* The samples span the time between the last two IMU readouts */
+  m_num_accelerations = input.num_acceleration_samples;
+  m_num_missed_accelerations = input.num_missed_acceleration_samples;
+  for (uint8_t i = 0; i < m_num_accelerations; i++) {
+    m_accelerations[i] = (m_fsm_enum < DROGUE) ? input.acceleration_samples[i] : 0.0F;
+  }
+  m_height_updated = input.height_updated;
+#endif
 }
 
-estimation_output_t StateEstimation::GetEstimationOutput() const noexcept {
-  estimation_output_t output = {};
-  output.height = m_filter.x_bar_data[0];
-  output.velocity = m_filter.x_bar_data[1];
-  output.acceleration = m_filter.measured_acceleration + m_filter.x_bar_data[2];
-  return output;
+float32_t StateEstimation::MeasureSampleTime(timestamp_us_t timestamp) noexcept {
+  const uint32_t nominal_dt_us = 1000000U / global_control_sampling_freq;
+  const uint32_t dt_us = timestamp - m_timestamp;
+  m_timestamp = timestamp;
+
+  /* No time passed if no new IMU data arrived, the next readout spans the whole time since the last one */
+  if (dt_us == 0U) {
+    return 0.0F;
+  }
+  /* Use the nominal sampling time in the first step, whose previous timestamp is zero, or if the timestamps are
+   * implausible */
+  if (dt_us > 5U * nominal_dt_us) {
+    return 1.0F / static_cast<float32_t>(global_control_sampling_freq);
+  }
+  return static_cast<float32_t>(dt_us) * 1e-6F;
 }
 
+#ifdef USE_MULTI_RATE_ESTIMATION
+void StateEstimation::KalmanMultiRateStep() noexcept {
+  const float32_t measured_acceleration = m_filter.measured_acceleration;
+  if (m_orientation_filter.t_sampl == 0.0F) {
+    /* No new IMU data, the state stays where the last readout left it and only a new height is fused */
+    kalman_multi_rate_step(&m_filter, m_fsm_enum, nullptr, 0, m_filter.dt, m_height_updated);
+  } else if (m_num_accelerations == 0) {
+    /* Time passed without IMU samples in the input, propagate over it with the last acceleration */
+    kalman_multi_rate_step(&m_filter, m_fsm_enum, &measured_acceleration, 1, m_orientation_filter.t_sampl,
+                           m_height_updated);
+  } else {
+    /* The measured time also spans the samples lost before the new ones, they are bridged with the first new sample */
+    const float32_t dt = m_orientation_filter.t_sampl / static_cast<float32_t>(m_num_accelerations +
+                                                                               m_num_missed_accelerations);
+    for (uint8_t i = 0; i < m_num_missed_accelerations; i++) {
+      kalman_multi_rate_step(&m_filter, m_fsm_enum, m_accelerations, 1, dt, false);
+    }
+    kalman_multi_rate_step(&m_filter, m_fsm_enum, m_accelerations, m_num_accelerations, dt, m_height_updated);
+  }
+  /* The outputs keep using the median filtered acceleration of the control step */
+  m_filter.measured_acceleration = measured_acceleration;
+}
+#endif
+
+#ifdef USE_GNSS_FUSION
+void StateEstimation::GnssFusionStep() noexcept {
+  gnss_fusion_step(&m_gnss_fusion, &m_filter, m_fsm_enum);
+
+  if (m_task_telemetry == nullptr) {
+    return;
+  }
+  const gnss_altitude_t gnss_altitude = m_task_telemetry->GetGnssAltitude();
+  if ((gnss_altitude.timestamp == m_gnss_timestamp) || (gnss_altitude.sats < GNSS_MIN_SATS)) {
+    return;
+  }
+  m_gnss_timestamp = gnss_altitude.timestamp;
+
+  /* The fix was taken GNSS_LATENCY before its reception, which can lie after the acquisition of the current data */
+  const auto reception_age_us = static_cast<int32_t>(m_timestamp - gnss_altitude.timestamp);
+  const float32_t age = static_cast<float32_t>(reception_age_us) * 1e-6F + GNSS_LATENCY;
+  gnss_fusion_update(&m_gnss_fusion, &m_filter, m_fsm_enum, gnss_altitude.altitude, age);
+}
+#endif
+
+void StateEstimation::UpdateConsistency() noexcept {
+  if (!m_filter.nis_updated) {
+    return;
+  }
+  m_filter.nis_updated = false;
+
+  /* The filter only starts from a defined state when it is reset on the transition to READY */
+  if (m_fsm_enum < READY) {
+    return;
+  }
+  filter_consistency_t window{};
+  if (update_consistency(&m_consistency_monitor, m_filter.nis, m_fsm_enum, &window)) {
+    m_consistency_channel.Write(window);
+    record(m_timestamp, FILTER_CONSISTENCY, &window);
+  }
+}
+
+Matrix<2, 2> StateEstimation::EstimationCovariance() const noexcept {
+  /* Taken from the filter that ran the step, the fixed point filter only keeps the upper triangle */
+#if defined(USE_FIXED_POINT_ESTIMATION)
+  const float32_t covariance = m_fixed_filter.P[0][1].ToFloat();
+  return {{m_fixed_filter.P[0][0].ToFloat(), covariance, covariance, m_fixed_filter.P[1][1].ToFloat()}};
+#elif defined(USE_GNSS_FUSION)
+  return {{m_gnss_fusion.P(0, 0), m_gnss_fusion.P(0, 1), m_gnss_fusion.P(1, 0), m_gnss_fusion.P(1, 1)}};
+#else
+  return {{m_filter.P_bar(0, 0), m_filter.P_bar(0, 1), m_filter.P_bar(1, 0), m_filter.P_bar(1, 1)}};
+#endif
+}
+
+estimation_output_t StateEstimation::GetEstimationOutput() const noexcept { return m_estimation_output_channel.Read(); }
+
+apogee_prediction_t StateEstimation::GetApogeePrediction() const noexcept { return m_apogee_prediction_channel.Read(); }
+
+filter_consistency_t StateEstimation::GetFilterConsistency() const noexcept { return m_consistency_channel.Read(); }
+
 /**
  * @brief Function implementing the task_preprocessing thread.
  * @param argument: Not used
@@ -46,22 +155,42 @@ estimation_output_t StateEstimation::GetEstimationOutput() const noexcept {
   osDelay(1000);
 
   /* Initialize Kalman Filter */
-  init_filter_struct(&m_filter);
   initialize_matrices(&m_filter);
+#ifdef USE_FIXED_POINT_ESTIMATION
+  initialize_kalman_fixed(&m_fixed_filter, &m_filter);
+#endif
+#ifdef USE_GNSS_FUSION
+  init_gnss_fusion(&m_gnss_fusion, &m_filter);
+#endif
 
   /* initialize Orientation State Estimation */
   init_orientation_filter(&m_orientation_filter);
   reset_orientation_filter(&m_orientation_filter);
 
   uint32_t tick_count = osKernelGetTickCount();
-  constexpr uint32_t tick_update = sysGetTickFreq() / CONTROL_SAMPLING_FREQ;
+  const uint32_t tick_update = sysGetTickFreq() / global_control_sampling_freq;
   while (true) {
+#ifdef USE_DATAFLOW_PIPELINE
+    loop_timing_begin_triggered(LOOP_TIMING_STATE_ESTIMATION, LOOP_TIMING_PREPROCESSING);
+#else
+    loop_timing_begin(LOOP_TIMING_STATE_ESTIMATION, tick_count);
+#endif
+
     /* update fsm enum */
     bool fsm_updated = GetNewFsmEnum();
 
     /* Reset IMU when we go from CALIBRATING to READY */
     if ((m_fsm_enum == READY) && fsm_updated) {
       reset_kalman(&m_filter);
+      reset_consistency_monitor(&m_consistency_monitor);
+#ifdef USE_FIXED_POINT_ESTIMATION
+      reset_kalman_fixed(&m_fixed_filter);
+#endif
+#ifdef USE_GNSS_FUSION
+      reset_gnss_fusion(&m_gnss_fusion);
+#endif
+      /* The rocket rests on the launch pad, the measured acceleration points up */
+      set_orientation_vertical(&m_orientation_filter, m_task_preprocessing.GetSIData().acc);
       reset_orientation_filter(&m_orientation_filter);
     }
 
@@ -69,14 +198,47 @@ estimation_output_t StateEstimation::GetEstimationOutput() const noexcept {
     /* Reset Orientation Estimate when going to thrusting */
     if ((m_fsm_enum == THRUSTING) && fsm_updated) {
       soft_reset_kalman(&m_filter);
+#ifdef USE_FIXED_POINT_ESTIMATION
+      soft_reset_kalman_fixed(&m_fixed_filter);
+#endif
+#ifdef USE_GNSS_FUSION
+      soft_reset_gnss_fusion(&m_gnss_fusion);
+#endif
       reset_orientation_filter(&m_orientation_filter);
     }
 
+    /* Start a new drag fit when coasting begins */
+    if ((m_fsm_enum == COASTING) && fsm_updated) {
+      reset_apogee_predictor(&m_apogee_predictor, 1.0F / static_cast<float32_t>(global_control_sampling_freq));
+    }
+
     /* Write measurement data into the filter struct */
     GetEstimationInputData();
 
     /* Do a Kalman Step */
+#if defined(USE_FIXED_POINT_ESTIMATION)
+    kalman_fixed_step(&m_fixed_filter, &m_filter, m_fsm_enum);
+#elif defined(USE_GNSS_FUSION)
+    GnssFusionStep();
+#elif defined(USE_MULTI_RATE_ESTIMATION)
+    KalmanMultiRateStep();
+#else
     kalman_step(&m_filter, m_fsm_enum);
+#endif
+
+    UpdateConsistency();
+
+    const estimation_output_t estimation_output = {.height = m_filter.x_bar[0],
+                                                   .velocity = m_filter.x_bar[1],
+                                                   .acceleration = m_filter.measured_acceleration + m_filter.x_bar[2]};
+    m_estimation_output_channel.Write(estimation_output);
+
+    if (m_fsm_enum == COASTING) {
+      const apogee_prediction_t apogee_prediction =
+          predict_apogee(&m_apogee_predictor, estimation_output, EstimationCovariance(), m_timestamp);
+      m_apogee_prediction_channel.Write(apogee_prediction);
+      record(m_timestamp, APOGEE_PREDICTION, &apogee_prediction);
+    }
 
     orientation_info_t orientation_info{};
     /*
@@ -89,7 +251,7 @@ estimation_output_t StateEstimation::GetEstimationOutput() const noexcept {
           static_cast<int16_t>(m_orientation_filter.estimate_data[i] * 10000.0F);
     }
 
-    record(tick_count, ORIENTATION_INFO, &orientation_info);
+    record(m_timestamp, ORIENTATION_INFO, &orientation_info);
 
     /* record filtered data */
     filtered_data_info_t filtered_data_info = {
@@ -97,25 +259,36 @@ estimation_output_t StateEstimation::GetEstimationOutput() const noexcept {
         .filtered_acceleration = m_filter.measured_acceleration,
     };
 
-    record(tick_count, FILTERED_DATA_INFO, &filtered_data_info);
+    record(m_timestamp, FILTERED_DATA_INFO, &filtered_data_info);
 
     /* Log KF outputs */
-    flight_info_t flight_info = {.height = m_filter.x_bar_data[0],
-                                 .velocity = m_filter.x_bar_data[1],
-                                 .acceleration = m_filter.measured_acceleration + m_filter.x_bar_data[2]};
+    flight_info_t flight_info = {.height = m_filter.x_bar[0],
+                                 .velocity = m_filter.x_bar[1],
+                                 .acceleration = m_filter.measured_acceleration + m_filter.x_bar[2]};
     if (m_fsm_enum >= DROGUE) {
-      flight_info.acceleration = m_filter.x_bar_data[2];
+      flight_info.acceleration = m_filter.x_bar[2];
     }
-    record(tick_count, FLIGHT_INFO, &flight_info);
+    record(m_timestamp, FLIGHT_INFO, &flight_info);
 
     // log_info("H: %ld; V: %ld; A: %ld; O: %ld", (int32_t)((float)filter.x_bar.pData[0] * 1000),
     //          (int32_t)((float)filter.x_bar.pData[1] * 1000), (int32_t)(filtered_data_info.filtered_acceleration *
     //          1000), (int32_t)((float)filter.x_bar.pData[2] * 1000));
-    log_sim("[%lu]: height: %f, velocity: %f, offset: %f", tick_count, static_cast<double>(m_filter.x_bar.pData[0]),
-            static_cast<double>(m_filter.x_bar.pData[1]), static_cast<double>(m_filter.x_bar_data[2]));
+    log_sim("[%lu]: height: %f, velocity: %f, offset: %f", tick_count, static_cast<double>(m_filter.x_bar[0]),
+            static_cast<double>(m_filter.x_bar[1]), static_cast<double>(m_filter.x_bar[2]));
+
+    loop_timing_publish(LOOP_TIMING_STATE_ESTIMATION);
+    NotifyDataSubscriber();
+
+    loop_timing_end(LOOP_TIMING_STATE_ESTIMATION);
 
+#ifdef USE_DATAFLOW_PIPELINE
+    /* Run as soon as the previous stage published new data, the timeout keeps the task alive if it stalls */
+    WaitForData(2 * tick_update);
+    tick_count = osKernelGetTickCount();
+#else
     tick_count += tick_update;
     osDelayUntil(tick_count);
+#endif
   }
 }
 
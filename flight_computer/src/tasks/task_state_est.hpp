@@ -4,20 +4,25 @@
 
 #pragma once
 
+#include "config/globals.hpp"
+#include "control/apogee_predictor.hpp"
+#include "control/consistency.hpp"
+#include "control/gnss_fusion.hpp"
 #include "control/kalman_filter.hpp"
+#include "control/kalman_fixed.hpp"
 #include "control/orientation_filter.hpp"
 #include "task.hpp"
 #include "task_preprocessing.hpp"
 #include "tasks/task_preprocessing.hpp"
 #include "util/error_handler.hpp"
+#include "util/latest_value.hpp"
 #include "util/log.h"
 #include "util/types.hpp"
 
-#include <atomic>
-
 namespace task {
 
 class StateEstimation;
+class Telemetry;
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 extern StateEstimation* global_state_estimation;
 
@@ -25,22 +30,75 @@ class StateEstimation final : public Task<StateEstimation, 512> {
  public:
   explicit StateEstimation(const Preprocessing& task_preprocessing)
       : m_task_preprocessing{task_preprocessing},
-        m_filter{.t_sampl = 1.0F / static_cast<float>(CONTROL_SAMPLING_FREQ)},
+        m_filter{.t_sampl = 1.0F / static_cast<float>(global_control_sampling_freq)},
         m_orientation_filter{} {
     global_state_estimation = this;
   }
   [[nodiscard]] estimation_output_t GetEstimationOutput() const noexcept;
+  [[nodiscard]] apogee_prediction_t GetApogeePrediction() const noexcept;
+  [[nodiscard]] filter_consistency_t GetFilterConsistency() const noexcept;
+#ifdef USE_GNSS_FUSION
+  /** Fuse the GNSS altitude received by the telemetry task, must be set before the scheduler starts
+   *
+   * @param task_telemetry telemetry task, can be nullptr
+   */
+  void SetGnssSource(const Telemetry* task_telemetry) noexcept { m_task_telemetry = task_telemetry; }
+#endif
 
  private:
   [[noreturn]] void Run() noexcept override;
 
   void GetEstimationInputData();
+  void UpdateConsistency() noexcept;
+  /* Covariance of the estimated height and velocity */
+  [[nodiscard]] Matrix<2, 2> EstimationCovariance() const noexcept;
+  /* Time since the previous IMU readout in s, zero if no new IMU data arrived */
+  float32_t MeasureSampleTime(timestamp_us_t timestamp) noexcept;
+#ifdef USE_MULTI_RATE_ESTIMATION
+  void KalmanMultiRateStep() noexcept;
+#endif
+#ifdef USE_GNSS_FUSION
+  void GnssFusionStep() noexcept;
+#endif
 
   const Preprocessing& m_task_preprocessing;
 
+  /* Acquisition time of the current input data */
+  timestamp_us_t m_timestamp = 0U;
+
   /* Initialize State Estimation */
   kalman_filter_t m_filter;
   orientation_filter_t m_orientation_filter;
+  apogee_predictor_t m_apogee_predictor{};
+  consistency_monitor_t m_consistency_monitor{};
+
+#ifdef USE_FIXED_POINT_ESTIMATION
+  kalman_fixed_t m_fixed_filter{};
+#endif
+
+#ifdef USE_GNSS_FUSION
+  gnss_fusion_t m_gnss_fusion{};
+  const Telemetry* m_task_telemetry = nullptr;
+  /* Reception time of the last GNSS fix that was handed to the filter */
+  timestamp_us_t m_gnss_timestamp = 0U;
+#endif
+
+#ifdef USE_MULTI_RATE_ESTIMATION
+  /* IMU samples and barometer update of the current control step */
+  float32_t m_accelerations[IMU_MAX_BATCH_SIZE] = {};
+  uint8_t m_num_accelerations = 0U;
+  uint8_t m_num_missed_accelerations = 0U;
+  bool m_height_updated = false;
+#endif
+
+  /* Published estimate, read by the flight state machine, telemetry and the CLI */
+  LatestValue<estimation_output_t> m_estimation_output_channel{};
+
+  /* Predicted apogee, updated while coasting */
+  LatestValue<apogee_prediction_t> m_apogee_prediction_channel{};
+
+  /* NIS statistics of the last completed window */
+  LatestValue<filter_consistency_t> m_consistency_channel{};
 };
 
 }  // namespace task
@@ -268,7 +268,7 @@ void Telemetry::ParseRxMessage(packed_rx_msg_t* rx_payload) noexcept {
 
     /* Log GNSS data if we received it in this iteration. */
     if (gnss_position_received) {
-      record(tick_count, GNSS_INFO, &(gnss_data.position));
+      record(sysGetMicros(), GNSS_INFO, &(gnss_data.position));
       gnss_position_received = false;
     }
 
@@ -310,6 +310,8 @@ void Telemetry::ParseRxMessage(packed_rx_msg_t* rx_payload) noexcept {
   }
 }
 
+gnss_altitude_t Telemetry::GetGnssAltitude() const noexcept { return m_gnss_altitude_channel.Read(); }
+
 bool Telemetry::CheckValidOpCode(uint8_t op_code) noexcept {
   /* TODO loop over all opcodes and check if it exists */
   return op_code == CMD_GNSS_INFO || op_code == CMD_GNSS_LOC || op_code == CMD_RX || op_code == CMD_INFO ||
@@ -344,6 +346,15 @@ bool Telemetry::Parse(uint8_t op_code, const uint8_t* buffer, uint32_t length, g
     memcpy(&(gnss->position.lat), buffer, 4);
     memcpy(&(gnss->position.lon), &buffer[4], 4);
     log_info("[GNSS location]: LAT: %f, LON: %f", (double)gnss->position.lat, (double)gnss->position.lon);
+    /* Older telemetry firmware does not send the altitude */
+    if (length >= 12) {
+      int32_t altitude = 0;
+      memcpy(&altitude, &buffer[8], 4);
+      m_gnss_altitude_channel.Write({.timestamp = sysGetMicros(),
+                                     .altitude = static_cast<float32_t>(altitude),
+                                     .sats = gnss->position.sats});
+      log_info("[GNSS location]: ALT: %ld", altitude);
+    }
   } else if (op_code == CMD_GNSS_INFO) {
     gnss_position_received = true;
     gnss->position.sats = buffer[0];
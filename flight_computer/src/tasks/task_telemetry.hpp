@@ -7,6 +7,8 @@
 #include "task.hpp"
 #include "task_buzzer.hpp"
 #include "task_state_est.hpp"
+#include "util/gnss.hpp"
+#include "util/latest_value.hpp"
 
 namespace task {
 
@@ -17,6 +19,8 @@ class Telemetry final : public Task<Telemetry, 1024> {
         m_task_state_estimation{task_state_estimation},
         m_task_buzzer{task_buzzer} {}
 
+  [[nodiscard]] gnss_altitude_t GetGnssAltitude() const noexcept;
+
  private:
   [[noreturn]] void Run() noexcept override;
 
@@ -78,6 +82,9 @@ class Telemetry final : public Task<Telemetry, 1024> {
 
   float32_t m_amplifier_temperature{0.0F};
 
+  /* Latest GNSS altitude, read by the state estimation */
+  LatestValue<gnss_altitude_t> m_gnss_altitude_channel{};
+
   static constexpr float32_t k_amplifier_hot_limit{60.F};
 };
 
@@ -24,6 +24,6 @@ void init_recorder_speed_map() {
 
     memset(recorder_speed_map[i], 0, 14 * sizeof(char));
     snprintf(recorder_speed_map[i], 14, "%.4gHz",
-             static_cast<double>(CONTROL_SAMPLING_FREQ) / static_cast<double>(i + 1));
+             static_cast<double>(global_control_sampling_freq) / static_cast<double>(i + 1));
   }
 }
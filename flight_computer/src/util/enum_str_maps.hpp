@@ -48,6 +48,10 @@ inline constexpr std::array<const char *, 2> on_off_map{
 
 inline constexpr std::array<const char *, 3> battery_map{"LI-ION", "LI-PO", "ALKALINE"};
 
+/* Same order as CONTROL_SAMPLING_FREQS */
+inline constexpr std::array<const char *, NUM_CONTROL_SAMPLING_FREQS> control_sampling_freq_map{
+    "50Hz", "100Hz", "125Hz", "250Hz"};
+
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 extern std::array<char *, NUM_REC_SPEEDS> recorder_speed_map;
 
@@ -5,6 +5,7 @@
 #include "util/error_handler.hpp"
 #include "flash/recorder.hpp"
 #include "util/log.h"
+#include "util/task_util.hpp"
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 static uint32_t errors = 0;
@@ -17,7 +18,7 @@ void add_error(cats_error_e err) {
       errors |= err;
 
       error_info_t error_info = {.error = static_cast<cats_error_e>(errors)};
-      record(osKernelGetTickCount(), ERROR_INFO, &error_info);
+      record(sysGetMicros(), ERROR_INFO, &error_info);
     }
   }
 }
@@ -27,7 +28,7 @@ void clear_error(cats_error_e err) {
     errors &= ~err;
 
     error_info_t error_info = {.error = static_cast<cats_error_e>(errors)};
-    record(osKernelGetTickCount(), ERROR_INFO, &error_info);
+    record(sysGetMicros(), ERROR_INFO, &error_info);
   }
 }
 
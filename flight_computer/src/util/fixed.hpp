@@ -0,0 +1,186 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "arm_math.h"
+
+#include <compare>
+#include <cstdint>
+
+/**
+ * Signed 32 bit fixed point number with FracBits fractional bits, e.g. Fixed<16> is Q16.16 and Fixed<30> is Q2.30.
+ *
+ * All operations are integer operations with a defined rounding, the results are therefore identical on every
+ * platform and with every compiler setting. Results outside of the range saturate instead of wrapping around.
+ * Products and quotients are rounded to the nearest value, ties away from zero.
+ *
+ * @tparam FracBits number of fractional bits
+ */
+template <uint8_t FracBits>
+class Fixed {
+  static_assert(FracBits < 32, "at least the sign bit has to remain");
+
+ public:
+  static constexpr uint8_t kFracBits = FracBits;
+
+  constexpr Fixed() = default;
+
+  /** Wrap a raw value
+   *
+   * @param raw value scaled by 2^FracBits
+   */
+  static constexpr Fixed FromRaw(int32_t raw) noexcept {
+    Fixed out;
+    out.m_raw = raw;
+    return out;
+  }
+
+  /** Convert from an integer
+   *
+   * @param value integer value, saturated to the range
+   */
+  static constexpr Fixed FromInt(int32_t value) noexcept {
+    return FromRaw(Saturate(static_cast<int64_t>(value) * kOne));
+  }
+
+  /** Convert from a float, this is the only point where the rounding of the float unit enters
+   *
+   * @param value float value, rounded to the nearest representable value and saturated to the range
+   */
+  static constexpr Fixed FromFloat(float32_t value) noexcept {
+    /* The scaling by a power of two is exact */
+    const float32_t scaled = value * static_cast<float32_t>(kOne);
+    if (!(scaled < static_cast<float32_t>(INT32_MAX))) {
+      /* NaN saturates to the maximum as well */
+      return FromRaw(scaled < 0.0F ? INT32_MIN : INT32_MAX);
+    }
+    if (scaled <= static_cast<float32_t>(INT32_MIN)) {
+      return FromRaw(INT32_MIN);
+    }
+    const auto truncated = static_cast<int32_t>(scaled);
+    const float32_t remainder = scaled - static_cast<float32_t>(truncated);
+    if (remainder >= 0.5F) {
+      return FromRaw(truncated + 1);
+    }
+    if (remainder <= -0.5F) {
+      return FromRaw(truncated - 1);
+    }
+    return FromRaw(truncated);
+  }
+
+  static constexpr Fixed Max() noexcept { return FromRaw(INT32_MAX); }
+  static constexpr Fixed Min() noexcept { return FromRaw(INT32_MIN); }
+
+  [[nodiscard]] constexpr int32_t Raw() const noexcept { return m_raw; }
+
+  [[nodiscard]] constexpr float32_t ToFloat() const noexcept {
+    return static_cast<float32_t>(m_raw) / static_cast<float32_t>(kOne);
+  }
+
+  /** Change the number of fractional bits
+   *
+   * @tparam F fractional bits of the result
+   * @return the value rounded and saturated to the new format
+   */
+  template <uint8_t F>
+  [[nodiscard]] constexpr Fixed<F> Convert() const noexcept {
+    return Fixed<F>::FromRaw(Saturate(Shift(m_raw, static_cast<int32_t>(F) - FracBits)));
+  }
+
+  constexpr Fixed operator-() const noexcept { return FromRaw(Saturate(-static_cast<int64_t>(m_raw))); }
+
+  constexpr Fixed& operator+=(Fixed other) noexcept {
+    m_raw = Saturate(static_cast<int64_t>(m_raw) + other.m_raw);
+    return *this;
+  }
+
+  constexpr Fixed& operator-=(Fixed other) noexcept {
+    m_raw = Saturate(static_cast<int64_t>(m_raw) - other.m_raw);
+    return *this;
+  }
+
+  friend constexpr Fixed operator+(Fixed lhs, Fixed rhs) noexcept { return lhs += rhs; }
+  friend constexpr Fixed operator-(Fixed lhs, Fixed rhs) noexcept { return lhs -= rhs; }
+
+  friend constexpr bool operator==(const Fixed& lhs, const Fixed& rhs) noexcept = default;
+  friend constexpr auto operator<=>(const Fixed& lhs, const Fixed& rhs) noexcept = default;
+
+  /* Saturate a wide intermediate result to the 32 bit range */
+  static constexpr int32_t Saturate(int64_t value) noexcept {
+    if (value > INT32_MAX) {
+      return INT32_MAX;
+    }
+    if (value < INT32_MIN) {
+      return INT32_MIN;
+    }
+    return static_cast<int32_t>(value);
+  }
+
+  /* Multiply by 2^shift, a negative shift divides and rounds to the nearest value, ties away from zero */
+  static constexpr int64_t Shift(int64_t value, int32_t shift) noexcept {
+    if (shift >= 0) {
+      /* Shifting a negative value left is defined since C++20 */
+      return value << shift;
+    }
+    const int64_t half = int64_t{1} << (-shift - 1);
+    return (value >= 0) ? ((value + half) >> -shift) : -((-value + half) >> -shift);
+  }
+
+ private:
+  static constexpr int64_t kOne = int64_t{1} << FracBits;
+
+  int32_t m_raw = 0;
+};
+
+/** Multiply two fixed point numbers of any format
+ *
+ * @tparam F fractional bits of the result
+ * @return the product rounded and saturated to Fixed<F>
+ */
+template <uint8_t F, uint8_t A, uint8_t B>
+constexpr Fixed<F> multiply(Fixed<A> lhs, Fixed<B> rhs) noexcept {
+  static_assert(A + B >= F, "the product has fewer fractional bits than the result");
+  const int64_t product = static_cast<int64_t>(lhs.Raw()) * rhs.Raw();
+  return Fixed<F>::FromRaw(Fixed<F>::Saturate(Fixed<F>::Shift(product, static_cast<int32_t>(F) - A - B)));
+}
+
+/** Divide two fixed point numbers of any format
+ *
+ * @tparam F fractional bits of the result
+ * @return the quotient rounded and saturated to Fixed<F>, a division by zero saturates in the direction of the sign of
+ *         the dividend
+ */
+template <uint8_t F, uint8_t A, uint8_t B>
+constexpr Fixed<F> divide(Fixed<A> lhs, Fixed<B> rhs) noexcept {
+  static_assert(F + B >= A, "the quotient needs to be scaled up");
+  static_assert(F + B - A < 32, "the scaled dividend has to fit into 64 bit");
+  if (rhs.Raw() == 0) {
+    return (lhs.Raw() < 0) ? Fixed<F>::Min() : Fixed<F>::Max();
+  }
+  const int64_t dividend = static_cast<int64_t>(lhs.Raw()) * (int64_t{1} << (F + B - A));
+  const int64_t divisor = rhs.Raw();
+  /* Round the magnitude to the nearest value, ties away from zero */
+  const int64_t divisor_magnitude = (divisor < 0) ? -divisor : divisor;
+  const int64_t magnitude = ((dividend < 0) ? -dividend : dividend) + divisor_magnitude / 2;
+  const int64_t quotient = magnitude / divisor_magnitude;
+  return Fixed<F>::FromRaw(Fixed<F>::Saturate(((dividend < 0) != (divisor < 0)) ? -quotient : quotient));
+}
+
+/* Product in the format of the left operand */
+template <uint8_t A, uint8_t B>
+constexpr Fixed<A> operator*(Fixed<A> lhs, Fixed<B> rhs) noexcept {
+  return multiply<A>(lhs, rhs);
+}
+
+/* Quotient in the format of the left operand */
+template <uint8_t A, uint8_t B>
+constexpr Fixed<A> operator/(Fixed<A> lhs, Fixed<B> rhs) noexcept {
+  return divide<A>(lhs, rhs);
+}
+
+/* Q16.16, e.g. heights, velocities and accelerations */
+using q16_16_t = Fixed<16>;
+/* Q2.30, e.g. gains and model coefficients with a magnitude below two */
+using q2_30_t = Fixed<30>;
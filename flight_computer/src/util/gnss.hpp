@@ -23,3 +23,10 @@ struct gnss_data_t {
   gnss_position_t position;
   gnss_time_t time;
 };
+
+/* GNSS altitude handed from the telemetry task to the state estimation */
+struct gnss_altitude_t {
+  uint32_t timestamp;  // us, reception time of the fix on the flight computer
+  float32_t altitude;  // m above mean sea level
+  uint8_t sats;        // number of satellites used for the fix, 0 if no fix was received yet
+};
@@ -0,0 +1,166 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "util/types.hpp"
+
+#include "arm_math.h"
+
+#include <cstdint>
+#include <cstring>
+
+/* Kernels for the int16 sensor samples. Two channels are packed into each 32 bit word, such that the M4 DSP extension
+ * processes both with one instruction. Every kernel has a portable version with bit identical results. The DSP versions
+ * also build on the host, where arm_math.h defines the intrinsics in C, so both can be compared there. */
+
+/* The six channels of an IMU sample, as packed in imu_data_t */
+inline constexpr uint8_t IMU_NUM_CHANNELS = 6;
+
+static_assert(sizeof(imu_data_t) == IMU_NUM_CHANNELS * sizeof(int16_t), "the channels are packed in pairs");
+static_assert(sizeof(vi16_t) == 3 * sizeof(int16_t), "the channels are packed in pairs");
+
+namespace int16_kernels {
+
+/* x and y in the first word, z in the lower half of the second one, the upper half is zero */
+inline void pack(const vi16_t& value, uint32_t (&words)[2]) {
+  words[0] = static_cast<uint16_t>(value.x) | (static_cast<uint32_t>(static_cast<uint16_t>(value.y)) << 16U);
+  words[1] = static_cast<uint16_t>(value.z);
+}
+
+namespace dsp {
+
+inline void sum_imu_samples(const imu_data_t* samples, uint8_t count, int32_t (&sum)[IMU_NUM_CHANNELS]) {
+  /* Each word holds two channels, the lower one first. SMLAD multiplies both halves with those of the second operand
+   * and adds the products, a one in only one half adds that channel sign extended. */
+  constexpr uint32_t kLower = 0x00000001U;
+  constexpr uint32_t kUpper = 0x00010000U;
+  uint32_t acc[IMU_NUM_CHANNELS];
+  memcpy(acc, sum, sizeof(acc));
+  for (uint8_t k = 0; k < count; k++) {
+    uint32_t words[IMU_NUM_CHANNELS / 2];
+    /* imu_data_t is only 2 byte aligned, the M4 handles unaligned word loads */
+    memcpy(words, &samples[k], sizeof(words));
+    for (uint8_t j = 0; j < IMU_NUM_CHANNELS / 2; j++) {
+      acc[2 * j] = __SMLAD(words[j], kLower, acc[2 * j]);
+      acc[2 * j + 1] = __SMLAD(words[j], kUpper, acc[2 * j + 1]);
+    }
+  }
+  memcpy(sum, acc, sizeof(acc));
+}
+
+inline bool out_of_bounds(const vi16_t& value, const vi16_t& lower, const vi16_t& upper) {
+  uint32_t v[2];
+  uint32_t lo[2];
+  uint32_t hi[2];
+  pack(value, v);
+  pack(lower, lo);
+  pack(upper, hi);
+  /* A channel is above its upper limit if upper - value is negative, below its lower limit if value - lower is. The
+   * saturating subtraction keeps the sign of differences beyond the int16 range. */
+  constexpr uint32_t kSignBits = 0x80008000U;
+  const uint32_t violations = (__QSUB16(hi[0], v[0]) | __QSUB16(v[0], lo[0]) | __QSUB16(hi[1], v[1]) |
+                               __QSUB16(v[1], lo[1])) &
+                              kSignBits;
+  return violations != 0U;
+}
+
+inline bool changed(const vi16_t& value, const vi16_t& last) {
+  uint32_t v[2];
+  uint32_t l[2];
+  pack(value, v);
+  pack(last, l);
+  /* Two channels per comparison */
+  return ((v[0] ^ l[0]) | (v[1] ^ l[1])) != 0U;
+}
+
+inline void scale(const vi16_t& value, const float32_t (&factor)[3], float32_t (&out)[3]) {
+  uint32_t v[2];
+  pack(value, v);
+  /* The float conversion has no packed form, the halves are sign extended from the words */
+  out[0] = static_cast<float32_t>(static_cast<int16_t>(v[0] & 0xFFFFU)) * factor[0];
+  out[1] = static_cast<float32_t>(static_cast<int16_t>(v[0] >> 16U)) * factor[1];
+  out[2] = static_cast<float32_t>(static_cast<int16_t>(v[1] & 0xFFFFU)) * factor[2];
+}
+
+}  // namespace dsp
+
+namespace portable {
+
+inline void sum_imu_samples(const imu_data_t* samples, uint8_t count, int32_t (&sum)[IMU_NUM_CHANNELS]) {
+  for (uint8_t k = 0; k < count; k++) {
+    sum[0] += samples[k].acc.x;
+    sum[1] += samples[k].acc.y;
+    sum[2] += samples[k].acc.z;
+    sum[3] += samples[k].gyro.x;
+    sum[4] += samples[k].gyro.y;
+    sum[5] += samples[k].gyro.z;
+  }
+}
+
+inline bool out_of_bounds(const vi16_t& value, const vi16_t& lower, const vi16_t& upper) {
+  return (value.x > upper.x) || (value.x < lower.x) || (value.y > upper.y) || (value.y < lower.y) ||
+         (value.z > upper.z) || (value.z < lower.z);
+}
+
+inline bool changed(const vi16_t& value, const vi16_t& last) {
+  return (value.x != last.x) || (value.y != last.y) || (value.z != last.z);
+}
+
+inline void scale(const vi16_t& value, const float32_t (&factor)[3], float32_t (&out)[3]) {
+  out[0] = static_cast<float32_t>(value.x) * factor[0];
+  out[1] = static_cast<float32_t>(value.y) * factor[1];
+  out[2] = static_cast<float32_t>(value.z) * factor[2];
+}
+
+}  // namespace portable
+
+#ifdef ARM_MATH_DSP
+namespace impl = dsp;
+#else
+namespace impl = portable;
+#endif
+
+}  // namespace int16_kernels
+
+/** Sum up IMU samples channel by channel
+ *
+ * @param samples IMU samples
+ * @param count number of samples
+ * @param sum acceleration x, y, z followed by angular rate x, y, z, added to the given values
+ */
+inline void sum_imu_samples(const imu_data_t* samples, uint8_t count, int32_t (&sum)[IMU_NUM_CHANNELS]) {
+  int16_kernels::impl::sum_imu_samples(samples, count, sum);
+}
+
+/** Average IMU samples channel by channel, the mean is rounded towards zero
+ *
+ * @param samples IMU samples
+ * @param count number of samples, at least one
+ * @return mean of the samples
+ */
+inline imu_data_t mean_imu_samples(const imu_data_t* samples, uint8_t count) {
+  int32_t sum[IMU_NUM_CHANNELS] = {};
+  sum_imu_samples(samples, count, sum);
+  const auto n = static_cast<int32_t>(count);
+  return {.acc = {.x = static_cast<int16_t>(sum[0] / n),
+                  .y = static_cast<int16_t>(sum[1] / n),
+                  .z = static_cast<int16_t>(sum[2] / n)},
+          .gyro = {.x = static_cast<int16_t>(sum[3] / n),
+                   .y = static_cast<int16_t>(sum[4] / n),
+                   .z = static_cast<int16_t>(sum[5] / n)}};
+}
+
+/* True if any channel lies outside of [lower, upper] */
+inline bool vi16_out_of_bounds(const vi16_t& value, const vi16_t& lower, const vi16_t& upper) {
+  return int16_kernels::impl::out_of_bounds(value, lower, upper);
+}
+
+/* True if any channel differs from the last sample */
+inline bool vi16_changed(const vi16_t& value, const vi16_t& last) { return int16_kernels::impl::changed(value, last); }
+
+/* Multiply every channel with its conversion factor */
+inline void vi16_scale(const vi16_t& value, const float32_t (&factor)[3], float32_t (&out)[3]) {
+  int16_kernels::impl::scale(value, factor, out);
+}
@@ -0,0 +1,97 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Hands the latest value of a struct from one writer task to any number of reader tasks without locking.
+ *
+ * The value is kept in two copies guarded by a sequence counter. The writer always updates the copy the readers are
+ * currently not directed to, a reader therefore never has to wait for a write in progress. If the writer overtakes a
+ * reader, e.g. because it preempted the reader, the reader notices the changed sequence and copies the value again.
+ * Writing is wait-free, reading is lock-free and can not be starved by a lower priority writer.
+ *
+ * @tparam T trivially copyable value type
+ */
+template <typename T>
+class LatestValue {
+  static_assert(std::is_trivially_copyable_v<T>, "the value is copied word by word");
+
+ public:
+  LatestValue() { Write(T{}); }
+
+  explicit LatestValue(const T& value) { Write(value); }
+
+  /** Publish a new value, must only be called from a single task
+   *
+   * @param value the new value
+   */
+  void Write(const T& value) noexcept {
+    std::array<uint32_t, kNumWords> words{};
+    std::memcpy(words.data(), &value, sizeof(T));
+
+    const uint32_t seq = m_sequence.load(std::memory_order_relaxed);
+    /* Direct the readers to the second copy and update the first one */
+    m_sequence.store(seq + 1U, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Store(m_copies[0], words);
+    /* Direct the readers back to the first copy and update the second one */
+    m_sequence.store(seq + 2U, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    Store(m_copies[1], words);
+  }
+
+  /** Get the latest value
+   *
+   * @return a consistent copy of the latest value
+   */
+  [[nodiscard]] T Read() const noexcept {
+    std::array<uint32_t, kNumWords> words{};
+    uint32_t seq = 0U;
+    do {
+      seq = m_sequence.load(std::memory_order_acquire);
+      Load(m_copies[seq & 1U], words);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while (seq != m_sequence.load(std::memory_order_relaxed));
+
+    T value;
+    std::memcpy(&value, words.data(), sizeof(T));
+    return value;
+  }
+
+  /** Get the number of values written so far
+   *
+   * @return the number of calls to Write, including the initial value
+   */
+  [[nodiscard]] uint32_t GetWriteCount() const noexcept {
+    return m_sequence.load(std::memory_order_relaxed) / 2U;
+  }
+
+ private:
+  static constexpr size_t kNumWords = (sizeof(T) + sizeof(uint32_t) - 1U) / sizeof(uint32_t);
+
+  using Copy = std::array<std::atomic<uint32_t>, kNumWords>;
+
+  static void Store(Copy& copy, const std::array<uint32_t, kNumWords>& words) noexcept {
+    for (size_t i = 0U; i < kNumWords; i++) {
+      copy[i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+  static void Load(const Copy& copy, std::array<uint32_t, kNumWords>& words) noexcept {
+    for (size_t i = 0U; i < kNumWords; i++) {
+      words[i] = copy[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  /// Even while the first copy is valid, odd while the first copy is being written
+  std::atomic<uint32_t> m_sequence{0U};
+  std::array<Copy, 2> m_copies{};
+};
@@ -0,0 +1,130 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "util/loop_timing.hpp"
+
+#include "cmsis_os.h"
+#include "target.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+static loop_timing_stats_t stats[NUM_LOOP_TIMING_TASKS];
+
+static uint32_t start_cycles[NUM_LOOP_TIMING_TASKS];
+static uint32_t publish_cycles[NUM_LOOP_TIMING_TASKS];
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+static const char *const task_names[NUM_LOOP_TIMING_TASKS] = {"SensorRead", "Preprocessing", "StateEstimation",
+                                                              "FlightFsm"};
+
+static uint32_t cycles_to_us(uint32_t cycles) { return cycles / (SystemCoreClock / 1000000U); }
+
+static uint8_t get_bin(uint32_t us) {
+  if (us == 0U) {
+    return 0U;
+  }
+  /* Number of significant bits, e.g. 1 us -> bin 1, 2-3 us -> bin 2 */
+  const auto bin = static_cast<uint8_t>(32U - static_cast<uint32_t>(__builtin_clz(us)));
+  return std::min(bin, static_cast<uint8_t>(LOOP_TIMING_NUM_BINS - 1U));
+}
+
+static void add_sample(loop_timing_hist_t *hist, uint32_t us) {
+  hist->bins[get_bin(us)]++;
+  hist->count++;
+  hist->max_us = std::max(hist->max_us, us);
+  hist->window_max_us = std::max(hist->window_max_us, us);
+}
+
+/* Time since the start of expected_tick, with the resolution of the SysTick counter */
+static uint32_t get_cycles_since_tick(uint32_t expected_tick) {
+  uint32_t tick = 0U;
+  uint32_t val = 0U;
+  /* Read again if the tick was incremented in between, tick and counter value would not match otherwise */
+  do {
+    tick = osKernelGetTickCount();
+    val = SysTick->VAL;
+  } while (tick != osKernelGetTickCount());
+
+  /* A task that was woken up by something else than its tick might run before it */
+  if (static_cast<int32_t>(tick - expected_tick) < 0) {
+    return 0U;
+  }
+
+  /* SysTick counts down from LOAD to zero once per tick */
+  const uint32_t reload = SysTick->LOAD;
+  return (tick - expected_tick) * (reload + 1U) + (reload - val);
+}
+
+void loop_timing_init() {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  loop_timing_reset();
+}
+
+void loop_timing_begin(loop_timing_task_e task, uint32_t expected_tick) {
+  start_cycles[task] = DWT->CYCCNT;
+  add_sample(&stats[task].lateness, cycles_to_us(get_cycles_since_tick(expected_tick)));
+}
+
+void loop_timing_begin_triggered(loop_timing_task_e task, loop_timing_task_e trigger) {
+  start_cycles[task] = DWT->CYCCNT;
+  add_sample(&stats[task].lateness, cycles_to_us(start_cycles[task] - publish_cycles[trigger]));
+}
+
+void loop_timing_begin_untimed(loop_timing_task_e task) { start_cycles[task] = DWT->CYCCNT; }
+
+void loop_timing_publish(loop_timing_task_e task) { publish_cycles[task] = DWT->CYCCNT; }
+
+void loop_timing_end(loop_timing_task_e task) {
+  /* Unsigned arithmetic takes care of a counter overflow in between */
+  add_sample(&stats[task].execution, cycles_to_us(DWT->CYCCNT - start_cycles[task]));
+}
+
+const loop_timing_stats_t *loop_timing_get_stats(loop_timing_task_e task) { return &stats[task]; }
+
+uint32_t loop_timing_percentile(const loop_timing_hist_t *hist, uint8_t percent) {
+  if (hist->count == 0U) {
+    return 0U;
+  }
+  /* Number of samples that have to be at or below the percentile, rounded up */
+  const uint32_t target = static_cast<uint32_t>((static_cast<uint64_t>(hist->count) * percent + 99U) / 100U);
+  uint32_t cumulative = 0U;
+  for (uint8_t i = 0; i < LOOP_TIMING_NUM_BINS - 1U; i++) {
+    cumulative += hist->bins[i];
+    if (cumulative >= target) {
+      /* The maximum is a tighter bound if it lies in this bin */
+      return std::min((1U << i) - 1U, hist->max_us);
+    }
+  }
+  return hist->max_us;
+}
+
+loop_timing_info_t loop_timing_get_info(loop_timing_task_e task) {
+  loop_timing_stats_t *task_stats = &stats[task];
+  constexpr auto to_u16 = [](uint32_t us) {
+    return static_cast<uint16_t>(std::min(us, static_cast<uint32_t>(UINT16_MAX)));
+  };
+
+  const loop_timing_info_t info = {
+      .lateness_max = to_u16(task_stats->lateness.window_max_us),
+      .lateness_p99 = to_u16(loop_timing_percentile(&task_stats->lateness, 99)),
+      .execution_max = to_u16(task_stats->execution.window_max_us),
+      .execution_p99 = to_u16(loop_timing_percentile(&task_stats->execution, 99)),
+  };
+  task_stats->lateness.window_max_us = 0U;
+  task_stats->execution.window_max_us = 0U;
+  return info;
+}
+
+void loop_timing_reset() { memset(stats, 0, sizeof(stats)); }
+
+const char *loop_timing_task_name(loop_timing_task_e task) {
+  if (task >= NUM_LOOP_TIMING_TASKS) {
+    return "Unknown";
+  }
+  return task_names[task];
+}
@@ -0,0 +1,73 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+
+/* Wake-up lateness and execution time of the periodic control tasks, measured with the DWT cycle counter */
+
+enum loop_timing_task_e : uint8_t {
+  LOOP_TIMING_SENSOR_READ = 0,
+  LOOP_TIMING_PREPROCESSING,
+  LOOP_TIMING_STATE_ESTIMATION,
+  LOOP_TIMING_FLIGHT_FSM,
+  NUM_LOOP_TIMING_TASKS,
+};
+
+/* Bin i holds the durations in [2^(i-1), 2^i) us, bin 0 holds durations below 1 us and the last bin is open ended */
+inline constexpr uint8_t LOOP_TIMING_NUM_BINS = 16;
+
+struct loop_timing_hist_t {
+  uint32_t bins[LOOP_TIMING_NUM_BINS];
+  uint32_t count;
+  /* Maximum since boot or the last reset */
+  uint32_t max_us;
+  /* Maximum since the last call to loop_timing_get_info */
+  uint32_t window_max_us;
+};
+
+struct loop_timing_stats_t {
+  loop_timing_hist_t lateness;
+  loop_timing_hist_t execution;
+};
+
+/* Recorded once per second and task, the task is encoded in the record ID. All values in us. */
+struct loop_timing_info_t {
+  uint16_t lateness_max;
+  uint16_t lateness_p99;
+  uint16_t execution_max;
+  uint16_t execution_p99;
+};
+
+/* Enable the cycle counter, needs to be called once before the scheduler is started */
+void loop_timing_init();
+
+/* Called right after a task woke up, expected_tick is the tick the task was supposed to wake up at */
+void loop_timing_begin(loop_timing_task_e task, uint32_t expected_tick);
+
+/* Called right after a task of the dataflow pipeline woke up. Such a task has no tick to be late for, its lateness is
+ * the time since the trigger task last published new data. */
+void loop_timing_begin_triggered(loop_timing_task_e task, loop_timing_task_e trigger);
+
+/* Called right after a task was woken up by an interrupt instead of its tick, only the execution time is measured */
+void loop_timing_begin_untimed(loop_timing_task_e task);
+
+/* Called right before a task wakes its subscriber with new data */
+void loop_timing_publish(loop_timing_task_e task);
+
+/* Called right before a task goes back to sleep */
+void loop_timing_end(loop_timing_task_e task);
+
+const loop_timing_stats_t *loop_timing_get_stats(loop_timing_task_e task);
+
+/* Upper bound of the bin that contains the given percentile */
+uint32_t loop_timing_percentile(const loop_timing_hist_t *hist, uint8_t percent);
+
+/* Summary for the recorder, restarts the window maximum */
+loop_timing_info_t loop_timing_get_info(loop_timing_task_e task);
+
+void loop_timing_reset();
+
+const char *loop_timing_task_name(loop_timing_task_e task);
@@ -0,0 +1,228 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "arm_math.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Small dense matrix with dimensions known at compile time, stored row by row.
+ *
+ * All loops have constant bounds and are unrolled, the operations compile to straight line code without the size and
+ * status checks of the generic arm_mat functions.
+ *
+ * @tparam R number of rows
+ * @tparam C number of columns
+ */
+template <uint8_t R, uint8_t C>
+struct Matrix {
+  static_assert((R > 0) && (C > 0), "empty matrices are not supported");
+
+  static constexpr uint8_t kRows = R;
+  static constexpr uint8_t kCols = C;
+
+  std::array<float32_t, R * C> data{};
+
+  static constexpr Matrix Identity() {
+    static_assert(R == C, "only square matrices have an identity");
+    Matrix out{};
+#pragma GCC unroll 16
+    for (uint8_t i = 0; i < R; i++) {
+      out(i, i) = 1.0F;
+    }
+    return out;
+  }
+
+  constexpr float32_t& operator()(uint8_t row, uint8_t col) { return data[row * C + col]; }
+  constexpr float32_t operator()(uint8_t row, uint8_t col) const { return data[row * C + col]; }
+
+  /* Element access by the storage index, mostly useful for vectors */
+  constexpr float32_t& operator[](uint8_t index) { return data[index]; }
+  constexpr float32_t operator[](uint8_t index) const { return data[index]; }
+
+  [[nodiscard]] constexpr Matrix<C, R> Transpose() const {
+    Matrix<C, R> out{};
+#pragma GCC unroll 16
+    for (uint8_t i = 0; i < R; i++) {
+#pragma GCC unroll 16
+      for (uint8_t j = 0; j < C; j++) {
+        out(j, i) = (*this)(i, j);
+      }
+    }
+    return out;
+  }
+
+  constexpr Matrix& operator+=(const Matrix& other) {
+#pragma GCC unroll 16
+    for (uint8_t i = 0; i < R * C; i++) {
+      data[i] += other.data[i];
+    }
+    return *this;
+  }
+
+  constexpr Matrix& operator-=(const Matrix& other) {
+#pragma GCC unroll 16
+    for (uint8_t i = 0; i < R * C; i++) {
+      data[i] -= other.data[i];
+    }
+    return *this;
+  }
+
+  constexpr Matrix& operator*=(float32_t scale) {
+#pragma GCC unroll 16
+    for (uint8_t i = 0; i < R * C; i++) {
+      data[i] *= scale;
+    }
+    return *this;
+  }
+};
+
+template <uint8_t R, uint8_t C>
+constexpr Matrix<R, C> operator+(Matrix<R, C> lhs, const Matrix<R, C>& rhs) {
+  return lhs += rhs;
+}
+
+template <uint8_t R, uint8_t C>
+constexpr Matrix<R, C> operator-(Matrix<R, C> lhs, const Matrix<R, C>& rhs) {
+  return lhs -= rhs;
+}
+
+template <uint8_t R, uint8_t C>
+constexpr Matrix<R, C> operator*(Matrix<R, C> lhs, float32_t scale) {
+  return lhs *= scale;
+}
+
+template <uint8_t R, uint8_t C>
+constexpr Matrix<R, C> operator*(float32_t scale, Matrix<R, C> rhs) {
+  return rhs *= scale;
+}
+
+template <uint8_t R, uint8_t K, uint8_t C>
+constexpr Matrix<R, C> operator*(const Matrix<R, K>& lhs, const Matrix<K, C>& rhs) {
+  Matrix<R, C> out{};
+#pragma GCC unroll 16
+  for (uint8_t i = 0; i < R; i++) {
+#pragma GCC unroll 16
+    for (uint8_t j = 0; j < C; j++) {
+      float32_t sum = 0.0F;
+#pragma GCC unroll 16
+      for (uint8_t k = 0; k < K; k++) {
+        sum += lhs(i, k) * rhs(k, j);
+      }
+      out(i, j) = sum;
+    }
+  }
+  return out;
+}
+
+/**
+ * Propagate a covariance, out = A * P * A^T. Only the upper triangle is computed and mirrored, the result is
+ * symmetric by construction.
+ *
+ * @param a transformation
+ * @param p symmetric covariance
+ * @return transformed covariance
+ */
+template <uint8_t R, uint8_t N>
+constexpr Matrix<R, R> symmetric_product(const Matrix<R, N>& a, const Matrix<N, N>& p) {
+  const Matrix<R, N> ap = a * p;
+  Matrix<R, R> out{};
+#pragma GCC unroll 16
+  for (uint8_t i = 0; i < R; i++) {
+#pragma GCC unroll 16
+    for (uint8_t j = i; j < R; j++) {
+      float32_t sum = 0.0F;
+#pragma GCC unroll 16
+      for (uint8_t k = 0; k < N; k++) {
+        sum += ap(i, k) * a(j, k);
+      }
+      out(i, j) = sum;
+      out(j, i) = sum;
+    }
+  }
+  return out;
+}
+
+/**
+ * Covariance after a measurement update, out = P - K * (H * P). Only the upper triangle is computed and mirrored such
+ * that rounding errors can not make the covariance asymmetric.
+ *
+ * @param p symmetric covariance before the update
+ * @param k Kalman gain
+ * @param hp measurement matrix times the covariance
+ * @return covariance after the update
+ */
+template <uint8_t N, uint8_t M>
+constexpr Matrix<N, N> symmetric_update(const Matrix<N, N>& p, const Matrix<N, M>& k, const Matrix<M, N>& hp) {
+  Matrix<N, N> out{};
+#pragma GCC unroll 16
+  for (uint8_t i = 0; i < N; i++) {
+#pragma GCC unroll 16
+    for (uint8_t j = i; j < N; j++) {
+      float32_t sum = p(i, j);
+#pragma GCC unroll 16
+      for (uint8_t m = 0; m < M; m++) {
+        sum -= k(i, m) * hp(m, j);
+      }
+      out(i, j) = sum;
+      out(j, i) = sum;
+    }
+  }
+  return out;
+}
+
+/* Smallest absolute determinant for which a matrix is considered invertible */
+inline constexpr float32_t MATRIX_MIN_DETERMINANT = 1e-12F;
+
+/**
+ * Closed form inverse of a matrix with up to three rows.
+ *
+ * @param in matrix to invert
+ * @param out inverse, left unchanged if the matrix is singular
+ * @return false if the matrix is singular
+ */
+template <uint8_t N>
+constexpr bool inverse(const Matrix<N, N>& in, Matrix<N, N>& out) {
+  static_assert(N <= 3, "closed form inverse only for up to 3x3 matrices");
+  if constexpr (N == 1) {
+    if (std::fabs(in(0, 0)) < MATRIX_MIN_DETERMINANT) {
+      return false;
+    }
+    out(0, 0) = 1.0F / in(0, 0);
+  } else if constexpr (N == 2) {
+    const float32_t det = in(0, 0) * in(1, 1) - in(0, 1) * in(1, 0);
+    if (std::fabs(det) < MATRIX_MIN_DETERMINANT) {
+      return false;
+    }
+    const float32_t inv_det = 1.0F / det;
+    out(0, 0) = in(1, 1) * inv_det;
+    out(0, 1) = -in(0, 1) * inv_det;
+    out(1, 0) = -in(1, 0) * inv_det;
+    out(1, 1) = in(0, 0) * inv_det;
+  } else {
+    /* Cofactors of the first row are reused for the determinant */
+    const float32_t c00 = in(1, 1) * in(2, 2) - in(1, 2) * in(2, 1);
+    const float32_t c01 = in(1, 2) * in(2, 0) - in(1, 0) * in(2, 2);
+    const float32_t c02 = in(1, 0) * in(2, 1) - in(1, 1) * in(2, 0);
+    const float32_t det = in(0, 0) * c00 + in(0, 1) * c01 + in(0, 2) * c02;
+    if (std::fabs(det) < MATRIX_MIN_DETERMINANT) {
+      return false;
+    }
+    const float32_t inv_det = 1.0F / det;
+    out(0, 0) = c00 * inv_det;
+    out(0, 1) = (in(0, 2) * in(2, 1) - in(0, 1) * in(2, 2)) * inv_det;
+    out(0, 2) = (in(0, 1) * in(1, 2) - in(0, 2) * in(1, 1)) * inv_det;
+    out(1, 0) = c01 * inv_det;
+    out(1, 1) = (in(0, 0) * in(2, 2) - in(0, 2) * in(2, 0)) * inv_det;
+    out(1, 2) = (in(0, 2) * in(1, 0) - in(0, 0) * in(1, 2)) * inv_det;
+    out(2, 0) = c02 * inv_det;
+    out(2, 1) = (in(0, 1) * in(2, 0) - in(0, 0) * in(2, 1)) * inv_det;
+    out(2, 2) = (in(0, 0) * in(1, 1) - in(0, 1) * in(1, 0)) * inv_det;
+  }
+  return true;
+}
@@ -0,0 +1,171 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * Median over the last values of a stream, the window length is chosen at construction and limited to N.
+ *
+ * The window is kept in a ring buffer. Its elements are ordered in two heaps that meet at the median: a max heap with
+ * the values below and a min heap with the values above. A new value replaces the oldest one in the ring and is moved
+ * to its place in the heaps, which takes O(log N) comparisons. No memory is allocated and the median is available in
+ * constant time. For an even window length, the upper of the two middle values is returned.
+ *
+ * The window starts out filled with value-initialized elements, i.e. zeros for arithmetic types.
+ *
+ * @tparam T value type, needs to be ordered by operator<
+ * @tparam N maximum window length
+ */
+template <typename T, size_t N>
+class SlidingMedian {
+  static constexpr size_t kMinLength = 3U;
+
+  static_assert(N >= kMinLength, "a median needs a window of at least three values");
+  static_assert(N <= INT16_MAX, "heap positions are stored as int16_t");
+
+ public:
+  /** Constructor
+   *
+   * @param length window length, clamped to between three and N
+   */
+  explicit SlidingMedian(size_t length = N) noexcept
+      : m_length{std::clamp(length, kMinLength, N)},
+        m_max_count{static_cast<int32_t>(m_length / 2U)},
+        m_min_count{static_cast<int32_t>(m_length) - 1 - m_max_count} {
+    for (size_t i = 0; i < m_length; i++) {
+      m_heap[i] = static_cast<int16_t>(i);
+      m_pos[i] = static_cast<int16_t>(static_cast<int32_t>(i) - m_max_count);
+    }
+  }
+
+  /** Replace the oldest value of the window
+   *
+   * @param value the new value
+   * @return the median of the window including the new value
+   */
+  T Add(T value) noexcept {
+    const int32_t p = m_pos[m_index];
+    const T old = m_data[m_index];
+    m_data[m_index] = value;
+    m_index = (m_index + 1U) % m_length;
+
+    if (p > 0) {
+      /* The value is in the min heap */
+      if (old < value) {
+        MinSortDown(p);
+      } else if (MinSortUp(p) && CompareExchange(0, -1)) {
+        /* The value became the median but belongs into the max heap */
+        MaxSortDown(-1);
+      }
+    } else if (p < 0) {
+      /* The value is in the max heap */
+      if (value < old) {
+        MaxSortDown(p);
+      } else if (MaxSortUp(p) && CompareExchange(1, 0)) {
+        /* The value became the median but belongs into the min heap */
+        MinSortDown(1);
+      }
+    } else {
+      /* The value is the median */
+      if (MaxSortUp(-1)) {
+        MaxSortDown(-1);
+      }
+      if (MinSortUp(1)) {
+        MinSortDown(1);
+      }
+    }
+    return Get();
+  }
+
+  /** Get the median of the window
+   *
+   * @return the median
+   */
+  [[nodiscard]] T Get() const noexcept { return Item(0); }
+
+  /** Get the window length
+   *
+   * @return number of values the median is taken over
+   */
+  [[nodiscard]] size_t GetLength() const noexcept { return m_length; }
+
+ private:
+  /* Heap positions run from -m_max_count to m_min_count. The median is at 0, the max heap is at the negative positions
+   * with its root at -1 and the min heap at the positive positions with its root at 1. The children of position i are
+   * at 2 * i and 2 * i + 1 (2 * i - 1 in the max heap). */
+  [[nodiscard]] T Item(int32_t pos) const noexcept { return m_data[static_cast<size_t>(m_heap[pos + m_max_count])]; }
+
+  [[nodiscard]] bool Less(int32_t i, int32_t j) const noexcept { return Item(i) < Item(j); }
+
+  /* Swaps the elements at positions i and j if the first is smaller, returns true if they were swapped */
+  bool CompareExchange(int32_t i, int32_t j) noexcept {
+    if (!Less(i, j)) {
+      return false;
+    }
+    std::swap(m_heap[i + m_max_count], m_heap[j + m_max_count]);
+    m_pos[static_cast<size_t>(m_heap[i + m_max_count])] = static_cast<int16_t>(i);
+    m_pos[static_cast<size_t>(m_heap[j + m_max_count])] = static_cast<int16_t>(j);
+    return true;
+  }
+
+  /* Restores the min heap below position i */
+  void MinSortDown(int32_t i) noexcept {
+    for (i *= 2; i <= m_min_count; i *= 2) {
+      if ((i < m_min_count) && Less(i + 1, i)) {
+        ++i;
+      }
+      if (!CompareExchange(i, i / 2)) {
+        break;
+      }
+    }
+  }
+
+  /* Restores the max heap below position i */
+  void MaxSortDown(int32_t i) noexcept {
+    for (i *= 2; i >= -m_max_count; i *= 2) {
+      if ((i > -m_max_count) && Less(i, i - 1)) {
+        --i;
+      }
+      if (!CompareExchange(i / 2, i)) {
+        break;
+      }
+    }
+  }
+
+  /* Moves the element at position i up the min heap, returns true if it became the median */
+  bool MinSortUp(int32_t i) noexcept {
+    while ((i > 0) && CompareExchange(i, i / 2)) {
+      i /= 2;
+    }
+    return i == 0;
+  }
+
+  /* Moves the element at position i up the max heap, returns true if it became the median */
+  bool MaxSortUp(int32_t i) noexcept {
+    while ((i < 0) && CompareExchange(i / 2, i)) {
+      i /= 2;
+    }
+    return i == 0;
+  }
+
+  /* Window length and number of elements below and above the median */
+  size_t m_length;
+  int32_t m_max_count;
+  int32_t m_min_count;
+
+  /* Values in insertion order */
+  std::array<T, N> m_data{};
+  /* Index into m_data for every heap position, offset by m_max_count */
+  std::array<int16_t, N> m_heap{};
+  /* Heap position of every element of m_data */
+  std::array<int16_t, N> m_pos{};
+  /* Index of the oldest value */
+  size_t m_index = 0U;
+};
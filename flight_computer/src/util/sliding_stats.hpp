@@ -0,0 +1,346 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+/* Statistics over the last values of a stream. The window length is chosen at construction or reset and limited to the
+ * template parameter N, no memory is allocated. Adding a value takes constant time, apart from the running sums, which
+ * are summed up again from the window once per pass to keep their rounding errors from accumulating. This costs O(N)
+ * every N values, i.e. O(1) per value on average. */
+
+/**
+ * Mean and variance over the last values of a stream.
+ *
+ * The mean and the sum of squared deviations are updated with Welford's method, the value which falls out of a full
+ * window is removed with the inverse step.
+ *
+ * @tparam T floating point value type
+ * @tparam N maximum window length
+ */
+template <typename T, size_t N>
+class SlidingStats {
+  static_assert(std::is_floating_point_v<T>, "the statistics are computed in floating point");
+  static_assert(N >= 2U, "a variance needs a window of at least two values");
+
+ public:
+  SlidingStats() noexcept = default;
+
+  /** Constructor
+   *
+   * @param length window length, clamped to between two and N
+   */
+  explicit SlidingStats(size_t length) noexcept { Reset(length); }
+
+  /** Remove all values and change the window length
+   *
+   * @param length window length, clamped to between two and N
+   */
+  void Reset(size_t length) noexcept {
+    m_length = std::clamp(length, size_t{2U}, N);
+    Reset();
+  }
+
+  /** Remove all values */
+  void Reset() noexcept {
+    m_mean = T{};
+    m_m2 = T{};
+    m_index = 0U;
+    m_count = 0U;
+  }
+
+  /** Add a value, replacing the oldest one once the window is full
+   *
+   * @param value the new value
+   */
+  void Add(T value) noexcept {
+    const T old_mean = m_mean;
+    if (m_count < m_length) {
+      m_count++;
+      m_mean += (value - old_mean) / static_cast<T>(m_count);
+      m_m2 += (value - old_mean) * (value - m_mean);
+    } else {
+      const T old = m_data[m_index];
+      m_mean += (value - old) / static_cast<T>(m_length);
+      m_m2 += (value - old) * ((value - m_mean) + (old - old_mean));
+    }
+
+    m_data[m_index] = value;
+    m_index = (m_index + 1U) % m_length;
+    if (m_index == 0U) {
+      Resum();
+    }
+  }
+
+  /** Get the mean of the window
+   *
+   * @return the mean, zero for an empty window
+   */
+  [[nodiscard]] T GetMean() const noexcept { return m_mean; }
+
+  /** Get the variance of the values in the window
+   *
+   * @return the variance, normalized by the number of values
+   */
+  [[nodiscard]] T GetVariance() const noexcept {
+    if (m_count == 0U) {
+      return T{};
+    }
+    /* Rounding can leave a slightly negative sum for a constant stream */
+    return std::max(m_m2, T{}) / static_cast<T>(m_count);
+  }
+
+  /** Get the number of values in the window
+   *
+   * @return number of values, at most the window length
+   */
+  [[nodiscard]] size_t GetCount() const noexcept { return m_count; }
+
+  /** Check if the window is full
+   *
+   * @return true if as many values were added as the window is long
+   */
+  [[nodiscard]] bool IsFull() const noexcept { return m_count == m_length; }
+
+ private:
+  /* Computes the mean and the squared deviations of the full window from scratch */
+  void Resum() noexcept {
+    T sum{};
+    for (size_t i = 0; i < m_length; i++) {
+      sum += m_data[i];
+    }
+    m_mean = sum / static_cast<T>(m_length);
+    m_m2 = T{};
+    for (size_t i = 0; i < m_length; i++) {
+      m_m2 += (m_data[i] - m_mean) * (m_data[i] - m_mean);
+    }
+  }
+
+  size_t m_length = N;
+
+  /* Values in insertion order */
+  std::array<T, N> m_data{};
+  /* Mean and sum of squared deviations from it */
+  T m_mean{};
+  T m_m2{};
+  /* Index of the oldest value of a full window */
+  size_t m_index = 0U;
+  size_t m_count = 0U;
+};
+
+/**
+ * Extremum over the last values of a stream.
+ *
+ * The candidates are kept in a monotonic queue: the front holds the extremum of the window, and every value is
+ * followed only by values which are not as extreme. A new value removes the candidates at the back which it beats, as
+ * they leave the window before it and can never become the extremum again. Every value enters and leaves the queue
+ * once, which makes adding a value O(1) on average. Ties are resolved in favor of the newer value. NaN is not ordered
+ * and has to be mapped to an ordered value by the caller, otherwise it leaves the queue with the next value.
+ *
+ * @tparam T value type
+ * @tparam N maximum window length
+ * @tparam Compare ordering under which the largest value is tracked, std::less gives the maximum
+ */
+template <typename T, size_t N, typename Compare = std::less<T>>
+class SlidingExtremum {
+  static_assert(N >= 1U, "the window needs to hold at least one value");
+
+ public:
+  SlidingExtremum() noexcept = default;
+
+  /** Constructor
+   *
+   * @param length window length, clamped to between one and N
+   */
+  explicit SlidingExtremum(size_t length) noexcept { Reset(length); }
+
+  /** Remove all values and change the window length
+   *
+   * @param length window length, clamped to between one and N
+   */
+  void Reset(size_t length) noexcept {
+    m_length = std::clamp(length, size_t{1U}, N);
+    Reset();
+  }
+
+  /** Remove all values */
+  void Reset() noexcept {
+    m_head = 0U;
+    m_size = 0U;
+    m_step = 0U;
+    m_count = 0U;
+  }
+
+  /** Add a value, replacing the oldest one once the window is full
+   *
+   * @param value the new value
+   */
+  void Add(T value) noexcept {
+    m_step++;
+    if (m_count < m_length) {
+      m_count++;
+    }
+
+    /* The front candidate left the window */
+    if ((m_size > 0U) && (m_step - m_queue[m_head].step >= m_length)) {
+      m_head = (m_head + 1U) % N;
+      m_size--;
+    }
+
+    /* Candidates at the back that do not beat the new value */
+    while ((m_size > 0U) && !Compare{}(value, m_queue[(m_head + m_size - 1U) % N].value)) {
+      m_size--;
+    }
+
+    m_queue[(m_head + m_size) % N] = {value, m_step};
+    m_size++;
+  }
+
+  /** Get the extremum of the window
+   *
+   * @return the extremum, a value-initialized element for an empty window
+   */
+  [[nodiscard]] T Get() const noexcept { return (m_size > 0U) ? m_queue[m_head].value : T{}; }
+
+  /** Check if the window is full
+   *
+   * @return true if as many values were added as the window is long
+   */
+  [[nodiscard]] bool IsFull() const noexcept { return m_count == m_length; }
+
+ private:
+  struct Candidate {
+    T value;
+    /* Step in which the value was added, differences stay valid across the wrap around */
+    uint32_t step;
+  };
+
+  size_t m_length = N;
+
+  /* Ring buffer of the candidates, the window holds at most N of them */
+  std::array<Candidate, N> m_queue{};
+  size_t m_head = 0U;
+  size_t m_size = 0U;
+  uint32_t m_step = 0U;
+  size_t m_count = 0U;
+};
+
+template <typename T, size_t N>
+using SlidingMaximum = SlidingExtremum<T, N, std::less<T>>;
+
+template <typename T, size_t N>
+using SlidingMinimum = SlidingExtremum<T, N, std::greater<T>>;
+
+/**
+ * Slope of the least squares line through the last values of a stream, which are taken to be equally spaced.
+ *
+ * With the positions 0 to n - 1 in the window, only the sums of the values and of the values weighted by their position
+ * are needed. When the window slides, every position drops by one: the weighted sum loses the sum of the remaining
+ * values and gains the new value at the last position.
+ *
+ * @tparam T floating point value type
+ * @tparam N maximum window length
+ */
+template <typename T, size_t N>
+class SlidingSlope {
+  static_assert(std::is_floating_point_v<T>, "the slope is computed in floating point");
+  static_assert(N >= 2U, "a slope needs a window of at least two values");
+
+ public:
+  SlidingSlope() noexcept = default;
+
+  /** Constructor
+   *
+   * @param length window length, clamped to between two and N
+   */
+  explicit SlidingSlope(size_t length) noexcept { Reset(length); }
+
+  /** Remove all values and change the window length
+   *
+   * @param length window length, clamped to between two and N
+   */
+  void Reset(size_t length) noexcept {
+    m_length = std::clamp(length, size_t{2U}, N);
+    Reset();
+  }
+
+  /** Remove all values */
+  void Reset() noexcept {
+    m_sum = T{};
+    m_weighted_sum = T{};
+    m_index = 0U;
+    m_count = 0U;
+  }
+
+  /** Add a value, replacing the oldest one once the window is full
+   *
+   * @param value the new value
+   */
+  void Add(T value) noexcept {
+    if (m_count < m_length) {
+      m_weighted_sum += static_cast<T>(m_count) * value;
+      m_sum += value;
+      m_count++;
+    } else {
+      const T old = m_data[m_index];
+      m_weighted_sum += static_cast<T>(m_length - 1U) * value - (m_sum - old);
+      m_sum += value - old;
+    }
+
+    m_data[m_index] = value;
+    m_index = (m_index + 1U) % m_length;
+    if (m_index == 0U) {
+      Resum();
+    }
+  }
+
+  /** Get the slope of the window
+   *
+   * @return change of the fitted line per value, zero for less than two values
+   */
+  [[nodiscard]] T GetSlope() const noexcept {
+    if (m_count < 2U) {
+      return T{};
+    }
+    /* slope = (sum((x - x_mean) * y)) / sum((x - x_mean)^2) with x_mean = (n - 1) / 2 */
+    const auto n = static_cast<T>(m_count);
+    const T x_mean = (n - T{1}) / T{2};
+    const T x_variance_sum = n * (n * n - T{1}) / T{12};
+    return (m_weighted_sum - x_mean * m_sum) / x_variance_sum;
+  }
+
+  /** Check if the window is full
+   *
+   * @return true if as many values were added as the window is long
+   */
+  [[nodiscard]] bool IsFull() const noexcept { return m_count == m_length; }
+
+ private:
+  /* Computes the sums of the full window from scratch, the oldest value is at index 0 after a pass */
+  void Resum() noexcept {
+    m_sum = T{};
+    m_weighted_sum = T{};
+    for (size_t i = 0; i < m_length; i++) {
+      m_sum += m_data[i];
+      m_weighted_sum += static_cast<T>(i) * m_data[i];
+    }
+  }
+
+  size_t m_length = N;
+
+  /* Values in insertion order */
+  std::array<T, N> m_data{};
+  /* Sum of the values and of the values weighted by their position in the window */
+  T m_sum{};
+  T m_weighted_sum{};
+  /* Index of the oldest value of a full window */
+  size_t m_index = 0U;
+  size_t m_count = 0U;
+};
@@ -16,3 +16,5 @@ void sysDelay(uint32_t delay) {
     HAL_Delay(delay);
   }
 }
+
+uint32_t sysGetMicros() { return __HAL_TIM_GET_COUNTER(&MICROS_TIMER_HANDLE); }
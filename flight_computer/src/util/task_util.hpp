@@ -15,3 +15,16 @@ extern volatile bool rtos_started;
 void sysDelay(uint32_t delay);
 
 constexpr uint32_t sysGetTickFreq() { return configTICK_RATE_HZ; }
+
+/** Read the free running microsecond counter, wraps around after roughly 71 minutes
+ *
+ * @return time since boot in us
+ */
+uint32_t sysGetMicros();
+
+/// Thread flag set by the SPI driver when a transaction of the thread is finished
+inline constexpr uint32_t THREAD_FLAG_SPI_DONE = 0x40000000U;
+/// Thread flag set by the IMU data ready interrupt
+inline constexpr uint32_t THREAD_FLAG_IMU_DRDY = 0x20000000U;
+/// Thread flag set by the previous pipeline stage when it published new data
+inline constexpr uint32_t THREAD_FLAG_NEW_DATA = 0x10000000U;
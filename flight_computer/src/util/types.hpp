@@ -6,23 +6,31 @@
 
 #include "config/control_config.hpp"
 #include "util/actions.hpp"
+#include "util/matrix.hpp"
+#include "util/sliding_stats.hpp"
 
 #include "target.hpp"
 
 #include "arm_math.h"
 #include "cmsis_os2.h"
 
+#include <array>
 #include <cstdint>
 
 /** CONSTANTS **/
 
 inline constexpr uint8_t NUM_EVENTS = 9;
 inline constexpr uint8_t NUM_TIMERS = 4;
+/* Maximum number of IMU samples handed over per control step, the IMU runs at up to roughly eight times the control
+ * rate */
+inline constexpr uint8_t IMU_MAX_BATCH_SIZE = 16;
 
 /** BASIC TYPES **/
 
 /* Timestamp */
 using timestamp_t = uint32_t;  // ms
+/* High resolution timestamp from the microsecond timer, it wraps around after ~71 min so only differences are valid */
+using timestamp_us_t = uint32_t;  // us
 
 /* 3D vector types */
 struct vi8_t {
@@ -45,6 +53,14 @@ struct imu_data_t {
   vi16_t gyro;  // IMU unit
 };
 
+/* Consecutive IMU samples read out in one control step */
+struct imu_batch_t {
+  imu_data_t samples[IMU_MAX_BATCH_SIZE];  // oldest first
+  uint32_t first_index;                    // running sample index of samples[0]
+  timestamp_us_t timestamp;                // acquisition time of the newest sample
+  uint8_t count;
+};
+
 /* Barometer data */
 struct baro_data_t {
   int32_t pressure;     // Baro unit
@@ -55,29 +71,23 @@ struct baro_data_t {
 struct state_estimation_input_t {
   float32_t acceleration_z;  // m/s^2
   float32_t height_AGL;      // m
+  /* Set if the barometer delivered a new measurement in the last control step */
+  bool height_updated;
+#ifdef USE_MULTI_RATE_ESTIMATION
+  /* Acceleration of every IMU sample of the last control step, oldest first, not median filtered */
+  float32_t acceleration_samples[IMU_MAX_BATCH_SIZE];  // m/s^2
+  uint8_t num_acceleration_samples;
+  /* IMU samples lost right before the ones above, at most IMU_MAX_BATCH_SIZE are reported */
+  uint8_t num_missed_acceleration_samples;
+#endif
 };
 
 /* Todo: #if on SI data */
 struct SI_data_t {
-  vf32_t acc;          // m/s^2
-  vf32_t gyro;         // dps
-  float32_t pressure;  // hPa
-};
-
-/* Elimination Data */
-struct sensor_elimination_t {
-  int16_t freeze_counter_imu[NUM_IMU];
-  int16_t freeze_counter_baro[NUM_BARO];
-  int16_t last_value_imu[NUM_IMU];
-  int32_t last_value_baro[NUM_BARO];
-  uint8_t faulty_imu[NUM_IMU];
-  uint8_t faulty_baro[NUM_BARO];
-};
-
-struct median_filter_t {
-  float32_t acc[MEDIAN_FILTER_SIZE];         // m/s^2
-  float32_t height_AGL[MEDIAN_FILTER_SIZE];  // m
-  uint8_t counter;
+  vf32_t acc;                // m/s^2
+  vf32_t gyro;               // dps
+  float32_t pressure;        // hPa
+  timestamp_us_t timestamp;  // acquisition time of the IMU data
 };
 
 struct estimation_output_t {
@@ -86,6 +96,31 @@ struct estimation_output_t {
   float32_t acceleration;  // m/s^2
 };
 
+struct apogee_prediction_t {
+  timestamp_us_t timestamp;  // predicted time of apogee
+  float32_t height;          // m, predicted height of apogee
+  float32_t confidence;      // 0 without a prediction, 0.5 for a standard deviation of APOGEE_HEIGHT_TOLERANCE
+};
+
+/* Normalized innovation squared (NIS) of the barometer updates over a window of up to CONSISTENCY_TIME of updates */
+struct filter_consistency_t {
+  float32_t nis_mean;
+  float32_t nis_max;
+  uint8_t num_updates;
+  uint8_t flight_state;  // flight_fsm_e during the window
+};
+
+/* NIS of all barometer updates in one flight phase */
+struct consistency_summary_t {
+  uint32_t num_updates;
+  float32_t nis_sum;
+  float32_t nis_max;
+  /* Full windows, and those whose mean was below or above the chi-square bounds */
+  uint16_t num_windows;
+  uint16_t num_windows_low;
+  uint16_t num_windows_high;
+};
+
 struct calibration_data_t {
   vf32_t gyro_calib;
   float32_t angle;
@@ -94,44 +129,68 @@ struct calibration_data_t {
 
 enum flight_fsm_e : uint32_t { INVALID = 0, CALIBRATING = 1, READY, THRUSTING, COASTING, DROGUE, MAIN, TOUCHDOWN };
 
-/* Todo: Comment out this struct */
 struct flight_fsm_t {
   flight_fsm_e flight_state;
-  vf32_t old_acc_data;
-  vf32_t old_gyro_data;
-  uint32_t clock_memory;
-  uint32_t memory[3];
+  /* Range of the acceleration x, y, z and angular rate x, y, z over the stillness time while calibrating */
+  SlidingMaximum<float32_t, STILLNESS_WINDOW_SIZE> imu_max[6];
+  SlidingMinimum<float32_t, STILLNESS_WINDOW_SIZE> imu_min[6];
+  /* Tick count at which the IMU came to rest, or at which calibrating started */
+  timestamp_t rest_start_time;
+  /* Slope of the height over the safety time while coasting, the rocket descends if it is negative */
+  SlidingSlope<float32_t, FLIGHT_PHASE_WINDOW_SIZE> height_slope;
+  /* Margin by which the transition condition of the current phase is missed over its safety time, the condition held
+   * during the whole time if the maximum is negative */
+  SlidingMaximum<float32_t, FLIGHT_PHASE_WINDOW_SIZE> condition_margin;
   timestamp_t thrust_trigger_time;
   bool state_changed;
+  /* Set while calibrating if the stored calibration was validated, READY is reached sooner */
+  bool calibration_restored;
+};
+
+/* Converged gain and covariance of the Kalman filter for one measurement noise */
+struct kalman_steady_state_t {
+  float32_t R;
+  Matrix<3, 1> K;
+  Matrix<3, 3> P_bar;
+  /* Steps of the Riccati recursion until K converged, KALMAN_MAX_RICCATI_ITERATIONS if it did not */
+  uint32_t iterations;
 };
 
 struct kalman_filter_t {
-  float32_t Ad_data[9];
-  float32_t Ad_T_data[9];
-  float32_t Bd_data[3];
-  float32_t GdQGd_T_data[9];
-  float32_t H_data[3];
-  float32_t H_T_data[3];
-  float32_t K_data[3];
-  float32_t x_bar_data[3];
-  float32_t x_hat_data[3];
-  float32_t P_bar_data[9];
-  float32_t P_hat_data[9];
-  arm_matrix_instance_f32 Ad;
-  arm_matrix_instance_f32 Ad_T;
-  arm_matrix_instance_f32 GdQGd_T;
-  arm_matrix_instance_f32 Bd;
-  arm_matrix_instance_f32 H;
-  arm_matrix_instance_f32 H_T;
-  arm_matrix_instance_f32 K;
-  arm_matrix_instance_f32 x_bar;
-  arm_matrix_instance_f32 x_hat;
-  arm_matrix_instance_f32 P_bar;
-  arm_matrix_instance_f32 P_hat;
+  Matrix<3, 3> Ad;
+  Matrix<3, 1> Bd;
+  Matrix<3, 3> GdQGd_T;
+  Matrix<1, 3> H;
+  Matrix<3, 1> K;
+  Matrix<3, 1> x_bar;
+  Matrix<3, 1> x_hat;
+  Matrix<3, 3> P_bar;
+  Matrix<3, 3> P_hat;
   float32_t measured_acceleration;
   float32_t measured_AGL;
+  /* Set if measured_AGL comes from a new barometer measurement, the single rate steps fuse a held one as well */
+  bool measured_AGL_updated;
   float32_t R;
+  /* Control sampling period */
   float32_t t_sampl;
+  /* Step the model matrices are discretized for, and whether their process noise is the exact one of the multi-rate
+   * step */
+  float32_t dt;
+  bool exact_noise;
+  /* Normalized innovation squared of the last new barometer measurement, nis_updated is cleared by its consumer */
+  float32_t nis;
+  bool nis_updated;
+#ifdef USE_STEADY_STATE_KALMAN
+  /* Sorted by ascending measurement noise */
+  std::array<kalman_steady_state_t, KALMAN_NUM_STEADY_STATES> steady_states;
+  float32_t R_prev;
+  bool steady;
+#endif
+#ifdef USE_ADAPTIVE_MEASUREMENT_NOISE
+  /* Squared barometer innovations minus their part predicted by the state covariance of the last new measurements,
+   * as many as there are control steps in KALMAN_INNOVATION_TIME */
+  SlidingStats<float32_t, KALMAN_INNOVATION_MAX_SIZE> innovations;  // m^2
+#endif
 };
 
 struct control_settings_t {
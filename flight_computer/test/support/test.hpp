@@ -0,0 +1,64 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/* Minimal test registry for the host tests. Every test file is built into its own executable together with
+ * test_main.cpp, which runs all test cases and fails if any check failed. */
+
+namespace test {
+
+struct TestCase {
+  const char* name;
+  void (*function)();
+};
+
+inline std::vector<TestCase>& test_cases() {
+  static std::vector<TestCase> cases;
+  return cases;
+}
+
+inline int& failure_count() {
+  static int failures = 0;
+  return failures;
+}
+
+struct Registrar {
+  Registrar(const char* name, void (*function)()) { test_cases().push_back({name, function}); }
+};
+
+inline void report_failure(const char* file, int line, const char* expression) {
+  std::printf("%s:%d: check failed: %s\n", file, line, expression);
+  failure_count()++;
+}
+
+}  // namespace test
+
+// NOLINTBEGIN(cppcoreguidelines-macro-usage)
+#define TEST_CASE(name)                                          \
+  static void name();                                            \
+  static const test::Registrar name##_registrar{#name, &(name)}; \
+  static void name()
+
+#define CHECK(condition)                                    \
+  do {                                                      \
+    if (!(condition)) {                                     \
+      test::report_failure(__FILE__, __LINE__, #condition); \
+    }                                                       \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                                    \
+  do {                                                                                                             \
+    const double check_actual = static_cast<double>(actual);                                                       \
+    const double check_expected = static_cast<double>(expected);                                                   \
+    if (!(std::fabs(check_actual - check_expected) <= static_cast<double>(tolerance))) {                           \
+      std::printf("%s:%d: %s = %.9g, expected %.9g\n", __FILE__, __LINE__, #actual, check_actual, check_expected); \
+      test::failure_count()++;                                                                                     \
+    }                                                                                                              \
+  } while (0)
+// NOLINTEND(cppcoreguidelines-macro-usage)
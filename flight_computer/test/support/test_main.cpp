@@ -0,0 +1,14 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "test.hpp"
+
+int main() {
+  for (const test::TestCase& test_case : test::test_cases()) {
+    const int failures_before = test::failure_count();
+    test_case.function();
+    std::printf("[%s] %s\n", (test::failure_count() == failures_before) ? "PASS" : "FAIL", test_case.name);
+  }
+  return (test::failure_count() == 0) ? 0 : 1;
+}
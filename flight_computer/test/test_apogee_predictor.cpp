@@ -0,0 +1,268 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/apogee_predictor.hpp"
+#include "control/flight_phases.hpp"
+#include "test.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/* The apogee predictor on the flights of the simulator. The acceleration profiles of Simulator::SetCoefficients are
+ * integrated into the true trajectory. The predictor gets the true state at the control sampling rate from the
+ * transition to COASTING on and has to find the apogee of the trajectory. */
+
+namespace {
+
+constexpr size_t kPolynomSize = 16U;
+
+struct FlightProfile {
+  const char* name;
+  /* Acceleration measured along the rocket axis in g, highest power first, as in the simulator */
+  std::array<double, kPolynomSize> acc_coeff_thrusting;
+  std::array<double, kPolynomSize> acc_coeff_coasting;
+  double switch_time;   // s, the simulator changes from the first to the second polynomial
+  double acc_end_time;  // s, the simulator drops the acceleration to zero afterwards
+  /* Sign of the flight direction on the axis, the calibration finds it on the target */
+  double direction;
+};
+
+const std::array<FlightProfile, 2> kProfiles = {
+    FlightProfile{"Toyger",
+                  {-7.74384180e+06, 6.08296377e+07, -2.13568117e+08, 4.41789674e+08, -5.97189439e+08, 5.52253223e+08,
+                   -3.54499448e+08, 1.55874816e+08, -4.42126329e+07, 6.42928691e+06, 3.24708141e+05, -3.53925326e+05,
+                   7.33555220e+04, -7.72424267e+03, 4.30117076e+02, 1.12707667e+00},
+                  {-8.45958797e-07, 5.61687651e-05, -1.71045643e-03, 3.16557314e-02, -3.97736659e-01, 3.58938089e+00,
+                   -2.40047305e+01, 1.20982114e+02, -4.62655535e+02, 1.34060682e+03, -2.91533086e+03, 4.66615138e+03,
+                   -5.31417862e+03, 4.06084709e+03, -1.85964050e+03, 3.83546444e+02},
+                  1.1,
+                  6.5,
+                  1.0},
+    FlightProfile{"Piccard",
+                  {3.61459094e-02, -1.13220884e+00, 1.59256346e+01, -1.32825680e+02, 7.30507566e+02, -2.78686715e+03,
+                   7.55213783e+03, -1.46355473e+04, 2.01425971e+04, -1.92885323e+04, 1.24052703e+04, -5.10474479e+03,
+                   1.29652104e+03, -2.09483859e+02, 6.43292235e+00, -1.21991272e+00},
+                  {2.26958347e-17, -8.44586803e-15, 1.43443916e-12, -1.47229752e-10, 1.01924268e-08, -5.02955339e-07,
+                   1.82277767e-05, -4.92550515e-04, 9.97088339e-03, -1.50607679e-01, 1.67589821e+00, -1.34232022e+01,
+                   7.45195574e+01, -2.69574673e+02, 5.68434117e+02, -5.33345180e+02},
+                  4.2,
+                  30.0,
+                  -1.0}};
+
+/* Default control sampling rate and the integration step of the trajectory */
+constexpr double kSamplingPeriod = 1.0 / 125.0;
+constexpr uint32_t kSubsteps = 80U;
+
+double polynomial(const std::array<double, kPolynomSize>& coeff, double time) {
+  double result = 0.0;
+  for (const double c : coeff) {
+    result = result * time + c;
+  }
+  return result;
+}
+
+/* Acceleration along the flight direction in g as measured by the IMU, same as Simulator::ComputeSimValues */
+double measured_acceleration(const FlightProfile& profile, double time) {
+  if (time > profile.acc_end_time) {
+    return 0.0;
+  }
+  const auto& coeff = (time > profile.switch_time) ? profile.acc_coeff_coasting : profile.acc_coeff_thrusting;
+  return profile.direction * polynomial(coeff, time);
+}
+
+struct Trajectory {
+  std::vector<estimation_output_t> states;  // one per control step
+  size_t coasting_step;
+  size_t apogee_step;
+  double apogee_height;
+  double apogee_time;
+};
+
+/* Integrate the flight up to the apogee, the rocket rests on the pad until the thrust exceeds its weight. COASTING
+ * starts once the acceleration stayed below zero for COASTING_SAFETY_TIME, as in the flight state machine. */
+Trajectory integrate(const FlightProfile& profile) {
+  const double g = static_cast<double>(GRAVITY);
+  const double dt = kSamplingPeriod / kSubsteps;
+  Trajectory trajectory{};
+  double height = 0.0;
+  double velocity = 0.0;
+  bool burning = true;
+  uint32_t decelerating_steps = 0U;
+  for (size_t step = 0U; step < 100000U; step++) {
+    const double time = static_cast<double>(step) * kSamplingPeriod;
+    double acceleration = (measured_acceleration(profile, time) - 1.0) * g;
+    if ((height <= 0.0) && (acceleration < 0.0)) {
+      acceleration = 0.0;
+    }
+    decelerating_steps = (acceleration < 0.0) ? decelerating_steps + 1U : 0U;
+    if (burning && (static_cast<double>(decelerating_steps) * kSamplingPeriod * 1000.0 > COASTING_SAFETY_TIME)) {
+      burning = false;
+      trajectory.coasting_step = step;
+    }
+    trajectory.states.push_back({.height = static_cast<float32_t>(height),
+                                 .velocity = static_cast<float32_t>(velocity),
+                                 .acceleration = static_cast<float32_t>(acceleration)});
+
+    for (uint32_t k = 0U; k < kSubsteps; k++) {
+      const double t = time + static_cast<double>(k) * dt;
+      const double a = (measured_acceleration(profile, t) - 1.0) * g;
+      if ((height <= 0.0) && (a < 0.0)) {
+        continue;
+      }
+      const double previous_velocity = velocity;
+      velocity += a * dt;
+      height += velocity * dt;
+      if (!burning && (velocity <= 0.0)) {
+        /* Interpolate the zero crossing of the velocity */
+        const double fraction = previous_velocity / (previous_velocity - velocity);
+        trajectory.apogee_time = t + fraction * dt;
+        trajectory.apogee_height = height - velocity * dt * (1.0 - fraction);
+        trajectory.apogee_step = step + 1U;
+        return trajectory;
+      }
+    }
+  }
+  return trajectory;
+}
+
+/* The predictor gets the true state */
+const Matrix<2, 2> kExactState{};
+
+/* Standard deviation of the predicted height that a confidence stands for */
+double claimed_std(float32_t confidence) {
+  const auto c = static_cast<double>(confidence);
+  return static_cast<double>(APOGEE_HEIGHT_TOLERANCE) * std::sqrt((1.0 - c) / c);
+}
+
+timestamp_us_t to_timestamp(double time) { return static_cast<timestamp_us_t>(time * 1e6); }
+
+}  // namespace
+
+TEST_CASE(predicts_the_apogee_of_the_simulated_flights) {
+  for (const FlightProfile& profile : kProfiles) {
+    const Trajectory trajectory = integrate(profile);
+    const double coasting_time = static_cast<double>(trajectory.coasting_step) * kSamplingPeriod;
+    std::printf("%s: coasting after %.2f s, apogee of %.1f m after %.2f s\n", profile.name, coasting_time,
+                trajectory.apogee_height, trajectory.apogee_time);
+    CHECK(trajectory.apogee_step > trajectory.coasting_step);
+
+    apogee_predictor_t predictor{};
+    reset_apogee_predictor(&predictor, static_cast<float32_t>(kSamplingPeriod));
+    bool confident = false;
+    double worst_confident_error = 0.0;
+    /* Largest error in standard deviations claimed by the confidence */
+    double worst_normalized_error = 0.0;
+    for (size_t step = trajectory.coasting_step; step < trajectory.apogee_step; step++) {
+      const double time = static_cast<double>(step) * kSamplingPeriod;
+      const apogee_prediction_t prediction =
+          predict_apogee(&predictor, trajectory.states[step], kExactState, to_timestamp(time));
+      const double time_left = trajectory.apogee_time - time;
+      const double height_error = static_cast<double>(prediction.height) - trajectory.apogee_height;
+      const double time_error = static_cast<double>(prediction.timestamp) * 1e-6 - trajectory.apogee_time;
+      if ((step - trajectory.coasting_step) % 250U == 0U) {
+        std::printf("  %5.2f s before apogee: height error %7.1f m, time error %5.2f s, confidence %.2f\n", time_left,
+                    height_error, time_error, static_cast<double>(prediction.confidence));
+      }
+
+      if (static_cast<double>(step - trajectory.coasting_step + 1U) * kSamplingPeriod <
+          static_cast<double>(APOGEE_MIN_FIT_TIME) - kSamplingPeriod / 2.0) {
+        CHECK(prediction.confidence == 0.0F);
+      }
+      if (prediction.confidence > 0.5F) {
+        confident = true;
+        worst_confident_error = std::max(worst_confident_error, std::fabs(height_error));
+      }
+      if (prediction.confidence == 1.0F) {
+        /* Only claimed once the estimated velocity reached zero, the height of the exact state is the apogee */
+        CHECK(std::fabs(height_error) < 0.01);
+      } else if (prediction.confidence > 0.0F) {
+        worst_normalized_error =
+            std::max(worst_normalized_error, std::fabs(height_error) / claimed_std(prediction.confidence));
+      }
+      /* Close to the apogee the height is dominated by the known velocity. The simulated deceleration of Piccard stays
+       * at 0.4 g beyond gravity even as the velocity vanishes, which no drag quadratic in the velocity explains, so the
+       * time is only checked relative to the time left. */
+      if (time_left < 1.0) {
+        CHECK(std::fabs(height_error) < 0.001 * trajectory.apogee_height);
+        CHECK(std::fabs(time_error) < 0.5 * time_left);
+      }
+    }
+    /* The simulated drag is not quadratic in the velocity either, the model error covers the difference. Every
+     * prediction has to lie within three of the standard deviations its confidence claims. */
+    std::printf("  worst height error with confidence above 0.5: %.1f m, worst error in claimed deviations: %.2f\n",
+                worst_confident_error, worst_normalized_error);
+    CHECK(confident);
+    CHECK(worst_normalized_error < 3.0);
+    CHECK(worst_confident_error < 3.0 * static_cast<double>(APOGEE_HEIGHT_TOLERANCE));
+
+    /* Past the apogee, the prediction is the current height */
+    estimation_output_t state = trajectory.states[trajectory.apogee_step];
+    state.velocity = -1.0F;
+    const apogee_prediction_t prediction = predict_apogee(&predictor, state, kExactState, 0U);
+    CHECK(prediction.height == state.height);
+    CHECK(prediction.confidence == 1.0F);
+  }
+}
+
+TEST_CASE(vacuum_flight_is_ballistic) {
+  /* Without drag the fit stays at zero and the prediction is exact from the first step */
+  apogee_predictor_t predictor{};
+  reset_apogee_predictor(&predictor, static_cast<float32_t>(kSamplingPeriod));
+  constexpr double kVelocity = 200.0;
+  const double g = static_cast<double>(GRAVITY);
+  for (double time = 0.0; time < 20.0; time += kSamplingPeriod) {
+    const double v = kVelocity - g * time;
+    if (v <= 0.0) {
+      break;
+    }
+    const estimation_output_t state = {.height = static_cast<float32_t>(kVelocity * time - g * time * time / 2.0),
+                                       .velocity = static_cast<float32_t>(v),
+                                       .acceleration = -GRAVITY};
+    const apogee_prediction_t prediction = predict_apogee(&predictor, state, kExactState, to_timestamp(time));
+    CHECK_NEAR(prediction.height, kVelocity * kVelocity / (2.0 * g), 1e-2);
+    CHECK_NEAR(static_cast<double>(prediction.timestamp) * 1e-6, kVelocity / g, 1e-3);
+  }
+  CHECK_NEAR(predictor.drag_coeff, 0.0, 1e-9);
+}
+
+TEST_CASE(state_uncertainty_lowers_the_confidence) {
+  /* The same fit once with the exact state and once with an uncertain one, the difference of the height variances is
+   * the variance of the state propagated to the apogee. Without drag, the climb is v^2 / (2 * g). */
+  apogee_predictor_t exact{};
+  apogee_predictor_t uncertain{};
+  reset_apogee_predictor(&exact, static_cast<float32_t>(kSamplingPeriod));
+  reset_apogee_predictor(&uncertain, static_cast<float32_t>(kSamplingPeriod));
+  constexpr double kHeightVar = 4.0;
+  constexpr double kVelocityVar = 0.25;
+  constexpr double kCovariance = 0.5;
+  const Matrix<2, 2> covariance{{static_cast<float32_t>(kHeightVar), static_cast<float32_t>(kCovariance),
+                                 static_cast<float32_t>(kCovariance), static_cast<float32_t>(kVelocityVar)}};
+  const double g = static_cast<double>(GRAVITY);
+  constexpr double kVelocity = 50.0;
+  for (double time = 0.0; time < 4.0; time += kSamplingPeriod) {
+    const double v = kVelocity - g * time;
+    const estimation_output_t state = {.height = static_cast<float32_t>(kVelocity * time - g * time * time / 2.0),
+                                       .velocity = static_cast<float32_t>(v),
+                                       .acceleration = -GRAVITY};
+    const apogee_prediction_t exact_prediction = predict_apogee(&exact, state, kExactState, to_timestamp(time));
+    const apogee_prediction_t prediction = predict_apogee(&uncertain, state, covariance, to_timestamp(time));
+    CHECK(prediction.height == exact_prediction.height);
+    if (exact_prediction.confidence == 0.0F) {
+      CHECK(prediction.confidence == 0.0F);
+      continue;
+    }
+    const double sensitivity = v / g;
+    const double state_var = kHeightVar + 2.0 * sensitivity * kCovariance + sensitivity * sensitivity * kVelocityVar;
+    const double exact_var = claimed_std(exact_prediction.confidence) * claimed_std(exact_prediction.confidence);
+    const double var = claimed_std(prediction.confidence) * claimed_std(prediction.confidence);
+    CHECK_NEAR(var - exact_var, state_var, 1e-3 * var);
+  }
+
+  /* Past the apogee only the height is uncertain */
+  const apogee_prediction_t prediction =
+      predict_apogee(&uncertain, {.height = 100.0F, .velocity = -1.0F, .acceleration = -GRAVITY}, covariance, 0U);
+  CHECK_NEAR(claimed_std(prediction.confidence), std::sqrt(kHeightVar), 1e-3);
+}
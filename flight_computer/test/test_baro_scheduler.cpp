@@ -0,0 +1,145 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "config/globals.hpp"
+#include "sensors/baro_scheduler.hpp"
+#include "test.hpp"
+#include "util/task_util.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/* The barometer schedule of every flight phase at every selectable control sampling frequency, run slot by slot as the
+ * sensor task does and checked against the datasheet conversion times of the MS5607. */
+
+namespace {
+
+using sensor::BaroScheduler;
+using sensor::Ms5607;
+
+/* A conversion as seen by the barometer: what was started, when, and when it was read out */
+struct Conversion {
+  Ms5607::Request request;
+  Ms5607::Osr osr;
+  flight_fsm_e phase;
+  uint32_t start_us;
+  uint32_t read_us;
+};
+
+/* Runs the scheduler for the given number of slots. As in the sensor task, a conversion is read out and the next one
+ * started in the same slot, and the first conversion is started one slot before the first tick. The phase is changed
+ * to phases[k] at slot k * slots_per_phase. Returns the conversions that were read out. */
+std::vector<Conversion> run_schedule(uint32_t slot_time, const std::vector<flight_fsm_e>& phases,
+                                     uint32_t slots_per_phase) {
+  BaroScheduler scheduler{slot_time};
+  scheduler.SetPhase(phases.front());
+  std::vector<Conversion> readouts;
+
+  const auto first = scheduler.Next();
+  Conversion running{
+      .request = first.request, .osr = first.osr, .phase = phases.front(), .start_us = 0U, .read_us = 0U};
+  flight_fsm_e phase = phases.front();
+  for (uint32_t slot = 1U; slot <= phases.size() * slots_per_phase; slot++) {
+    const uint32_t now_us = slot * slot_time;
+    if (scheduler.Tick()) {
+      running.read_us = now_us;
+      readouts.push_back(running);
+      const auto next = scheduler.Next();
+      running = {.request = next.request, .osr = next.osr, .phase = phase, .start_us = now_us, .read_us = 0U};
+    }
+    /* The phase of the FSM is picked up at the start of the next slot and applies from the next conversion on */
+    const uint32_t phase_index = slot / slots_per_phase;
+    if (phase_index < phases.size()) {
+      phase = phases[phase_index];
+      scheduler.SetPhase(phase);
+    }
+  }
+  return readouts;
+}
+
+/* Time between two slots of the sensor task, which runs at twice the control sampling frequency, in us */
+constexpr uint32_t slot_time_us(uint16_t control_sampling_freq) {
+  return (sysGetTickFreq() / (2U * control_sampling_freq)) * (1000000U / sysGetTickFreq());
+}
+
+std::vector<flight_fsm_e> all_phases() {
+  std::vector<flight_fsm_e> phases;
+  for (uint32_t phase = CALIBRATING; phase <= TOUCHDOWN; phase++) {
+    phases.push_back(static_cast<flight_fsm_e>(phase));
+  }
+  return phases;
+}
+
+}  // namespace
+
+TEST_CASE(conversion_time_table_matches_datasheet) {
+  CHECK(Ms5607::GetConversionTime(Ms5607::Osr::kOsr256) == 600U);
+  CHECK(Ms5607::GetConversionTime(Ms5607::Osr::kOsr512) == 1170U);
+  CHECK(Ms5607::GetConversionTime(Ms5607::Osr::kOsr1024) == 2280U);
+  CHECK(Ms5607::GetConversionTime(Ms5607::Osr::kOsr2048) == 4540U);
+  CHECK(Ms5607::GetConversionTime(Ms5607::Osr::kOsr4096) == 9040U);
+}
+
+TEST_CASE(every_phase_waits_for_its_conversion_time) {
+  for (const uint16_t freq : CONTROL_SAMPLING_FREQS) {
+    const uint32_t slot_time = slot_time_us(freq);
+    for (const flight_fsm_e phase : all_phases()) {
+      const auto readouts = run_schedule(slot_time, {phase}, 1000U);
+      CHECK(!readouts.empty());
+      for (const auto& conversion : readouts) {
+        CHECK(conversion.osr == BaroScheduler::kPhaseConfig[phase].osr);
+        CHECK(conversion.read_us - conversion.start_us >= Ms5607::GetConversionTime(conversion.osr));
+        /* Not more than one slot is wasted waiting */
+        CHECK(conversion.read_us - conversion.start_us < Ms5607::GetConversionTime(conversion.osr) + slot_time);
+      }
+    }
+  }
+}
+
+TEST_CASE(pressure_and_temperature_follow_the_phase_ratio) {
+  for (const uint16_t freq : CONTROL_SAMPLING_FREQS) {
+    const uint32_t slot_time = slot_time_us(freq);
+    for (const flight_fsm_e phase : all_phases()) {
+      const uint8_t ratio = BaroScheduler::kPhaseConfig[phase].pressure_per_temperature;
+      const auto readouts = run_schedule(slot_time, {phase}, 1000U);
+      /* The schedule starts with a temperature conversion such that the first pressure can be compensated */
+      CHECK(readouts.front().request == Ms5607::Request::kTemperature);
+      uint32_t pressure_run = 0U;
+      uint32_t num_temperatures = 0U;
+      for (const auto& conversion : readouts) {
+        if (conversion.request == Ms5607::Request::kTemperature) {
+          /* Every run of pressure conversions between two temperature conversions has the length of the table */
+          CHECK((num_temperatures == 0U) || (pressure_run == ratio));
+          pressure_run = 0U;
+          num_temperatures++;
+        } else {
+          pressure_run++;
+          CHECK(pressure_run <= ratio);
+        }
+      }
+      CHECK(num_temperatures * (ratio + 1U) >= readouts.size());
+    }
+  }
+}
+
+TEST_CASE(phase_changes_keep_the_running_conversion) {
+  /* Walk through the flight, each phase long enough for a few conversions at the slowest over sampling rate */
+  for (const uint16_t freq : CONTROL_SAMPLING_FREQS) {
+    const uint32_t slot_time = slot_time_us(freq);
+    const auto readouts = run_schedule(slot_time, all_phases(), 17U);
+    for (const auto& conversion : readouts) {
+      /* A conversion started before a phase change is read out with the time of its own over sampling rate */
+      CHECK(conversion.osr == BaroScheduler::kPhaseConfig[conversion.phase].osr);
+      CHECK(conversion.read_us - conversion.start_us >= Ms5607::GetConversionTime(conversion.osr));
+    }
+    /* Every phase got to run its own conversions */
+    for (const flight_fsm_e phase : all_phases()) {
+      bool found = false;
+      for (const auto& conversion : readouts) {
+        found = found || (conversion.phase == phase);
+      }
+      CHECK(found);
+    }
+  }
+}
@@ -0,0 +1,157 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/calibration.hpp"
+#include "control/flight_phases.hpp"
+#include "test.hpp"
+
+#include <cstdint>
+#include <random>
+#include <utility>
+
+/* The check of a stored calibration after a reboot: the means over WARM_START_TIME have to agree with it within every
+ * tolerance, movement restarts them, and a calibration of another version or from before a flight is not used. */
+
+extern "C" {
+
+void log_raw(const char* /*format*/, ...) {}
+
+void log_log(int /*level*/, const char* /*file*/, int /*line*/, const char* /*format*/, ...) {}
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint32_t flight_counter = 7U;
+
+namespace {
+
+/* Control steps in WARM_START_TIME at the default control sampling rate */
+constexpr uint16_t kMinSamples = WARM_START_TIME * 125U / 1000U;
+
+const stored_calibration_t kStored = {
+    .version = STORED_CALIBRATION_VERSION,
+    .calibration = {.gyro_calib = {.x = 0.8F, .y = -1.2F, .z = 0.3F}, .angle = 0.99F, .axis = 0},
+    .acceleration = {.x = 9.7F, .y = 0.4F, .z = -1.1F},
+    .height_0 = 432.0F,
+    .temperature = 21.0F,
+    .flight_counter = 7U,
+};
+
+struct Offsets {
+  vf32_t acc;
+  vf32_t gyro;
+  float32_t height;
+  float32_t temperature;
+};
+
+/* Feeds noisy samples around the stored calibration plus the offsets until the check is final, returns the status and
+ * the number of samples it took */
+std::pair<warm_start_e, uint32_t> run_check(const stored_calibration_t& stored, const Offsets& offsets) {
+  warm_start_check_t check{};
+  init_warm_start_check(&check, &stored, kMinSamples);
+  std::mt19937 generator{5U};
+  std::normal_distribution<float32_t> acc_noise{0.0F, 0.02F};
+  std::normal_distribution<float32_t> gyro_noise{0.0F, 0.1F};
+  std::normal_distribution<float32_t> height_noise{0.0F, 1.0F};
+  warm_start_e status = check.status;
+  uint32_t samples = 0U;
+  while ((status == WARM_START_PENDING) && (samples < 10U * kMinSamples)) {
+    const vf32_t acc = {.x = kStored.acceleration.x + offsets.acc.x + acc_noise(generator),
+                        .y = kStored.acceleration.y + offsets.acc.y + acc_noise(generator),
+                        .z = kStored.acceleration.z + offsets.acc.z + acc_noise(generator)};
+    const vf32_t gyro = {.x = kStored.calibration.gyro_calib.x + offsets.gyro.x + gyro_noise(generator),
+                         .y = kStored.calibration.gyro_calib.y + offsets.gyro.y + gyro_noise(generator),
+                         .z = kStored.calibration.gyro_calib.z + offsets.gyro.z + gyro_noise(generator)};
+    const float32_t height = kStored.height_0 + offsets.height + height_noise(generator);
+    status = check_warm_start(&check, &stored, &acc, &gyro, height, kStored.temperature + offsets.temperature);
+    samples++;
+  }
+  return {status, samples};
+}
+
+}  // namespace
+
+TEST_CASE(matching_means_restore_the_calibration) {
+  const auto [status, samples] = run_check(kStored, {});
+  CHECK(status == WARM_START_VALID);
+  CHECK(samples == kMinSamples);
+
+  /* Just within every tolerance */
+  const Offsets within = {.acc = {.x = 0.15F, .y = -0.15F, .z = 0.15F},
+                          .gyro = {.x = -0.4F, .y = 0.4F, .z = -0.4F},
+                          .height = 8.0F,
+                          .temperature = -4.5F};
+  CHECK(run_check(kStored, within).first == WARM_START_VALID);
+}
+
+TEST_CASE(every_tolerance_rejects_on_its_own) {
+  /* Each offset is smaller than movement, the samples are averaged and the mean misses the tolerance */
+  const Offsets offsets[] = {
+      {.acc = {.x = 0.0F, .y = 0.3F, .z = 0.0F}, .gyro = {}, .height = 0.0F, .temperature = 0.0F},
+      {.acc = {}, .gyro = {.x = 0.0F, .y = 0.0F, .z = -1.0F}, .height = 0.0F, .temperature = 0.0F},
+      {.acc = {}, .gyro = {}, .height = -15.0F, .temperature = 0.0F},
+      {.acc = {}, .gyro = {}, .height = 0.0F, .temperature = 6.0F},
+  };
+  for (const Offsets& offset : offsets) {
+    const auto [status, samples] = run_check(kStored, offset);
+    CHECK(status == WARM_START_REJECTED);
+    CHECK(samples == kMinSamples);
+  }
+}
+
+TEST_CASE(movement_restarts_the_average) {
+  warm_start_check_t check{};
+  init_warm_start_check(&check, &kStored, kMinSamples);
+  const vf32_t at_rest = kStored.acceleration;
+  const vf32_t gyro = kStored.calibration.gyro_calib;
+  for (uint16_t i = 0U; i < kMinSamples - 1U; i++) {
+    CHECK(check_warm_start(&check, &kStored, &at_rest, &gyro, kStored.height_0, kStored.temperature) ==
+          WARM_START_PENDING);
+  }
+  CHECK(check.num_samples == kMinSamples - 1U);
+
+  /* Handling the rocket moves it by more than ALLOWED_ACC_ERROR or turns it faster than GYRO_ALLOWED_ERROR_SI */
+  const vf32_t moved = {.x = at_rest.x, .y = at_rest.y + 2.0F * ALLOWED_ACC_ERROR, .z = at_rest.z};
+  CHECK(check_warm_start(&check, &kStored, &moved, &gyro, kStored.height_0, kStored.temperature) ==
+        WARM_START_PENDING);
+  CHECK(check.num_samples == 0U);
+  const vf32_t turned = {.x = gyro.x + 2.0F * GYRO_ALLOWED_ERROR_SI, .y = gyro.y, .z = gyro.z};
+  CHECK(check_warm_start(&check, &kStored, &at_rest, &turned, kStored.height_0, kStored.temperature) ==
+        WARM_START_PENDING);
+  CHECK(check.num_samples == 0U);
+
+  /* The full time at rest is needed again, the samples before the movement do not count */
+  for (uint16_t i = 0U; i < kMinSamples - 1U; i++) {
+    CHECK(check_warm_start(&check, &kStored, &at_rest, &gyro, kStored.height_0, kStored.temperature) ==
+          WARM_START_PENDING);
+  }
+  CHECK(check_warm_start(&check, &kStored, &at_rest, &gyro, kStored.height_0, kStored.temperature) ==
+        WARM_START_VALID);
+
+  /* The result is final */
+  CHECK(check_warm_start(&check, &kStored, &moved, &gyro, kStored.height_0, kStored.temperature) == WARM_START_VALID);
+}
+
+TEST_CASE(flight_since_the_calibration_rejects_it) {
+  stored_calibration_t stored = kStored;
+  stored.flight_counter = flight_counter - 1U;
+  warm_start_check_t check{};
+  init_warm_start_check(&check, &stored, kMinSamples);
+  CHECK(check.status == WARM_START_REJECTED);
+  const auto [status, samples] = run_check(stored, {});
+  CHECK(status == WARM_START_REJECTED);
+  CHECK(samples == 0U);
+}
+
+TEST_CASE(other_version_rejects_it) {
+  stored_calibration_t stored = kStored;
+  stored.version = STORED_CALIBRATION_VERSION + 1U;
+  warm_start_check_t check{};
+  init_warm_start_check(&check, &stored, kMinSamples);
+  CHECK(check.status == WARM_START_REJECTED);
+  CHECK(run_check(stored, {}).first == WARM_START_REJECTED);
+
+  /* A missing calibration file leaves the version zero */
+  stored.version = 0U;
+  CHECK(run_check(stored, {}).first == WARM_START_REJECTED);
+}
@@ -0,0 +1,123 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/consistency.hpp"
+#include "control/kalman_filter.hpp"
+#include "test.hpp"
+
+#include <cstdio>
+#include <random>
+
+/* The windows of the NIS consistency monitor, their chi-square bounds and the NIS the Kalman filter stores for them. */
+
+extern "C" {
+
+void log_raw(const char* /*format*/, ...) {}
+
+void log_log(int /*level*/, const char* /*file*/, int /*line*/, const char* /*format*/, ...) {}
+}
+
+bool get_error_by_tag(cats_error_e /*err*/) { return false; }
+
+/* A window of 100 updates */
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 100;
+
+TEST_CASE(bounds_follow_wilson_hilferty) {
+  const consistency_bounds_t bounds = consistency_nis_bounds(100);
+  CHECK_NEAR(bounds.lower, 0.742, 1e-3);
+  CHECK_NEAR(bounds.upper, 1.296, 1e-3);
+
+  /* The bounds narrow around one with more updates and the lower one stays positive for a single update */
+  const consistency_bounds_t wide = consistency_nis_bounds(10);
+  const consistency_bounds_t narrow = consistency_nis_bounds(250);
+  CHECK((wide.lower < bounds.lower) && (bounds.lower < narrow.lower) && (narrow.lower < 1.0F));
+  CHECK((wide.upper > bounds.upper) && (bounds.upper > narrow.upper) && (narrow.upper > 1.0F));
+  const consistency_bounds_t single = consistency_nis_bounds(1);
+  CHECK(single.lower >= 0.0F);
+  CHECK(single.upper > 3.84F);
+}
+
+TEST_CASE(consistent_filter_leaves_the_bounds_at_the_quantile) {
+  consistency_monitor_t monitor{};
+  reset_consistency_monitor(&monitor);
+  CHECK(monitor.window_length == 100U);
+
+  /* The NIS of a consistent filter is the square of a standard normal innovation */
+  std::mt19937 generator{3U};
+  std::normal_distribution<float32_t> innovation{0.0F, 1.0F};
+  const consistency_bounds_t bounds = consistency_nis_bounds(monitor.window_length);
+  constexpr uint32_t kWindows = 4000U;
+  uint32_t num_windows = 0U;
+  uint32_t num_outside = 0U;
+  for (uint32_t i = 0U; i < kWindows * monitor.window_length; i++) {
+    const float32_t nu = innovation(generator);
+    filter_consistency_t window{};
+    if (update_consistency(&monitor, nu * nu, COASTING, &window)) {
+      CHECK(window.num_updates == 100U);
+      CHECK(window.flight_state == COASTING);
+      num_windows++;
+      num_outside += ((window.nis_mean < bounds.lower) || (window.nis_mean > bounds.upper)) ? 1U : 0U;
+    }
+  }
+  const double outside = static_cast<double>(num_outside) / num_windows;
+  std::printf("%u windows, %.2f %% outside the bounds\n", num_windows, 100.0 * outside);
+  CHECK(num_windows == kWindows);
+  /* CONSISTENCY_NIS_QUANTILE is the two sided 95 % quantile */
+  CHECK_NEAR(outside, 0.05, 0.01);
+}
+
+TEST_CASE(phase_change_closes_the_window) {
+  consistency_monitor_t monitor{};
+  reset_consistency_monitor(&monitor);
+  filter_consistency_t window{};
+
+  for (uint32_t i = 0U; i < 10U; i++) {
+    CHECK(!update_consistency(&monitor, static_cast<float32_t>(i), THRUSTING, &window));
+  }
+
+  /* The first update of COASTING closes the window of THRUSTING and starts the next one */
+  CHECK(update_consistency(&monitor, 100.0F, COASTING, &window));
+  CHECK(window.num_updates == 10U);
+  CHECK(window.flight_state == THRUSTING);
+  CHECK_NEAR(window.nis_mean, 4.5, 1e-6);
+  CHECK_NEAR(window.nis_max, 9.0, 0.0);
+
+  for (uint32_t i = 1U; i < monitor.window_length - 1U; i++) {
+    CHECK(!update_consistency(&monitor, 1.0F, COASTING, &window));
+  }
+  CHECK(update_consistency(&monitor, 1.0F, COASTING, &window));
+  CHECK(window.num_updates == 100U);
+  CHECK(window.flight_state == COASTING);
+  CHECK_NEAR(window.nis_mean, (100.0 + 99.0) / 100.0, 1e-5);
+  CHECK_NEAR(window.nis_max, 100.0, 0.0);
+}
+
+TEST_CASE(held_measurements_store_no_nis) {
+  kalman_filter_t filter{};
+  filter.t_sampl = 0.01F;
+  initialize_matrices(&filter);
+  filter.R = STD_NOISE_BARO_INITIAL;
+
+  filter.measured_AGL = 3.0F;
+  filter.measured_AGL_updated = true;
+  kalman_prediction(&filter);
+  const float32_t S = filter.P_hat(0, 0) + filter.R;
+  const float32_t nu = filter.measured_AGL - filter.x_hat[0];
+  kalman_update(&filter);
+  CHECK(filter.nis_updated);
+  CHECK_NEAR(filter.nis, nu * nu / S, 1e-6);
+
+  /* The consumer clears the flag, a held measurement leaves both alone */
+  filter.nis_updated = false;
+  const float32_t nis = filter.nis;
+  filter.measured_AGL_updated = false;
+  kalman_step(&filter, READY);
+  CHECK(!filter.nis_updated);
+  CHECK(filter.nis == nis);
+
+  filter.measured_AGL_updated = true;
+  kalman_step(&filter, READY);
+  CHECK(filter.nis_updated);
+}
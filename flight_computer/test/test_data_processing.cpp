@@ -0,0 +1,101 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "config/control_config.hpp"
+#include "control/data_processing.hpp"
+#include "test.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+/* calculate_height against the barometric formula evaluated with pow in double precision, and against the powf version
+ * it replaced. */
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+
+namespace {
+
+/* Measurement range of the barometer */
+constexpr double kMinPressure = 1000.0;    // Pa
+constexpr double kMaxPressure = 120000.0;  // Pa
+
+double exact_height(double pressure) {
+  return -(std::pow(pressure / static_cast<double>(P_INITIAL), 1.0 / 5.257) - 1.0) *
+         (static_cast<double>(TEMPERATURE_0) + 273.15) / 0.0065;
+}
+
+/* The implementation before the polynomial, also the fallback outside its range */
+float32_t powf_height(float32_t pressure) {
+  return (-(powf(pressure / P_INITIAL, 1 / 5.257F) - 1) * (TEMPERATURE_0 + 273.15F) / 0.0065F);
+}
+
+/* Largest deviation from the exact height of pressures spaced geometrically between min and max */
+template <typename Function>
+double max_height_error(Function&& height, double min_pressure, double max_pressure) {
+  constexpr int kSteps = 200000;
+  double max_error = 0.0;
+  for (int i = 0; i <= kSteps; i++) {
+    const double pressure = min_pressure * std::pow(max_pressure / min_pressure, static_cast<double>(i) / kSteps);
+    const double error = std::fabs(static_cast<double>(height(static_cast<float32_t>(pressure))) -
+                                   exact_height(static_cast<double>(static_cast<float32_t>(pressure))));
+    max_error = std::max(max_error, error);
+  }
+  return max_error;
+}
+
+}  // namespace
+
+TEST_CASE(height_error_over_the_measurement_range) {
+  const double error = max_height_error(calculate_height, kMinPressure, kMaxPressure);
+  const double powf_error = max_height_error(powf_height, kMinPressure, kMaxPressure);
+  std::printf("max height error: polynomial %.4f m, powf %.4f m\n", error, powf_error);
+  CHECK(error < 0.02);
+}
+
+TEST_CASE(height_error_over_the_whole_table) {
+  /* Pressure ratios from 2^-9 up to 4, every binary exponent of the table and the mantissas at its edges */
+  const double min_pressure = static_cast<double>(P_INITIAL) * std::ldexp(1.0, -9);
+  const double max_pressure = static_cast<double>(P_INITIAL) * 3.999;
+  const double error = max_height_error(calculate_height, min_pressure, max_pressure);
+  std::printf("max height error over the table: %.4f m\n", error);
+  CHECK(error < 0.03);
+  for (int exp = -8; exp <= 2; exp++) {
+    for (const double mantissa : {0.5, 0.75, 0.9999999}) {
+      const double pressure = static_cast<double>(P_INITIAL) * std::ldexp(mantissa, exp);
+      CHECK_NEAR(calculate_height(static_cast<float32_t>(pressure)), exact_height(pressure), 0.03);
+    }
+  }
+}
+
+TEST_CASE(outside_the_table_falls_back_to_powf) {
+  for (const float32_t pressure : {1.0F, 100.0F, 500000.0F}) {
+    CHECK(calculate_height(pressure) == powf_height(pressure));
+  }
+  CHECK_NEAR(calculate_height(P_INITIAL), 0.0, 0.02);
+}
+
+TEST_CASE(benchmark) {
+  constexpr int kIterations = 2000000;
+  volatile float32_t sink = 0.0F;
+
+  const auto time_ns = [](auto&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      function(i);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) /
+           kIterations;
+  };
+
+  /* Pressures of a flight to 10 km */
+  const auto pressure = [](int i) { return 100000.0F - static_cast<float32_t>(i % 74000); };
+  const double polynomial_ns = time_ns([&](int i) { sink = sink + calculate_height(pressure(i)); });
+  const double powf_ns = time_ns([&](int i) { sink = sink + powf_height(pressure(i)); });
+
+  std::printf("calculate_height: polynomial %.1f ns, powf %.1f ns\n", polynomial_ns, powf_ns);
+  CHECK(std::isfinite(sink));
+}
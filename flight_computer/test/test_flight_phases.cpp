@@ -0,0 +1,466 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "config/cats_config.hpp"
+#include "config/globals.hpp"
+#include "control/flight_phases.hpp"
+#include "tasks/task_peripherals.hpp"
+#include "test.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+/* The flight state machine on the flights of the simulator at every configurable control sampling rate. Each flight
+ * is fed step by step to check_flight_phase and to the step counters the state machine used before the sliding
+ * windows, which are kept below as the reference. The transitions checked with the condition window have to happen in
+ * the same step as with the counters, also when a NaN input restarts them. The stillness window and the height slope
+ * decide differently by design, their transitions are checked against the bounds that the windows allow. */
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+cats_config_t global_cats_config{};
+osEventFlagsId_t fsm_flag_id = nullptr;
+
+namespace {
+uint32_t fake_tick_count = 0U;
+uint32_t fsm_flags = 0U;
+std::vector<cats_event_e> triggered_events;
+}  // namespace
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+extern "C" {
+
+uint32_t osKernelGetTickCount() { return fake_tick_count; }
+
+uint32_t osEventFlagsSet(osEventFlagsId_t /*ef_id*/, uint32_t flags) {
+  fsm_flags |= flags;
+  return fsm_flags;
+}
+
+uint32_t osEventFlagsClear(osEventFlagsId_t /*ef_id*/, uint32_t flags) {
+  const uint32_t previous = fsm_flags;
+  fsm_flags &= ~flags;
+  return previous;
+}
+}
+
+osStatus_t trigger_event(cats_event_e ev, bool /*event_unique*/) {
+  triggered_events.push_back(ev);
+  return osOK;
+}
+
+namespace {
+
+constexpr size_t kPolynomSize = 16U;
+
+struct FlightProfile {
+  const char* name;
+  /* Acceleration measured along the rocket axis in g, highest power first, as in the simulator */
+  std::array<double, kPolynomSize> acc_coeff_thrusting;
+  std::array<double, kPolynomSize> acc_coeff_coasting;
+  double switch_time;   // s, the simulator changes from the first to the second polynomial
+  double acc_end_time;  // s, the simulator drops the acceleration to zero afterwards
+  /* Sign of the flight direction on the axis, the calibration finds it on the target */
+  double direction;
+};
+
+const FlightProfile kToyger{
+    "Toyger",
+    {-7.74384180e+06, 6.08296377e+07, -2.13568117e+08, 4.41789674e+08, -5.97189439e+08, 5.52253223e+08,
+     -3.54499448e+08, 1.55874816e+08, -4.42126329e+07, 6.42928691e+06, 3.24708141e+05, -3.53925326e+05, 7.33555220e+04,
+     -7.72424267e+03, 4.30117076e+02, 1.12707667e+00},
+    {-8.45958797e-07, 5.61687651e-05, -1.71045643e-03, 3.16557314e-02, -3.97736659e-01, 3.58938089e+00,
+     -2.40047305e+01, 1.20982114e+02, -4.62655535e+02, 1.34060682e+03, -2.91533086e+03, 4.66615138e+03,
+     -5.31417862e+03, 4.06084709e+03, -1.85964050e+03, 3.83546444e+02},
+    1.1,
+    6.5,
+    1.0};
+
+const FlightProfile kPiccard{
+    "Piccard",
+    {3.61459094e-02, -1.13220884e+00, 1.59256346e+01, -1.32825680e+02, 7.30507566e+02, -2.78686715e+03,
+     7.55213783e+03, -1.46355473e+04, 2.01425971e+04, -1.92885323e+04, 1.24052703e+04, -5.10474479e+03,
+     1.29652104e+03, -2.09483859e+02, 6.43292235e+00, -1.21991272e+00},
+    {2.26958347e-17, -8.44586803e-15, 1.43443916e-12, -1.47229752e-10, 1.01924268e-08, -5.02955339e-07,
+     1.82277767e-05, -4.92550515e-04, 9.97088339e-03, -1.50607679e-01, 1.67589821e+00, -1.34232022e+01,
+     7.45195574e+01, -2.69574673e+02, 5.68434117e+02, -5.33345180e+02},
+    4.2,
+    30.0,
+    -1.0};
+
+/* A short hop of 0.2 s at 5 g, the rocket reaches the apogee sooner than MIN_TICK_COUNTS_BETWEEN_THRUSTING_APOGEE
+ * after the burnout */
+const FlightProfile kHop{"Hop", {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 5.0}, {},
+                         0.2, 0.2, 1.0};
+
+constexpr double kPadTime = 25.0;               // s, from the power up to the ignition
+constexpr double kHandlingStart = 2.0;          // s, the rocket is moved on the pad from here on
+constexpr double kHandlingDuration = 0.5;       // s
+constexpr double kDrogueDescentRate = -25.0;    // m/s
+constexpr double kMainDescentRate = -6.0;       // m/s
+constexpr double kParachuteTimeConstant = 0.5;  // s, of the descent rate approaching the one of the parachute
+constexpr double kMaxFlightTime = 600.0;        // s
+constexpr uint32_t kSubsteps = 20U;
+constexpr uint16_t kMainAltitude = 200;     // m
+constexpr uint16_t kLiftoffThreshold = 35;  // m/s^2
+
+double polynomial(const std::array<double, kPolynomSize>& coeff, double time) {
+  double result = 0.0;
+  for (const double c : coeff) {
+    result = result * time + c;
+  }
+  return result;
+}
+
+/* Acceleration along the flight direction in g as measured by the IMU, same as Simulator::ComputeSimValues */
+double measured_acceleration(const FlightProfile& profile, double time) {
+  if (time > profile.acc_end_time) {
+    return 0.0;
+  }
+  const auto& coeff = (time > profile.switch_time) ? profile.acc_coeff_coasting : profile.acc_coeff_thrusting;
+  return profile.direction * polynomial(coeff, time);
+}
+
+struct Step {
+  vf32_t acc;
+  vf32_t gyro;
+  estimation_output_t state;
+};
+
+struct Flight {
+  std::vector<Step> steps;
+  /* First step with a negative velocity after the liftoff */
+  size_t apogee_step;
+};
+
+/* Integrate the flight at the given control sampling rate. The IMU is noisy on the pad and is moved once, the rocket
+ * descends on the drogue and below the main altitude on the main parachute. The state machine gets the true state. */
+Flight simulate(const FlightProfile& profile, uint16_t frequency) {
+  const double g = static_cast<double>(GRAVITY);
+  const double period = 1.0 / frequency;
+  const double dt = period / kSubsteps;
+  std::mt19937 generator{42U};
+  std::uniform_real_distribution<float> acc_noise{-0.1F, 0.1F};
+  std::uniform_real_distribution<float> gyro_noise{-1.0F, 1.0F};
+
+  Flight flight{};
+  double height = 0.0;
+  double velocity = 0.0;
+  bool climbed = false;
+  bool past_apogee = false;
+  bool landed = false;
+  for (size_t step = 0U; static_cast<double>(step) * period < kPadTime + kMaxFlightTime; step++) {
+    const double time = static_cast<double>(step) * period;
+    Step sample{.acc = {acc_noise(generator), acc_noise(generator), static_cast<float32_t>(g) + acc_noise(generator)},
+                .gyro = {gyro_noise(generator), gyro_noise(generator), gyro_noise(generator)},
+                .state = {}};
+    if ((time >= kHandlingStart) && (time < kHandlingStart + kHandlingDuration)) {
+      sample.acc.x += 1.5F;
+      sample.gyro.y += 30.0F;
+    }
+    if (time < kPadTime) {
+      flight.steps.push_back(sample);
+      continue;
+    }
+
+    const double flight_time = time - kPadTime;
+    double acceleration = 0.0;
+    if (!past_apogee) {
+      acceleration = (measured_acceleration(profile, flight_time) - 1.0) * g;
+      if ((height <= 0.0) && (acceleration < 0.0)) {
+        acceleration = 0.0;
+      }
+      sample.acc.z = static_cast<float32_t>(std::fabs(measured_acceleration(profile, flight_time)) * g);
+    } else if (!landed) {
+      const double descent_rate = (height > kMainAltitude) ? kDrogueDescentRate : kMainDescentRate;
+      acceleration = (descent_rate - velocity) / kParachuteTimeConstant;
+    }
+    sample.state = {.height = static_cast<float32_t>(height),
+                    .velocity = static_cast<float32_t>(velocity),
+                    .acceleration = static_cast<float32_t>(acceleration)};
+    flight.steps.push_back(sample);
+    if (landed) {
+      continue;
+    }
+
+    for (uint32_t k = 0U; k < kSubsteps; k++) {
+      const double t = flight_time + static_cast<double>(k) * dt;
+      double a = 0.0;
+      if (!past_apogee) {
+        a = (measured_acceleration(profile, t) - 1.0) * g;
+        if ((height <= 0.0) && (a < 0.0)) {
+          continue;
+        }
+      } else {
+        const double descent_rate = (height > kMainAltitude) ? kDrogueDescentRate : kMainDescentRate;
+        a = (descent_rate - velocity) / kParachuteTimeConstant;
+      }
+      velocity += a * dt;
+      height += velocity * dt;
+      climbed = climbed || (velocity > 0.0);
+      if (!past_apogee && climbed && (velocity < 0.0)) {
+        past_apogee = true;
+        flight.apogee_step = step + 1U;
+      }
+      if (past_apogee && (height <= 0.0)) {
+        height = 0.0;
+        velocity = 0.0;
+        landed = true;
+        break;
+      }
+    }
+  }
+  return flight;
+}
+
+/* The state machine before the sliding windows: counters of the consecutive steps that met the transition condition,
+ * reset if it was missed */
+class ReferenceFsm {
+ public:
+  void Check(const Step& step) {
+    switch (flight_state) {
+      case CALIBRATING:
+        if ((std::fabs(m_old_acc.x - step.acc.x) < ALLOWED_ACC_ERROR) &&
+            (std::fabs(m_old_acc.y - step.acc.y) < ALLOWED_ACC_ERROR) &&
+            (std::fabs(m_old_acc.z - step.acc.z) < ALLOWED_ACC_ERROR) &&
+            (std::fabs(m_old_gyro.x - step.gyro.x) < ALLOWED_GYRO_ERROR) &&
+            (std::fabs(m_old_gyro.y - step.gyro.y) < ALLOWED_GYRO_ERROR) &&
+            (std::fabs(m_old_gyro.z - step.gyro.z) < ALLOWED_GYRO_ERROR)) {
+          m_memory++;
+        } else {
+          m_memory = 0U;
+        }
+        m_old_acc = step.acc;
+        m_old_gyro = step.gyro;
+        if (m_memory > Steps(TIME_THRESHOLD_CALIB_TO_READY)) {
+          ChangeStateTo(READY);
+        }
+        break;
+      case READY: {
+        const float32_t acceleration =
+            step.acc.x * step.acc.x + step.acc.y * step.acc.y + step.acc.z * step.acc.z;
+        Count(acceleration > static_cast<float32_t>(kLiftoffThreshold * kLiftoffThreshold), LIFTOFF_SAFETY_TIME,
+              THRUSTING);
+        break;
+      }
+      case THRUSTING:
+        Count(step.state.acceleration < 0.0F, COASTING_SAFETY_TIME, COASTING);
+        break;
+      case COASTING:
+        /* Not reset by a missed condition */
+        if (step.state.velocity < 0.0F) {
+          m_memory++;
+        }
+        if (m_memory > Steps(APOGEE_SAFETY_TIME)) {
+          ChangeStateTo(((fake_tick_count - m_thrust_trigger_time) < MIN_TICK_COUNTS_BETWEEN_THRUSTING_APOGEE)
+                            ? TOUCHDOWN
+                            : DROGUE);
+        }
+        break;
+      case DROGUE:
+        Count(step.state.height < static_cast<float32_t>(kMainAltitude), MAIN_SAFETY_TIME, MAIN);
+        break;
+      case MAIN:
+        Count(std::fabs(step.state.velocity) < VELOCITY_BOUND_TOUCHDOWN, TOUCHDOWN_SAFETY_TIME, TOUCHDOWN);
+        break;
+      default:
+        break;
+    }
+  }
+
+  // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+  flight_fsm_e flight_state = CALIBRATING;
+
+ private:
+  static uint32_t Steps(uint16_t duration) {
+    return static_cast<uint32_t>(duration) * global_control_sampling_freq / 1000U;
+  }
+
+  void Count(bool condition, uint16_t safety_time, flight_fsm_e next_state) {
+    m_memory = condition ? m_memory + 1U : 0U;
+    if (m_memory > Steps(safety_time)) {
+      ChangeStateTo(next_state);
+    }
+  }
+
+  void ChangeStateTo(flight_fsm_e new_state) {
+    if (flight_state == THRUSTING) {
+      m_thrust_trigger_time = fake_tick_count;
+    }
+    flight_state = new_state;
+    m_memory = 0U;
+  }
+
+  uint32_t m_memory = 0U;
+  vf32_t m_old_acc{};
+  vf32_t m_old_gyro{};
+  uint32_t m_thrust_trigger_time = 0U;
+};
+
+constexpr size_t kNoStep = std::numeric_limits<size_t>::max();
+
+/* Step in which each state was entered, kNoStep if it was not */
+using TransitionSteps = std::array<size_t, TOUCHDOWN + 1U>;
+
+struct Run {
+  TransitionSteps fsm;
+  TransitionSteps reference;
+  std::vector<cats_event_e> events;
+  uint32_t final_flags;
+};
+
+/* Feed the flight to both state machines, the inputs of the given steps are replaced by NaN */
+Run run(const Flight& flight, uint16_t frequency, const std::vector<size_t>& invalid_steps = {}) {
+  global_control_sampling_freq = frequency;
+  global_cats_config.control_settings = {.liftoff_acc_threshold = kLiftoffThreshold, .main_altitude = kMainAltitude};
+  const control_settings_t settings = global_cats_config.control_settings;
+  fake_tick_count = 0U;
+  fsm_flags = 0U;
+  triggered_events.clear();
+
+  /* Large, flight_fsm_t holds the windows */
+  static flight_fsm_t fsm_state;
+  fsm_state = flight_fsm_t{};
+  fsm_state.flight_state = CALIBRATING;
+  init_flight_phase(&fsm_state);
+  ReferenceFsm reference;
+
+  Run result{};
+  result.fsm.fill(kNoStep);
+  result.reference.fill(kNoStep);
+  for (size_t i = 0U; i < flight.steps.size(); i++) {
+    fake_tick_count = static_cast<uint32_t>(i * 1000U / frequency);
+    Step step = flight.steps[i];
+    for (const size_t invalid : invalid_steps) {
+      if (i == invalid) {
+        constexpr float32_t nan = std::numeric_limits<float32_t>::quiet_NaN();
+        step = {.acc = {nan, nan, nan}, .gyro = {nan, nan, nan}, .state = {nan, nan, nan}};
+      }
+    }
+
+    check_flight_phase(&fsm_state, step.acc, step.gyro, step.state, &settings);
+    if (fsm_state.state_changed) {
+      result.fsm[fsm_state.flight_state] = i;
+    }
+    const flight_fsm_e old_reference_state = reference.flight_state;
+    reference.Check(step);
+    if (old_reference_state != reference.flight_state) {
+      result.reference[reference.flight_state] = i;
+    }
+  }
+  result.events = triggered_events;
+  result.final_flags = fsm_flags;
+  return result;
+}
+
+/* Checks the transitions of the state machine against the ones of the reference */
+void check_transitions(const Run& result, const Flight& flight, uint16_t frequency) {
+  const auto& fsm = result.fsm;
+  const auto& reference = result.reference;
+  const size_t stillness_steps = STILLNESS_TIME * frequency / 1000U;
+  for (const flight_fsm_e state : {READY, THRUSTING, COASTING, DROGUE, MAIN, TOUCHDOWN}) {
+    CHECK(fsm[state] != kNoStep);
+    CHECK(reference[state] != kNoStep);
+  }
+  if ((fsm[TOUCHDOWN] == kNoStep) || (reference[TOUCHDOWN] == kNoStep)) {
+    return;
+  }
+
+  /* The IMU has to stay within the allowed range over the stillness window instead of between two steps, READY is
+   * delayed by at most the window */
+  CHECK(fsm[READY] >= reference[READY]);
+  CHECK(fsm[READY] <= reference[READY] + stillness_steps);
+  CHECK(fsm[READY] < static_cast<size_t>(kPadTime * frequency));
+
+  CHECK(fsm[THRUSTING] == reference[THRUSTING]);
+  CHECK(fsm[COASTING] == reference[COASTING]);
+
+  /* The height is fitted after the apogee, the transition itself is checked by the callers */
+  CHECK(fsm[DROGUE] >= flight.apogee_step);
+
+  CHECK(fsm[MAIN] == reference[MAIN]);
+  CHECK(fsm[TOUCHDOWN] == reference[TOUCHDOWN]);
+}
+
+}  // namespace
+
+TEST_CASE(flights_at_every_sampling_rate) {
+  for (const FlightProfile* profile : {&kToyger, &kPiccard}) {
+    for (const uint16_t frequency : CONTROL_SAMPLING_FREQS) {
+      std::printf("%s at %u Hz\n", profile->name, frequency);
+      const Flight flight = simulate(*profile, frequency);
+      const Run result = run(flight, frequency);
+      check_transitions(result, flight, frequency);
+
+      /* The fitted height decreases once the apogee passed the middle of the window, before the velocity was negative
+       * for the whole safety time */
+      const size_t apogee_steps = APOGEE_SAFETY_TIME * frequency / 1000U;
+      CHECK(result.fsm[DROGUE] <= result.reference[DROGUE]);
+      CHECK(result.reference[DROGUE] == flight.apogee_step + apogee_steps);
+
+      const std::vector<cats_event_e> expected_events = {EV_READY,  EV_LIFTOFF,         EV_MAX_V,
+                                                         EV_APOGEE, EV_MAIN_DEPLOYMENT, EV_TOUCHDOWN};
+      CHECK(result.events == expected_events);
+      CHECK(result.final_flags == TOUCHDOWN);
+    }
+  }
+}
+
+/* A NaN input in the last steps of a safety time restarts it, as a missed condition did with the counters */
+TEST_CASE(nan_inputs_restart_the_safety_times) {
+  for (const FlightProfile* profile : {&kToyger, &kPiccard}) {
+    for (const uint16_t frequency : CONTROL_SAMPLING_FREQS) {
+      std::printf("%s at %u Hz\n", profile->name, frequency);
+      const Flight flight = simulate(*profile, frequency);
+      const Run clean = run(flight, frequency);
+      if (clean.reference[TOUCHDOWN] == kNoStep) {
+        CHECK(clean.reference[TOUCHDOWN] != kNoStep);
+        continue;
+      }
+
+      const size_t apogee_steps = APOGEE_SAFETY_TIME * frequency / 1000U;
+      const std::vector<size_t> invalid_steps = {clean.reference[READY] - 5U,   clean.reference[THRUSTING] - 2U,
+                                                 clean.reference[COASTING] - 2U, flight.apogee_step,
+                                                 clean.reference[MAIN] - 2U,     clean.reference[TOUCHDOWN] - 2U};
+      const Run result = run(flight, frequency, invalid_steps);
+      check_transitions(result, flight, frequency);
+
+      /* Every restarted transition is delayed */
+      CHECK(result.reference[READY] > clean.reference[READY]);
+      CHECK(result.fsm[THRUSTING] > clean.fsm[THRUSTING]);
+      CHECK(result.fsm[COASTING] > clean.fsm[COASTING]);
+      CHECK(result.fsm[MAIN] > clean.fsm[MAIN]);
+      CHECK(result.fsm[TOUCHDOWN] > clean.fsm[TOUCHDOWN]);
+
+      /* The NaN height keeps the slope NaN until it left the window and the sums were computed again */
+      CHECK(result.fsm[DROGUE] > flight.apogee_step + apogee_steps);
+      CHECK(result.fsm[DROGUE] <= flight.apogee_step + 2U * (apogee_steps + 1U));
+    }
+  }
+}
+
+/* The apogee of the hop follows the burnout within MIN_TICK_COUNTS_BETWEEN_THRUSTING_APOGEE, the flight is aborted */
+TEST_CASE(early_apogee_goes_to_touchdown) {
+  for (const uint16_t frequency : CONTROL_SAMPLING_FREQS) {
+    std::printf("Hop at %u Hz\n", frequency);
+    const Flight flight = simulate(kHop, frequency);
+    const Run result = run(flight, frequency);
+
+    CHECK(result.fsm[COASTING] == result.reference[COASTING]);
+    CHECK(result.fsm[TOUCHDOWN] != kNoStep);
+    CHECK(result.fsm[TOUCHDOWN] >= flight.apogee_step);
+    CHECK(result.fsm[TOUCHDOWN] <= result.reference[TOUCHDOWN]);
+    CHECK(result.fsm[DROGUE] == kNoStep);
+    CHECK(result.reference[DROGUE] == kNoStep);
+    CHECK(result.reference[TOUCHDOWN] != kNoStep);
+
+    const std::vector<cats_event_e> expected_events = {EV_READY, EV_LIFTOFF, EV_MAX_V, EV_TOUCHDOWN};
+    CHECK(result.events == expected_events);
+    CHECK(result.final_flags == TOUCHDOWN);
+  }
+}
@@ -0,0 +1,182 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/gnss_fusion.hpp"
+#include "control/kalman_filter.hpp"
+#include "test.hpp"
+
+#include <cmath>
+
+/* The GNSS fusion on a rocket resting on the pad and climbing with constant acceleration, the barometer measures the
+ * exact height. The fixes arrive with the latency of the telemetry MCU and carry the altitude of the time they were
+ * measured. */
+
+extern "C" {
+
+void log_raw(const char* /*format*/, ...) {}
+
+void log_log(int /*level*/, const char* /*file*/, int /*line*/, const char* /*format*/, ...) {}
+}
+
+bool get_error_by_tag(cats_error_e /*err*/) { return false; }
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+
+namespace {
+
+constexpr float32_t kSamplingPeriod = 1.0F / 125.0F;
+/* GNSS altitude of the launch pad */
+constexpr float32_t kPadAltitude = 480.0F;  // m
+constexpr float32_t kAcceleration = 30.0F;  // m/s^2
+/* Steps on the pad before the first fix and before liftoff */
+constexpr uint32_t kPadSteps = 500U;
+
+struct Fusion {
+  kalman_filter_t filter;
+  gnss_fusion_t fusion;
+  uint32_t step;
+  uint32_t liftoff_step;
+};
+
+Fusion make_fusion() {
+  Fusion f{};
+  f.filter.t_sampl = kSamplingPeriod;
+  initialize_matrices(&f.filter);
+  reset_kalman(&f.filter);
+  /* Start at rest instead of the velocity of the reset, which takes minutes to settle on the pad */
+  f.filter.x_bar = {};
+  init_gnss_fusion(&f.fusion, &f.filter);
+  return f;
+}
+
+float32_t seconds(uint32_t steps) { return static_cast<float32_t>(steps) * kSamplingPeriod; }
+
+/* True height AGL after the given step */
+float32_t true_height(const Fusion& f, uint32_t step) {
+  if (step <= f.liftoff_step) {
+    return 0.0F;
+  }
+  const float32_t t = seconds(step - f.liftoff_step);
+  return kAcceleration * t * t / 2.0F;
+}
+
+/* One control step, on the pad until liftoff_step */
+void run(Fusion* f, uint32_t steps) {
+  for (uint32_t i = 0; i < steps; i++) {
+    f->step++;
+    const bool flying = f->step > f->liftoff_step;
+    f->filter.measured_acceleration = flying ? kAcceleration : 0.0F;
+    f->filter.measured_AGL = true_height(*f, f->step);
+    gnss_fusion_step(&f->fusion, &f->filter, flying ? THRUSTING : READY);
+  }
+}
+
+/* Fix measured age seconds ago, the altitude is off by the given error */
+bool fuse(Fusion* f, float32_t age, float32_t error = 0.0F) {
+  const auto steps_ago = static_cast<uint32_t>(std::lround(age / kSamplingPeriod));
+  const float32_t altitude = kPadAltitude + true_height(*f, f->step - steps_ago) + error;
+  const flight_fsm_e state = (f->step > f->liftoff_step) ? THRUSTING : READY;
+  return gnss_fusion_update(&f->fusion, &f->filter, state, altitude, age);
+}
+
+/* Rests on the pad with a fused offset and lifts off after the current step */
+Fusion initialized_on_pad() {
+  Fusion f = make_fusion();
+  f.liftoff_step = 2U * kPadSteps;
+  run(&f, kPadSteps);
+  CHECK(fuse(&f, GNSS_LATENCY));
+  run(&f, kPadSteps);
+  return f;
+}
+
+}  // namespace
+
+TEST_CASE(stale_fixes_are_dropped) {
+  Fusion f = make_fusion();
+  f.liftoff_step = 2U * kPadSteps;
+  /* Without a height history, not even a fix of this step can be placed */
+  CHECK(!fuse(&f, 0.0F));
+  run(&f, kPadSteps);
+
+  CHECK(!fuse(&f, -kSamplingPeriod));
+  CHECK(!fuse(&f, GNSS_MAX_AGE + kSamplingPeriod));
+  CHECK(!f.fusion.offset_initialized);
+
+  /* The offset is only initialized on the pad */
+  const float32_t altitude = kPadAltitude;
+  CHECK(!gnss_fusion_update(&f.fusion, &f.filter, THRUSTING, altitude, GNSS_LATENCY));
+  CHECK(!f.fusion.offset_initialized);
+
+  CHECK(fuse(&f, GNSS_MAX_AGE));
+  CHECK(f.fusion.offset_initialized);
+  CHECK_NEAR(f.fusion.gnss_offset, kPadAltitude, 0.01);
+
+  /* A fix older than the history after the reset at the transition to READY */
+  reset_gnss_fusion(&f.fusion);
+  run(&f, 10U);
+  CHECK(!fuse(&f, seconds(10U)));
+  CHECK(fuse(&f, seconds(9U)));
+}
+
+TEST_CASE(delayed_fixes_are_fused_at_their_measurement_time) {
+  Fusion f = initialized_on_pad();
+  const Fusion on_pad = f;
+
+  /* Fixes at 5 Hz during three seconds of thrust */
+  uint32_t num_fused = 0U;
+  for (uint32_t i = 0; i < 15U; i++) {
+    run(&f, 25U);
+    num_fused += fuse(&f, GNSS_LATENCY) ? 1U : 0U;
+  }
+  const float32_t height = true_height(f, f.step);
+  CHECK(num_fused == 15U);
+  CHECK_NEAR(f.fusion.gnss_offset, kPadAltitude, 0.5);
+  CHECK_NEAR(f.filter.x_bar[0], height, 0.5);
+  CHECK_NEAR(f.filter.x_bar[1], kAcceleration * seconds(f.step - f.liftoff_step), 0.5);
+
+  /* Taken as current, the altitude of the last fix lags behind by the distance flown during the latency */
+  Fusion undelayed = on_pad;
+  run(&undelayed, f.step - on_pad.step);
+  const float32_t velocity = kAcceleration * seconds(undelayed.step - undelayed.liftoff_step);
+  const float32_t lagging_altitude = kPadAltitude + true_height(undelayed, undelayed.step) - velocity * GNSS_LATENCY;
+  CHECK(!gnss_fusion_update(&undelayed.fusion, &undelayed.filter, THRUSTING, lagging_altitude, 0.0F));
+}
+
+TEST_CASE(outliers_are_rejected) {
+  Fusion f = initialized_on_pad();
+  f.liftoff_step += kPadSteps;
+
+  /* A single outlier leaves the state untouched */
+  const Matrix<3, 1> x_bar = f.filter.x_bar;
+  CHECK(!fuse(&f, GNSS_LATENCY, 100.0F));
+  CHECK(f.fusion.gnss_offset == kPadAltitude);
+  for (uint8_t i = 0; i < 3; i++) {
+    CHECK(f.filter.x_bar[i] == x_bar[i]);
+  }
+  CHECK(fuse(&f, GNSS_LATENCY));
+  CHECK(f.fusion.num_rejections == 0U);
+
+  /* On the pad, a persistent disagreement initializes the offset again */
+  for (uint8_t i = 0; i < GNSS_MAX_REJECTIONS; i++) {
+    run(&f, 25U);
+    CHECK(!fuse(&f, GNSS_LATENCY, 100.0F));
+  }
+  CHECK(!f.fusion.offset_initialized);
+  run(&f, 25U);
+  CHECK(fuse(&f, GNSS_LATENCY, 100.0F));
+  CHECK_NEAR(f.fusion.gnss_offset, kPadAltitude + 100.0F, 0.01);
+
+  /* In flight, it is fused after GNSS_MAX_REJECTIONS fixes */
+  run(&f, kPadSteps + 125U);
+  for (uint8_t i = 1; i < GNSS_MAX_REJECTIONS; i++) {
+    run(&f, 25U);
+    CHECK(!fuse(&f, GNSS_LATENCY));
+  }
+  run(&f, 25U);
+  const float32_t offset = f.fusion.gnss_offset;
+  CHECK(fuse(&f, GNSS_LATENCY));
+  CHECK(f.fusion.num_rejections == 0U);
+  CHECK(f.fusion.gnss_offset < offset);
+}
@@ -0,0 +1,175 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "test.hpp"
+#include "util/int16_kernels.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+/* The DSP versions of the int16 kernels against the portable ones. On the host, arm_math.h defines the intrinsics in C,
+ * these definitions are first checked against the semantics of the instructions in the Armv7-M reference manual. */
+
+namespace {
+
+constexpr int16_t kMin = std::numeric_limits<int16_t>::min();
+constexpr int16_t kMax = std::numeric_limits<int16_t>::max();
+
+int32_t lower_half(uint32_t word) { return static_cast<int16_t>(word & 0xFFFFU); }
+int32_t upper_half(uint32_t word) { return static_cast<int16_t>(word >> 16U); }
+
+uint32_t make_word(int32_t lower, int32_t upper) {
+  return static_cast<uint16_t>(lower) | (static_cast<uint32_t>(static_cast<uint16_t>(upper)) << 16U);
+}
+
+/* SMLAD: both signed 16 x 16 products added to the accumulator, modulo 2^32 */
+uint32_t reference_smlad(uint32_t x, uint32_t y, uint32_t sum) {
+  const int64_t result = static_cast<int64_t>(lower_half(x)) * lower_half(y) +
+                         static_cast<int64_t>(upper_half(x)) * upper_half(y) + static_cast<int32_t>(sum);
+  return static_cast<uint32_t>(result);
+}
+
+/* QSUB16: signed difference of each half, saturated to the int16 range */
+uint32_t reference_qsub16(uint32_t x, uint32_t y) {
+  const auto saturate = [](int32_t value) { return std::clamp<int32_t>(value, kMin, kMax); };
+  return make_word(saturate(lower_half(x) - lower_half(y)), saturate(upper_half(x) - upper_half(y)));
+}
+
+/* Random values with the edges of the range overrepresented */
+class Generator {
+ public:
+  int16_t Value() {
+    switch (m_generator() % 8U) {
+      case 0:
+        return kMin;
+      case 1:
+        return kMax;
+      case 2:
+        return static_cast<int16_t>(static_cast<int32_t>(m_generator() % 5U) - 2);
+      default:
+        return static_cast<int16_t>(m_generator());
+    }
+  }
+
+  vi16_t Triple() { return {.x = Value(), .y = Value(), .z = Value()}; }
+
+  uint32_t Word() { return make_word(Value(), Value()); }
+
+  uint32_t Next() { return m_generator(); }
+
+ private:
+  std::mt19937 m_generator{0x16161616U};
+};
+
+bool equal(const imu_data_t& a, const imu_data_t& b) {
+  return (a.acc.x == b.acc.x) && (a.acc.y == b.acc.y) && (a.acc.z == b.acc.z) && (a.gyro.x == b.gyro.x) &&
+         (a.gyro.y == b.gyro.y) && (a.gyro.z == b.gyro.z);
+}
+
+}  // namespace
+
+TEST_CASE(host_intrinsics_follow_the_instruction_semantics) {
+  Generator generator;
+  uint32_t mismatches = 0U;
+  for (int k = 0; k < 200000; k++) {
+    const uint32_t x = generator.Word();
+    const uint32_t y = generator.Word();
+    const uint32_t sum = generator.Next();
+    mismatches += (__SMLAD(x, y, sum) != reference_smlad(x, y, sum)) ? 1U : 0U;
+    mismatches += (__QSUB16(x, y) != reference_qsub16(x, y)) ? 1U : 0U;
+  }
+  CHECK(mismatches == 0U);
+
+  /* The saturation keeps the sign of differences beyond the int16 range */
+  CHECK(__QSUB16(make_word(kMax, kMin), make_word(kMin, kMax)) == make_word(kMax, kMin));
+  CHECK(__SMLAD(make_word(kMin, 0), 0x00000001U, 0U) == static_cast<uint32_t>(static_cast<int32_t>(kMin)));
+}
+
+TEST_CASE(sums_are_bit_exact) {
+  Generator generator;
+  std::vector<imu_data_t> samples(IMU_MAX_BATCH_SIZE);
+  uint32_t mismatches = 0U;
+  for (int k = 0; k < 50000; k++) {
+    const auto count = static_cast<uint8_t>(generator.Next() % (IMU_MAX_BATCH_SIZE + 1U));
+    for (auto& sample : samples) {
+      sample = {.acc = generator.Triple(), .gyro = generator.Triple()};
+    }
+    int32_t dsp_sum[IMU_NUM_CHANNELS] = {};
+    int32_t portable_sum[IMU_NUM_CHANNELS] = {};
+    /* The sums are added to the given values */
+    for (uint8_t ch = 0; ch < IMU_NUM_CHANNELS; ch++) {
+      dsp_sum[ch] = portable_sum[ch] = static_cast<int32_t>(generator.Value()) * 1000;
+    }
+    int16_kernels::dsp::sum_imu_samples(samples.data(), count, dsp_sum);
+    int16_kernels::portable::sum_imu_samples(samples.data(), count, portable_sum);
+    for (uint8_t ch = 0; ch < IMU_NUM_CHANNELS; ch++) {
+      mismatches += (dsp_sum[ch] != portable_sum[ch]) ? 1U : 0U;
+    }
+  }
+  CHECK(mismatches == 0U);
+}
+
+TEST_CASE(mean_rounds_towards_zero) {
+  const std::vector<imu_data_t> samples = {{.acc = {.x = 1, .y = -1, .z = kMax}, .gyro = {.x = kMin, .y = 3, .z = 0}},
+                                           {.acc = {.x = 2, .y = -2, .z = kMax}, .gyro = {.x = kMin, .y = 4, .z = 0}}};
+  const imu_data_t mean = mean_imu_samples(samples.data(), static_cast<uint8_t>(samples.size()));
+  CHECK(equal(mean, {.acc = {.x = 1, .y = -1, .z = kMax}, .gyro = {.x = kMin, .y = 3, .z = 0}}));
+  CHECK(equal(mean_imu_samples(samples.data(), 1U), samples[0]));
+}
+
+TEST_CASE(bounds_and_freeze_checks_are_bit_exact) {
+  Generator generator;
+  uint32_t mismatches = 0U;
+  uint32_t num_out_of_bounds = 0U;
+  for (int k = 0; k < 200000; k++) {
+    const vi16_t value = generator.Triple();
+    const vi16_t lower = generator.Triple();
+    const vi16_t upper = generator.Triple();
+    const bool out_of_bounds = int16_kernels::portable::out_of_bounds(value, lower, upper);
+    mismatches += (int16_kernels::dsp::out_of_bounds(value, lower, upper) != out_of_bounds) ? 1U : 0U;
+    num_out_of_bounds += out_of_bounds ? 1U : 0U;
+
+    /* Differ in a single channel half of the time */
+    vi16_t last = value;
+    if ((generator.Next() % 2U) == 0U) {
+      int16_t* channels[3] = {&last.x, &last.y, &last.z};
+      *channels[generator.Next() % 3U] ^= static_cast<int16_t>(1 << (generator.Next() % 16U));
+    }
+    mismatches += (int16_kernels::dsp::changed(value, last) != int16_kernels::portable::changed(value, last)) ? 1U : 0U;
+  }
+  CHECK(mismatches == 0U);
+  /* Both outcomes were covered */
+  CHECK(num_out_of_bounds > 0U);
+  CHECK(num_out_of_bounds < 200000U);
+
+  /* Values on the limits are in bounds, also at the ends of the range */
+  const vi16_t lower = {.x = kMin, .y = -5, .z = 0};
+  const vi16_t upper = {.x = kMax, .y = 5, .z = 0};
+  CHECK(!int16_kernels::dsp::out_of_bounds({.x = kMin, .y = -5, .z = 0}, lower, upper));
+  CHECK(!int16_kernels::dsp::out_of_bounds({.x = kMax, .y = 5, .z = 0}, lower, upper));
+  CHECK(int16_kernels::dsp::out_of_bounds({.x = 0, .y = 6, .z = 0}, lower, upper));
+  CHECK(int16_kernels::dsp::out_of_bounds({.x = 0, .y = 0, .z = -1}, lower, upper));
+  CHECK(int16_kernels::dsp::out_of_bounds({.x = 0, .y = 0, .z = kMax}, lower, upper));
+}
+
+TEST_CASE(scaling_is_bit_exact) {
+  Generator generator;
+  const float32_t factor[3] = {9.81F / 1024.0F, 0.07F, -0.0123F};
+  uint32_t mismatches = 0U;
+  for (int k = 0; k < 200000; k++) {
+    const vi16_t value = generator.Triple();
+    float32_t dsp[3];
+    float32_t portable[3];
+    int16_kernels::dsp::scale(value, factor, dsp);
+    int16_kernels::portable::scale(value, factor, portable);
+    for (uint8_t ch = 0; ch < 3; ch++) {
+      mismatches += (std::memcmp(&dsp[ch], &portable[ch], sizeof(float32_t)) != 0) ? 1U : 0U;
+    }
+  }
+  CHECK(mismatches == 0U);
+}
@@ -0,0 +1,137 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/kalman_filter.hpp"
+#include "test.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+/* The barometer noise estimated from the innovations while coasting. The filter follows a ballistic climb measured by
+ * a barometer with a known noise and has to find its variance, clamped to KALMAN_ADAPTIVE_R_MIN and MAX. */
+
+extern "C" {
+
+void log_raw(const char* /*format*/, ...) {}
+
+void log_log(int /*level*/, const char* /*file*/, int /*line*/, const char* /*format*/, ...) {}
+}
+
+bool get_error_by_tag(cats_error_e /*err*/) { return false; }
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+
+namespace {
+
+/* Default control sampling rate */
+constexpr float32_t kSamplingPeriod = 1.0F / 125.0F;
+
+/* Height and upwards velocity at the start of the coast */
+constexpr double kStartHeight = 300.0;      // m
+constexpr double kStartVelocity = 150.0;    // m/s
+constexpr uint32_t kCoastingSteps = 1500U;  // 12 s, shortly before the apogee
+
+/* Steps after which the estimate is judged, the filter has settled and the window is full */
+constexpr uint32_t kSettlingSteps = 250U;
+
+struct Estimate {
+  double mean;
+  float32_t min;
+  float32_t max;
+};
+
+/* Coast with the given barometer noise variance, returns the statistics of the measurement noise the filter used once
+ * it settled. Every step brings a new barometer measurement. */
+Estimate coast(double noise_variance, uint32_t seed) {
+  kalman_filter_t filter{};
+  filter.t_sampl = kSamplingPeriod;
+  initialize_matrices(&filter);
+  reset_kalman(&filter);
+  filter.x_bar = {{static_cast<float32_t>(kStartHeight), static_cast<float32_t>(kStartVelocity), 0.0F}};
+
+  std::mt19937 generator{seed};
+  std::normal_distribution<double> noise{0.0, std::sqrt(noise_variance)};
+  const double g = static_cast<double>(GRAVITY);
+  double sum = 0.0;
+  Estimate estimate{.mean = 0.0, .min = KALMAN_ADAPTIVE_R_MAX, .max = KALMAN_ADAPTIVE_R_MIN};
+  for (uint32_t i = 1U; i <= kCoastingSteps; i++) {
+    const double t = i * static_cast<double>(kSamplingPeriod);
+    const double height = kStartHeight + kStartVelocity * t - g * t * t / 2.0;
+    filter.measured_acceleration = -GRAVITY;
+    filter.measured_AGL = static_cast<float32_t>(height + noise(generator));
+    filter.measured_AGL_updated = true;
+    kalman_step(&filter, COASTING);
+
+    if (i > kSettlingSteps) {
+      sum += static_cast<double>(filter.R);
+      estimate.min = std::min(estimate.min, filter.R);
+      estimate.max = std::max(estimate.max, filter.R);
+    }
+  }
+  estimate.mean = sum / (kCoastingSteps - kSettlingSteps);
+  return estimate;
+}
+
+}  // namespace
+
+TEST_CASE(estimate_matches_the_barometer_noise) {
+  for (const double variance : {25.0, 100.0, 400.0}) {
+    const Estimate estimate = coast(variance, 7U);
+    std::printf("noise variance %5.0f m^2: R mean %7.2f, range %7.2f to %7.2f\n", variance, estimate.mean,
+                static_cast<double>(estimate.min), static_cast<double>(estimate.max));
+    /* The predicted variance includes process noise which the exact acceleration does not have, the mean over the
+     * coast is a few percent low. A single window of KALMAN_INNOVATION_TIME spreads wider. */
+    CHECK_NEAR(estimate.mean, variance, 0.1 * variance);
+    CHECK(estimate.min > 0.4 * variance);
+    CHECK(estimate.max < 1.8 * variance);
+  }
+}
+
+TEST_CASE(estimate_is_clamped) {
+  const Estimate low = coast(1.0, 11U);
+  CHECK(low.min == KALMAN_ADAPTIVE_R_MIN);
+  CHECK(low.max == KALMAN_ADAPTIVE_R_MIN);
+
+  const Estimate high = coast(4.0 * KALMAN_ADAPTIVE_R_MAX, 13U);
+  CHECK(high.min == KALMAN_ADAPTIVE_R_MAX);
+  CHECK(high.max == KALMAN_ADAPTIVE_R_MAX);
+}
+
+TEST_CASE(empty_window_distrusts_the_barometer) {
+  kalman_filter_t filter{};
+  filter.t_sampl = kSamplingPeriod;
+  initialize_matrices(&filter);
+  reset_kalman(&filter);
+  update_measurement_noise(&filter, COASTING);
+  CHECK(filter.R == KALMAN_ADAPTIVE_R_MAX);
+}
+
+TEST_CASE(held_measurements_are_not_recorded) {
+  kalman_filter_t filter{};
+  filter.t_sampl = kSamplingPeriod;
+  initialize_matrices(&filter);
+  reset_kalman(&filter);
+  CHECK(filter.innovations.GetCount() == 0U);
+
+  filter.measured_AGL = 1.0F;
+  filter.measured_AGL_updated = true;
+  kalman_step(&filter, COASTING);
+  CHECK(filter.innovations.GetCount() == 1U);
+
+  /* The same measurement again, its innovation is what the first update left */
+  filter.measured_AGL_updated = false;
+  kalman_step(&filter, COASTING);
+  kalman_step(&filter, COASTING);
+  CHECK(filter.innovations.GetCount() == 1U);
+
+  /* The window covers KALMAN_INNOVATION_TIME of new measurements */
+  filter.measured_AGL_updated = true;
+  for (uint32_t i = 0U; i < 2U * kalman_innovation_window(global_control_sampling_freq); i++) {
+    kalman_step(&filter, COASTING);
+  }
+  CHECK(filter.innovations.GetCount() == kalman_innovation_window(global_control_sampling_freq));
+}
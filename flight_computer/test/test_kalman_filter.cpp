@@ -0,0 +1,135 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/kalman_filter.hpp"
+#include "test.hpp"
+
+#include <array>
+#include <cmath>
+
+/* The discretization of the Kalman filter model and the multi-rate step. */
+
+extern "C" {
+
+void log_raw(const char* /*format*/, ...) {}
+
+void log_log(int /*level*/, const char* /*file*/, int /*line*/, const char* /*format*/, ...) {}
+}
+
+bool get_error_by_tag(cats_error_e /*err*/) { return false; }
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+
+namespace {
+
+using Matrix3d = std::array<std::array<double, 3>, 3>;
+
+/* Qd = int_0^dt e^(A t) G Qc G' e^(A' t) dt with Simpson's rule */
+Matrix3d integrate_process_noise(double dt) {
+  constexpr int kIntervals = 1000;
+  const double q_acc = static_cast<double>(STD_NOISE_IMU) / static_cast<double>(KALMAN_NOISE_TUNING_PERIOD);
+  const double q_offset = static_cast<double>(STD_NOISE_OFFSET) / static_cast<double>(KALMAN_NOISE_TUNING_PERIOD);
+  Matrix3d Qd{};
+  for (int k = 0; k <= kIntervals; k++) {
+    const double t = dt * k / kIntervals;
+    const double weight = ((k == 0) || (k == kIntervals)) ? 1.0 : ((k % 2 == 1) ? 4.0 : 2.0);
+    /* Columns of e^(A t) G, the response of height, velocity and offset to the two noise inputs */
+    const std::array<double, 3> acc = {t, 1.0, 0.0};
+    const std::array<double, 3> offset = {t * t / 2.0, t, 1.0};
+    for (size_t i = 0; i < 3; i++) {
+      for (size_t j = 0; j < 3; j++) {
+        Qd[i][j] += weight * dt / (3.0 * kIntervals) * (q_acc * acc[i] * acc[j] + q_offset * offset[i] * offset[j]);
+      }
+    }
+  }
+  return Qd;
+}
+
+kalman_filter_t make_filter(float32_t t_sampl) {
+  kalman_filter_t filter{};
+  filter.t_sampl = t_sampl;
+  initialize_matrices(&filter);
+  reset_kalman(&filter);
+  return filter;
+}
+
+}  // namespace
+
+TEST_CASE(process_noise_is_the_integral_over_the_step) {
+  for (const float32_t dt : {0.001F, 0.008F, 0.01F, 0.05F}) {
+    const Matrix<3, 3> Qd = kalman_exact_process_noise(dt);
+    const Matrix3d expected = integrate_process_noise(static_cast<double>(dt));
+    for (uint8_t i = 0; i < 3; i++) {
+      for (uint8_t j = 0; j < 3; j++) {
+        CHECK_NEAR(Qd(i, j), expected[i][j], 1e-5 * std::fabs(expected[i][j]));
+        CHECK(Qd(i, j) == Qd(j, i));
+      }
+    }
+  }
+  /* The variances collected over the tuning period */
+  const Matrix<3, 3> Qd = kalman_exact_process_noise(KALMAN_NOISE_TUNING_PERIOD);
+  CHECK_NEAR(Qd(1, 1), STD_NOISE_IMU, 1e-6 * STD_NOISE_IMU);
+  CHECK_NEAR(Qd(2, 2), STD_NOISE_OFFSET, 1e-6 * STD_NOISE_OFFSET);
+}
+
+TEST_CASE(exact_process_noise_adds_up_over_substeps) {
+  /* Propagating over two half steps collects the same noise as one full step */
+  constexpr float32_t kDt = 0.008F;
+  kalman_filter_t half = make_filter(kDt / 2.0F);
+  kalman_discretize(&half, kDt / 2.0F, true);
+  const Matrix<3, 3> two_halves = symmetric_product(half.Ad, half.GdQGd_T) + half.GdQGd_T;
+  const Matrix<3, 3> full = kalman_exact_process_noise(kDt);
+  for (uint8_t i = 0; i < 9; i++) {
+    CHECK_NEAR(two_halves[i], full[i], 1e-5 * std::fabs(full[i]));
+  }
+}
+
+TEST_CASE(single_rate_step_keeps_the_tuned_process_noise) {
+  /* Gd*Q*Gd' with Gd = [dt dt^2/2; 1 dt; 0 1] and the variances scaled from the tuning period, as the filter was tuned
+   * with in simulations */
+  constexpr float32_t kDt = 0.01F;
+  kalman_filter_t filter = make_filter(kDt);
+  CHECK(!filter.exact_noise);
+  CHECK_NEAR(filter.GdQGd_T(0, 0), STD_NOISE_IMU * kDt * kDt + STD_NOISE_OFFSET * kDt * kDt * kDt * kDt / 4.0F, 1e-12);
+  CHECK_NEAR(filter.GdQGd_T(0, 1), STD_NOISE_IMU * kDt + STD_NOISE_OFFSET * kDt * kDt * kDt / 2.0F, 1e-10);
+  CHECK_NEAR(filter.GdQGd_T(1, 1), STD_NOISE_IMU + STD_NOISE_OFFSET * kDt * kDt, 1e-9);
+  CHECK_NEAR(filter.GdQGd_T(2, 2), STD_NOISE_OFFSET, 1e-12);
+
+  const Matrix<3, 3> GdQGd_T = filter.GdQGd_T;
+  const std::array<float32_t, 3> heights = {0.0F, 0.1F, -0.1F};
+  for (const float32_t height : heights) {
+    filter.measured_AGL = height;
+    filter.measured_AGL_updated = true;
+    kalman_step(&filter, READY);
+  }
+  for (uint8_t i = 0; i < 9; i++) {
+    CHECK(filter.GdQGd_T[i] == GdQGd_T[i]);
+  }
+}
+
+TEST_CASE(multi_rate_step_keeps_the_model_under_jitter) {
+  constexpr float32_t kDt = 0.002F;
+  kalman_filter_t filter = make_filter(kDt);
+  const std::array<float32_t, 4> accelerations = {0.0F, 0.0F, 0.0F, 0.0F};
+
+  /* The first multi-rate step replaces the tuned process noise by the exact one, even for the same step */
+  kalman_multi_rate_step(&filter, READY, accelerations.data(), accelerations.size(), kDt, false);
+  CHECK(filter.exact_noise);
+  CHECK(filter.dt == kDt);
+  CHECK_NEAR(filter.GdQGd_T(0, 0), kalman_exact_process_noise(kDt)(0, 0), 0.0);
+
+  const float32_t jitter = 0.5F * KALMAN_DT_TOLERANCE * kDt;
+  for (const float32_t dt : {kDt + jitter, kDt - jitter, kDt}) {
+    kalman_multi_rate_step(&filter, READY, accelerations.data(), accelerations.size(), dt, false);
+    CHECK(filter.dt == kDt);
+  }
+
+  /* A noticeable change of the step discretizes anew */
+  const float32_t dt = kDt * (1.0F + 2.0F * KALMAN_DT_TOLERANCE);
+  kalman_multi_rate_step(&filter, READY, accelerations.data(), accelerations.size(), dt, false);
+  CHECK(filter.dt == dt);
+  CHECK_NEAR(filter.Ad(0, 1), dt, 0.0);
+  CHECK_NEAR(filter.GdQGd_T(1, 1), kalman_exact_process_noise(dt)(1, 1), 0.0);
+}
@@ -0,0 +1,177 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/kalman_filter.hpp"
+#include "control/kalman_fixed.hpp"
+#include "flash/recorder.hpp"
+#include "test.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/* Replay of a flight log through the fixed point Kalman filter. A flight is estimated as on the target, recording the
+ * filter inputs as FILTERED_DATA_INFO and the estimate as FLIGHT_INFO. Feeding the recorded inputs and flight phases to
+ * a new filter has to reproduce every recorded estimate bit by bit, and the estimate of the whole flight has to match
+ * the hash recorded for it. The test is built a second time with -ffast-math, which rounds and contracts the float
+ * operations differently. */
+
+extern "C" {
+
+void log_raw(const char* /*format*/, ...) {}
+
+void log_log(int /*level*/, const char* /*file*/, int /*line*/, const char* /*format*/, ...) {}
+}
+
+bool get_error_by_tag(cats_error_e /*err*/) { return false; }
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+
+namespace {
+
+/* FNV-1a of the FLIGHT_INFO records of the flight */
+constexpr uint64_t kFlightHash = 0x3fceb94d9713317bU;
+
+struct LogEntry {
+  flight_fsm_e flight_state;
+  filtered_data_info_t input;
+  flight_info_t output;
+};
+
+/* Flight with integer kinematics, so that the inputs do not depend on the float settings either: 2 s on the pad,
+ * 2.5 s of thrust, coasting up to the apogee and 20 s under the drogue. The barometer is off by up to 1 m, the
+ * accelerometer by up to 1 m/s^2. */
+std::vector<LogEntry> make_flight_inputs() {
+  constexpr int32_t kStepMs = 8;
+  std::mt19937 generator{42U};
+  std::vector<LogEntry> log;
+  int64_t velocity_mm_s = 0;
+  int64_t height_um = 0;
+  for (int32_t step = 0;; step++) {
+    flight_fsm_e state = READY;
+    int32_t acceleration = 0;  // m/s^2
+    if (step >= 500) {
+      state = (step < 5 * 125 / 2 + 250) ? THRUSTING : COASTING;
+      acceleration = (state == THRUSTING) ? 60 : -12;
+      if ((state == COASTING) && (velocity_mm_s <= 0)) {
+        break;
+      }
+    }
+    velocity_mm_s += acceleration * kStepMs;
+    height_um += velocity_mm_s * kStepMs;
+    const auto height_mm = static_cast<int32_t>(height_um / 1000) + static_cast<int32_t>(generator() % 2001U) - 1000;
+    const int32_t acceleration_cm = acceleration * 100 + static_cast<int32_t>(generator() % 201U) - 100;
+    log.push_back({.flight_state = state,
+                   .input = {.filtered_altitude_AGL = static_cast<float32_t>(height_mm) * 0.001F,
+                             .filtered_acceleration = static_cast<float32_t>(acceleration_cm) * 0.01F},
+                   .output = {}});
+  }
+  for (int32_t step = 0; step < 20 * 125; step++) {
+    height_um -= 20 * 1000 * kStepMs;
+    const auto height_mm = static_cast<int32_t>(height_um / 1000) + static_cast<int32_t>(generator() % 2001U) - 1000;
+    log.push_back({.flight_state = DROGUE,
+                   .input = {.filtered_altitude_AGL = static_cast<float32_t>(height_mm) * 0.001F,
+                             .filtered_acceleration = 0.0F},
+                   .output = {}});
+  }
+  return log;
+}
+
+/* The Kalman part of StateEstimation::Run with USE_FIXED_POINT_ESTIMATION */
+void estimate(std::vector<LogEntry>* log) {
+  kalman_filter_t filter{};
+  filter.t_sampl = 1.0F / static_cast<float32_t>(global_control_sampling_freq);
+  kalman_fixed_t fixed{};
+  initialize_matrices(&filter);
+  initialize_kalman_fixed(&fixed, &filter);
+  flight_fsm_e previous_state = CALIBRATING;
+  for (LogEntry& entry : *log) {
+    if (entry.flight_state != previous_state) {
+      if (entry.flight_state == READY) {
+        reset_kalman(&filter);
+        reset_kalman_fixed(&fixed);
+      } else if (entry.flight_state == THRUSTING) {
+        soft_reset_kalman(&filter);
+        soft_reset_kalman_fixed(&fixed);
+      }
+      previous_state = entry.flight_state;
+    }
+    filter.measured_AGL = entry.input.filtered_altitude_AGL;
+    filter.measured_acceleration = entry.input.filtered_acceleration;
+    kalman_fixed_step(&fixed, &filter, entry.flight_state);
+    entry.output = {.height = filter.x_bar[0],
+                    .velocity = filter.x_bar[1],
+                    .acceleration = filter.measured_acceleration + filter.x_bar[2]};
+    if (entry.flight_state >= DROGUE) {
+      entry.output.acceleration = filter.x_bar[2];
+    }
+  }
+}
+
+uint64_t hash(const std::vector<LogEntry>& log) {
+  uint64_t result = 14695981039346656037U;
+  for (const LogEntry& entry : log) {
+    uint8_t bytes[sizeof(flight_info_t)];
+    std::memcpy(bytes, &entry.output, sizeof(bytes));
+    for (const uint8_t byte : bytes) {
+      result = (result ^ byte) * 1099511628211U;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST_CASE(replay_reproduces_the_recorded_estimate) {
+  std::vector<LogEntry> flight = make_flight_inputs();
+  estimate(&flight);
+
+  /* Only the recorded inputs and flight phases are replayed */
+  std::vector<LogEntry> replay = flight;
+  for (LogEntry& entry : replay) {
+    entry.output = {};
+  }
+  estimate(&replay);
+
+  uint32_t mismatches = 0U;
+  for (size_t i = 0; i < flight.size(); i++) {
+    mismatches += (std::memcmp(&flight[i].output, &replay[i].output, sizeof(flight_info_t)) != 0) ? 1U : 0U;
+  }
+  CHECK(mismatches == 0U);
+
+  std::printf("%zu steps, hash of the estimate 0x%016llx\n", flight.size(),
+              static_cast<unsigned long long>(hash(flight)));  // NOLINT(google-runtime-int)
+  CHECK(hash(flight) == kFlightHash);
+}
+
+TEST_CASE(follows_the_float_filter) {
+  std::vector<LogEntry> flight = make_flight_inputs();
+  estimate(&flight);
+
+  kalman_filter_t filter{};
+  filter.t_sampl = 1.0F / static_cast<float32_t>(global_control_sampling_freq);
+  initialize_matrices(&filter);
+  reset_kalman(&filter);
+  float32_t max_height_error = 0.0F;
+  float32_t max_velocity_error = 0.0F;
+  flight_fsm_e previous_state = READY;
+  for (const LogEntry& entry : flight) {
+    if ((entry.flight_state == THRUSTING) && (previous_state != THRUSTING)) {
+      soft_reset_kalman(&filter);
+    }
+    previous_state = entry.flight_state;
+    filter.measured_AGL = entry.input.filtered_altitude_AGL;
+    filter.measured_acceleration = entry.input.filtered_acceleration;
+    kalman_step(&filter, entry.flight_state);
+    max_height_error = std::max(max_height_error, std::fabs(filter.x_bar[0] - entry.output.height));
+    max_velocity_error = std::max(max_velocity_error, std::fabs(filter.x_bar[1] - entry.output.velocity));
+  }
+  std::printf("fixed point against float: height %.4f m, velocity %.4f m/s\n", static_cast<double>(max_height_error),
+              static_cast<double>(max_velocity_error));
+  CHECK(max_height_error < 0.05F);
+  CHECK(max_velocity_error < 0.05F);
+}
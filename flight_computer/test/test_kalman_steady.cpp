@@ -0,0 +1,71 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/kalman_filter.hpp"
+#include "test.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+/* The steady state table of the Kalman filter: every entry has to converge within the iteration limit and match the
+ * gain the full filter settles at for the same measurement noise. */
+
+extern "C" {
+
+void log_raw(const char* /*format*/, ...) {}
+
+void log_log(int /*level*/, const char* /*file*/, int /*line*/, const char* /*format*/, ...) {}
+}
+
+bool get_error_by_tag(cats_error_e /*err*/) { return false; }
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+
+namespace {
+
+/* Default control sampling rate */
+constexpr float32_t kSamplingPeriod = 1.0F / 125.0F;
+
+/* Steps of the full filter, far more than the recursion needs for the smallest gains */
+constexpr uint32_t kFullFilterSteps = 200000U;
+
+kalman_filter_t make_filter() {
+  kalman_filter_t filter{};
+  filter.t_sampl = kSamplingPeriod;
+  initialize_matrices(&filter);
+  return filter;
+}
+
+}  // namespace
+
+TEST_CASE(every_entry_converges_before_the_iteration_limit) {
+  const kalman_filter_t filter = make_filter();
+  uint32_t total = 0U;
+  for (const kalman_steady_state_t& entry : filter.steady_states) {
+    std::printf("R = %8.2f: %5u iterations, K = [%.6f %.6f %.3g]\n", static_cast<double>(entry.R), entry.iterations,
+                static_cast<double>(entry.K[0]), static_cast<double>(entry.K[1]), static_cast<double>(entry.K[2]));
+    CHECK(entry.iterations > 0U);
+    CHECK(entry.iterations < KALMAN_MAX_RICCATI_ITERATIONS);
+    total += entry.iterations;
+  }
+  std::printf("%u iterations in total\n", total);
+  CHECK_NEAR(filter.steady_states.front().R, STD_NOISE_BARO_INITIAL, 1e-3);
+  CHECK_NEAR(filter.steady_states.back().R, STD_NOISE_BARO, 1e-2);
+}
+
+TEST_CASE(tabulated_gain_matches_the_full_filter) {
+  const kalman_filter_t table = make_filter();
+  for (const kalman_steady_state_t& entry : table.steady_states) {
+    kalman_filter_t filter = make_filter();
+    filter.R = entry.R;
+    for (uint32_t i = 0U; i < kFullFilterSteps; i++) {
+      kalman_prediction(&filter);
+      kalman_update(&filter);
+    }
+    CHECK_NEAR(entry.K[0], filter.K[0], 1e-3 * filter.K[0]);
+    CHECK_NEAR(entry.K[1], filter.K[1], 1e-3 * filter.K[1]);
+    CHECK_NEAR(entry.P_bar[0], filter.P_bar[0], 1e-3 * filter.P_bar[0]);
+  }
+}
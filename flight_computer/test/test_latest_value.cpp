@@ -0,0 +1,122 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "test.hpp"
+#include "util/latest_value.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/* LatestValue under concurrent access: one writer thread publishes values as fast as it can while reader threads check
+ * every value they get. The host threads run truly in parallel, which exercises more interleavings than the preemption
+ * on the target. */
+
+namespace {
+
+/* Every word of a value holds the same sequence number, a torn value mixes two of them */
+struct Value {
+  std::array<uint32_t, 15> words;
+  uint16_t half;
+  uint8_t byte;
+};
+
+/* Duration of the stress test */
+constexpr std::chrono::milliseconds kStressTime{1000};
+constexpr size_t kNumReaders = 3U;
+
+Value make_value(uint32_t n) {
+  Value value{};
+  value.words.fill(n);
+  value.half = static_cast<uint16_t>(n);
+  value.byte = static_cast<uint8_t>(n);
+  return value;
+}
+
+bool is_consistent(const Value& value) {
+  const uint32_t n = value.words[0];
+  for (const uint32_t word : value.words) {
+    if (word != n) {
+      return false;
+    }
+  }
+  return (value.half == static_cast<uint16_t>(n)) && (value.byte == static_cast<uint8_t>(n));
+}
+
+}  // namespace
+
+TEST_CASE(single_thread_returns_the_latest_value) {
+  LatestValue<Value> channel;
+  CHECK(channel.GetWriteCount() == 1U);
+  CHECK(channel.Read().words[0] == 0U);
+  for (uint32_t n = 1U; n <= 5U; n++) {
+    channel.Write(make_value(n));
+    const Value value = channel.Read();
+    CHECK(is_consistent(value));
+    CHECK(value.words[0] == n);
+  }
+  CHECK(channel.GetWriteCount() == 6U);
+}
+
+TEST_CASE(readers_never_see_a_torn_value) {
+  LatestValue<Value> channel;
+  std::atomic<bool> done{false};
+  std::array<uint32_t, kNumReaders> torn{};
+  std::array<uint32_t, kNumReaders> backwards{};
+  std::array<uint32_t, kNumReaders> reads{};
+  std::array<uint32_t, kNumReaders> distinct{};
+
+  std::vector<std::thread> readers;
+  for (size_t r = 0U; r < kNumReaders; r++) {
+    readers.emplace_back([&, r] {
+      uint32_t last = 0U;
+      while (!done.load(std::memory_order_relaxed)) {
+        const Value value = channel.Read();
+        reads[r]++;
+        if (!is_consistent(value)) {
+          torn[r]++;
+          continue;
+        }
+        /* A single writer only ever moves forward */
+        if (value.words[0] < last) {
+          backwards[r]++;
+        }
+        distinct[r] += (value.words[0] != last) ? 1U : 0U;
+        last = value.words[0];
+      }
+    });
+  }
+
+  uint32_t num_writes = 0U;
+  std::thread writer([&] {
+    const auto end = std::chrono::steady_clock::now() + kStressTime;
+    while (std::chrono::steady_clock::now() < end) {
+      for (uint32_t k = 0U; k < 64U; k++) {
+        num_writes++;
+        channel.Write(make_value(num_writes));
+      }
+      /* Hand the core to the readers in case the host runs all threads on one core */
+      std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_relaxed);
+  });
+
+  writer.join();
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  for (size_t r = 0U; r < kNumReaders; r++) {
+    CHECK(torn[r] == 0U);
+    CHECK(backwards[r] == 0U);
+    CHECK(reads[r] > 0U);
+    std::printf("reader %zu: %u reads, %u distinct values\n", r, reads[r], distinct[r]);
+  }
+  std::printf("writer: %u writes\n", num_writes);
+  CHECK(channel.GetWriteCount() == num_writes + 1U);
+  CHECK(channel.Read().words[0] == num_writes);
+}
@@ -0,0 +1,421 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "test.hpp"
+#include "util/matrix.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <utility>
+
+/* The fixed-size Matrix against the arm_mat functions it replaced in the Kalman filter.
+ *
+ * With CMSIS_DSP_SOURCE set in CMake the CMSIS-DSP matrix functions are built for the host and used directly. Otherwise
+ * the ref_mat functions below stand in for them: they follow the generic C implementation of the CMSIS-DSP library,
+ * i.e. the same loop order and accumulation order, runtime dimensions and size checks, and Gauss-Jordan elimination
+ * with partial pivoting for the inverse. */
+
+#ifdef CATS_TEST_CMSIS_DSP
+#define REF_MAT(name) arm_mat_##name##_f32
+#else
+#define REF_MAT(name) ref_mat_##name##_f32
+
+namespace {
+
+void ref_mat_init_f32(arm_matrix_instance_f32* s, uint16_t rows, uint16_t cols, float32_t* data) {
+  s->numRows = rows;
+  s->numCols = cols;
+  s->pData = data;
+}
+
+arm_status ref_mat_mult_f32(const arm_matrix_instance_f32* a, const arm_matrix_instance_f32* b,
+                            arm_matrix_instance_f32* dst) {
+  if ((a->numCols != b->numRows) || (a->numRows != dst->numRows) || (b->numCols != dst->numCols)) {
+    return ARM_MATH_SIZE_MISMATCH;
+  }
+  for (uint16_t i = 0; i < a->numRows; i++) {
+    for (uint16_t j = 0; j < b->numCols; j++) {
+      float32_t sum = 0.0F;
+      for (uint16_t k = 0; k < a->numCols; k++) {
+        sum += a->pData[i * a->numCols + k] * b->pData[k * b->numCols + j];
+      }
+      dst->pData[i * dst->numCols + j] = sum;
+    }
+  }
+  return ARM_MATH_SUCCESS;
+}
+
+arm_status ref_mat_trans_f32(const arm_matrix_instance_f32* src, arm_matrix_instance_f32* dst) {
+  if ((src->numRows != dst->numCols) || (src->numCols != dst->numRows)) {
+    return ARM_MATH_SIZE_MISMATCH;
+  }
+  for (uint16_t i = 0; i < src->numRows; i++) {
+    for (uint16_t j = 0; j < src->numCols; j++) {
+      dst->pData[j * dst->numCols + i] = src->pData[i * src->numCols + j];
+    }
+  }
+  return ARM_MATH_SUCCESS;
+}
+
+arm_status ref_mat_add_f32(const arm_matrix_instance_f32* a, const arm_matrix_instance_f32* b,
+                           arm_matrix_instance_f32* dst) {
+  if ((a->numRows != b->numRows) || (a->numCols != b->numCols)) {
+    return ARM_MATH_SIZE_MISMATCH;
+  }
+  for (uint32_t i = 0; i < static_cast<uint32_t>(a->numRows * a->numCols); i++) {
+    dst->pData[i] = a->pData[i] + b->pData[i];
+  }
+  return ARM_MATH_SUCCESS;
+}
+
+arm_status ref_mat_sub_f32(const arm_matrix_instance_f32* a, const arm_matrix_instance_f32* b,
+                           arm_matrix_instance_f32* dst) {
+  if ((a->numRows != b->numRows) || (a->numCols != b->numCols)) {
+    return ARM_MATH_SIZE_MISMATCH;
+  }
+  for (uint32_t i = 0; i < static_cast<uint32_t>(a->numRows * a->numCols); i++) {
+    dst->pData[i] = a->pData[i] - b->pData[i];
+  }
+  return ARM_MATH_SUCCESS;
+}
+
+arm_status ref_mat_scale_f32(const arm_matrix_instance_f32* src, float32_t scale, arm_matrix_instance_f32* dst) {
+  for (uint32_t i = 0; i < static_cast<uint32_t>(src->numRows * src->numCols); i++) {
+    dst->pData[i] = src->pData[i] * scale;
+  }
+  return ARM_MATH_SUCCESS;
+}
+
+/* Gauss-Jordan elimination with partial pivoting, the source matrix is destroyed like in CMSIS-DSP */
+arm_status ref_mat_inverse_f32(const arm_matrix_instance_f32* src, arm_matrix_instance_f32* dst) {
+  const uint16_t n = src->numRows;
+  if ((n != src->numCols) || (dst->numRows != n) || (dst->numCols != n)) {
+    return ARM_MATH_SIZE_MISMATCH;
+  }
+  float32_t* a = src->pData;
+  float32_t* inv = dst->pData;
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t j = 0; j < n; j++) {
+      inv[i * n + j] = (i == j) ? 1.0F : 0.0F;
+    }
+  }
+  for (uint16_t col = 0; col < n; col++) {
+    uint16_t pivot = col;
+    for (uint16_t row = col + 1U; row < n; row++) {
+      if (std::fabs(a[row * n + col]) > std::fabs(a[pivot * n + col])) {
+        pivot = row;
+      }
+    }
+    if (a[pivot * n + col] == 0.0F) {
+      return ARM_MATH_SINGULAR;
+    }
+    for (uint16_t j = 0; j < n; j++) {
+      std::swap(a[pivot * n + j], a[col * n + j]);
+      std::swap(inv[pivot * n + j], inv[col * n + j]);
+    }
+    const float32_t scale = 1.0F / a[col * n + col];
+    for (uint16_t j = 0; j < n; j++) {
+      a[col * n + j] *= scale;
+      inv[col * n + j] *= scale;
+    }
+    for (uint16_t row = 0; row < n; row++) {
+      if (row == col) {
+        continue;
+      }
+      const float32_t factor = a[row * n + col];
+      for (uint16_t j = 0; j < n; j++) {
+        a[row * n + j] -= factor * a[col * n + j];
+        inv[row * n + j] -= factor * inv[col * n + j];
+      }
+    }
+  }
+  return ARM_MATH_SUCCESS;
+}
+
+}  // namespace
+#endif
+
+namespace {
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::mt19937 rng{1234U};
+
+template <uint8_t R, uint8_t C>
+Matrix<R, C> random_matrix() {
+  std::uniform_real_distribution<float32_t> dist{-10.0F, 10.0F};
+  Matrix<R, C> out{};
+  for (float32_t& value : out.data) {
+    value = dist(rng);
+  }
+  return out;
+}
+
+/* Random symmetric positive definite matrix, as a covariance */
+template <uint8_t N>
+Matrix<N, N> random_covariance() {
+  const Matrix<N, N> a = random_matrix<N, N>();
+  return a * a.Transpose() + Matrix<N, N>::Identity();
+}
+
+/* An arm_mat view of a copy of the data, the arm_mat functions take non-const pointers */
+template <uint8_t R, uint8_t C>
+struct ArmView {
+  explicit ArmView(const Matrix<R, C>& m) : data{m.data} { REF_MAT(init)(&instance, R, C, data.data()); }
+  ArmView() { REF_MAT(init)(&instance, R, C, data.data()); }
+  std::array<float32_t, R * C> data{};
+  arm_matrix_instance_f32 instance{};
+};
+
+template <uint8_t R, uint8_t C>
+float32_t max_abs(const std::array<float32_t, R * C>& values) {
+  float32_t out = 0.0F;
+  for (const float32_t value : values) {
+    out = std::max(out, std::fabs(value));
+  }
+  return out;
+}
+
+/* Checks the elements relative to the largest one, the accumulation order may differ in the last bits */
+template <uint8_t R, uint8_t C>
+void check_equal(const Matrix<R, C>& actual, const std::array<float32_t, R * C>& expected, float32_t rel_tol) {
+  const float32_t tol = rel_tol * std::max(max_abs<R, C>(expected), 1.0F);
+  for (size_t i = 0; i < R * C; i++) {
+    CHECK_NEAR(actual.data[i], expected[i], tol);
+  }
+}
+
+constexpr int kNumRandomCases = 100;
+
+}  // namespace
+
+TEST_CASE(multiply_matches_arm_mat_mult) {
+  for (int n = 0; n < kNumRandomCases; n++) {
+    const auto a = random_matrix<3, 3>();
+    const auto b = random_matrix<3, 3>();
+    const auto h = random_matrix<1, 3>();
+    const auto x = random_matrix<3, 1>();
+    const auto g = random_matrix<3, 2>();
+    const auto q = random_matrix<2, 2>();
+
+    ArmView<3, 3> ab;
+    ArmView<3, 3> av{a};
+    ArmView<3, 3> bv{b};
+    CHECK(REF_MAT(mult)(&av.instance, &bv.instance, &ab.instance) == ARM_MATH_SUCCESS);
+    /* Same accumulation order, the results only differ if the compiler contracted differently */
+    check_equal(a * b, ab.data, 1e-6F);
+
+    ArmView<1, 3> hb;
+    ArmView<1, 3> hv{h};
+    CHECK(REF_MAT(mult)(&hv.instance, &bv.instance, &hb.instance) == ARM_MATH_SUCCESS);
+    check_equal(h * b, hb.data, 1e-6F);
+
+    ArmView<3, 1> ax;
+    ArmView<3, 1> xv{x};
+    CHECK(REF_MAT(mult)(&av.instance, &xv.instance, &ax.instance) == ARM_MATH_SUCCESS);
+    check_equal(a * x, ax.data, 1e-6F);
+
+    ArmView<3, 2> gq;
+    ArmView<3, 2> gv{g};
+    ArmView<2, 2> qv{q};
+    CHECK(REF_MAT(mult)(&gv.instance, &qv.instance, &gq.instance) == ARM_MATH_SUCCESS);
+    check_equal(g * q, gq.data, 1e-6F);
+  }
+
+  /* The runtime size check that the template makes unnecessary */
+  ArmView<3, 3> a;
+  ArmView<1, 3> h;
+  ArmView<3, 3> out;
+  CHECK(REF_MAT(mult)(&a.instance, &h.instance, &out.instance) == ARM_MATH_SIZE_MISMATCH);
+}
+
+TEST_CASE(elementwise_operations_match_arm_mat) {
+  for (int n = 0; n < kNumRandomCases; n++) {
+    const auto a = random_matrix<3, 3>();
+    const auto b = random_matrix<3, 3>();
+    ArmView<3, 3> av{a};
+    ArmView<3, 3> bv{b};
+    ArmView<3, 3> out;
+
+    CHECK(REF_MAT(add)(&av.instance, &bv.instance, &out.instance) == ARM_MATH_SUCCESS);
+    check_equal(a + b, out.data, 0.0F);
+    CHECK(REF_MAT(sub)(&av.instance, &bv.instance, &out.instance) == ARM_MATH_SUCCESS);
+    check_equal(a - b, out.data, 0.0F);
+    CHECK(REF_MAT(scale)(&av.instance, 0.37F, &out.instance) == ARM_MATH_SUCCESS);
+    check_equal(a * 0.37F, out.data, 0.0F);
+    check_equal(0.37F * a, out.data, 0.0F);
+
+    ArmView<3, 3> at;
+    CHECK(REF_MAT(trans)(&av.instance, &at.instance) == ARM_MATH_SUCCESS);
+    check_equal(a.Transpose(), at.data, 0.0F);
+
+    const auto g = random_matrix<3, 2>();
+    ArmView<3, 2> gv{g};
+    ArmView<2, 3> gt;
+    CHECK(REF_MAT(trans)(&gv.instance, &gt.instance) == ARM_MATH_SUCCESS);
+    check_equal(g.Transpose(), gt.data, 0.0F);
+  }
+}
+
+TEST_CASE(symmetric_product_matches_arm_mat) {
+  for (int n = 0; n < kNumRandomCases; n++) {
+    const auto a = random_matrix<3, 3>();
+    const auto p = random_covariance<3>();
+    const auto h = random_matrix<1, 3>();
+
+    /* A * P * A^T as in the previous covariance propagation */
+    ArmView<3, 3> av{a};
+    ArmView<3, 3> pv{p};
+    ArmView<3, 3> at;
+    ArmView<3, 3> ap;
+    ArmView<3, 3> apat;
+    CHECK(REF_MAT(trans)(&av.instance, &at.instance) == ARM_MATH_SUCCESS);
+    CHECK(REF_MAT(mult)(&av.instance, &pv.instance, &ap.instance) == ARM_MATH_SUCCESS);
+    CHECK(REF_MAT(mult)(&ap.instance, &at.instance, &apat.instance) == ARM_MATH_SUCCESS);
+
+    const Matrix<3, 3> result = symmetric_product(a, p);
+    check_equal(result, apat.data, 1e-6F);
+    for (uint8_t i = 0; i < 3; i++) {
+      for (uint8_t j = 0; j < 3; j++) {
+        CHECK(result(i, j) == result(j, i));
+      }
+    }
+
+    /* H * P * H^T, the innovation covariance */
+    ArmView<1, 3> hv{h};
+    ArmView<3, 1> ht;
+    ArmView<1, 3> hp;
+    ArmView<1, 1> hpht;
+    CHECK(REF_MAT(trans)(&hv.instance, &ht.instance) == ARM_MATH_SUCCESS);
+    CHECK(REF_MAT(mult)(&hv.instance, &pv.instance, &hp.instance) == ARM_MATH_SUCCESS);
+    CHECK(REF_MAT(mult)(&hp.instance, &ht.instance, &hpht.instance) == ARM_MATH_SUCCESS);
+    check_equal(symmetric_product(h, p), hpht.data, 1e-6F);
+  }
+}
+
+TEST_CASE(symmetric_update_matches_arm_mat) {
+  for (int n = 0; n < kNumRandomCases; n++) {
+    const auto p = random_covariance<3>();
+    const auto k = random_matrix<3, 1>();
+    const auto h = random_matrix<1, 3>();
+    const Matrix<1, 3> hp = h * p;
+
+    /* P - K * (H * P) */
+    ArmView<3, 3> pv{p};
+    ArmView<3, 1> kv{k};
+    ArmView<1, 3> hpv{hp};
+    ArmView<3, 3> khp;
+    ArmView<3, 3> expected;
+    CHECK(REF_MAT(mult)(&kv.instance, &hpv.instance, &khp.instance) == ARM_MATH_SUCCESS);
+    CHECK(REF_MAT(sub)(&pv.instance, &khp.instance, &expected.instance) == ARM_MATH_SUCCESS);
+
+    /* Only the upper triangle is computed, the lower one is its mirror */
+    const Matrix<3, 3> result = symmetric_update(p, k, hp);
+    const float32_t tol = 1e-6F * std::max(max_abs<3, 3>(expected.data), 1.0F);
+    for (uint8_t i = 0; i < 3; i++) {
+      for (uint8_t j = i; j < 3; j++) {
+        CHECK_NEAR(result(i, j), expected.data[i * 3 + j], tol);
+        CHECK(result(j, i) == result(i, j));
+      }
+    }
+  }
+}
+
+TEST_CASE(inverse_matches_arm_mat_inverse) {
+  for (int n = 0; n < kNumRandomCases; n++) {
+    const auto a1 = random_covariance<1>();
+    const auto a2 = random_covariance<2>();
+    const auto a3 = random_covariance<3>();
+
+    Matrix<1, 1> inv1{};
+    Matrix<2, 2> inv2{};
+    Matrix<3, 3> inv3{};
+    CHECK(inverse(a1, inv1));
+    CHECK(inverse(a2, inv2));
+    CHECK(inverse(a3, inv3));
+
+    ArmView<1, 1> v1{a1};
+    ArmView<2, 2> v2{a2};
+    ArmView<3, 3> v3{a3};
+    ArmView<1, 1> ref1;
+    ArmView<2, 2> ref2;
+    ArmView<3, 3> ref3;
+    CHECK(REF_MAT(inverse)(&v1.instance, &ref1.instance) == ARM_MATH_SUCCESS);
+    CHECK(REF_MAT(inverse)(&v2.instance, &ref2.instance) == ARM_MATH_SUCCESS);
+    CHECK(REF_MAT(inverse)(&v3.instance, &ref3.instance) == ARM_MATH_SUCCESS);
+
+    /* Closed form and elimination round differently */
+    check_equal(inv1, ref1.data, 1e-6F);
+    check_equal(inv2, ref2.data, 1e-4F);
+    check_equal(inv3, ref3.data, 1e-4F);
+    check_equal(a3 * inv3, Matrix<3, 3>::Identity().data, 1e-4F);
+  }
+}
+
+TEST_CASE(inverse_rejects_a_singular_matrix) {
+  Matrix<3, 3> singular{};
+  singular.data = {1.0F, 2.0F, 3.0F, 2.0F, 4.0F, 6.0F, 0.0F, 1.0F, 1.0F};
+  Matrix<3, 3> out = Matrix<3, 3>::Identity();
+  CHECK(!inverse(singular, out));
+  /* The output is left unchanged */
+  check_equal(out, Matrix<3, 3>::Identity().data, 0.0F);
+
+  ArmView<3, 3> v{singular};
+  ArmView<3, 3> ref;
+  CHECK(REF_MAT(inverse)(&v.instance, &ref.instance) == ARM_MATH_SINGULAR);
+
+  Matrix<2, 2> zero{};
+  Matrix<2, 2> out2{};
+  CHECK(!inverse(zero, out2));
+}
+
+/* Time per call of the Kalman filter operations, with the template and with the arm_mat functions with runtime sizes.
+ * Only printed, the host timing says little about the target but shows the relative cost. */
+TEST_CASE(benchmark) {
+  constexpr int kIterations = 200000;
+  const auto a = random_matrix<3, 3>();
+  const auto p = random_covariance<3>();
+  volatile float32_t sink = 0.0F;
+
+  /* Every element of the result goes into the sink, the compiler could drop the others otherwise */
+  const auto sum_of = [](const auto& data) {
+    float32_t sum = 0.0F;
+    for (const float32_t value : data) {
+      sum += value;
+    }
+    return sum;
+  };
+
+  const auto time_ns = [](auto&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      function(i);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) /
+           kIterations;
+  };
+
+  const double template_ns = time_ns([&](int i) {
+    Matrix<3, 3> pi = p;
+    pi(0, 0) += static_cast<float32_t>(i) * 1e-9F;
+    sink = sink + sum_of(symmetric_product(a, pi).data);
+  });
+
+  ArmView<3, 3> av{a};
+  ArmView<3, 3> at;
+  ArmView<3, 3> ap;
+  ArmView<3, 3> apat;
+  const double arm_ns = time_ns([&](int i) {
+    ArmView<3, 3> pv{p};
+    pv.data[0] += static_cast<float32_t>(i) * 1e-9F;
+    REF_MAT(trans)(&av.instance, &at.instance);
+    REF_MAT(mult)(&av.instance, &pv.instance, &ap.instance);
+    REF_MAT(mult)(&ap.instance, &at.instance, &apat.instance);
+    sink = sink + sum_of(apat.data);
+  });
+
+  std::printf("A * P * A^T: Matrix %.1f ns, arm_mat %.1f ns\n", template_ns, arm_ns);
+  CHECK(std::isfinite(sink));
+}
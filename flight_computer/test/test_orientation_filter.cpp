@@ -0,0 +1,158 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "config/control_config.hpp"
+#include "control/orientation_filter.hpp"
+#include "test.hpp"
+
+#include <array>
+#include <cmath>
+
+/* The orientation filter against rotations with a closed form: constant angular velocities about a fixed axis and
+ * sequences of them. */
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint16_t global_control_sampling_freq = 125;
+
+/* Same as in math_util.cpp, which cannot be linked without the CMSIS-DSP matrix functions */
+void normalize_q(float32_t* input) {
+  const float32_t norm = sqrtf(input[0] * input[0] + input[1] * input[1] + input[2] * input[2] + input[3] * input[3]);
+  for (int i = 0; i < 4; i++) {
+    input[i] /= norm;
+  }
+}
+
+namespace {
+
+using Quaternion = std::array<double, 4>;
+
+constexpr double kPi = 3.14159265358979323846;
+
+/* Rotation by angle (rad) about the unit axis */
+Quaternion axis_angle(vf32_t axis, double angle) {
+  const double s = std::sin(angle / 2.0);
+  return {std::cos(angle / 2.0), s * axis.x, s * axis.y, s * axis.z};
+}
+
+Quaternion multiply(const Quaternion& a, const Quaternion& b) {
+  return {a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3], a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+          a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1], a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0]};
+}
+
+/* Rotate v from the reference frame into the body frame, q* ⊗ v ⊗ q */
+vf32_t to_body(const Quaternion& q, vf32_t v) {
+  const Quaternion conjugate = {q[0], -q[1], -q[2], -q[3]};
+  const Quaternion r = multiply(multiply(conjugate, {0.0, v.x, v.y, v.z}), q);
+  return {.x = static_cast<float32_t>(r[1]), .y = static_cast<float32_t>(r[2]), .z = static_cast<float32_t>(r[3])};
+}
+
+orientation_filter_t make_filter() {
+  orientation_filter_t filter{};
+  init_orientation_filter(&filter);
+  reset_orientation_filter(&filter);
+  return filter;
+}
+
+/* Rotate with the angular velocity (dps) for the given number of steps */
+void rotate(orientation_filter_t* filter, vf32_t angular_vel, uint32_t steps) {
+  for (uint32_t i = 0; i < steps; i++) {
+    quaternion_kinematics(filter, angular_vel);
+  }
+}
+
+/* q and -q are the same rotation */
+void check_quaternion(const orientation_filter_t& filter, const Quaternion& expected, double tolerance) {
+  const double sign = (expected[0] * filter.estimate_data[0] + expected[1] * filter.estimate_data[1] +
+                       expected[2] * filter.estimate_data[2] + expected[3] * filter.estimate_data[3]) < 0.0
+                          ? -1.0
+                          : 1.0;
+  for (size_t i = 0; i < 4; i++) {
+    CHECK_NEAR(filter.estimate_data[i], sign * expected[i], tolerance);
+  }
+}
+
+void check_vector(vf32_t actual, vf32_t expected, double tolerance) {
+  CHECK_NEAR(actual.x, expected.x, tolerance);
+  CHECK_NEAR(actual.y, expected.y, tolerance);
+  CHECK_NEAR(actual.z, expected.z, tolerance);
+}
+
+}  // namespace
+
+TEST_CASE(slow_rotation_about_each_axis) {
+  /* 90 dps for one second stays below the small angle threshold */
+  const std::array<vf32_t, 3> axes = {vf32_t{1.0F, 0.0F, 0.0F}, vf32_t{0.0F, 1.0F, 0.0F}, vf32_t{0.0F, 0.0F, 1.0F}};
+  for (const vf32_t& axis : axes) {
+    orientation_filter_t filter = make_filter();
+    rotate(&filter, {.x = 90.0F * axis.x, .y = 90.0F * axis.y, .z = 90.0F * axis.z}, global_control_sampling_freq);
+    const Quaternion expected = axis_angle(axis, kPi / 2.0);
+    check_quaternion(filter, expected, 1e-5);
+    check_vector(filter.up, to_body(expected, filter.up_reference), 1e-5);
+  }
+  /* Tilted by 90 degrees about x, the vertical points along y of the body */
+  orientation_filter_t filter = make_filter();
+  rotate(&filter, {.x = 90.0F, .y = 0.0F, .z = 0.0F}, global_control_sampling_freq);
+  check_vector(filter.up, {.x = 0.0F, .y = 1.0F, .z = 0.0F}, 1e-5);
+}
+
+TEST_CASE(fast_rotation_about_an_oblique_axis) {
+  /* 2000 dps is 0.28 rad per step, well above the small angle threshold */
+  const float32_t n = 1.0F / std::sqrt(14.0F);
+  const vf32_t axis = {.x = 1.0F * n, .y = -2.0F * n, .z = 3.0F * n};
+  constexpr float32_t kRate = 2000.0F;
+  constexpr uint32_t kSteps = 100U;
+  orientation_filter_t filter = make_filter();
+  rotate(&filter, {.x = kRate * axis.x, .y = kRate * axis.y, .z = kRate * axis.z}, kSteps);
+
+  const double angle = static_cast<double>(kRate) / 180.0 * kPi * kSteps / global_control_sampling_freq;
+  const Quaternion expected = axis_angle(axis, angle);
+  check_quaternion(filter, expected, 1e-4);
+  check_vector(filter.up, to_body(expected, filter.up_reference), 1e-4);
+}
+
+TEST_CASE(sequence_of_rotations_composes_in_the_body_frame) {
+  /* Roll by 90 degrees, then pitch by 45 degrees and yaw by 180 degrees about the axes of the rotated body */
+  orientation_filter_t filter = make_filter();
+  rotate(&filter, {.x = 90.0F, .y = 0.0F, .z = 0.0F}, global_control_sampling_freq);
+  rotate(&filter, {.x = 0.0F, .y = 45.0F, .z = 0.0F}, global_control_sampling_freq);
+  rotate(&filter, {.x = 0.0F, .y = 0.0F, .z = 180.0F}, global_control_sampling_freq);
+
+  const Quaternion expected =
+      multiply(multiply(axis_angle({1.0F, 0.0F, 0.0F}, kPi / 2.0), axis_angle({0.0F, 1.0F, 0.0F}, kPi / 4.0)),
+               axis_angle({0.0F, 0.0F, 1.0F}, kPi));
+  check_quaternion(filter, expected, 1e-5);
+  check_vector(filter.up, to_body(expected, filter.up_reference), 1e-5);
+}
+
+TEST_CASE(long_spin_keeps_the_norm) {
+  /* Ten minutes of a spinning and coning rocket */
+  orientation_filter_t filter = make_filter();
+  rotate(&filter, {.x = 3.0F, .y = -5.0F, .z = 720.0F}, 600U * global_control_sampling_freq);
+  const float32_t* q = filter.estimate_data;
+  CHECK_NEAR(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3], 1.0, 1e-5);
+  CHECK_NEAR(filter.up.x * filter.up.x + filter.up.y * filter.up.y + filter.up.z * filter.up.z, 1.0, 1e-4);
+}
+
+TEST_CASE(vertical_from_the_resting_acceleration) {
+  /* Rocket on a rail tilted by 30 degrees about y */
+  const double tilt = kPi / 6.0;
+  const vf32_t acc = {.x = static_cast<float32_t>(-GRAVITY * std::sin(tilt)),
+                      .y = 0.0F,
+                      .z = static_cast<float32_t>(GRAVITY * std::cos(tilt))};
+  orientation_filter_t filter{};
+  init_orientation_filter(&filter);
+  set_orientation_vertical(&filter, acc);
+  reset_orientation_filter(&filter);
+  check_vector(filter.up, {.x = acc.x / GRAVITY, .y = 0.0F, .z = acc.z / GRAVITY}, 1e-6);
+  CHECK_NEAR(vertical_acceleration(&filter, acc), GRAVITY, 1e-5);
+
+  /* Free fall does not change the vertical */
+  set_orientation_vertical(&filter, {.x = 0.1F, .y = 0.2F, .z = 0.3F});
+  reset_orientation_filter(&filter);
+  CHECK_NEAR(vertical_acceleration(&filter, acc), GRAVITY, 1e-5);
+
+  /* After pitching back by the tilt, the vertical is the z axis of the body */
+  rotate(&filter, {.x = 0.0F, .y = -30.0F, .z = 0.0F}, global_control_sampling_freq);
+  check_vector(filter.up, {.x = 0.0F, .y = 0.0F, .z = 1.0F}, 1e-5);
+}
@@ -0,0 +1,166 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "control/sensor_bank.hpp"
+#include "test.hpp"
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/* The health checks of the IMU banks: the accelerometer and the gyroscope of an IMU are judged on their own. */
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+/* Same limits as the VEGA target */
+sens_info_t acc_info[NUM_IMU] = {{.sens_type = SensorType::kAcc,
+                                  .conversion_to_SI = 9.81F / 1024.0F,
+                                  .upper_limit = 32.0F * 9.81F,
+                                  .lower_limit = -32.0F * 9.81F,
+                                  .resolution = 1.0F}};
+sens_info_t gyro_info[NUM_IMU] = {{.sens_type = SensorType::kGyro,
+                                   .conversion_to_SI = 0.07F,
+                                   .upper_limit = 2000.0F,
+                                   .lower_limit = -2000.0F,
+                                   .resolution = 1.0F}};
+sens_info_t baro_info[NUM_BARO] = {{.sens_type = SensorType::kBaro,
+                                    .conversion_to_SI = 1.0F,
+                                    .upper_limit = 200000.0F,
+                                    .lower_limit = 10.0F,
+                                    .resolution = 1.0F}};
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+namespace {
+
+using AccBank = SensorBank<AccBankTraits, NUM_IMU>;
+using GyroBank = SensorBank<GyroBankTraits, NUM_IMU>;
+
+imu_data_t make_sample(int16_t acc, int16_t gyro) {
+  return {.acc = {.x = acc, .y = 0, .z = 1024}, .gyro = {.x = gyro, .y = 0, .z = 0}};
+}
+
+/* Feeds the same sample to both banks and checks them, returns the fault masks */
+std::pair<uint32_t, uint32_t> step(AccBank& acc_bank, GyroBank& gyro_bank, const imu_data_t& sample) {
+  acc_bank.Set(0, sample);
+  gyro_bank.Set(0, sample);
+  return {acc_bank.Check(), gyro_bank.Check()};
+}
+
+}  // namespace
+
+TEST_CASE(gyro_beyond_nominal_range_keeps_accelerometer) {
+  AccBank acc_bank;
+  GyroBank gyro_bank;
+  /* 2200 dps and the negative raw full scale, both beyond the nominal 2000 dps */
+  int16_t acc = 0;
+  for (const int16_t raw : {static_cast<int16_t>(31429), static_cast<int16_t>(-32768)}) {
+    const auto [acc_faults, gyro_faults] = step(acc_bank, gyro_bank, make_sample(++acc, raw));
+    CHECK(acc_faults == 0U);
+    CHECK(gyro_faults == 1U);
+  }
+  const auto [acc_faults, gyro_faults] = step(acc_bank, gyro_bank, make_sample(++acc, 28571));
+  CHECK(acc_faults == 0U);
+  CHECK(gyro_faults == 0U);
+  GyroBank::channels_t gyro{};
+  CHECK(gyro_bank.Fuse(gyro));
+  CHECK_NEAR(gyro[0], 28571 * 0.07F, 1e-3);
+}
+
+TEST_CASE(frozen_accelerometer_keeps_gyroscope) {
+  AccBank acc_bank;
+  GyroBank gyro_bank;
+  uint32_t acc_faults = 0U;
+  uint32_t gyro_faults = 0U;
+  for (int16_t k = 0; k <= MAX_NUM_SAME_VALUE + 1; k++) {
+    std::tie(acc_faults, gyro_faults) = step(acc_bank, gyro_bank, make_sample(100, k));
+  }
+  CHECK(acc_faults == 1U);
+  CHECK(gyro_faults == 0U);
+  CHECK(!acc_bank.IsHealthy(0));
+  CHECK(gyro_bank.IsHealthy(0));
+
+  AccBank::channels_t acc{};
+  GyroBank::channels_t gyro{};
+  CHECK(!acc_bank.Fuse(acc));
+  CHECK(gyro_bank.Fuse(gyro));
+  CHECK_NEAR(gyro[0], (MAX_NUM_SAME_VALUE + 1) * 0.07F, 1e-4);
+
+  /* A changing value makes it healthy again */
+  std::tie(acc_faults, gyro_faults) = step(acc_bank, gyro_bank, make_sample(101, 0));
+  CHECK(acc_faults == 0U);
+  CHECK(acc_bank.Fuse(acc));
+}
+
+TEST_CASE(frozen_gyroscope_keeps_accelerometer) {
+  AccBank acc_bank;
+  GyroBank gyro_bank;
+  uint32_t acc_faults = 0U;
+  uint32_t gyro_faults = 0U;
+  for (int16_t k = 0; k <= MAX_NUM_SAME_VALUE + 1; k++) {
+    std::tie(acc_faults, gyro_faults) = step(acc_bank, gyro_bank, make_sample(k, 5));
+  }
+  CHECK(acc_faults == 0U);
+  CHECK(gyro_faults == 1U);
+
+  AccBank::channels_t acc{};
+  GyroBank::channels_t gyro{};
+  CHECK(acc_bank.Fuse(acc));
+  CHECK(!gyro_bank.Fuse(gyro));
+  CHECK_NEAR(acc[2], 9.81F, 1e-4);
+}
+
+namespace {
+
+/* A single channel triple with limits and a scale that do not divide evenly */
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+sens_info_t odd_info = {.sens_type = SensorType::kAcc,
+                        .conversion_to_SI = 0.0478F,
+                        .upper_limit = 3.3F,
+                        .lower_limit = -7.1F,
+                        .resolution = 1.0F};
+
+struct OddBankTraits {
+  using sample_t = vi16_t;
+  using raw_t = int16_t;
+  static constexpr uint8_t kNumChannels = 3;
+
+  static void Split(const sample_t& sample, raw_t (&raw)[kNumChannels]) {
+    raw[0] = sample.x;
+    raw[1] = sample.y;
+    raw[2] = sample.z;
+  }
+
+  static const sens_info_t& GetInfo(uint8_t /*channel*/, uint8_t /*index*/) { return odd_info; }
+};
+
+/* Checks every raw value of the x channel in raw units against the bounds check in SI units */
+template <typename Traits>
+uint32_t count_bound_mismatches(const sens_info_t& info) {
+  static_assert(SensorBank<Traits, 1>::kInt16Triple);
+  SensorBank<Traits, 1> bank;
+  uint32_t mismatches = 0U;
+  for (int32_t raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+    const float32_t value = static_cast<float32_t>(raw) * info.conversion_to_SI;
+    const bool out_of_bounds = (value > info.upper_limit) || (value < info.lower_limit);
+    typename Traits::sample_t sample{};
+    if constexpr (std::is_same_v<typename Traits::sample_t, imu_data_t>) {
+      sample.acc.x = static_cast<int16_t>(raw);
+      sample.gyro.x = static_cast<int16_t>(raw);
+    } else {
+      sample.x = static_cast<int16_t>(raw);
+    }
+    bank.Set(0, sample);
+    /* The value changes every step, only the bounds can make the sensor faulty */
+    mismatches += ((bank.Check() != 0U) != out_of_bounds) ? 1U : 0U;
+  }
+  return mismatches;
+}
+
+}  // namespace
+
+TEST_CASE(raw_bounds_match_the_si_bounds) {
+  CHECK(count_bound_mismatches<AccBankTraits>(acc_info[0]) == 0U);
+  CHECK(count_bound_mismatches<GyroBankTraits>(gyro_info[0]) == 0U);
+  CHECK(count_bound_mismatches<OddBankTraits>(odd_info) == 0U);
+}
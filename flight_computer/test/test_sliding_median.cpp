@@ -0,0 +1,218 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "test.hpp"
+#include "util/sliding_median.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+/* SlidingMedian against the median of a sorted copy of the window, and against the filter it replaced: a ring buffer
+ * whose median was selected from a copy with quickselect, or with a sorting network for nine values. */
+
+namespace {
+
+constexpr size_t kMaxLength = 63U;
+
+/* Median of the window by sorting, the upper of the two middle values for an even length */
+float brute_force_median(std::vector<float> window) {
+  std::sort(window.begin(), window.end());
+  return window[window.size() / 2U];
+}
+
+/* The median function of data_processing.cpp before the SlidingMedian, with the window length as a parameter */
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+float old_median(const float* input_array, int32_t size) {
+  float array[kMaxLength];
+  std::copy(input_array, input_array + size, array);
+  float tmp = 0.0F;
+  const auto swap = [&tmp](float& a, float& b) {
+    tmp = a;
+    a = b;
+    b = tmp;
+  };
+  const auto sort_two = [&swap](float& a, float& b) {
+    if (a > b) {
+      swap(a, b);
+    }
+  };
+
+  if (size == 9) {
+    sort_two(array[1], array[2]);
+    sort_two(array[4], array[5]);
+    sort_two(array[7], array[8]);
+    sort_two(array[0], array[1]);
+    sort_two(array[3], array[4]);
+    sort_two(array[6], array[7]);
+    sort_two(array[1], array[2]);
+    sort_two(array[4], array[5]);
+    sort_two(array[7], array[8]);
+    sort_two(array[0], array[3]);
+    sort_two(array[5], array[8]);
+    sort_two(array[4], array[7]);
+    sort_two(array[3], array[6]);
+    sort_two(array[1], array[4]);
+    sort_two(array[2], array[5]);
+    sort_two(array[4], array[7]);
+    sort_two(array[4], array[2]);
+    sort_two(array[6], array[4]);
+    sort_two(array[4], array[2]);
+    return array[4];
+  }
+
+  const int32_t k = size >> 1U;
+  int32_t l = 0;
+  int32_t r = size - 1;
+  while (r > l + 1) {
+    const int32_t m = (l + r) >> 1U;
+    swap(array[m], array[l + 1]);
+    sort_two(array[l], array[r]);
+    sort_two(array[l + 1], array[r]);
+    sort_two(array[l], array[l + 1]);
+
+    int32_t i = l + 1;
+    int32_t j = r;
+    const float a = array[l + 1];
+    while (true) {
+      i++;
+      j--;
+      while (array[i] < a) {
+        i++;
+      }
+      while (array[j] > a) {
+        j--;
+      }
+      if (j < i) {
+        break;
+      }
+      swap(array[i], array[j]);
+    }
+    array[l + 1] = array[j];
+    array[j] = a;
+
+    if (j >= k) {
+      r = j - 1;
+    }
+    if (j <= k) {
+      l = i;
+    }
+  }
+  if (r == l + 1) {
+    sort_two(array[l], array[r]);
+  }
+  return array[k];
+}
+
+/* Ring buffer of the old filter */
+class OldMedianFilter {
+ public:
+  explicit OldMedianFilter(size_t length) : m_data(length, 0.0F) {}
+
+  float Add(float value) {
+    m_data[m_counter] = value;
+    m_counter = (m_counter + 1U) % m_data.size();
+    return old_median(m_data.data(), static_cast<int32_t>(m_data.size()));
+  }
+
+ private:
+  std::vector<float> m_data;
+  size_t m_counter = 0U;
+};
+
+/* Barometer like signal: a slow ramp with noise, outliers and runs of equal values */
+std::vector<float> make_signal(size_t size, uint32_t seed) {
+  std::mt19937 generator{seed};
+  std::normal_distribution<float> noise{0.0F, 1.0F};
+  std::uniform_int_distribution<int> event{0, 99};
+  std::vector<float> signal(size);
+  float held = 0.0F;
+  for (size_t i = 0U; i < size; i++) {
+    const int e = event(generator);
+    if (e < 3) {
+      signal[i] = 1000.0F * noise(generator);
+    } else if (e < 10) {
+      signal[i] = held;
+    } else {
+      signal[i] = 0.01F * static_cast<float>(i) + noise(generator);
+      held = std::round(signal[i]);
+    }
+  }
+  return signal;
+}
+
+}  // namespace
+
+TEST_CASE(matches_the_sorted_window) {
+  for (size_t length = 3U; length <= kMaxLength; length++) {
+    const std::vector<float> signal = make_signal(2000U, static_cast<uint32_t>(length));
+    SlidingMedian<float, kMaxLength> median{length};
+    CHECK(median.GetLength() == length);
+    std::vector<float> window(length, 0.0F);
+    uint32_t mismatches = 0U;
+    for (size_t i = 0U; i < signal.size(); i++) {
+      window[i % length] = signal[i];
+      if (median.Add(signal[i]) != brute_force_median(window)) {
+        mismatches++;
+      }
+    }
+    if (mismatches != 0U) {
+      std::printf("length %zu: %u mismatches\n", length, mismatches);
+    }
+    CHECK(mismatches == 0U);
+  }
+}
+
+TEST_CASE(matches_the_old_filter) {
+  for (size_t length = 3U; length <= kMaxLength; length += 2U) {
+    const std::vector<float> signal = make_signal(2000U, 1000U + static_cast<uint32_t>(length));
+    SlidingMedian<float, kMaxLength> median{length};
+    OldMedianFilter old{length};
+    uint32_t mismatches = 0U;
+    for (const float value : signal) {
+      mismatches += (median.Add(value) != old.Add(value)) ? 1U : 0U;
+    }
+    CHECK(mismatches == 0U);
+  }
+}
+
+TEST_CASE(length_is_clamped) {
+  CHECK((SlidingMedian<float, 9>{1U}.GetLength() == 3U));
+  CHECK((SlidingMedian<float, 9>{100U}.GetLength() == 9U));
+}
+
+TEST_CASE(benchmark) {
+  constexpr size_t kSamples = 200000U;
+  const std::vector<float> signal = make_signal(kSamples, 7U);
+  volatile float sink = 0.0F;
+
+  const auto time_ns = [&signal](auto&& filter) {
+    const auto start = std::chrono::steady_clock::now();
+    float sum = 0.0F;
+    for (const float value : signal) {
+      sum += filter.Add(value);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::make_pair(
+        static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / kSamples,
+        sum);
+  };
+
+  std::printf("length  SlidingMedian  old filter\n");
+  for (const size_t length : {5U, 9U, 11U, 15U, 23U, 31U, 47U, 63U}) {
+    SlidingMedian<float, kMaxLength> median{length};
+    OldMedianFilter old{length};
+    const auto [median_ns, median_sum] = time_ns(median);
+    const auto [old_ns, old_sum] = time_ns(old);
+    std::printf("%6zu  %10.1f ns  %7.1f ns\n", length, median_ns, old_ns);
+    CHECK(median_sum == old_sum);
+    sink = sink + median_sum;
+  }
+  CHECK(std::isfinite(sink));
+}
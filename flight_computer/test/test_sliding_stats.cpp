@@ -0,0 +1,278 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "test.hpp"
+#include "util/sliding_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <random>
+#include <vector>
+
+/* SlidingStats, SlidingMaximum, SlidingMinimum and SlidingSlope against the statistics of a copy of the window, over
+ * streams long enough for the running sums to be summed up again many times. */
+
+namespace {
+
+constexpr size_t kMaxLength = 125U;
+
+/* Innovation like signal: noise around an offset which jumps now and then, with outliers and runs of equal values */
+std::vector<float> make_signal(size_t size, uint32_t seed) {
+  std::mt19937 generator{seed};
+  std::normal_distribution<float> noise{0.0F, 1.0F};
+  std::uniform_int_distribution<int> event{0, 99};
+  std::vector<float> signal(size);
+  float offset = 0.0F;
+  for (size_t i = 0U; i < size; i++) {
+    const int e = event(generator);
+    if (e < 1) {
+      offset = 100.0F * noise(generator);
+    }
+    if (e < 3) {
+      signal[i] = offset + 1000.0F * noise(generator);
+    } else if ((e < 10) && (i > 0U)) {
+      signal[i] = signal[i - 1U];
+    } else {
+      signal[i] = offset + noise(generator);
+    }
+  }
+  return signal;
+}
+
+double brute_force_mean(const std::deque<float>& window) {
+  double sum = 0.0;
+  for (const float value : window) {
+    sum += static_cast<double>(value);
+  }
+  return sum / static_cast<double>(window.size());
+}
+
+double brute_force_variance(const std::deque<float>& window) {
+  const double mean = brute_force_mean(window);
+  double sum = 0.0;
+  for (const float value : window) {
+    sum += (static_cast<double>(value) - mean) * (static_cast<double>(value) - mean);
+  }
+  return sum / static_cast<double>(window.size());
+}
+
+/* Least squares slope through the window, with the positions 0 to n - 1 */
+double brute_force_slope(const std::deque<float>& window) {
+  const auto n = static_cast<double>(window.size());
+  const double x_mean = (n - 1.0) / 2.0;
+  const double y_mean = brute_force_mean(window);
+  double xy = 0.0;
+  double xx = 0.0;
+  for (size_t i = 0U; i < window.size(); i++) {
+    const double x = static_cast<double>(i) - x_mean;
+    xy += x * (static_cast<double>(window[i]) - y_mean);
+    xx += x * x;
+  }
+  return xy / xx;
+}
+
+/* Slides the window over the signal, the brute force statistics are computed on the values in it */
+template <typename Check>
+void slide(const std::vector<float>& signal, size_t length, Check check) {
+  std::deque<float> window;
+  for (size_t i = 0U; i < signal.size(); i++) {
+    window.push_back(signal[i]);
+    if (window.size() > length) {
+      window.pop_front();
+    }
+    check(i, window);
+  }
+}
+
+/* Largest magnitude since the running sums were last summed up again, at most two window lengths ago. The rounding
+ * errors of the removed values scale with it until then. */
+double magnitude(const std::vector<float>& signal, size_t index, size_t length) {
+  double result = 1.0;
+  for (size_t i = (index + 1U > 2U * length) ? index + 1U - 2U * length : 0U; i <= index; i++) {
+    result = std::max(result, std::fabs(static_cast<double>(signal[i])));
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST_CASE(stats_match_the_window) {
+  for (const size_t length : {2U, 3U, 7U, 10U, 50U, 64U, 125U}) {
+    const std::vector<float> signal = make_signal(5000U, static_cast<uint32_t>(length));
+    SlidingStats<float, kMaxLength> stats{length};
+    double worst_mean_error = 0.0;
+    double worst_variance_error = 0.0;
+    uint32_t count_mismatches = 0U;
+    slide(signal, length, [&](size_t i, const std::deque<float>& window) {
+      stats.Add(signal[i]);
+      const bool full = window.size() == length;
+      count_mismatches += ((stats.GetCount() != window.size()) || (stats.IsFull() != full)) ? 1U : 0U;
+      const double scale = magnitude(signal, i, length);
+      const double mean_error = std::fabs(static_cast<double>(stats.GetMean()) - brute_force_mean(window)) / scale;
+      const double variance_error =
+          std::fabs(static_cast<double>(stats.GetVariance()) - brute_force_variance(window)) / (scale * scale);
+      worst_mean_error = std::max(worst_mean_error, mean_error);
+      worst_variance_error = std::max(worst_variance_error, variance_error);
+    });
+    std::printf("length %3zu: mean error %.1e, variance error %.1e\n", length, worst_mean_error, worst_variance_error);
+    CHECK(count_mismatches == 0U);
+    CHECK(worst_mean_error < 1e-5);
+    CHECK(worst_variance_error < 1e-5);
+  }
+}
+
+TEST_CASE(stats_of_a_constant_stream) {
+  SlidingStats<float, 10> stats{10U};
+  CHECK(stats.GetMean() == 0.0F);
+  CHECK(stats.GetVariance() == 0.0F);
+  for (uint32_t i = 0U; i < 1000U; i++) {
+    stats.Add(0.1F);
+    CHECK(stats.GetVariance() >= 0.0F);
+  }
+  CHECK_NEAR(stats.GetMean(), 0.1, 1e-7);
+  CHECK_NEAR(stats.GetVariance(), 0.0, 1e-12);
+
+  stats.Reset(4U);
+  CHECK(stats.GetCount() == 0U);
+  CHECK(!stats.IsFull());
+  for (const float value : {1.0F, 2.0F, 3.0F, 4.0F, 5.0F}) {
+    stats.Add(value);
+  }
+  CHECK(stats.IsFull());
+  CHECK(stats.GetMean() == 3.5F);
+  CHECK(stats.GetVariance() == 1.25F);
+}
+
+TEST_CASE(maximum_matches_the_window) {
+  for (size_t length = 1U; length <= kMaxLength; length++) {
+    const std::vector<float> signal = make_signal(2000U, 1000U + static_cast<uint32_t>(length));
+    SlidingMaximum<float, kMaxLength> maximum{length};
+    uint32_t mismatches = 0U;
+    slide(signal, length, [&](size_t i, const std::deque<float>& window) {
+      maximum.Add(signal[i]);
+      const bool full = window.size() == length;
+      mismatches += ((maximum.Get() != *std::max_element(window.begin(), window.end())) || (maximum.IsFull() != full))
+                        ? 1U
+                        : 0U;
+    });
+    if (mismatches != 0U) {
+      std::printf("length %zu: %u mismatches\n", length, mismatches);
+    }
+    CHECK(mismatches == 0U);
+  }
+}
+
+TEST_CASE(minimum_matches_the_window) {
+  for (size_t length = 1U; length <= kMaxLength; length++) {
+    const std::vector<float> signal = make_signal(2000U, 2000U + static_cast<uint32_t>(length));
+    SlidingMinimum<float, kMaxLength> minimum{length};
+    uint32_t mismatches = 0U;
+    slide(signal, length, [&](size_t i, const std::deque<float>& window) {
+      minimum.Add(signal[i]);
+      const bool full = window.size() == length;
+      mismatches += ((minimum.Get() != *std::min_element(window.begin(), window.end())) || (minimum.IsFull() != full))
+                        ? 1U
+                        : 0U;
+    });
+    if (mismatches != 0U) {
+      std::printf("length %zu: %u mismatches\n", length, mismatches);
+    }
+    CHECK(mismatches == 0U);
+  }
+}
+
+TEST_CASE(slope_matches_the_window) {
+  for (const size_t length : {2U, 3U, 7U, 10U, 50U, 64U, 125U}) {
+    const std::vector<float> signal = make_signal(5000U, 3000U + static_cast<uint32_t>(length));
+    SlidingSlope<float, kMaxLength> slope{length};
+    double worst_error = 0.0;
+    uint32_t full_mismatches = 0U;
+    slide(signal, length, [&](size_t i, const std::deque<float>& window) {
+      slope.Add(signal[i]);
+      full_mismatches += (slope.IsFull() != (window.size() == length)) ? 1U : 0U;
+      if (window.size() < 2U) {
+        CHECK(slope.GetSlope() == 0.0F);
+        return;
+      }
+      const double error = std::fabs(static_cast<double>(slope.GetSlope()) - brute_force_slope(window)) /
+                           magnitude(signal, i, length);
+      worst_error = std::max(worst_error, error);
+    });
+    std::printf("length %3zu: slope error %.1e\n", length, worst_error);
+    CHECK(full_mismatches == 0U);
+    CHECK(worst_error < 1e-5);
+  }
+}
+
+TEST_CASE(slope_of_a_climb_far_from_zero) {
+  /* A height near apogee: the slope of a few meters per window has to come out of sums of thousands of meters */
+  SlidingSlope<float, 251> slope{76U};
+  for (uint32_t i = 0U; i < 1000U; i++) {
+    const float t = static_cast<float>(i) * 0.004F;
+    slope.Add(3000.0F + 20.0F * t - 4.905F * t * t);
+  }
+  /* The center of the last window lies 37.5 steps before its end, the velocity there is 20 - 9.81 * t */
+  const double t_center = (999.0 - 37.5) * 0.004;
+  CHECK_NEAR(static_cast<double>(slope.GetSlope()) / 0.004, 20.0 - 9.81 * t_center, 0.05);
+  CHECK(slope.GetSlope() < 0.0F);
+
+  slope.Reset(3U);
+  CHECK(!slope.IsFull());
+  for (const float value : {5.0F, 1.0F, 2.0F, 3.0F}) {
+    slope.Add(value);
+  }
+  CHECK(slope.IsFull());
+  CHECK(slope.GetSlope() == 1.0F);
+}
+
+TEST_CASE(maximum_with_infinite_margins) {
+  /* A margin which is never met, as the flight state machine adds it for NaN, has to stay for the whole window */
+  SlidingMaximum<float, 8> maximum{4U};
+  CHECK(maximum.Get() == 0.0F);
+  for (uint32_t i = 0U; i < 4U; i++) {
+    maximum.Add(-1.0F);
+  }
+  CHECK(maximum.Get() == -1.0F);
+  maximum.Add(std::numeric_limits<float>::infinity());
+  for (uint32_t i = 0U; i < 3U; i++) {
+    maximum.Add(-1.0F);
+    CHECK(std::isinf(maximum.Get()));
+  }
+  maximum.Add(-1.0F);
+  CHECK(maximum.Get() == -1.0F);
+}
+
+TEST_CASE(length_is_clamped) {
+  SlidingStats<float, 9> shortest{0U};
+  shortest.Add(1.0F);
+  CHECK(!shortest.IsFull());
+  shortest.Add(3.0F);
+  CHECK(shortest.IsFull());
+  CHECK(shortest.GetVariance() == 1.0F);
+
+  SlidingStats<float, 9> stats{100U};
+  for (uint32_t i = 0U; i < 20U; i++) {
+    stats.Add(static_cast<float>(i));
+  }
+  CHECK(stats.GetCount() == 9U);
+  CHECK(stats.GetMean() == 15.0F);
+
+  SlidingMaximum<float, 9> maximum{0U};
+  maximum.Add(2.0F);
+  CHECK(maximum.IsFull());
+  maximum.Add(1.0F);
+  CHECK(maximum.Get() == 1.0F);
+
+  SlidingSlope<float, 9> slope{0U};
+  slope.Add(1.0F);
+  CHECK(!slope.IsFull());
+  CHECK(slope.GetSlope() == 0.0F);
+  slope.Add(3.0F);
+  CHECK(slope.IsFull());
+  CHECK(slope.GetSlope() == 2.0F);
+}
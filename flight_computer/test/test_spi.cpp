@@ -0,0 +1,361 @@
+/// Copyright (C) 2020, 2024 Control and Telemetry Systems GmbH
+///
+/// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "drivers/spi.hpp"
+#include "test.hpp"
+#include "util/task_util.hpp"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+/* The transaction queue of driver::Spi against a mock HAL. The mock records the transfers that were put on the bus,
+ * the tests complete them by calling the HAL callbacks like the DMA interrupt does. */
+
+using driver::Spi;
+
+namespace {
+
+struct StartedTransfer {
+  const uint8_t* tx;
+  uint8_t* rx;
+  uint16_t length;
+  /* Value written to BSRR last, i.e. the chip select state when the transfer started */
+  uint32_t cs_bsrr;
+};
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+SPI_HandleTypeDef spi_handle{};
+GPIO_TypeDef gpio{};
+std::vector<StartedTransfer> started;
+HAL_StatusTypeDef start_status = HAL_OK;
+uint32_t abort_count = 0U;
+uint32_t notify_count = 0U;
+uint32_t tick = 0U;
+int32_t critical_nesting = 0;
+/* Critical section nesting while the last abort ran */
+int32_t abort_nesting = 0;
+/* Called while a transfer is aborted, emulates what the other threads and interrupts do in the meantime */
+std::function<void()> on_abort;
+/* Called while a thread waits for a thread flag, emulates what happens on the bus in the meantime */
+std::function<void()> on_wait;
+int thread_dummy = 0;
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+constexpr uint16_t kCsPin = 3U;
+constexpr uint32_t kCsHigh = 1U << kCsPin;
+constexpr uint32_t kCsLow = kCsHigh << 16U;
+constexpr uint32_t kTimeout = 5U;
+
+HAL_StatusTypeDef record_start(const uint8_t* tx, uint8_t* rx, uint16_t length) {
+  started.push_back({tx, rx, length, gpio.BSRR});
+  return start_status;
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+Spi spi{&spi_handle, kTimeout};
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+driver::OutputPin cs{&gpio, kCsPin};
+
+void reset_mocks() {
+  started.clear();
+  start_status = HAL_OK;
+  abort_count = 0U;
+  abort_nesting = 0;
+  notify_count = 0U;
+  on_wait = nullptr;
+  on_abort = nullptr;
+  gpio.BSRR = 0U;
+}
+
+void complete(bool success) {
+  if (success) {
+    HAL_SPI_TxRxCpltCallback(&spi_handle);
+  } else {
+    HAL_SPI_ErrorCallback(&spi_handle);
+  }
+}
+
+Spi::Transaction make_transaction(Spi::Priority priority, const uint8_t* tx) {
+  return {.cs = &cs, .tx = tx, .rx = nullptr, .length = 1U, .priority = priority};
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+volatile bool rtos_started = true;
+
+extern "C" {
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* /*hspi*/, uint8_t* /*pData*/, uint16_t /*Size*/,
+                                   uint32_t /*Timeout*/) {
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* /*hspi*/, uint8_t* /*pTxData*/, uint8_t* /*pRxData*/,
+                                          uint16_t /*Size*/, uint32_t /*Timeout*/) {
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* /*hspi*/, uint8_t* pData, uint16_t Size) {
+  return record_start(pData, nullptr, Size);
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef* /*hspi*/, uint8_t* pTxData, uint8_t* pRxData,
+                                              uint16_t Size) {
+  return record_start(pTxData, pRxData, Size);
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef* /*hspi*/) {
+  abort_count++;
+  abort_nesting = critical_nesting;
+  if (on_abort) {
+    on_abort();
+  }
+  return HAL_OK;
+}
+
+osThreadId_t osThreadGetId() { return &thread_dummy; }
+
+uint32_t osThreadFlagsSet(osThreadId_t /*thread_id*/, uint32_t flags) {
+  if ((flags & THREAD_FLAG_SPI_DONE) != 0U) {
+    notify_count++;
+  }
+  return flags;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t /*options*/, uint32_t timeout) {
+  if (on_wait) {
+    on_wait();
+  } else {
+    tick += timeout;
+  }
+  return flags;
+}
+
+uint32_t osKernelGetTickCount() { return tick; }
+
+void vPortEnterCritical() { critical_nesting++; }
+
+void vPortExitCritical() { critical_nesting--; }
+}
+
+TEST_CASE(higher_priority_starts_first) {
+  reset_mocks();
+  const std::array<uint8_t, 4> tx = {1U, 2U, 3U, 4U};
+  Spi::Transaction first = make_transaction(Spi::Priority::kLow, &tx[0]);
+  Spi::Transaction low = make_transaction(Spi::Priority::kLow, &tx[1]);
+  Spi::Transaction medium = make_transaction(Spi::Priority::kMedium, &tx[2]);
+  Spi::Transaction high = make_transaction(Spi::Priority::kHigh, &tx[3]);
+
+  CHECK(spi.Submit(first));
+  CHECK(spi.Submit(low));
+  CHECK(spi.Submit(medium));
+  CHECK(spi.Submit(high));
+  /* The bus was idle for the first one, the others wait */
+  CHECK(started.size() == 1U);
+  CHECK(first.status == Spi::Status::kActive);
+  CHECK(high.status == Spi::Status::kQueued);
+
+  complete(true);
+  complete(true);
+  complete(true);
+  complete(true);
+  CHECK(started.size() == 4U);
+  CHECK(started[1].tx == &tx[3]);
+  CHECK(started[2].tx == &tx[2]);
+  CHECK(started[3].tx == &tx[1]);
+  for (const Spi::Transaction* t : {&first, &low, &medium, &high}) {
+    CHECK(t->status == Spi::Status::kDone);
+  }
+  CHECK(notify_count == 4U);
+  CHECK(critical_nesting == 0);
+}
+
+TEST_CASE(chip_select_frames_the_transfer) {
+  reset_mocks();
+  const uint8_t tx = 0x42U;
+  Spi::Transaction transaction = make_transaction(Spi::Priority::kLow, &tx);
+  CHECK(spi.Submit(transaction));
+  CHECK(started.size() == 1U);
+  CHECK(started[0].cs_bsrr == kCsLow);
+  complete(true);
+  CHECK(gpio.BSRR == kCsHigh);
+}
+
+TEST_CASE(batch_keeps_the_bus) {
+  reset_mocks();
+  const std::array<uint8_t, 4> tx = {1U, 2U, 3U, 4U};
+  std::array<Spi::Transaction, 3> batch = {make_transaction(Spi::Priority::kLow, &tx[0]),
+                                           make_transaction(Spi::Priority::kLow, &tx[1]),
+                                           make_transaction(Spi::Priority::kLow, &tx[2])};
+  Spi::Transaction high = make_transaction(Spi::Priority::kHigh, &tx[3]);
+
+  CHECK(spi.SubmitBatch(batch.data(), batch.size()));
+  CHECK(spi.Submit(high));
+  complete(true);
+  /* The batch continues although a transaction with a higher priority is waiting, the thread is not woken yet */
+  CHECK(started.size() == 2U);
+  CHECK(started[1].tx == &tx[1]);
+  CHECK(notify_count == 0U);
+  complete(true);
+  complete(true);
+  CHECK(notify_count == 1U);
+  CHECK(started.size() == 4U);
+  CHECK(started[3].tx == &tx[3]);
+  complete(true);
+  CHECK(high.status == Spi::Status::kDone);
+}
+
+TEST_CASE(error_ends_the_batch) {
+  reset_mocks();
+  const std::array<uint8_t, 4> tx = {1U, 2U, 3U, 4U};
+  std::array<Spi::Transaction, 3> batch = {make_transaction(Spi::Priority::kMedium, &tx[0]),
+                                           make_transaction(Spi::Priority::kMedium, &tx[1]),
+                                           make_transaction(Spi::Priority::kMedium, &tx[2])};
+  Spi::Transaction other = make_transaction(Spi::Priority::kLow, &tx[3]);
+
+  CHECK(spi.SubmitBatch(batch.data(), batch.size()));
+  CHECK(spi.Submit(other));
+  complete(false);
+  for (const Spi::Transaction& t : batch) {
+    CHECK(t.status == Spi::Status::kError);
+  }
+  CHECK(notify_count == 1U);
+  CHECK(gpio.BSRR == kCsLow);  // the next transaction took over the bus
+  CHECK(started.size() == 2U);
+  CHECK(started[1].tx == &tx[3]);
+  complete(true);
+  CHECK(other.status == Spi::Status::kDone);
+}
+
+TEST_CASE(failed_start_releases_the_bus) {
+  reset_mocks();
+  const std::array<uint8_t, 2> tx = {1U, 2U};
+  Spi::Transaction failing = make_transaction(Spi::Priority::kLow, &tx[0]);
+  start_status = HAL_ERROR;
+  CHECK(spi.Submit(failing));
+  CHECK(failing.status == Spi::Status::kError);
+  CHECK(gpio.BSRR == kCsHigh);
+
+  start_status = HAL_OK;
+  Spi::Transaction next = make_transaction(Spi::Priority::kLow, &tx[1]);
+  CHECK(spi.Submit(next));
+  CHECK(next.status == Spi::Status::kActive);
+  complete(true);
+  CHECK(next.status == Spi::Status::kDone);
+}
+
+TEST_CASE(full_queue_rejects_the_transaction) {
+  reset_mocks();
+  const uint8_t tx = 0U;
+  Spi::Transaction active = make_transaction(Spi::Priority::kLow, &tx);
+  CHECK(spi.Submit(active));
+
+  /* The ring buffer keeps one slot free */
+  std::array<Spi::Transaction, 8> queued{};
+  for (size_t i = 0U; i < queued.size() - 1U; i++) {
+    queued[i] = make_transaction(Spi::Priority::kLow, &tx);
+    CHECK(spi.Submit(queued[i]));
+  }
+  queued.back() = make_transaction(Spi::Priority::kLow, &tx);
+  CHECK(!spi.Submit(queued.back()));
+  CHECK(queued.back().status == Spi::Status::kError);
+
+  for (size_t i = 0U; i < queued.size(); i++) {
+    complete(true);
+  }
+  CHECK(active.status == Spi::Status::kDone);
+  for (size_t i = 0U; i < queued.size() - 1U; i++) {
+    CHECK(queued[i].status == Spi::Status::kDone);
+  }
+}
+
+TEST_CASE(transmit_receive_waits_for_the_transfer) {
+  reset_mocks();
+  std::array<uint8_t, 3> tx = {0x80U, 0U, 0U};
+  std::array<uint8_t, 3> rx = {};
+  on_wait = [] {
+    /* The DMA clocked in the response */
+    started.back().rx[1] = 0xABU;
+    started.back().rx[2] = 0xCDU;
+    complete(true);
+  };
+  CHECK(spi.TransmitReceive(cs, tx.data(), rx.data(), tx.size(), Spi::Priority::kHigh));
+  CHECK(started.size() == 1U);
+  CHECK(started[0].length == 3U);
+  CHECK(rx[1] == 0xABU);
+  CHECK(rx[2] == 0xCDU);
+}
+
+TEST_CASE(timeout_aborts_the_active_transfer) {
+  reset_mocks();
+  const std::array<uint8_t, 2> tx = {1U, 2U};
+  Spi::Transaction stuck = make_transaction(Spi::Priority::kLow, &tx[0]);
+  Spi::Transaction next = make_transaction(Spi::Priority::kLow, &tx[1]);
+  CHECK(spi.Submit(stuck));
+  CHECK(spi.Submit(next));
+
+  /* The transfer never completes */
+  CHECK(!spi.Wait(stuck));
+  CHECK(stuck.status == Spi::Status::kError);
+  CHECK(abort_count == 1U);
+  CHECK(abort_nesting == 0);
+  CHECK(critical_nesting == 0);
+  /* The bus moved on to the next transaction */
+  CHECK(started.size() == 2U);
+  CHECK(next.status == Spi::Status::kActive);
+  complete(true);
+  CHECK(next.status == Spi::Status::kDone);
+}
+
+TEST_CASE(no_transfer_starts_during_an_abort) {
+  reset_mocks();
+  const std::array<uint8_t, 2> tx = {1U, 2U};
+  Spi::Transaction stuck = make_transaction(Spi::Priority::kLow, &tx[0]);
+  Spi::Transaction high = make_transaction(Spi::Priority::kHigh, &tx[1]);
+  CHECK(spi.Submit(stuck));
+
+  /* Another thread submits and the late DMA interrupt of the aborted transfer fires while the abort runs */
+  size_t started_during_abort = 0U;
+  on_abort = [&] {
+    CHECK(spi.Submit(high));
+    complete(true);
+    started_during_abort = started.size() - 1U;
+  };
+  CHECK(!spi.Wait(stuck));
+  CHECK(stuck.status == Spi::Status::kError);
+  CHECK(started_during_abort == 0U);
+  /* The queued transaction starts once the abort finished */
+  CHECK(started.size() == 2U);
+  CHECK(high.status == Spi::Status::kActive);
+  complete(true);
+  CHECK(high.status == Spi::Status::kDone);
+  CHECK(critical_nesting == 0);
+}
+
+TEST_CASE(timeout_removes_a_queued_batch) {
+  reset_mocks();
+  const std::array<uint8_t, 4> tx = {1U, 2U, 3U, 4U};
+  Spi::Transaction active = make_transaction(Spi::Priority::kLow, &tx[0]);
+  Spi::Transaction before = make_transaction(Spi::Priority::kLow, &tx[1]);
+  Spi::Transaction waiting = make_transaction(Spi::Priority::kLow, &tx[2]);
+  Spi::Transaction after = make_transaction(Spi::Priority::kLow, &tx[3]);
+  CHECK(spi.Submit(active));
+  CHECK(spi.Submit(before));
+  CHECK(spi.Submit(waiting));
+  CHECK(spi.Submit(after));
+
+  CHECK(!spi.Wait(waiting));
+  CHECK(waiting.status == Spi::Status::kError);
+  /* The active transfer is not touched and the remaining ones keep their order */
+  CHECK(abort_count == 0U);
+  complete(true);
+  complete(true);
+  complete(true);
+  CHECK(started.size() == 3U);
+  CHECK(started[1].tx == &tx[1]);
+  CHECK(started[2].tx == &tx[3]);
+  CHECK(after.status == Spi::Status::kDone);
+}